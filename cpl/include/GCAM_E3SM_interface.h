@@ -27,6 +27,15 @@
 #include "util/base/include/version.h"
 #include "../include/remap_data.h"
 
+class EmissDownscale;
+class CarbonScalers;
+struct ScalerTable;
+class SetDataHelper;
+class GetDataHelper;
+class AsyncWriter;
+class CouplingTimings;
+struct GridMapping;
+
 using namespace std;
 using namespace xercesc;
 
@@ -35,23 +44,26 @@ public:
     GCAM_E3SM_interface();
     ~GCAM_E3SM_interface();
     void initGCAM(std::string aCaseName, std::string aGCAMConfig, std::string aGCAM2ELMCO2Map, std::string aGCAM2ELMLUCMap, std::string aGCAM2ELMWHMap);
-    void runGCAM(int *yyyymmdd, double *gcamoluc, double *gcamoemiss);
+    void initGCAM(std::string aCaseName, std::string aGCAMConfig, std::string aGCAM2ELMCO2Map, std::string aGCAM2ELMLUCMap, std::string aGCAM2ELMWHMap,
+                  std::string aBaseCO2SfcFile, std::string aBaseCO2AirFile, std::string aGCAMBaseCO2EmisFile, std::string aMappingFile,
+                  int *aNumLon, int *aNumLat);
+    void initEmissionsDownscaling(std::string aBaseCO2SfcFile, std::string aBaseCO2AirFile, std::string aGCAMBaseCO2EmisFile, std::string aMappingFile,
+                                  int *aNumLon, int *aNumLat);
+    bool isEmissionsDownscalingInitialized() const;
+    void addGasEmissions(std::string aGas, std::string aSector, std::string aBaseGriddedFile, std::string aGCAMBaseEmisFile,
+                         int aNumLev, bool aNormalizeWeight);
+    void runGCAM(int *yyyymmdd, double *gcamoluc, double *gcamoemiss, const int aEmissLength);
+    int getCO2EmissionsLength() const;
+    int getGasEmissionsLength() const;
+    void getGasEmissions(double *aGasEmiss, const int aLength) const;
     void setDensityGCAM(int *yyyymmdd, double *aELMArea, double *aELMPFTFract, double *aELMNPP, double *aELMHR,
                         int *aNumLon, int *aNumLat, int *aNumPFT, std::string aMappingFile, int *aFirstCoupledYear, bool aReadScalars, bool aWriteScalars,
                         bool aScaleCarbon,  std::string aBaseNPPFileName, std::string aBaseHRFileName, std::string aBasePFTWtFileName);
     void downscaleEmissionsGCAM(double *gcamoemiss,
-                                double *gcamoco2sfcjan, double *gcamoco2sfcfeb, double *gcamoco2sfcmar, double *gcamoco2sfcapr,
-                                double *gcamoco2sfcmay, double *gcamoco2sfcjun, double *gcamoco2sfcjul, double *gcamoco2sfcaug,
-                                double *gcamoco2sfcsep, double *gcamoco2sfcoct, double *gcamoco2sfcnov, double *gcamoco2sfcdec,
-                                double *gcamoco2airlojan, double *gcamoco2airlofeb, double *gcamoco2airlomar, double *gcamoco2airloapr,
-                                double *gcamoco2airlomay, double *gcamoco2airlojun, double *gcamoco2airlojul, double *gcamoco2airloaug,
-                                double *gcamoco2airlosep, double *gcamoco2airlooct, double *gcamoco2airlonov, double *gcamoco2airlodec,
-                                double *gcamoco2airhijan, double *gcamoco2airhifeb, double *gcamoco2airhimar, double *gcamoco2airhiapr,
-                                double *gcamoco2airhimay, double *gcamoco2airhijun, double *gcamoco2airhijul, double *gcamoco2airhiaug,
-                                double *gcamoco2airhisep, double *gcamoco2airhioct, double *gcamoco2airhinov, double *gcamoco2airhidec,
-                                std::string aBaseCO2SfcFile, std::string aBaseCO2AirFile, std::string aGCAMBaseCO2EmisFile,
-                                std::string aMappingFile,
-                                int *aNumLon, int *aNumLat, bool aWriteCO2, int *aCurrYear);
+                                const std::vector<double*>& aSurfaceCO2Output,
+                                const std::vector<double*>& aAircraftCO2Output,
+                                bool aWriteCO2, int *aCurrYear);
+    void downscaleGasEmissionsGCAM(double *aGriddedEmiss, const int aLength, bool aWriteEmiss, int *aCurrYear);
     void finalizeGCAM();
     int gcamStartYear;
     int gcamEndYear;
@@ -63,5 +75,61 @@ public:
     
 private:
     std::auto_ptr<IScenarioRunner> runner;
+
+    // ELM grid to GCAM region mapping. This is read once in initEmissionsDownscaling and shared
+    // by the emissions downscaling and the carbon scalers.
+    std::shared_ptr<const GridMapping> mGridMapping;
+
+    // Emissions downscalers. These are set up once in initEmissionsDownscaling and reused every coupled year.
+    std::unique_ptr<EmissDownscale> mSurfaceCO2;
+    std::unique_ptr<EmissDownscale> mAircraftCO2;
+    // Index in the GCAM emissions of each value runGCAM copies to E3SM. E3SM reads the CO2
+    // surface and aircraft emissions of each region, in that order.
+    std::vector<size_t> mCO2EmissIndex;
+
+    // Downscaling of a gas and sector added by addGasEmissions
+    struct GasEmissions {
+        std::string mGas;
+        std::string mSector;
+        int mNumLev;
+        std::unique_ptr<EmissDownscale> mDownscaler;
+        // Index in the GCAM emissions of each region's emissions
+        std::vector<size_t> mGCAMIndex;
+    };
+    // Gases other than CO2 in the order they were added
+    std::vector<GasEmissions> mGases;
+    // Regional emissions of each added gas from the last runGCAM, one block of regions per gas
+    std::vector<double> mGasRegionEmiss;
+    int mNumLon;
+    int mNumLat;
+
+    // Carbon scalers and the table they are written to. These are set up in the first
+    // coupled year and reused after that.
+    std::unique_ptr<CarbonScalers> mCarbonScalers;
+    std::unique_ptr<ScalerTable> mScalers;
+    std::unique_ptr<SetDataHelper> mSetScalers;
+
+    // Queries for the CO2 emissions, land use, and wood harvest outputs. These are set up
+    // once in initGCAM and gather each year from values bound in the scenario.
+    std::unique_ptr<GetDataHelper> mGetCO2;
+    std::unique_ptr<GetDataHelper> mGetLUC;
+    std::unique_ptr<GetDataHelper> mGetWH;
+    // Whether the emissions mapping has a ghg column and so every gas in it is read. The
+    // GHGs of each new vintage are then added to the emissions query, see runGCAM.
+    bool mEmissAllGases;
+    // Last period the emissions query has the values of, -1 before it is first gathered
+    int mEmissBoundPeriod;
+
+    // Writes the time spent in each coupling phase and the coupling counters for each year
+    std::unique_ptr<CouplingTimings> mTimings;
+
+    // Writes the optional scaler and gridded emissions diagnostics in the background so
+    // the coupled run does not wait on the file system. Declared last so that it finishes
+    // any queued writes before the other members are destroyed.
+    std::unique_ptr<AsyncWriter> mWriter;
+
+    std::vector<size_t> getEmissionsIndex(const std::string& aGas, const std::string& aSector);
+    std::string getEmissionsPath(const int aVintage) const;
+    void checkGasEmissions(const int aYear);
     typedef std::vector<Region*>::iterator RegionIterator;
 };
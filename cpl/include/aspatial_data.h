@@ -49,16 +49,22 @@ public:
     virtual double readSpatialData(std::string aFileName, bool aHasLatLon, bool aHasID, bool aCalcTotal);
     virtual double readSpatialData(std::string aFileName, bool aHasLatLon, bool aHasID, bool aCalcTotal, double *aValueArray);
     virtual void writeSpatialData(std::string aFileName, bool aWriteID);
-    virtual void setValueVector(std::vector<double> aValueVector);
-    virtual std::vector<double> getValueVector();
-    virtual std::vector<int> getIDVector();
-    virtual std::vector<double> getLatVector();
-    virtual std::vector<double> getLonVector();
+    virtual void writeBinarySpatialData(std::string aFileName, bool aHasLatLon, bool aHasID);
+    static void writeBinaryValues(std::string aFileName, const std::vector<double>& aValues);
+    static bool isBinarySpatialData(std::string aFileName);
+    // Accessors return references to the stored data; copy explicitly if needed
+    virtual void setValueVector(std::vector<double>&& aValueVector);
+    virtual const std::vector<double>& getValueVector() const;
+    virtual const std::vector<int>& getIDVector() const;
+    virtual const std::vector<double>& getLatVector() const;
+    virtual const std::vector<double>& getLonVector() const;
 private:
     std::vector<double> mValueVector;
     std::vector<double> mLatVector;
     std::vector<double> mLonVector;
     std::vector<int> mIDVector;
+
+    double readBinarySpatialData(std::string aFileName, bool aHasLatLon, bool aHasID, double *aValueArray);
 };
 
 #endif // __ASPATIAL_DATA__
@@ -0,0 +1,75 @@
+#ifndef __ASYNC_WRITER_H__
+#define __ASYNC_WRITER_H__
+
+/*
+ * LEGAL NOTICE
+ * This computer software was prepared by Battelle Memorial Institute,
+ * hereinafter the Contractor, under Contract No. DE-AC05-76RL0 1830
+ * with the Department of Energy (DOE). NEITHER THE GOVERNMENT NOR THE
+ * CONTRACTOR MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR ASSUMES ANY
+ * LIABILITY FOR THE USE OF THIS SOFTWARE. This notice including this
+ * sentence must appear on any copies of this computer software.
+ *
+ * EXPORT CONTROL
+ * User agrees that the Software will not be shipped, transferred or
+ * exported into any country or used in any manner prohibited by the
+ * United States Export Administration Act or any other applicable
+ * export laws, restrictions or regulations (collectively the "Export Laws").
+ * Export of the Software may require some form of license or other
+ * authority from the U.S. Government, and failure to obtain such
+ * export control license may result in criminal liability under
+ * U.S. laws. In addition, if the Software is identified as export controlled
+ * items under the Export Laws, User represents and warrants that User
+ * is not a citizen, or otherwise located within, an embargoed nation
+ * (including without limitation Iran, Syria, Sudan, Cuba, and North Korea)
+ *     and that User is not otherwise prohibited
+ * under the Export Laws from receiving the Software.
+ *
+ * Copyright 2011 Battelle Memorial Institute.  All Rights Reserved.
+ * Distributed as open-source under the terms of the Educational Community
+ * License version 2.0 (ECL 2.0). http://www.opensource.org/licenses/ecl2.php
+ *
+ * For further details, see: http://www.globalchange.umd.edu/models/gcam/
+ *
+ */
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+/*!
+ * \brief Writes diagnostic output on a background thread.
+ * \details Each write is a function which formats and writes a file from data it owns,
+ *          so the caller can reuse its buffers as soon as write returns. Writes are
+ *          done one at a time in the order they were queued. The destructor waits for
+ *          all queued writes to finish.
+ */
+class AsyncWriter {
+public:
+    AsyncWriter();
+    ~AsyncWriter();
+    void write(std::function<void()> aWrite);
+    void wait();
+
+    // Helpers to format and write files in large blocks
+    static void writeText(const std::string& aFileName, const std::string& aText);
+    static void writeScientific(const std::string& aFileName, const std::vector<double>& aValues);
+private:
+    std::deque<std::function<void()> > mQueue;
+    std::mutex mMutex;
+    // Signals the writer thread that a write was queued or it should stop
+    std::condition_variable mQueued;
+    // Signals wait that the queue is empty
+    std::condition_variable mIdle;
+    bool mIsWriting;
+    bool mStop;
+    std::thread mThread;
+
+    void run();
+};
+
+#endif // __ASYNC_WRITER_H__
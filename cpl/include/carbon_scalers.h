@@ -39,25 +39,46 @@
 #include <string>
 #include <memory>
 #include <list>
+#include <map>
 #include <vector>
 
 #include "../include/aspatial_data.h"
+#include "../include/grid_mapping.h"
+
+class AsyncWriter;
+
+// Carbon scalers for one GCAM year, one row per GCAM region and land technology. Regions and
+// land technologies are stored as ids into mRegionNames and mLandTechNames. The names are shared
+// by every year computed from the same mapping, so no strings are built per row. Land technology
+// names are "crop_basin" and match any technology name that starts with them.
+struct ScalerTable {
+    std::shared_ptr<const std::vector<std::string>> mRegionNames;
+    std::shared_ptr<const std::vector<std::string>> mLandTechNames;
+
+    std::vector<int> mYear;
+    std::vector<int> mRegion;
+    std::vector<int> mLandTech;
+    std::vector<double> mAboveScaler;
+    std::vector<double> mBelowScaler;
+
+    size_t size() const { return mYear.size(); }
+};
 
 class CarbonScalers : public ASpatialData {
 public:
     CarbonScalers(int aNumLat, int aNumLon, int aNumPFT);
     ~CarbonScalers();
-    void readScalers(std::vector<int>& aYears, std::vector<std::string>& aRegions, std::vector<std::string>& aLandTechs,
-                      std::vector<double>& aAboveScalers, std::vector<double>& aBelowScalers);
+    void readScalers(ScalerTable& aScalers);
     void calcScalers(int aGCAMYear, double *aELMArea, double *aELMPFTFract, double *aELMNPP, double *aELMHR,
-                     std::vector<int>& aYears, std::vector<std::string>& aRegions, std::vector<std::string>& aLandTechs, std::vector<double>& aAboveScalers, std::vector<double>& aBelowScalers, std::string aBaseNPPFileName, std::string aBaseHRFileName, std::string aBasePFTWtFileName);
-    void createScalerVectors(int aGCAMYear, std::vector<int>& aYears, std::vector<std::string>& aRegions, std::vector<std::string>& aLandTechs,
-                                            std::vector<double>& aAboveScalers, std::vector<double>& aBelowScalers,
-                                            std::map<std::pair<std::string,std::string>, double> aAboveScalarMap,
-                                            std::map<std::pair<std::string,std::string>, double> aBelowScalarMap);
-    void writeScalers(std::string aFileName, std::vector<int>& aYears, std::vector<std::string>& aRegions, std::vector<std::string>& aLandTechs, std::vector<double>& aAboveScalers, std::vector<double>& aBelowScalers, int aLength);
+                     ScalerTable& aScalers, std::string aBaseNPPFileName, std::string aBaseHRFileName, std::string aBasePFTWtFileName);
+    void createScalerTable(int aGCAMYear, ScalerTable& aScalers,
+                           const std::vector<double>& aAboveScalarTable,
+                           const std::vector<double>& aBelowScalarTable);
+    void writeScalers(std::string aFileName, const ScalerTable& aScalers);
+    void writeScalers(AsyncWriter& aWriter, std::string aFileName, const ScalerTable& aScalers);
     void readBaseYearData(std::string aBaseNPPFileName, std::string aBaseHRFileName, std::string aBasePFTWtFileName);
     void readRegionalMappingData(std::string aFileName);
+    void readRegionalMappingData(const GridMapping& aGridMapping);
     void excludeOutliers(double *aELMNPP, double *aELMHR);
 private:
     // Data for calculating the scalar baseline
@@ -70,16 +91,39 @@ private:
     int mNumLon;
     int mNumPFT;
     
-    // Map grid cells to regions. Key is a string with longitude and latitude ("lon_lat").
-    // Key maps to a vector of strings containing the region and subregion
-    // Note that this map will be longer than lat * lon since some grid cells map to multiple regions
-    std::map<std::string, std::vector<std::string>> mRegionMapping;
-    
-    // Map region weights (these indicate the fraction of a grid cell assigned to each region)
-    // Key is a pair indicating the grid cell and the region/subregion
-    // Key maps to a double representing the fraction of the grid cell in that region/subregion
-    std::map<std::pair<std::string,std::string>, double> mRegionWeights;
-    
+    // Crops from mPFT2GCAMCropMap, interned to dense ids in sorted order. mPFTCrops holds the
+    // crop ids for each PFT, including repeated crops, so each entry gets the same share as before.
+    std::vector<std::string> mCropNames;
+    std::vector<std::vector<int>> mPFTCrops;
+
+    // Region/subregion ("region.basin") keys from the mapping file are interned to dense ids in
+    // sorted order. The entries for region/subregion id r are stored in
+    // [mRegionStart[r], mRegionStart[r+1]) of mRegionCell/mRegionWeight, in grid order.
+    // Grid index is ( lat * mNumLon + lon ) and weight is the fraction of the cell in the region.
+    std::vector<int> mRegionStart;
+    std::vector<int> mRegionCell;
+    std::vector<double> mRegionWeight;
+
+    // Keys ( region/subregion id * mCropNames.size() + crop id ) that receive data, in output order,
+    // with the GCAM region and land technology of each key as ids into mRegionNames/mLandTechNames
+    std::vector<int> mScalerKeys;
+    std::vector<int> mScalerRegion;
+    std::vector<int> mScalerLandTech;
+    std::shared_ptr<const std::vector<std::string>> mRegionNames;
+    std::shared_ptr<const std::vector<std::string>> mLandTechNames;
+
+    // Per key accumulators for calcScalers, reused across calls
+    std::vector<double> mTotalArea;
+    std::vector<double> mBaseTotalArea;
+    std::vector<double> mTotalNPP;
+    std::vector<double> mBaseTotalNPP;
+    std::vector<double> mTotalHR;
+    std::vector<double> mBaseTotalHR;
+
+    // Scratch space for the NPP and HR ratios in excludeOutliers, reused across calls
+    std::vector<double> mNPPRatios;
+    std::vector<double> mHRRatios;
+
     //! Map PFTs to GCAM crops
     std::map<int, std::vector<std::string>> mPFT2GCAMCropMap {
      { 0, { "RockIceDesert", "UrbanLand" } }, // 0. BPFT, Bare ground/not vegetated
@@ -100,6 +144,8 @@ private:
      { 15, { "Rice","Wheat", "MiscCrop", "OtherGrain", "OilCrop", "FiberCrop", "FodderHerb", "RootTuber", "OtherArableLand", "OtherArableLand" } }, // 15. CPFT, Cropland
      { 16, {  } } // 16. NA
     };
+
+    static void writeScalerFile(const std::string& aFileName, const ScalerTable& aScalers);
 };
 
 #endif // __CARBON_SCALERS__
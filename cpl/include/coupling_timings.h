@@ -0,0 +1,62 @@
+#ifndef __COUPLING_TIMINGS_H__
+#define __COUPLING_TIMINGS_H__
+
+/*
+ * LEGAL NOTICE
+ * This computer software was prepared by Battelle Memorial Institute,
+ * hereinafter the Contractor, under Contract No. DE-AC05-76RL0 1830
+ * with the Department of Energy (DOE). NEITHER THE GOVERNMENT NOR THE
+ * CONTRACTOR MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR ASSUMES ANY
+ * LIABILITY FOR THE USE OF THIS SOFTWARE. This notice including this
+ * sentence must appear on any copies of this computer software.
+ *
+ * EXPORT CONTROL
+ * User agrees that the Software will not be shipped, transferred or
+ * exported into any country or used in any manner prohibited by the
+ * United States Export Administration Act or any other applicable
+ * export laws, restrictions or regulations (collectively the "Export Laws").
+ * Export of the Software may require some form of license or other
+ * authority from the U.S. Government, and failure to obtain such
+ * export control license may result in criminal liability under
+ * U.S. laws. In addition, if the Software is identified as export controlled
+ * items under the Export Laws, User represents and warrants that User
+ * is not a citizen, or otherwise located within, an embargoed nation
+ * (including without limitation Iran, Syria, Sudan, Cuba, and North Korea)
+ *     and that User is not otherwise prohibited
+ * under the Export Laws from receiving the Software.
+ *
+ * Copyright 2011 Battelle Memorial Institute.  All Rights Reserved.
+ * Distributed as open-source under the terms of the Educational Community
+ * License version 2.0 (ECL 2.0). http://www.opensource.org/licenses/ecl2.php
+ *
+ * For further details, see: http://www.globalchange.umd.edu/models/gcam/
+ *
+ */
+
+#include <string>
+#include <map>
+
+/*!
+ * \brief Writes the coupling timers and counters for each coupled year.
+ * \details The timers and counters are kept in the TimerRegistry. Each row written is
+ *          what was added to them since the last row, so the phases of one coupled
+ *          year can be compared directly. Rows are appended to aFileName.csv with the
+ *          columns year,type,name,value and to aFileName.json as one JSON object per
+ *          line. Anything recorded before the first year is set, such as initialization,
+ *          is written as year 0.
+ */
+class CouplingTimings {
+public:
+    CouplingTimings(const std::string& aFileName);
+    void setYear(int aYear);
+    void write();
+private:
+    std::string mFileName;
+    // Year of the row being recorded
+    int mYear;
+    // Totals when the last row was written
+    std::map<std::string, double> mLastTimes;
+    std::map<std::string, double> mLastCounters;
+};
+
+#endif // __COUPLING_TIMINGS_H__
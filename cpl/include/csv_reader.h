@@ -0,0 +1,72 @@
+#ifndef __CSV_READER_H__
+#define __CSV_READER_H__
+
+/*
+ * LEGAL NOTICE
+ * This computer software was prepared by Battelle Memorial Institute,
+ * hereinafter the Contractor, under Contract No. DE-AC05-76RL0 1830
+ * with the Department of Energy (DOE). NEITHER THE GOVERNMENT NOR THE
+ * CONTRACTOR MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR ASSUMES ANY
+ * LIABILITY FOR THE USE OF THIS SOFTWARE. This notice including this
+ * sentence must appear on any copies of this computer software.
+ *
+ * EXPORT CONTROL
+ * User agrees that the Software will not be shipped, transferred or
+ * exported into any country or used in any manner prohibited by the
+ * United States Export Administration Act or any other applicable
+ * export laws, restrictions or regulations (collectively the "Export Laws").
+ * Export of the Software may require some form of license or other
+ * authority from the U.S. Government, and failure to obtain such
+ * export control license may result in criminal liability under
+ * U.S. laws. In addition, if the Software is identified as export controlled
+ * items under the Export Laws, User represents and warrants that User
+ * is not a citizen, or otherwise located within, an embargoed nation
+ * (including without limitation Iran, Syria, Sudan, Cuba, and North Korea)
+ *     and that User is not otherwise prohibited
+ * under the Export Laws from receiving the Software.
+ *
+ * Copyright 2011 Battelle Memorial Institute.  All Rights Reserved.
+ * Distributed as open-source under the terms of the Educational Community
+ * License version 2.0 (ECL 2.0). http://www.opensource.org/licenses/ecl2.php
+ *
+ * For further details, see: http://www.globalchange.umd.edu/models/gcam/
+ *
+ */
+
+#include <string>
+#include <vector>
+
+/*!
+ * \brief Reads a delimited text file one row at a time.
+ * \details The whole file is read into memory once and each row is split in place,
+ *          so reading a row and its numbers does not allocate. Surrounding quotes are
+ *          removed from each field. Errors are logged to the coupling log with the
+ *          file name, line, and column, and then the program exits.
+ */
+class CSVReader {
+public:
+    CSVReader(const std::string& aFileName, char aDelimiter = ',');
+    bool nextRow();
+    size_t getNumFields() const;
+    int getLineNumber() const;
+    const char* getField(size_t aField) const;
+    std::string getString(size_t aField) const;
+    void getString(size_t aField, std::string& aValue) const;
+    int getInt(size_t aField) const;
+    double getDouble(size_t aField) const;
+    bool getBool(size_t aField) const;
+    void error(size_t aField, const std::string& aMessage) const;
+private:
+    std::string mFileName;
+    char mDelimiter;
+    // Contents of the file, with each field of the current row null terminated
+    std::vector<char> mBuffer;
+    // Position of the next row in mBuffer
+    size_t mNextRow;
+    int mLineNumber;
+    // Start and end of each field of the current row
+    std::vector<const char*> mFieldStart;
+    std::vector<const char*> mFieldEnd;
+};
+
+#endif // __CSV_READER_H__
@@ -39,133 +39,82 @@
 #include <string>
 #include <memory>
 #include <list>
+#include <map>
 #include <vector>
 
 #include "../include/aspatial_data.h"
+#include "../include/grid_mapping.h"
 
+class AsyncWriter;
+
+// Grid to region mapping compiled into a sparse (CSR) operator. Only land grid cells are
+// stored; ocean cells are not in the mapping and are never visited by the downscaling loops.
+// mLandCells holds the grid index ( lat * numLon + lon ) of each land cell and the entries for
+// land cell i are stored in [mCellStart[i], mCellStart[i+1]) of mCellRegion/mCellWeight.
+struct RegionalMapping {
+    std::vector<int> mLandCells;
+    std::vector<int> mCellStart;
+
+    // Region index (position in mRegionNames) for each entry
+    std::vector<int> mCellRegion;
+
+    // Weight (fraction of the grid cell in that region) for each entry
+    std::vector<double> mCellWeight;
+
+    // Region names with spaces removed as they are written in the mapping and base year files
+    std::vector<std::string> mRegionNames;
+};
+
+// Downscales the regional emissions of one gas and sector to the grid by scaling the
+// gridded base year emissions with the ratio of current to base year regional emissions.
+// Any number of gases and sectors sharing a mapping can be downscaled together in one pass.
 class EmissDownscale : public ASpatialData
 {
 public:
-    EmissDownscale(int aNumLon, int aNumLat, int aNumMon, int aNumLev);
+    EmissDownscale(int aNumLon, int aNumLat, int aNumMon, int aNumLev, bool aNormalizeWeight);
     ~EmissDownscale();
-    // TODO: Eventually these will need to be vectors of regional emissions instead of global totals
-    void downscaleSurfaceCO2Emissions(double *aCurrYearEmissions);
-    void downscaleAircraftCO2Emissions(double *aCurrYearEmissions);
-    void separateMonthlyEmissions(double *gcamoco2sfcjan, double *gcamoco2sfcfeb, double *gcamoco2sfcmar,
-                                  double *gcamoco2sfcapr, double *gcamoco2sfcmay, double *gcamoco2sfcjun,
-                                  double *gcamoco2sfcjul, double *gcamoco2sfcaug, double *gcamoco2sfcsep,
-                                  double *gcamoco2sfcoct, double *gcamoco2sfcnov, double *gcamoco2sfcdec,
-                                  int aNumLon, int aNumLat);
-    void separateMonthlyEmissionsWithVertical(double *gcamoco2airlojan, double *gcamoco2airlofeb, double *gcamoco2airlomar,
-                                              double *gcamoco2airloapr, double *gcamoco2airlomay, double *gcamoco2airlojun,
-                                              double *gcamoco2airlojul, double *gcamoco2airloaug, double *gcamoco2airlosep,
-                                              double *gcamoco2airlooct, double *gcamoco2airlonov, double *gcamoco2airlodec,
-                                              double *gcamoco2airhijan, double *gcamoco2airhifeb, double *gcamoco2airhimar,
-                                              double *gcamoco2airhiapr, double *gcamoco2airhimay, double *gcamoco2airhijun,
-                                              double *gcamoco2airhijul, double *gcamoco2airhiaug, double *gcamoco2airhisep,
-                                              double *gcamoco2airhioct, double *gcamoco2airhinov, double *gcamoco2airhidec,
-                                              int aNumLon, int aNumLat);
-    void readRegionalMappingData(std::string aFileName);
-    void readRegionalBaseYearEmissionData(std::string aFileName);
-    double aBaseYearEmissions_sfc[32];
-    double aBaseYearEmissions_air[32];
+    // aOutput holds one pointer per ( month, level ) plane of mNumLon * mNumLat values, indexed as
+    // [ lev * mNumMon + mon ]. These can point directly into E3SM's arrays or into one contiguous buffer.
+    void downscaleEmissions(const double *aCurrYearEmissions, const std::vector<double*>& aOutput);
+    static void downscaleEmissions(const std::vector<EmissDownscale*>& aDownscalers, const double *aCurrYearEmissions,
+                                   const std::vector<std::vector<double*> >& aOutputs);
+    void writeGriddedEmissions(std::string aFileName, const std::vector<double*>& aOutput);
+    void writeGriddedEmissions(AsyncWriter& aWriter, std::string aFileName, const std::vector<double*>& aOutput);
+    void readRegionalMappingData(std::string aFileName, const std::vector<std::string>& aRegionNames);
+    void readRegionalMappingData(const GridMapping& aGridMapping, const std::vector<std::string>& aRegionNames);
+    void setRegionalMapping(std::shared_ptr<const RegionalMapping> aMapping);
+    std::shared_ptr<const RegionalMapping> getRegionalMapping() const;
+    void readRegionalBaseYearEmissionData(std::string aFileName, const std::string& aSector);
+    void readGriddedBaseYearEmissionData(std::string aFileName);
+    void setRegionalEmissionsIndex(const std::vector<size_t>& aRegionEmissIndex);
+    const std::vector<size_t>& getRegionalEmissionsIndex() const;
+    const std::vector<double>& getRegionalBaseYearEmissions() const;
 
 private:
-    std::vector<double> mBaseYearEmissVector;
-    std::vector<double> mCurrYearEmissVector;
-
     // Number of latitude, longitude, and PFTs. Storing this so it doesn't have to be passed to every method
     int mNumLat;
     int mNumLon;
     int mNumMon;
     int mNumLev;
 
+    // Whether the scalar of a grid cell is normalized by the total weight of its regions
+    bool mNormalizeWeight;
+
+    // Compiled grid to region mapping. This is shared between all of the downscalers.
+    std::shared_ptr<const RegionalMapping> mMapping;
+
+    // Base year emissions for each region in the mapping
+    std::vector<double> mBaseYearRegionEmiss;
+
+    // Index of the current year emissions of each region in the GCAM emissions
+    std::vector<size_t> mRegionEmissIndex;
+
+    // Ratio of current to base year emissions for each grid cell, ocean cells are one
+    std::vector<double> mCellScaler;
 
-    
-    //double aBaseYearEmissions_R[32] = {9663.0297,9663.0297,9663.0297,9663.0297,9663.0297,9663.0297,
-    //                                   9663.0297,9663.0297,9663.0297,9663.0297,9663.0297,9663.0297,
-    //                                   9663.0297,9663.0297,9663.0297,9663.0297,9663.0297,9663.0297,
-    //                                   9663.0297,9663.0297,9663.0297,9663.0297,9663.0297,9663.0297,
-    //                                   9663.0297,9663.0297,9663.0297,9663.0297,9663.0297,9663.0297,
-    //                                   9663.0297,9663.0297};
-
-    // Map grid cells to regions. Key is a string with longitude and latitude ("lon_lat").
-    // Key maps to a vector of strings containing the region
-    // Note that this map will be longer than lat * lon since some grid cells map to multiple regions
-    std::map<std::string, std::vector<std::string>> mRegionMapping;
-
-    // Map region weights (these indicate the fraction of a grid cell assigned to each region)
-    // Key is a pair indicating the grid cell and the region/subregion
-    // Key maps to a double representing the fraction of the grid cell in that region/subregion
-    std::map<std::pair<std::string,std::string>, double> mRegionWeights;
-
-    //! Map Region -> ID
-     /*  {"Africa_Eastern", 1},
-        {"Africa_Northern", 2},
-        {"Africa_Southern", 3},
-        {"Africa_Western", 4},
-        {"Argentina", 5},
-        {"Australia_NZ", 6},
-        {"Brazil", 7},
-        {"Canada", 8},
-        {"CentralAmericaandCaribbean", 9},
-        {"CentralAsia", 10},
-        {"China", 11},
-        {"Colombia", 12},
-        {"EU-12", 13},
-        {"EU-15", 14},
-        {"Europe_Eastern", 15},
-        {"Europe_Non_EU", 16},
-        {"EuropeanFreeTradeAssociation", 17},
-        {"India", 18},
-        {"Indonesia", 19},
-        {"Japan", 20},
-        {"Mexico", 21},
-        {"MiddleEast", 22},
-        {"Pakistan", 23},
-        {"Russia", 24},
-        {"SouthAfrica", 25},
-        {"SouthAmerica_Northern", 26},
-        {"SouthAmerica_Southern", 27},
-        {"SouthAsia", 28},
-        {"SoutheastAsia", 29},
-        {"SouthKorea", 30},
-        {"Taiwan", 31},
-        {"USA", 32}*/ 
-    std::map<std::string, int> mRegionIDName{
-        {"USA", 1},
-        {"Africa_Eastern", 2},
-        {"Africa_Northern", 3},
-        {"Africa_Southern", 4},
-        {"Africa_Western", 5},
-        {"Australia_NZ", 6},
-        {"Brazil", 7},
-        {"Canada", 8},
-        {"CentralAmericaandCaribbean", 9},
-        {"CentralAsia", 10},
-        {"China", 11},
-        {"EU-12", 12},
-        {"EU-15", 13},
-        {"Europe_Eastern", 14},
-        {"Europe_Non_EU", 15},
-        {"EuropeanFreeTradeAssociation", 16},
-        {"India", 17},
-        {"Indonesia", 18},
-        {"Japan", 19},
-        {"Mexico", 20},
-        {"MiddleEast", 21},
-        {"Pakistan", 22},
-        {"Russia", 23},
-        {"SouthAfrica", 24},
-        {"SouthAmerica_Northern", 25},
-        {"SouthAmerica_Southern", 26},
-        {"SouthAsia", 27},
-        {"SouthKorea", 28},
-        {"SoutheastAsia", 29}, 
-        {"Taiwan", 30},
-        {"Argentina", 31},
-        {"Colombia", 32}
-    };
+    void scalePlane(int aPlane, double *aOutput) const;
+    std::vector<double> copyPlanes(const std::vector<double*>& aOutput) const;
+    static void writeGriddedValues(const std::string& aFileName, const std::vector<double>& aValues);
 };
 
 #endif // __EMISS_DOWNSCALE__
@@ -35,24 +35,48 @@
 
 #include <vector>
 #include <string>
+#include <unordered_map>
 
 class Scenario;
 class FilterStep;
 class AMatcherWrapper;
 class ReMapData;
+class Value;
 
+/*!
+ * \brief Gets data from the model and aggregates it into a ReMapData.
+ * \details run traverses the scenario and adds every value the path finds. gather
+ *          instead binds the path once, keeping a pointer to each value found and the
+ *          index it is added to, and then only adds the bound values for the requested
+ *          year. Binding is redone if the scenario changes, and appendBindings adds the
+ *          values of objects created since. To gather any year the path should read the
+ *          year without fixing it, i.e. [+YearFilter,MatchesAny].
+ */
 class GetDataHelper {
 public:
   GetDataHelper(const std::string& aHeader, ReMapData& aDataMapper)
-      :mDataMapper(aDataMapper)
+      :mDataMapper(aDataMapper),
+       mIsBinding(false),
+       mScenario(0)
   {
     parseFilterString(aHeader);
   }
   ~GetDataHelper();
   void run(Scenario* aScenario);
+  void gather(Scenario* aScenario, const int aYear);
+  void appendBindings(Scenario* aScenario, GetDataHelper& aNewValues);
   template<typename T>
   void processData(T& aData);
 private:
+  // A value found while binding and the index in the ReMapData it is added to. Indices
+  // past the end of the data are offsets into mUnmappedColValues.
+  struct Binding {
+    const Value* mValue;
+    const double* mDouble;
+    const int* mInt;
+    size_t mIndex;
+  };
+
   double mCurrDataValue;
   int mCurrYearValue;
   std::vector<std::string> mCurrColValues;
@@ -61,6 +85,19 @@ private:
   std::vector<FilterStep*> mFilterSteps;
   ReMapData& mDataMapper;
 
+  // Set while traversing in bind so processData records instead of adding
+  bool mIsBinding;
+  // Scenario the bindings were made in
+  Scenario* mScenario;
+  // Bindings for each year in traversal order
+  std::unordered_map<int, std::vector<Binding> > mBindings;
+  // Column values of bindings not in the mapping, kept for the error if they are ever non-zero
+  std::vector<std::vector<std::string> > mUnmappedColValues;
+
+  void bind(Scenario* aScenario);
+  static const void* getBoundValue(const Binding& aBinding);
+  void addData(const Value* aValue, const double* aDouble, const int* aInt, const double aData);
+
   void parseFilterString(const std::string& aFilterStr );
   FilterStep* parseFilterStepStr( const std::string& aFilterStepStr, int& aCol );
   template<typename VecType>
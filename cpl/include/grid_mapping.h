@@ -0,0 +1,62 @@
+#ifndef __GRID_MAPPING_H__
+#define __GRID_MAPPING_H__
+
+/*
+ * LEGAL NOTICE
+ * This computer software was prepared by Battelle Memorial Institute,
+ * hereinafter the Contractor, under Contract No. DE-AC05-76RL0 1830
+ * with the Department of Energy (DOE). NEITHER THE GOVERNMENT NOR THE
+ * CONTRACTOR MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR ASSUMES ANY
+ * LIABILITY FOR THE USE OF THIS SOFTWARE. This notice including this
+ * sentence must appear on any copies of this computer software.
+ *
+ * EXPORT CONTROL
+ * User agrees that the Software will not be shipped, transferred or
+ * exported into any country or used in any manner prohibited by the
+ * United States Export Administration Act or any other applicable
+ * export laws, restrictions or regulations (collectively the "Export Laws").
+ * Export of the Software may require some form of license or other
+ * authority from the U.S. Government, and failure to obtain such
+ * export control license may result in criminal liability under
+ * U.S. laws. In addition, if the Software is identified as export controlled
+ * items under the Export Laws, User represents and warrants that User
+ * is not a citizen, or otherwise located within, an embargoed nation
+ * (including without limitation Iran, Syria, Sudan, Cuba, and North Korea)
+ *     and that User is not otherwise prohibited
+ * under the Export Laws from receiving the Software.
+ *
+ * Copyright 2011 Battelle Memorial Institute.  All Rights Reserved.
+ * Distributed as open-source under the terms of the Educational Community
+ * License version 2.0 (ECL 2.0). http://www.opensource.org/licenses/ecl2.php
+ *
+ * For further details, see: http://www.globalchange.umd.edu/models/gcam/
+ *
+ */
+
+#include <string>
+#include <vector>
+#include <memory>
+
+// The ELM grid to GCAM region and subregion (GLU) mapping, as read from the mapping file. This is
+// read once and shared by the carbon scalers and the emissions downscaling, which each compile it
+// into the form they need. Rows are in file order. Longitude and latitude are the 1-based grid
+// indices in the file, so rows outside of a grid can be skipped by whoever uses the mapping.
+struct GridMapping {
+    std::string mFileName;
+
+    std::vector<int> mLon;
+    std::vector<int> mLat;
+    // Index of the region (position in mRegionNames) and subregion (position in mSubregionNames)
+    std::vector<int> mRegion;
+    std::vector<int> mSubregion;
+    // Fraction of the grid cell in that region and subregion
+    std::vector<double> mWeight;
+
+    // Names in the order they are first read
+    std::vector<std::string> mRegionNames;
+    std::vector<std::string> mSubregionNames;
+
+    static std::shared_ptr<const GridMapping> readGridMapping(const std::string& aFileName);
+};
+
+#endif // __GRID_MAPPING_H__
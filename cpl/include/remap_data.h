@@ -36,7 +36,7 @@
 #include <string>
 #include <vector>
 #include <map>
-#include <map>
+#include <unordered_map>
 #include <iostream>
 
 #include <xercesc/dom/DOMNode.hpp>
@@ -50,9 +50,13 @@ public:
     std::string mDataName;
     std::vector<T> mInOrderOutputNames;
     std::map<T, T> mGCAMToOutputNameMap;
+    // GCAM name to index with renames applied, built by buildIndexMap
+    std::unordered_map<T, size_t> mIndexMap;
     size_t getIndex(const T& aGCAMName) const;
+    size_t findIndex(const T& aGCAMName) const;
     size_t getStrideLength() const;
     std::string getName() const;
+    void buildIndexMap();
     bool XMLParse(const xercesc::DOMNode* aNode);
 };
 
@@ -64,9 +68,13 @@ public:
     void addYearColumn(std::string aDataName, std::vector<int> aInOrderOutputNames, std::map<int, int> aGCAMToOutputNameMap);
     void finalizeColumns();
     void setData(std::vector<std::string>& aColValues, const int aYearValue, const double aValue);
+    size_t findIndex(const std::vector<std::string>& aColValues, const int aYearValue);
     double* getData();
     bool XMLParse(const xercesc::DOMNode* aNode);
     size_t getArrayLength() const;
+    std::vector<std::string> getColumnNames() const;
+    const std::vector<std::string>& getColumnOutputNames(const std::string& aColumnName) const;
+    std::vector<std::string> getColumnGCAMNames(const std::string& aColumnName) const;
     std::ostream& printAsTable(std::ostream& aOut) const;
 private:
     bool mIsInitialized;
@@ -74,6 +82,11 @@ private:
     std::vector<ReMapDataHelper<std::string> > mColumns;
     ReMapDataHelper<int> mYearColumn;
     double* mData;
+    // Index for each combination of column values and year already looked up
+    std::unordered_map<std::string, size_t> mIndexCache;
+    std::string mCacheKey;
+
+    void decomposeLandNames(std::vector<std::string>& aColValues) const;
 };
 
 std::ostream& operator<<(std::ostream& aOut, const ReMapData& aData);
@@ -35,34 +35,61 @@
 
 #include <vector>
 #include <string>
+#include <set>
+#include <unordered_map>
 
 class Scenario;
 class FilterStep;
+class Value;
 
+/*!
+ * \brief Sets data in the model from columns of region, land technology, year, and value.
+ * \details The scenario is traversed once to find every value the path can set, and those are
+ *          cached by region and year, sorted by technology name. Each run then sets all rows
+ *          from the cache without traversing the model again. A row sets every technology whose
+ *          name starts with the row's land technology. Rows are applied in order, so if more
+ *          than one row sets the same value the last one is kept.
+ */
 class SetDataHelper {
 public:
-    SetDataHelper(const std::vector<int>& aYearColumn, const std::vector<std::string>& aRegionColumn,
-                  const std::vector<std::string>& aLandTechColumn,
-                  const std::vector<double>& aDataVector, const std::string& aHeader):
-    mYearColumn(aYearColumn),
-    mRegionColumn(aRegionColumn),
-    mLandTechColumn(aLandTechColumn),
-    mDataVector(aDataVector),
+    SetDataHelper(const std::string& aHeader):
+    mScenario(0),
     mFilterSteps(parseFilterString(aHeader))
     {
     }
     ~SetDataHelper();
-    void run( Scenario* aScenario );
+    // The region and land technology columns are ids into aRegionNames and aLandTechNames
+    void run( Scenario* aScenario, const std::vector<int>& aYearColumn,
+              const std::vector<int>& aRegionColumn, const std::vector<std::string>& aRegionNames,
+              const std::vector<int>& aLandTechColumn, const std::vector<std::string>& aLandTechNames,
+              const std::vector<double>& aDataVector );
     template<typename T>
     void processData(T& aData);
 private:
-    const std::vector<int>& mYearColumn;
-    const std::vector<std::string>& mRegionColumn;
-    const std::vector<std::string>& mLandTechColumn;
-    const std::vector<double>& mDataVector;
+    // A value that can be set, found while traversing the scenario
+    struct Target {
+        const std::string* mLandTech;
+        Value* mValue;
+        double* mDouble;
+        int* mInt;
+    };
+
+    // Scenario the targets were found in
+    Scenario* mScenario;
+
+    // Region and technology names and year of the current path while traversing
+    std::string mCurrRegion;
+    std::string mCurrLandTech;
+    int mCurrYear;
+
+    // Targets for each region and year, sorted by technology name
+    std::unordered_map<std::string, std::unordered_map<int, std::vector<Target> > > mTargets;
+    std::set<std::string> mTargetNames;
+
     std::vector<FilterStep*> mFilterSteps;
-    size_t mRow;
     
+    void findTargets( Scenario* aScenario );
+    void addTarget( const Target& aTarget );
     std::vector<FilterStep*> parseFilterString(const std::string& aFilterStr );
     FilterStep* parseFilterStepStr( const std::string& aFilterStepStr, int& aCol );
 };
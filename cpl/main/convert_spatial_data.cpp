@@ -0,0 +1,100 @@
+/*
+* LEGAL NOTICE
+* This computer software was prepared by Battelle Memorial Institute,
+* hereinafter the Contractor, under Contract No. DE-AC05-76RL0 1830
+* with the Department of Energy (DOE). NEITHER THE GOVERNMENT NOR THE
+* CONTRACTOR MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR ASSUMES ANY
+* LIABILITY FOR THE USE OF THIS SOFTWARE. This notice including this
+* sentence must appear on any copies of this computer software.
+* 
+* EXPORT CONTROL
+* User agrees that the Software will not be shipped, transferred or
+* exported into any country or used in any manner prohibited by the
+* United States Export Administration Act or any other applicable
+* export laws, restrictions or regulations (collectively the "Export Laws").
+* Export of the Software may require some form of license or other
+* authority from the U.S. Government, and failure to obtain such
+* export control license may result in criminal liability under
+* U.S. laws. In addition, if the Software is identified as export controlled
+* items under the Export Laws, User represents and warrants that User
+* is not a citizen, or otherwise located within, an embargoed nation
+* (including without limitation Iran, Syria, Sudan, Cuba, and North Korea)
+*     and that User is not otherwise prohibited
+* under the Export Laws from receiving the Software.
+* 
+* Copyright 2011 Battelle Memorial Institute.  All Rights Reserved.
+* Distributed as open-source under the terms of the Educational Community 
+* License version 2.0 (ECL 2.0). http://www.opensource.org/licenses/ecl2.php
+* 
+* For further details, see: http://www.globalchange.umd.edu/models/gcam/
+*
+*/
+
+
+/*!
+* \file convert_spatial_data.cpp
+* \brief Converts a space delimited spatial data file (e.g., base year gridded emissions or
+*        ELM baseline NPP/HR/PFT files) into the binary format read by ASpatialData.
+*
+*        Usage: convert_spatial_data <text file> <binary file> [--no-id] [--no-latlon]
+*
+*        The text file is expected to have a header line followed by one row per value,
+*        with an ID, longitude, and latitude column unless --no-id or --no-latlon are given.
+*        readSpatialData detects the binary format automatically, so the binary file
+*        can be used anywhere the text file was used.
+*/
+
+// include standard libraries
+#include <iostream>
+#include <fstream>
+#include <string>
+
+#include "../include/aspatial_data.h"
+
+using namespace std;
+
+int main( int argc, char* argv[] ) {
+    if ( argc < 3 ) {
+        cout << "Usage: " << argv[0] << " <text file> <binary file> [--no-id] [--no-latlon]" << endl;
+        return 1;
+    }
+    string inFileName = argv[1];
+    string outFileName = argv[2];
+    bool hasID = true;
+    bool hasLatLon = true;
+    for ( int i = 3; i < argc; i++ ) {
+        string arg = argv[i];
+        if ( arg == "--no-id" ) {
+            hasID = false;
+        } else if ( arg == "--no-latlon" ) {
+            hasLatLon = false;
+        } else {
+            cout << "Unknown option: " << arg << endl;
+            return 1;
+        }
+    }
+    
+    // Count the rows so the data can be sized to match the file
+    ifstream data( inFileName );
+    if ( !data.is_open() ) {
+        cout << "File not found: " << inFileName << endl;
+        return 1;
+    }
+    string str;
+    getline( data, str ); // skip the first line
+    int numRows = 0;
+    while ( getline( data, str ) ) {
+        numRows++;
+    }
+    data.close();
+    
+    // Read the text file and write it back out in binary
+    ASpatialData spatialData( numRows );
+    double total = spatialData.readSpatialData( inFileName, hasLatLon, hasID, true );
+    spatialData.writeBinarySpatialData( outFileName, hasLatLon, hasID );
+    
+    cout << "Converted " << numRows << " rows (total " << total << ") from "
+         << inFileName << " to " << outFileName << endl;
+    
+    return 0;
+}
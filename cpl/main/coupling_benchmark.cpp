@@ -0,0 +1,362 @@
+/*
+* LEGAL NOTICE
+* This computer software was prepared by Battelle Memorial Institute,
+* hereinafter the Contractor, under Contract No. DE-AC05-76RL0 1830
+* with the Department of Energy (DOE). NEITHER THE GOVERNMENT NOR THE
+* CONTRACTOR MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR ASSUMES ANY
+* LIABILITY FOR THE USE OF THIS SOFTWARE. This notice including this
+* sentence must appear on any copies of this computer software.
+* 
+* EXPORT CONTROL
+* User agrees that the Software will not be shipped, transferred or
+* exported into any country or used in any manner prohibited by the
+* United States Export Administration Act or any other applicable
+* export laws, restrictions or regulations (collectively the "Export Laws").
+* Export of the Software may require some form of license or other
+* authority from the U.S. Government, and failure to obtain such
+* export control license may result in criminal liability under
+* U.S. laws. In addition, if the Software is identified as export controlled
+* items under the Export Laws, User represents and warrants that User
+* is not a citizen, or otherwise located within, an embargoed nation
+* (including without limitation Iran, Syria, Sudan, Cuba, and North Korea)
+*     and that User is not otherwise prohibited
+* under the Export Laws from receiving the Software.
+* 
+* Copyright 2011 Battelle Memorial Institute.  All Rights Reserved.
+* Distributed as open-source under the terms of the Educational Community 
+* License version 2.0 (ECL 2.0). http://www.opensource.org/licenses/ecl2.php
+* 
+* For further details, see: http://www.globalchange.umd.edu/models/gcam/
+*
+*/
+
+
+/*!
+* \file coupling_benchmark.cpp
+* \brief Times the coupling code paths on synthetic data without running GCAM.
+*
+*        Usage: coupling_benchmark [--resolution 0.9x1.25|0.5|0.25] [--years <n>]
+*                                  [--mapping <file>] [--work-dir <dir>] [--write]
+*
+*        The ELM to GCAM mapping is regridded to the requested resolution by taking each
+*        grid cell's mapping from the 0.9x1.25 cell that contains its center. Synthetic
+*        base year files are written to the work directory, then the carbon scaler
+*        calculation and the emissions downscaling are run for the given number of years
+*        with synthetic ELM inputs and GCAM emissions. Setting and getting data in the
+*        GCAM scenario need a solved scenario, so they are not included.
+*
+*        The time spent in each phase, the throughput of each phase, and the peak
+*        resident memory are printed. The per year timers and counters are also written
+*        to benchmark_timings.csv and benchmark_timings.json in the work directory.
+*/
+
+// include standard libraries
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <random>
+#include <cstdlib>
+#include <sys/resource.h>
+
+#include "util/base/include/definitions.h"
+#include "util/base/include/timer.h"
+#include "../include/aspatial_data.h"
+#include "../include/carbon_scalers.h"
+#include "../include/emiss_downscale.h"
+#include "../include/async_writer.h"
+#include "../include/coupling_timings.h"
+#include "../include/grid_mapping.h"
+
+using namespace std;
+
+namespace {
+    // Resolution of the grid in the mapping file
+    const int MAPPING_NUM_LON = 288;
+    const int MAPPING_NUM_LAT = 192;
+
+    const int NUM_PFT = 17;
+    const int NUM_MON = 12;
+    const int BASE_YEAR = 2015;
+
+    // Peak resident memory of this process in MB
+    double getPeakRSS() {
+        struct rusage usage;
+        getrusage( RUSAGE_SELF, &usage );
+        return usage.ru_maxrss / 1024.0;
+    }
+
+    // Write a synthetic spatial data file in the binary format with ID and lat/lon columns
+    void writeSyntheticData( const string& aFileName, size_t aSize, double aMin, double aMax, mt19937& aRandom ) {
+        uniform_real_distribution<double> dist( aMin, aMax );
+        vector<double> values( aSize );
+        for ( auto& value : values ) {
+            value = dist( aRandom );
+        }
+        ASpatialData data( aSize );
+        data.setValueVector( std::move( values ) );
+        data.writeBinarySpatialData( aFileName, true, true );
+    }
+
+    // Regrid the 0.9x1.25 mapping to aNumLon x aNumLat, returning the region names in it
+    set<string> regridMapping( const string& aMappingFile, const string& aOutFileName, int aNumLon, int aNumLat ) {
+        ifstream data( aMappingFile );
+        if ( !data.is_open() ) {
+            cout << "File not found: " << aMappingFile << endl;
+            exit( EXIT_FAILURE );
+        }
+        string header;
+        getline( data, header );
+
+        // Rows for each grid cell of the mapping, with the x,y columns removed
+        vector<vector<pair<string, string> > > cellRows( MAPPING_NUM_LON * MAPPING_NUM_LAT );
+        set<string> regionNames;
+        string str;
+        while ( getline( data, str ) ) {
+            istringstream iss( str );
+            string regionID, subregionID, lon, lat, rest;
+            getline( iss, regionID, ',' );
+            getline( iss, subregionID, ',' );
+            getline( iss, lon, ',' );
+            getline( iss, lat, ',' );
+            getline( iss, rest );
+            int x = stoi( lon );
+            int y = stoi( lat );
+            if ( x < 1 || x > MAPPING_NUM_LON || y < 1 || y > MAPPING_NUM_LAT ) {
+                continue;
+            }
+            cellRows[ ( y - 1 ) * MAPPING_NUM_LON + ( x - 1 ) ].push_back( make_pair( regionID + "," + subregionID, rest ) );
+            regionNames.insert( rest.substr( 0, rest.find( ',' ) ) );
+        }
+
+        ofstream out( aOutFileName );
+        out << header << "\n";
+        for ( int y = 1; y <= aNumLat; y++ ) {
+            int mapY = static_cast<int>( ( y - 0.5 ) * MAPPING_NUM_LAT / aNumLat );
+            for ( int x = 1; x <= aNumLon; x++ ) {
+                int mapX = static_cast<int>( ( x - 0.5 ) * MAPPING_NUM_LON / aNumLon );
+                for ( const auto& row : cellRows[ mapY * MAPPING_NUM_LON + mapX ] ) {
+                    out << row.first << "," << x << "," << y << "," << row.second << "\n";
+                }
+            }
+        }
+        return regionNames;
+    }
+
+    // Print the time and throughput of a phase
+    void printPhase( const string& aPhase, const string& aUnit, double aCount, int aYears ) {
+        const TimerRegistry& timers = TimerRegistry::getInstance();
+        double time = timers.getAllTimes()[ aPhase ];
+        cout << "  " << aPhase << ": " << time << " s";
+        if ( aYears > 0 ) {
+            cout << " (" << time / aYears * 1000 << " ms per year)";
+        }
+        if ( aCount > 0 && time > 0 ) {
+            cout << ", " << aCount / time / 1e6 << " M " << aUnit << "/s";
+        }
+        cout << endl;
+    }
+}
+
+int main( int argc, char* argv[] ) {
+    string resolution = "0.9x1.25";
+    int numYears = 10;
+    string mappingFile = "../cpl/mappings/elm0.9x1.25togcam_mapping.csv";
+    string workDir = ".";
+    bool writeOutput = false;
+    for ( int i = 1; i < argc; i++ ) {
+        string arg = argv[i];
+        if ( arg == "--resolution" && i + 1 < argc ) {
+            resolution = argv[++i];
+        } else if ( arg == "--years" && i + 1 < argc ) {
+            numYears = atoi( argv[++i] );
+        } else if ( arg == "--mapping" && i + 1 < argc ) {
+            mappingFile = argv[++i];
+        } else if ( arg == "--work-dir" && i + 1 < argc ) {
+            workDir = argv[++i];
+        } else if ( arg == "--write" ) {
+            writeOutput = true;
+        } else {
+            cout << "Usage: " << argv[0] << " [--resolution 0.9x1.25|0.5|0.25] [--years <n>]"
+                 << " [--mapping <file>] [--work-dir <dir>] [--write]" << endl;
+            return 1;
+        }
+    }
+
+    int numLon;
+    int numLat;
+    if ( resolution == "0.9x1.25" ) {
+        numLon = 288;
+        numLat = 192;
+    } else if ( resolution == "0.5" ) {
+        numLon = 720;
+        numLat = 360;
+    } else if ( resolution == "0.25" ) {
+        numLon = 1440;
+        numLat = 720;
+    } else {
+        cout << "Unknown resolution: " << resolution << endl;
+        return 1;
+    }
+    const int gridSize = numLon * numLat;
+    cout << "Coupling benchmark on a " << numLon << " x " << numLat << " grid for " << numYears << " years" << endl;
+
+    /*
+     STEP 1: WRITE THE SYNTHETIC INPUT FILES
+     */
+    mt19937 random( 2015 );
+    const string mapFile = workDir + "/benchmark_mapping.csv";
+    const string sfcFile = workDir + "/benchmark_co2_sfc.bin";
+    const string airFile = workDir + "/benchmark_co2_air.bin";
+    const string regionalFile = workDir + "/benchmark_co2_regional.csv";
+    const string baseNPPFile = workDir + "/benchmark_base_npp.bin";
+    const string baseHRFile = workDir + "/benchmark_base_hr.bin";
+    const string basePFTFile = workDir + "/benchmark_base_pft_wt.bin";
+
+    set<string> regionSet = regridMapping( mappingFile, mapFile, numLon, numLat );
+    vector<string> regionNames( regionSet.begin(), regionSet.end() );
+    writeSyntheticData( sfcFile, gridSize * NUM_MON, 0.0, 1e-9, random );
+    writeSyntheticData( airFile, gridSize * NUM_MON * 2, 0.0, 1e-10, random );
+    writeSyntheticData( baseNPPFile, gridSize * NUM_PFT, 0.0, 1e-4, random );
+    writeSyntheticData( baseHRFile, gridSize * NUM_PFT, 0.0, 1e-4, random );
+    writeSyntheticData( basePFTFile, gridSize * NUM_PFT, 0.0, 100.0 / NUM_PFT, random );
+
+    // Regional base year emissions, laid out in the GCAM emissions as region * 2 + sector
+    uniform_real_distribution<double> emissDist( 10.0, 1000.0 );
+    vector<double> baseEmiss( regionNames.size() * 2 );
+    ofstream regional( regionalFile );
+    regional << "region,sector,year,value\n";
+    for ( size_t reg = 0; reg < regionNames.size(); reg++ ) {
+        baseEmiss[ reg * 2 ] = emissDist( random );
+        baseEmiss[ reg * 2 + 1 ] = emissDist( random ) / 10.0;
+        regional << regionNames[ reg ] << ",surface," << BASE_YEAR << "," << baseEmiss[ reg * 2 ] << "\n";
+        regional << regionNames[ reg ] << ",aircraft," << BASE_YEAR << "," << baseEmiss[ reg * 2 + 1 ] << "\n";
+    }
+    regional.close();
+    vector<size_t> sfcIndex;
+    vector<size_t> airIndex;
+    for ( size_t reg = 0; reg < regionNames.size(); reg++ ) {
+        sfcIndex.push_back( reg * 2 );
+        airIndex.push_back( reg * 2 + 1 );
+    }
+
+    // Synthetic ELM inputs
+    vector<double> area( gridSize );
+    vector<double> pftFract( gridSize * NUM_PFT );
+    vector<double> npp( gridSize * NUM_PFT );
+    vector<double> hr( gridSize * NUM_PFT );
+    uniform_real_distribution<double> unitDist( 0.0, 1.0 );
+    for ( auto& value : area ) {
+        value = 1e4 * unitDist( random );
+    }
+    for ( auto& value : pftFract ) {
+        value = 100.0 / NUM_PFT * unitDist( random );
+    }
+
+    // Output planes, as passed in from E3SM
+    vector<double> sfcOutput( gridSize * NUM_MON );
+    vector<double> airOutput( gridSize * NUM_MON * 2 );
+    vector<double*> sfcPlanes;
+    vector<double*> airPlanes;
+    for ( int plane = 0; plane < NUM_MON; plane++ ) {
+        sfcPlanes.push_back( &sfcOutput[ plane * gridSize ] );
+    }
+    for ( int plane = 0; plane < NUM_MON * 2; plane++ ) {
+        airPlanes.push_back( &airOutput[ plane * gridSize ] );
+    }
+    cout << "Synthetic inputs written, peak RSS " << getPeakRSS() << " MB" << endl;
+
+    /*
+     STEP 2: SET UP THE COUPLING AS IN initGCAM
+     */
+    TimerRegistry& timers = TimerRegistry::getInstance();
+    Timer& parseMappingsTimer = timers.getTimer( "cpl-parse-mappings" );
+    Timer& readFilesTimer = timers.getTimer( "cpl-read-files" );
+    Timer& scalersTimer = timers.getTimer( "cpl-calc-scalers" );
+    Timer& downscaleTimer = timers.getTimer( "cpl-downscale" );
+    Timer& writeTimer = timers.getTimer( "cpl-write-diagnostics" );
+    CouplingTimings timings( workDir + "/benchmark_timings" );
+
+    EmissDownscale surfaceCO2( numLon, numLat, NUM_MON, 1, true );
+    EmissDownscale aircraftCO2( numLon, numLat, NUM_MON, 2, false );
+    CarbonScalers carbonScalers( numLon, numLat, NUM_PFT );
+
+    parseMappingsTimer.start();
+    shared_ptr<const GridMapping> gridMapping = GridMapping::readGridMapping( mapFile );
+    surfaceCO2.readRegionalMappingData( *gridMapping, regionNames );
+    aircraftCO2.setRegionalMapping( surfaceCO2.getRegionalMapping() );
+    carbonScalers.readRegionalMappingData( *gridMapping );
+    parseMappingsTimer.stop();
+
+    readFilesTimer.start();
+    surfaceCO2.readGriddedBaseYearEmissionData( sfcFile );
+    surfaceCO2.readRegionalBaseYearEmissionData( regionalFile, "surface" );
+    aircraftCO2.readGriddedBaseYearEmissionData( airFile );
+    aircraftCO2.readRegionalBaseYearEmissionData( regionalFile, "aircraft" );
+    readFilesTimer.stop();
+    surfaceCO2.setRegionalEmissionsIndex( sfcIndex );
+    aircraftCO2.setRegionalEmissionsIndex( airIndex );
+    const size_t numLandCells = surfaceCO2.getRegionalMapping()->mLandCells.size();
+    cout << numLandCells << " land cells in " << regionNames.size() << " regions, peak RSS " << getPeakRSS() << " MB" << endl;
+
+    /*
+     STEP 3: RUN THE COUPLING FOR EACH YEAR
+     */
+    AsyncWriter writer;
+    ScalerTable scalers;
+    vector<double> emissions( baseEmiss.size() );
+    uniform_real_distribution<double> growthDist( 0.9, 1.1 );
+    for ( int year = BASE_YEAR + 1; year <= BASE_YEAR + numYears; year++ ) {
+        timings.setYear( year );
+
+        // Synthetic ELM NPP and HR and GCAM emissions for this year
+        for ( size_t i = 0; i < npp.size(); i++ ) {
+            npp[ i ] = 1e-4 * unitDist( random );
+            hr[ i ] = 1e-4 * unitDist( random );
+        }
+        for ( size_t i = 0; i < emissions.size(); i++ ) {
+            emissions[ i ] = baseEmiss[ i ] * growthDist( random );
+        }
+
+        scalersTimer.start();
+        carbonScalers.calcScalers( year, &area[0], &pftFract[0], &npp[0], &hr[0], scalers,
+                                   baseNPPFile, baseHRFile, basePFTFile );
+        scalersTimer.stop();
+        timers.addToCounter( "cpl-scaler-values", gridSize * NUM_PFT );
+
+        downscaleTimer.start();
+        EmissDownscale::downscaleEmissions( { &surfaceCO2, &aircraftCO2 }, &emissions[0], { sfcPlanes, airPlanes } );
+        downscaleTimer.stop();
+        timers.addToCounter( "cpl-cells-downscaled", numLandCells );
+
+        if ( writeOutput ) {
+            writeTimer.start();
+            carbonScalers.writeScalers( writer, workDir + "/benchmark_scalers_" + to_string( year ) + ".csv", scalers );
+            surfaceCO2.writeGriddedEmissions( writer, workDir + "/benchmark_co2_sfc_" + to_string( year ) + ".bin", sfcPlanes );
+            aircraftCO2.writeGriddedEmissions( writer, workDir + "/benchmark_co2_air_" + to_string( year ) + ".bin", airPlanes );
+            writeTimer.stop();
+        }
+    }
+    writer.wait();
+    timings.write();
+
+    /*
+     STEP 4: REPORT
+     */
+    const map<string, double>& counters = timers.getAllCounters();
+    cout << "Setup:" << endl;
+    printPhase( "cpl-parse-mappings", "grid cells", 0, 0 );
+    printPhase( "cpl-read-files", "grid cells", 0, 0 );
+    cout << "Per year:" << endl;
+    printPhase( "cpl-calc-scalers", "grid cell PFTs", counters.at( "cpl-scaler-values" ), numYears );
+    printPhase( "cpl-downscale", "land cells", counters.at( "cpl-cells-downscaled" ), numYears );
+    if ( writeOutput ) {
+        printPhase( "cpl-write-diagnostics", "grid cells", 0, numYears );
+    }
+    cout << "Peak RSS: " << getPeakRSS() << " MB" << endl;
+
+    return 0;
+}
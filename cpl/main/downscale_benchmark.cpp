@@ -0,0 +1,305 @@
+/*
+* LEGAL NOTICE
+* This computer software was prepared by Battelle Memorial Institute,
+* hereinafter the Contractor, under Contract No. DE-AC05-76RL0 1830
+* with the Department of Energy (DOE). NEITHER THE GOVERNMENT NOR THE
+* CONTRACTOR MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR ASSUMES ANY
+* LIABILITY FOR THE USE OF THIS SOFTWARE. This notice including this
+* sentence must appear on any copies of this computer software.
+* 
+* EXPORT CONTROL
+* User agrees that the Software will not be shipped, transferred or
+* exported into any country or used in any manner prohibited by the
+* United States Export Administration Act or any other applicable
+* export laws, restrictions or regulations (collectively the "Export Laws").
+* Export of the Software may require some form of license or other
+* authority from the U.S. Government, and failure to obtain such
+* export control license may result in criminal liability under
+* U.S. laws. In addition, if the Software is identified as export controlled
+* items under the Export Laws, User represents and warrants that User
+* is not a citizen, or otherwise located within, an embargoed nation
+* (including without limitation Iran, Syria, Sudan, Cuba, and North Korea)
+*     and that User is not otherwise prohibited
+* under the Export Laws from receiving the Software.
+* 
+* Copyright 2011 Battelle Memorial Institute.  All Rights Reserved.
+* Distributed as open-source under the terms of the Educational Community 
+* License version 2.0 (ECL 2.0). http://www.opensource.org/licenses/ecl2.php
+* 
+* For further details, see: http://www.globalchange.umd.edu/models/gcam/
+*
+*/
+
+
+
+/*!
+* \file downscale_benchmark.cpp
+* \brief Times the emissions downscaling against the string keyed implementation it replaced.
+*
+*        Usage: downscale_benchmark [--mapping <file>] [--reps <n>] [--work-dir <dir>]
+*
+*        Synthetic gridded and regional base year emissions and current year GCAM emissions
+*        are generated for the 0.9x1.25 grid. The surface (normalized by weight, 12 months)
+*        and aircraft (not normalized, 12 months x 2 levels) emissions are then downscaled
+*        with EmissDownscale and with a copy of the original implementation, which rebuilt a
+*        "lon_lat" string for every grid cell and looked up the regions and weights in string
+*        keyed maps. The time per call of each is printed and the outputs are checked to be
+*        bit-identical.
+*/
+
+// include standard libraries
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <random>
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+
+#include "util/base/include/definitions.h"
+#include "../include/aspatial_data.h"
+#include "../include/emiss_downscale.h"
+#include "../include/grid_mapping.h"
+
+using namespace std;
+
+namespace {
+    const int NUM_LON = 288;
+    const int NUM_LAT = 192;
+    const int NUM_MON = 12;
+
+    // The downscaling as it was done before the mapping was compiled into a sparse operator.
+    // This is kept as the reference the current implementation must reproduce exactly.
+    class StringMapDownscale {
+    public:
+        StringMapDownscale( const string& aMappingFile, const vector<string>& aRegionNames ) {
+            for ( size_t reg = 0; reg < aRegionNames.size(); reg++ ) {
+                mRegionIDName[ aRegionNames[ reg ] ] = reg + 1;
+            }
+            ifstream data( aMappingFile );
+            string str;
+            getline( data, str ); // skip the first line
+            while ( getline( data, str ) ) {
+                istringstream iss( str );
+                string token;
+
+                // Skip region & GLU ID
+                getline( iss, token, ',' );
+                getline( iss, token, ',' );
+                getline( iss, token, ',' );
+                int lon = stoi( token );
+                getline( iss, token, ',' );
+                int lat = stoi( token );
+                string gridID = to_string( lon ) + "_" + to_string( lat );
+
+                getline( iss, token, ',' );
+                string regID = token;
+                regID.erase( remove( regID.begin(), regID.end(), '\"' ), regID.end() );
+
+                // Skip SubRegion Name
+                getline( iss, token, ',' );
+                mRegionMapping[ gridID ].push_back( regID );
+
+                getline( iss, token, ',' );
+                mRegionWeights[ make_pair( gridID, regID ) ] = stod( token );
+            }
+        }
+
+        void downscale( const vector<double>& aBase, const double* aCurrYearEmissions, const double* aBaseYearEmissions,
+                        int aNumLev, bool aNormalizeWeight, vector<double>& aOutput ) {
+            aOutput = aBase;
+            for ( int k = 1; k <= NUM_LAT; k++ ) {
+                for ( int j = 1; j <= NUM_LON; j++ ) {
+                    string gridID = to_string( j ) + "_" + to_string( k );
+                    auto tempGrid = mRegionMapping.find( gridID );
+                    if ( tempGrid == mRegionMapping.end() ) {
+                        continue;
+                    }
+                    vector<string> regInGrd = ( *tempGrid ).second;
+                    double scalar = 0;
+                    double weight = 0;
+                    for ( auto regID : regInGrd ) {
+                        int regIndex = mRegionIDName.find( regID )->second - 1;
+                        scalar += aCurrYearEmissions[ regIndex ] / aBaseYearEmissions[ regIndex ] * mRegionWeights[ make_pair( gridID, regID ) ];
+                        weight += mRegionWeights[ make_pair( gridID, regID ) ];
+                    }
+                    if ( aNormalizeWeight ) {
+                        scalar = scalar / weight;
+                    }
+                    for ( int plane = 0; plane < NUM_MON * aNumLev; plane++ ) {
+                        int valIndex = plane * NUM_LON * NUM_LAT + ( k - 1 ) * NUM_LON + ( j - 1 );
+                        aOutput[ valIndex ] = aBase[ valIndex ] * scalar;
+                    }
+                }
+            }
+        }
+
+    private:
+        map<string, vector<string> > mRegionMapping;
+        map<pair<string, string>, double> mRegionWeights;
+        map<string, int> mRegionIDName;
+    };
+
+    // Time aCall over aReps calls in ms per call
+    template<class CALL>
+    double timeCalls( int aReps, CALL aCall ) {
+        auto start = chrono::steady_clock::now();
+        for ( int rep = 0; rep < aReps; rep++ ) {
+            aCall();
+        }
+        return chrono::duration<double, milli>( chrono::steady_clock::now() - start ).count() / aReps;
+    }
+
+    // Count the values of aNew that are not bit-identical to aOld
+    size_t countDifferent( const vector<double>& aOld, const vector<double>& aNew ) {
+        size_t numDiff = 0;
+        for ( size_t i = 0; i < aOld.size(); i++ ) {
+            numDiff += memcmp( &aOld[ i ], &aNew[ i ], sizeof( double ) ) != 0;
+        }
+        return numDiff;
+    }
+}
+
+int main( int argc, char* argv[] ) {
+    string mappingFile = "../cpl/mappings/elm0.9x1.25togcam_mapping.csv";
+    string workDir = ".";
+    int numReps = 20;
+    for ( int i = 1; i < argc; i++ ) {
+        string arg = argv[i];
+        if ( arg == "--mapping" && i + 1 < argc ) {
+            mappingFile = argv[++i];
+        } else if ( arg == "--reps" && i + 1 < argc ) {
+            numReps = atoi( argv[++i] );
+        } else if ( arg == "--work-dir" && i + 1 < argc ) {
+            workDir = argv[++i];
+        } else {
+            cout << "Usage: " << argv[0] << " [--mapping <file>] [--reps <n>] [--work-dir <dir>]" << endl;
+            return 1;
+        }
+    }
+    const int gridSize = NUM_LON * NUM_LAT;
+
+    /*
+     STEP 1: SYNTHETIC INPUTS
+     */
+    shared_ptr<const GridMapping> gridMapping = GridMapping::readGridMapping( mappingFile );
+    set<string> regionSet( gridMapping->mRegionNames.begin(), gridMapping->mRegionNames.end() );
+    vector<string> regionNames( regionSet.begin(), regionSet.end() );
+    const size_t numRegions = regionNames.size();
+
+    mt19937 random( 2015 );
+    uniform_real_distribution<double> unitDist( 0.5, 2.0 );
+    vector<double> sfcBase( gridSize * NUM_MON );
+    vector<double> airBase( gridSize * NUM_MON * 2 );
+    for ( auto& value : sfcBase ) {
+        value = unitDist( random );
+    }
+    for ( auto& value : airBase ) {
+        value = unitDist( random );
+    }
+    const string sfcFile = workDir + "/downscale_benchmark_sfc.bin";
+    const string airFile = workDir + "/downscale_benchmark_air.bin";
+    const string regionalFile = workDir + "/downscale_benchmark_regional.csv";
+    ASpatialData sfcData( sfcBase.size() );
+    sfcData.setValueVector( vector<double>( sfcBase ) );
+    sfcData.writeBinarySpatialData( sfcFile, true, true );
+    ASpatialData airData( airBase.size() );
+    airData.setValueVector( vector<double>( airBase ) );
+    airData.writeBinarySpatialData( airFile, true, true );
+
+    // Base year and current year regional emissions, laid out in the GCAM emissions as region * 2 + sector
+    vector<double> sfcBaseRegion( numRegions );
+    vector<double> airBaseRegion( numRegions );
+    vector<double> emissions( numRegions * 2 );
+    vector<double> sfcEmiss( numRegions );
+    vector<double> airEmiss( numRegions );
+    vector<size_t> sfcIndex( numRegions );
+    vector<size_t> airIndex( numRegions );
+    ofstream regional( regionalFile );
+    regional.precision( 17 );
+    regional << "region,sector,year,value\n";
+    for ( size_t reg = 0; reg < numRegions; reg++ ) {
+        sfcBaseRegion[ reg ] = 100 * unitDist( random );
+        airBaseRegion[ reg ] = 10 * unitDist( random );
+        regional << regionNames[ reg ] << ",surface,2015," << sfcBaseRegion[ reg ] << "\n";
+        regional << regionNames[ reg ] << ",aircraft,2015," << airBaseRegion[ reg ] << "\n";
+        sfcEmiss[ reg ] = emissions[ reg * 2 ] = 100 * unitDist( random );
+        airEmiss[ reg ] = emissions[ reg * 2 + 1 ] = 10 * unitDist( random );
+        sfcIndex[ reg ] = reg * 2;
+        airIndex[ reg ] = reg * 2 + 1;
+    }
+    regional.close();
+
+    /*
+     STEP 2: DOWNSCALE WITH BOTH IMPLEMENTATIONS
+     */
+    EmissDownscale surfaceCO2( NUM_LON, NUM_LAT, NUM_MON, 1, true );
+    EmissDownscale aircraftCO2( NUM_LON, NUM_LAT, NUM_MON, 2, false );
+    surfaceCO2.readRegionalMappingData( *gridMapping, regionNames );
+    aircraftCO2.setRegionalMapping( surfaceCO2.getRegionalMapping() );
+    surfaceCO2.readGriddedBaseYearEmissionData( sfcFile );
+    surfaceCO2.readRegionalBaseYearEmissionData( regionalFile, "surface" );
+    aircraftCO2.readGriddedBaseYearEmissionData( airFile );
+    aircraftCO2.readRegionalBaseYearEmissionData( regionalFile, "aircraft" );
+    surfaceCO2.setRegionalEmissionsIndex( sfcIndex );
+    aircraftCO2.setRegionalEmissionsIndex( airIndex );
+
+    vector<double> sfcOutput( sfcBase.size() );
+    vector<double> airOutput( airBase.size() );
+    vector<double*> sfcPlanes;
+    vector<double*> airPlanes;
+    for ( int plane = 0; plane < NUM_MON; plane++ ) {
+        sfcPlanes.push_back( &sfcOutput[ plane * gridSize ] );
+    }
+    for ( int plane = 0; plane < NUM_MON * 2; plane++ ) {
+        airPlanes.push_back( &airOutput[ plane * gridSize ] );
+    }
+
+    // The regional emissions must survive the round trip through the base year file for the
+    // outputs to be comparable.
+    if ( surfaceCO2.getRegionalBaseYearEmissions() != sfcBaseRegion ||
+         aircraftCO2.getRegionalBaseYearEmissions() != airBaseRegion ) {
+        cout << "Regional base year emissions were not read back exactly" << endl;
+        return 1;
+    }
+
+    StringMapDownscale reference( mappingFile, regionNames );
+    vector<double> sfcReference;
+    vector<double> airReference;
+
+    double sfcOld = timeCalls( numReps, [&]() {
+        reference.downscale( sfcBase, &sfcEmiss[0], &sfcBaseRegion[0], 1, true, sfcReference );
+    } );
+    double airOld = timeCalls( numReps, [&]() {
+        reference.downscale( airBase, &airEmiss[0], &airBaseRegion[0], 2, false, airReference );
+    } );
+    double sfcNew = timeCalls( numReps, [&]() {
+        surfaceCO2.downscaleEmissions( &emissions[0], sfcPlanes );
+    } );
+    double airNew = timeCalls( numReps, [&]() {
+        aircraftCO2.downscaleEmissions( &emissions[0], airPlanes );
+    } );
+    double bothNew = timeCalls( numReps, [&]() {
+        EmissDownscale::downscaleEmissions( { &surfaceCO2, &aircraftCO2 }, &emissions[0], { sfcPlanes, airPlanes } );
+    } );
+
+    /*
+     STEP 3: REPORT
+     */
+    size_t sfcDiff = countDifferent( sfcReference, sfcOutput );
+    size_t airDiff = countDifferent( airReference, airOutput );
+    cout << surfaceCO2.getRegionalMapping()->mLandCells.size() << " land cells in " << numRegions
+         << " regions, " << numReps << " calls each" << endl;
+    cout << "  surface:  " << sfcOld << " ms -> " << sfcNew << " ms per call, "
+         << sfcDiff << " values differ" << endl;
+    cout << "  aircraft: " << airOld << " ms -> " << airNew << " ms per call, "
+         << airDiff << " values differ" << endl;
+    cout << "  surface and aircraft together: " << bothNew << " ms per call" << endl;
+
+    return sfcDiff + airDiff == 0 ? 0 : 1;
+}
@@ -43,11 +43,14 @@
 #include <fstream>
 #include <string>
 #include <memory>
+#include <vector>
 #include <list>
+#include <map>
 
 // Include interface
 #include "../include/GCAM_E3SM_interface.h"
 #include "../include/aspatial_data.h"
+#include "../include/csv_reader.h"
 
 int main( ) {
     /* STEP 1: DEFINE CONTROL VARIABLES WITH DEFAULTS
@@ -64,6 +67,15 @@ int main( ) {
     std::string GCAM_CONFIG = "configuration.xml";
     std::string BASE_CO2_SURFACE_FILE = "../cpl/data/gcam_CO2-em-anthro_0.9x1.25_201401-201412_c20200406.txt";
     std::string BASE_CO2_AIRCRAFT_FILE = "../cpl/data/gcam_CO2-em-AIR-anthro_0.9x1.25_201401-201412_c20200427.txt";
+    std::string BASE_CO2_GCAM_FILE = "../cpl/data/gcam_co2_emissions_2015.csv";
+    // Surface emissions of other gases are downscaled if both of their files are set. The
+    // emissions mapping then needs a ghg column with the gas.
+    std::string BASE_CH4_SURFACE_FILE = "";
+    std::string BASE_CH4_GCAM_FILE = "";
+    std::string BASE_BC_SURFACE_FILE = "";
+    std::string BASE_BC_GCAM_FILE = "";
+    std::string BASE_SO2_SURFACE_FILE = "";
+    std::string BASE_SO2_GCAM_FILE = "";
     std::string GCAM2ELM_CO2_MAPPING_FILE = "../cpl/mappings/co2.xml";
     std::string GCAM2ELM_LUC_MAPPING_FILE = "../cpl/mappings/luc.xml";
     std::string GCAM2ELM_WOODHARVEST_MAPPING_FILE = "../cpl/mappings/woodharvest.xml";
@@ -110,100 +122,84 @@ int main( ) {
     int numER = 32;
     int* NUM_EMISS_REGIONS = &numER;
     int numEG = 1;
-    int* NUM_EMISS_GASES = &numEG;
+    int* NUM_EMISS_GASES = &numEG; // Number of gases downscaled, including CO2
     
     /*
      STEP 2: READ NAMELIST
      */
     ILogger& coupleLog = ILogger::getLogger( "coupling_log" );
-    coupleLog.setLevel( ILogger::ERROR );
-    ifstream namelist("user_nl_gcam");
-    if (!namelist.is_open())
-    {
-        coupleLog << "Namelist not found: user_nl_gcam" << endl;
-        exit(EXIT_FAILURE);
-    }
-    string str;
-    getline(namelist, str); // skip the first line
-    while (getline(namelist, str))
-    {
-        istringstream iss(str);
-        string name;
-        string value;
 
-        getline(iss, name, ' ');
-        getline(iss, value, ' '); // Throw away the equals sign
-        getline(iss, value, ' ');
-        if ( name == "CASE_NAME" ) {
-            CASE_NAME = value;
-        } else if ( name == "GCAM_CONFIG" ) {
-            GCAM_CONFIG = value;
-        } else if ( name == "BASE_CO2_SURFACE_FILE" ) {
-            BASE_CO2_SURFACE_FILE = value;
-        } else if ( name == "BASE_CO2_AIRCRAFT_FILE" ) {
-            BASE_CO2_AIRCRAFT_FILE = value;
-        } else if ( name == "GCAM2ELM_CO2_MAPPING_FILE" ) {
-            GCAM2ELM_CO2_MAPPING_FILE = value;
-        } else if ( name == "GCAM2ELM_LUC_MAPPING_FILE" ) {
-            GCAM2ELM_LUC_MAPPING_FILE = value;
-        } else if ( name == "GCAM2ELM_WOODHARVEST_MAPPING_FILE" ) {
-            GCAM2ELM_WOODHARVEST_MAPPING_FILE = value;
-        } else if ( name == "ELM2GCAM_MAPPING_FILE" ) {
-            ELM2GCAM_MAPPING_FILE = value;
-        } else if ( name == "BASE_NPP_FILE" ) {
-            BASE_NPP_FILE = value;
-        } else if ( name == "BASE_HR_FILE" ) {
-            BASE_HR_FILE = value;
-        } else if ( name == "BASE_PFT_FILE" ) {
-            BASE_PFT_FILE = value;
-        } else if ( name == "READ_SCALARS" ) {
-            *READ_SCALARS = std::stoi(value);
-        } else if ( name == "READ_ELM_FROM_FILE" ) {
-            istringstream(value) >> std::boolalpha >> READ_ELM_FROM_FILE;
-        } else if ( name == "WRITE_CO2" ) {
-            *WRITE_CO2 = std::stoi(value);
-        } else if ( name == "WRITE_SCALARS" ) {
-            *WRITE_SCALARS = std::stoi(value);
-        } else if ( name == "ELM_IAC_CARBON_SCALING" ) {
-            istringstream(value) >> std::boolalpha >> ELM_IAC_CARBON_SCALING;
-        } else if ( name == "IAC_EAM_CO2_EMISSIONS" ) {
-            istringstream(value) >> std::boolalpha >> IAC_EAM_CO2_EMISSIONS;
-        } else if ( name == "FIRST_COUPLED_YEAR" ) {
-            *FIRST_COUPLED_YEAR = std::stoi(value);
-        } else if ( name == "YEAR" ) {
-            *YEAR = std::stoi(value);
-        } else if ( name == "NUM_LAT" ) {
-            *NUM_LAT = std::stoi(value);
-        } else if ( name == "NUM_LON" ) {
-            *NUM_LON = std::stoi(value);
-        } else if ( name == "NUM_PFT" ) {
-            *NUM_PFT = std::stoi(value);
-        } else if ( name == "NUM_GCAM_ENERGY_REGIONS" ) {
-            *NUM_GCAM_ENERGY_REGIONS = std::stoi(value);
-        } else if ( name == "NUM_GCAM_LAND_REGIONS" ) {
-            *NUM_GCAM_LAND_REGIONS = std::stoi(value);
-        } else if ( name == "NUM_IAC2ELM_LANDTYPES" ) {
-            *NUM_IAC2ELM_LANDTYPES = std::stoi(value);
-        } else if ( name == "NUM_EMISS_SECTORS" ) {
-            *NUM_EMISS_SECTORS = std::stoi(value);
-        } else if ( name == "NUM_EMISS_REGIONS" ) {
-            *NUM_EMISS_REGIONS = std::stoi(value);
-        } else if ( name == "NUM_EMISS_GASES" ) {
-            *NUM_EMISS_GASES = std::stoi(value);
-        } else if ( name == "BASE_CO2EMISS_SURFACE" ) {
-            *BASE_CO2EMISS_SURFACE = std::stod(value);
-        } else if ( name == "BASE_CO2EMISS_AIRCRAFT" ) {
-            *BASE_CO2EMISS_AIRCRAFT = std::stod(value);
-        } else if ( name == "RUN_FULL_SCENARIO" ) {
-            istringstream(value) >> std::boolalpha >> RUN_FULL_SCENARIO;
-        }else {
+    // Namelist variables by type. Each line of the namelist is "NAME = VALUE".
+    const map<string, string*> stringVariables = {
+        { "CASE_NAME", &CASE_NAME },
+        { "GCAM_CONFIG", &GCAM_CONFIG },
+        { "BASE_CO2_SURFACE_FILE", &BASE_CO2_SURFACE_FILE },
+        { "BASE_CO2_AIRCRAFT_FILE", &BASE_CO2_AIRCRAFT_FILE },
+        { "BASE_CO2_GCAM_FILE", &BASE_CO2_GCAM_FILE },
+        { "BASE_CH4_SURFACE_FILE", &BASE_CH4_SURFACE_FILE },
+        { "BASE_CH4_GCAM_FILE", &BASE_CH4_GCAM_FILE },
+        { "BASE_BC_SURFACE_FILE", &BASE_BC_SURFACE_FILE },
+        { "BASE_BC_GCAM_FILE", &BASE_BC_GCAM_FILE },
+        { "BASE_SO2_SURFACE_FILE", &BASE_SO2_SURFACE_FILE },
+        { "BASE_SO2_GCAM_FILE", &BASE_SO2_GCAM_FILE },
+        { "GCAM2ELM_CO2_MAPPING_FILE", &GCAM2ELM_CO2_MAPPING_FILE },
+        { "GCAM2ELM_LUC_MAPPING_FILE", &GCAM2ELM_LUC_MAPPING_FILE },
+        { "GCAM2ELM_WOODHARVEST_MAPPING_FILE", &GCAM2ELM_WOODHARVEST_MAPPING_FILE },
+        { "ELM2GCAM_MAPPING_FILE", &ELM2GCAM_MAPPING_FILE },
+        { "BASE_NPP_FILE", &BASE_NPP_FILE },
+        { "BASE_HR_FILE", &BASE_HR_FILE },
+        { "BASE_PFT_FILE", &BASE_PFT_FILE }
+    };
+    const map<string, int*> intVariables = {
+        { "READ_SCALARS", READ_SCALARS },
+        { "WRITE_CO2", WRITE_CO2 },
+        { "WRITE_SCALARS", WRITE_SCALARS },
+        { "FIRST_COUPLED_YEAR", FIRST_COUPLED_YEAR },
+        { "YEAR", YEAR },
+        { "NUM_LAT", NUM_LAT },
+        { "NUM_LON", NUM_LON },
+        { "NUM_PFT", NUM_PFT },
+        { "NUM_GCAM_ENERGY_REGIONS", NUM_GCAM_ENERGY_REGIONS },
+        { "NUM_GCAM_LAND_REGIONS", NUM_GCAM_LAND_REGIONS },
+        { "NUM_IAC2ELM_LANDTYPES", NUM_IAC2ELM_LANDTYPES },
+        { "NUM_EMISS_SECTORS", NUM_EMISS_SECTORS },
+        { "NUM_EMISS_REGIONS", NUM_EMISS_REGIONS },
+        { "NUM_EMISS_GASES", NUM_EMISS_GASES }
+    };
+    const map<string, bool*> boolVariables = {
+        { "READ_ELM_FROM_FILE", &READ_ELM_FROM_FILE },
+        { "ELM_IAC_CARBON_SCALING", &ELM_IAC_CARBON_SCALING },
+        { "IAC_EAM_CO2_EMISSIONS", &IAC_EAM_CO2_EMISSIONS },
+        { "RUN_FULL_SCENARIO", &RUN_FULL_SCENARIO }
+    };
+    const map<string, double*> doubleVariables = {
+        { "BASE_CO2EMISS_SURFACE", BASE_CO2EMISS_SURFACE },
+        { "BASE_CO2EMISS_AIRCRAFT", BASE_CO2EMISS_AIRCRAFT }
+    };
+
+    // Values that are not valid for their type are reported with the line number and stop the run
+    CSVReader namelist( "user_nl_gcam", ' ' );
+    namelist.nextRow(); // skip the first line
+    const int VALUE = 2; // the value follows the name and the equals sign
+    string name;
+    while ( namelist.nextRow() ) {
+        namelist.getString( 0, name );
+        if ( stringVariables.count( name ) ) {
+            namelist.getString( VALUE, *stringVariables.at( name ) );
+        } else if ( intVariables.count( name ) ) {
+            *intVariables.at( name ) = namelist.getInt( VALUE );
+        } else if ( boolVariables.count( name ) ) {
+            *boolVariables.at( name ) = namelist.getBool( VALUE );
+        } else if ( doubleVariables.count( name ) ) {
+            *doubleVariables.at( name ) = namelist.getDouble( VALUE );
+        } else {
             coupleLog.setLevel( ILogger::ERROR );
-            coupleLog << "Invalid Namelist Variable" << endl;
+            coupleLog << "user_nl_gcam:" << namelist.getLineNumber() << ": Invalid Namelist Variable " << name << endl;
         }
     
         // Print to coupler log.
         coupleLog.setLevel( ILogger::NOTICE );
-        coupleLog << name << " = " << value << endl;
+        coupleLog << name << " = " << ( namelist.getNumFields() > VALUE ? namelist.getField( VALUE ) : "" ) << endl;
     }
     
     /*
@@ -213,8 +209,23 @@ int main( ) {
     GCAM_E3SM_interface *p_obj;
     p_obj = new GCAM_E3SM_interface();
     
-    // Initialize GCAM
-    p_obj->initGCAM(CASE_NAME, GCAM_CONFIG, GCAM2ELM_CO2_MAPPING_FILE, GCAM2ELM_LUC_MAPPING_FILE, GCAM2ELM_WOODHARVEST_MAPPING_FILE);
+    // Initialize GCAM and the emissions downscaling. E3SM does this through the wrapper with
+    // initcgcam_, which keeps its original arguments, and then the optional initcgcamemissions_.
+    p_obj->initGCAM(CASE_NAME, GCAM_CONFIG, GCAM2ELM_CO2_MAPPING_FILE, GCAM2ELM_LUC_MAPPING_FILE, GCAM2ELM_WOODHARVEST_MAPPING_FILE,
+                    BASE_CO2_SURFACE_FILE, BASE_CO2_AIRCRAFT_FILE, BASE_CO2_GCAM_FILE, ELM2GCAM_MAPPING_FILE,
+                    NUM_LON, NUM_LAT);
+    
+    // Add the other gases, E3SM does this with initcgcamgasemissions_
+    const vector<vector<string> > otherGases = {
+        { "CH4", BASE_CH4_SURFACE_FILE, BASE_CH4_GCAM_FILE },
+        { "BC", BASE_BC_SURFACE_FILE, BASE_BC_GCAM_FILE },
+        { "SO2", BASE_SO2_SURFACE_FILE, BASE_SO2_GCAM_FILE }
+    };
+    for( const auto& gas : otherGases ) {
+        if( !gas[ 1 ].empty() && !gas[ 2 ].empty() ) {
+            p_obj->addGasEmissions( gas[ 0 ], "surface", gas[ 1 ], gas[ 2 ], 1, true );
+        }
+    }
     
     // Set up data structures that will be passed to runGCAM
     // In fully coupled mode, these are allocated by E3SM
@@ -224,43 +235,24 @@ int main( ) {
     double *gcaminpp = new double [(*NUM_LAT) * (*NUM_LON) * (*NUM_PFT)]();
     double *gcamihr = new double [(*NUM_LAT) * (*NUM_LON) * (*NUM_PFT)]();
     double *gcamoluc = new double [(*NUM_GCAM_LAND_REGIONS) * (*NUM_IAC2ELM_LANDTYPES)]();
-    double *gcamoemiss = new double [(*NUM_EMISS_SECTORS) * (*NUM_EMISS_REGIONS) * (*NUM_EMISS_GASES)](); // Emissions by sector, gas, and region (not gridded)
-    double *gcamoco2sfcjan = new double [(*NUM_LAT) * (*NUM_LON)](); // Emissions data is monthly
-    double *gcamoco2sfcfeb = new double [(*NUM_LAT) * (*NUM_LON)](); // Emissions data is monthly
-    double *gcamoco2sfcmar = new double [(*NUM_LAT) * (*NUM_LON)](); // Emissions data is monthly
-    double *gcamoco2sfcapr = new double [(*NUM_LAT) * (*NUM_LON)](); // Emissions data is monthly
-    double *gcamoco2sfcmay = new double [(*NUM_LAT) * (*NUM_LON)](); // Emissions data is monthly
-    double *gcamoco2sfcjun = new double [(*NUM_LAT) * (*NUM_LON)](); // Emissions data is monthly
-    double *gcamoco2sfcjul = new double [(*NUM_LAT) * (*NUM_LON)](); // Emissions data is monthly
-    double *gcamoco2sfcaug = new double [(*NUM_LAT) * (*NUM_LON)](); // Emissions data is monthly
-    double *gcamoco2sfcsep = new double [(*NUM_LAT) * (*NUM_LON)](); // Emissions data is monthly
-    double *gcamoco2sfcoct = new double [(*NUM_LAT) * (*NUM_LON)](); // Emissions data is monthly
-    double *gcamoco2sfcnov = new double [(*NUM_LAT) * (*NUM_LON)](); // Emissions data is monthly
-    double *gcamoco2sfcdec = new double [(*NUM_LAT) * (*NUM_LON)](); // Emissions data is monthly
-    double *gcamoco2airhijan = new double [(*NUM_LAT) * (*NUM_LON)](); // Emissions data is monthly
-    double *gcamoco2airhifeb = new double [(*NUM_LAT) * (*NUM_LON)](); // Emissions data is monthly
-    double *gcamoco2airhimar = new double [(*NUM_LAT) * (*NUM_LON)](); // Emissions data is monthly
-    double *gcamoco2airhiapr = new double [(*NUM_LAT) * (*NUM_LON)](); // Emissions data is monthly
-    double *gcamoco2airhimay = new double [(*NUM_LAT) * (*NUM_LON)](); // Emissions data is monthly
-    double *gcamoco2airhijun = new double [(*NUM_LAT) * (*NUM_LON)](); // Emissions data is monthly
-    double *gcamoco2airhijul = new double [(*NUM_LAT) * (*NUM_LON)](); // Emissions data is monthly
-    double *gcamoco2airhiaug = new double [(*NUM_LAT) * (*NUM_LON)](); // Emissions data is monthly
-    double *gcamoco2airhisep = new double [(*NUM_LAT) * (*NUM_LON)](); // Emissions data is monthly
-    double *gcamoco2airhioct = new double [(*NUM_LAT) * (*NUM_LON)](); // Emissions data is monthly
-    double *gcamoco2airhinov = new double [(*NUM_LAT) * (*NUM_LON)](); // Emissions data is monthly
-    double *gcamoco2airhidec = new double [(*NUM_LAT) * (*NUM_LON)](); // Emissions data is monthly
-    double *gcamoco2airlojan = new double [(*NUM_LAT) * (*NUM_LON)](); // Emissions data is monthly
-    double *gcamoco2airlofeb = new double [(*NUM_LAT) * (*NUM_LON)](); // Emissions data is monthly
-    double *gcamoco2airlomar = new double [(*NUM_LAT) * (*NUM_LON)](); // Emissions data is monthly
-    double *gcamoco2airloapr = new double [(*NUM_LAT) * (*NUM_LON)](); // Emissions data is monthly
-    double *gcamoco2airlomay = new double [(*NUM_LAT) * (*NUM_LON)](); // Emissions data is monthly
-    double *gcamoco2airlojun = new double [(*NUM_LAT) * (*NUM_LON)](); // Emissions data is monthly
-    double *gcamoco2airlojul = new double [(*NUM_LAT) * (*NUM_LON)](); // Emissions data is monthly
-    double *gcamoco2airloaug = new double [(*NUM_LAT) * (*NUM_LON)](); // Emissions data is monthly
-    double *gcamoco2airlosep = new double [(*NUM_LAT) * (*NUM_LON)](); // Emissions data is monthly
-    double *gcamoco2airlooct = new double [(*NUM_LAT) * (*NUM_LON)](); // Emissions data is monthly
-    double *gcamoco2airlonov = new double [(*NUM_LAT) * (*NUM_LON)](); // Emissions data is monthly
-    double *gcamoco2airlodec = new double [(*NUM_LAT) * (*NUM_LON)](); // Emissions data is monthly
+    const int emissLength = (*NUM_EMISS_SECTORS) * (*NUM_EMISS_REGIONS);
+    double *gcamoemiss = new double [emissLength](); // CO2 emissions by sector and region (not gridded)
+    const int gasEmissLength = (*NUM_EMISS_GASES - 1) * (*NUM_EMISS_REGIONS);
+    double *gcamoghg = new double [gasEmissLength](); // Other gas emissions by region (not gridded)
+    // Gridded CO2 emissions, one contiguous block per sector holding month ( and level ) planes
+    const int numGridCells = (*NUM_LAT) * (*NUM_LON);
+    const int gasGridLength = numGridCells * 12 * (*NUM_EMISS_GASES - 1);
+    double *gcamoghggrid = new double [gasGridLength](); // Monthly surface emissions of each other gas
+    double *gcamoco2sfc = new double [numGridCells * 12](); // Emissions data is monthly
+    double *gcamoco2air = new double [numGridCells * 12 * 2](); // Monthly, low then high level
+    std::vector<double*> gcamoco2sfcPlanes( 12 );
+    std::vector<double*> gcamoco2airPlanes( 12 * 2 );
+    for( size_t plane = 0; plane < gcamoco2sfcPlanes.size(); ++plane ) {
+        gcamoco2sfcPlanes[ plane ] = gcamoco2sfc + plane * numGridCells;
+    }
+    for( size_t plane = 0; plane < gcamoco2airPlanes.size(); ++plane ) {
+        gcamoco2airPlanes[ plane ] = gcamoco2air + plane * numGridCells;
+    }
     
     /*
      STEP 4: RUN GCAM
@@ -292,12 +284,13 @@ int main( ) {
                     // Read in area of grid cell
                     tempData.readSpatialData("../cpl/data/landfrac.txt", true, false, false, gcamilfract);
                 }
-                p_obj->setDensityGCAM(yyyymmdd, gcamiarea, gcamilfract, gcamipftfract, gcaminpp, gcamihr,
-                                      NUM_LON, NUM_LAT, NUM_PFT, ELM2GCAM_MAPPING_FILE, FIRST_COUPLED_YEAR, READ_SCALARS, WRITE_SCALARS, BASE_NPP_FILE, BASE_HR_FILE, BASE_PFT_FILE);
+                p_obj->setDensityGCAM(yyyymmdd, gcamiarea, gcamipftfract, gcaminpp, gcamihr,
+                                      NUM_LON, NUM_LAT, NUM_PFT, ELM2GCAM_MAPPING_FILE, FIRST_COUPLED_YEAR, *READ_SCALARS == 1, *WRITE_SCALARS == 1,
+                                      ELM_IAC_CARBON_SCALING, BASE_NPP_FILE, BASE_HR_FILE, BASE_PFT_FILE);
             }
             
             // Run model
-            p_obj->runGCAM(yyyymmdd, gcamoluc, gcamoemiss);
+            p_obj->runGCAM(yyyymmdd, gcamoluc, gcamoemiss, emissLength);
             
             // TODO: Will we ever want to downscale emissions in this mode?
         }
@@ -330,27 +323,23 @@ int main( ) {
                 // Read in area of grid cell
                 tempData.readSpatialData("../cpl/data/landfrac.txt", true, false, false, gcamilfract);
             }
-            p_obj->setDensityGCAM(yyyymmdd, gcamiarea, gcamilfract, gcamipftfract, gcaminpp, gcamihr,
-                                  NUM_LON, NUM_LAT, NUM_PFT, ELM2GCAM_MAPPING_FILE, FIRST_COUPLED_YEAR, READ_SCALARS, WRITE_SCALARS, BASE_NPP_FILE, BASE_HR_FILE, BASE_PFT_FILE);
+            p_obj->setDensityGCAM(yyyymmdd, gcamiarea, gcamipftfract, gcaminpp, gcamihr,
+                                  NUM_LON, NUM_LAT, NUM_PFT, ELM2GCAM_MAPPING_FILE, FIRST_COUPLED_YEAR, *READ_SCALARS == 1, *WRITE_SCALARS == 1,
+                                  ELM_IAC_CARBON_SCALING, BASE_NPP_FILE, BASE_HR_FILE, BASE_PFT_FILE);
         }
         
         // Run model
-        p_obj->runGCAM(yyyymmdd, gcamoluc, gcamoemiss);
+        p_obj->runGCAM(yyyymmdd, gcamoluc, gcamoemiss, emissLength);
         
         if( IAC_EAM_CO2_EMISSIONS ) {
-            p_obj->downscaleEmissionsGCAM(gcamoemiss,
-                                      gcamoco2sfcjan, gcamoco2sfcfeb, gcamoco2sfcmar, gcamoco2sfcapr,
-                                      gcamoco2sfcmay, gcamoco2sfcjun, gcamoco2sfcjul, gcamoco2sfcaug,
-                                      gcamoco2sfcsep, gcamoco2sfcoct, gcamoco2sfcnov, gcamoco2sfcdec,
-                                      gcamoco2airlojan, gcamoco2airlofeb, gcamoco2airlomar, gcamoco2airloapr,
-                                      gcamoco2airlomay, gcamoco2airlojun, gcamoco2airlojul, gcamoco2airloaug,
-                                      gcamoco2airlosep, gcamoco2airlooct, gcamoco2airlonov, gcamoco2airlodec,
-                                      gcamoco2airhijan, gcamoco2airhifeb, gcamoco2airhimar, gcamoco2airhiapr,
-                                      gcamoco2airhimay, gcamoco2airhijun, gcamoco2airhijul, gcamoco2airhiaug,
-                                      gcamoco2airhisep, gcamoco2airhioct, gcamoco2airhinov, gcamoco2airhidec,
-                                      BASE_CO2_SURFACE_FILE, BASE_CO2EMISS_SURFACE, BASE_CO2_AIRCRAFT_FILE, BASE_CO2EMISS_AIRCRAFT,
-                                      ELM2GCAM_MAPPING_FILE,
-                                      NUM_LON, NUM_LAT, WRITE_CO2, YEAR);
+            // E3SM calls downscaleemissionscgcam_, which keeps its original arguments and
+            // passes its 36 month / level arrays as these plane tables.
+            p_obj->downscaleEmissionsGCAM(gcamoemiss, gcamoco2sfcPlanes, gcamoco2airPlanes,
+                                          *WRITE_CO2 == 1, YEAR);
+            if( *NUM_EMISS_GASES > 1 ) {
+                p_obj->getGasEmissions(gcamoghg, gasEmissLength);
+                p_obj->downscaleGasEmissionsGCAM(gcamoghggrid, gasGridLength, *WRITE_CO2 == 1, YEAR);
+            }
         }
         
     }
@@ -368,42 +357,10 @@ int main( ) {
     delete [] gcamihr;
     delete [] gcamoluc;
     delete [] gcamoemiss;
-    delete [] gcamoco2sfcjan;
-    delete [] gcamoco2sfcfeb;
-    delete [] gcamoco2sfcmar;
-    delete [] gcamoco2sfcapr;
-    delete [] gcamoco2sfcmay;
-    delete [] gcamoco2sfcjun;
-    delete [] gcamoco2sfcjul;
-    delete [] gcamoco2sfcaug;
-    delete [] gcamoco2sfcsep;
-    delete [] gcamoco2sfcoct;
-    delete [] gcamoco2sfcnov;
-    delete [] gcamoco2sfcdec;
-    delete [] gcamoco2airhijan;
-    delete [] gcamoco2airhifeb;
-    delete [] gcamoco2airhimar;
-    delete [] gcamoco2airhiapr;
-    delete [] gcamoco2airhimay;
-    delete [] gcamoco2airhijun;
-    delete [] gcamoco2airhijul;
-    delete [] gcamoco2airhiaug;
-    delete [] gcamoco2airhisep;
-    delete [] gcamoco2airhioct;
-    delete [] gcamoco2airhinov;
-    delete [] gcamoco2airhidec;
-    delete [] gcamoco2airlojan;
-    delete [] gcamoco2airlofeb;
-    delete [] gcamoco2airlomar;
-    delete [] gcamoco2airloapr;
-    delete [] gcamoco2airlomay;
-    delete [] gcamoco2airlojun;
-    delete [] gcamoco2airlojul;
-    delete [] gcamoco2airloaug;
-    delete [] gcamoco2airlosep;
-    delete [] gcamoco2airlooct;
-    delete [] gcamoco2airlonov;
-    delete [] gcamoco2airlodec;
+    delete [] gcamoghg;
+    delete [] gcamoghggrid;
+    delete [] gcamoco2sfc;
+    delete [] gcamoco2air;
     
     // Finalize Interface
     delete p_obj;
@@ -0,0 +1,204 @@
+/*
+* LEGAL NOTICE
+* This computer software was prepared by Battelle Memorial Institute,
+* hereinafter the Contractor, under Contract No. DE-AC05-76RL0 1830
+* with the Department of Energy (DOE). NEITHER THE GOVERNMENT NOR THE
+* CONTRACTOR MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR ASSUMES ANY
+* LIABILITY FOR THE USE OF THIS SOFTWARE. This notice including this
+* sentence must appear on any copies of this computer software.
+* 
+* EXPORT CONTROL
+* User agrees that the Software will not be shipped, transferred or
+* exported into any country or used in any manner prohibited by the
+* United States Export Administration Act or any other applicable
+* export laws, restrictions or regulations (collectively the "Export Laws").
+* Export of the Software may require some form of license or other
+* authority from the U.S. Government, and failure to obtain such
+* export control license may result in criminal liability under
+* U.S. laws. In addition, if the Software is identified as export controlled
+* items under the Export Laws, User represents and warrants that User
+* is not a citizen, or otherwise located within, an embargoed nation
+* (including without limitation Iran, Syria, Sudan, Cuba, and North Korea)
+*     and that User is not otherwise prohibited
+* under the Export Laws from receiving the Software.
+* 
+* Copyright 2011 Battelle Memorial Institute.  All Rights Reserved.
+* Distributed as open-source under the terms of the Educational Community 
+* License version 2.0 (ECL 2.0). http://www.opensource.org/licenses/ecl2.php
+* 
+* For further details, see: http://www.globalchange.umd.edu/models/gcam/
+*
+*/
+
+
+
+/*!
+* \file outlier_test.cpp
+* \brief Checks CarbonScalers::excludeOutliers against a sort based reference implementation.
+*
+*        Usage: outlier_test [--cases <n>] [--work-dir <dir>]
+*
+*        Each case generates random base year and current NPP and HR with injected outliers,
+*        negative values, and zero values, on grids from a few cells up to 288x192x17. The
+*        reference computes the median and MAD of the non-zero, non-NaN ratios with full sorts
+*        and masks each cell by its own ratio. The arrays masked by excludeOutliers must match
+*        it bit for bit. The program exits with a non-zero status if any case does not.
+*/
+
+// include standard libraries
+#include <iostream>
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+
+#include "util/base/include/definitions.h"
+#include "../include/aspatial_data.h"
+#include "../include/carbon_scalers.h"
+
+using namespace std;
+
+namespace {
+    const double MAD_LIMIT = 5.2;
+
+    // Median of the sorted values as the mean of the two middle values
+    double sortedMiddleValue( const vector<double>& aSorted ) {
+        if ( aSorted.size() == 1 ) {
+            return aSorted[ 0 ];
+        }
+        return 0.5 * ( aSorted[ aSorted.size() / 2 - 1 ] + aSorted[ aSorted.size() / 2 ] );
+    }
+
+    // Reference bounds: median +/- MAD_LIMIT * MAD of the non-zero, non-NaN ratios, using full sorts
+    void referenceBounds( const vector<double>& aValue, const vector<double>& aBase, double& aLower, double& aUpper ) {
+        vector<double> ratios;
+        for ( size_t i = 0; i < aValue.size(); i++ ) {
+            double ratio = aValue[ i ] / aBase[ i ];
+            if ( ratio != 0 && ratio == ratio ) {
+                ratios.push_back( ratio );
+            }
+        }
+        sort( ratios.begin(), ratios.end() );
+        double median = sortedMiddleValue( ratios );
+        for ( auto& ratio : ratios ) {
+            ratio = fabs( ratio - median );
+        }
+        sort( ratios.begin(), ratios.end() );
+        double mad = sortedMiddleValue( ratios );
+        aLower = median - MAD_LIMIT * mad;
+        aUpper = median + MAD_LIMIT * mad;
+    }
+
+    bool referenceIsOutlier( double aValue, double aBase, double aLower, double aUpper ) {
+        double ratio = aValue / aBase;
+        return ratio != 0 && ratio == ratio && ( ratio > aUpper || ratio < aLower );
+    }
+
+    void writeData( const string& aFileName, const vector<double>& aValues ) {
+        ASpatialData data( aValues.size() );
+        data.setValueVector( vector<double>( aValues ) );
+        data.writeBinarySpatialData( aFileName, true, true );
+    }
+}
+
+int main( int argc, char* argv[] ) {
+    int numCases = 40;
+    string workDir = ".";
+    for ( int i = 1; i < argc; i++ ) {
+        string arg = argv[i];
+        if ( arg == "--cases" && i + 1 < argc ) {
+            numCases = atoi( argv[++i] );
+        } else if ( arg == "--work-dir" && i + 1 < argc ) {
+            workDir = argv[++i];
+        } else {
+            cout << "Usage: " << argv[0] << " [--cases <n>] [--work-dir <dir>]" << endl;
+            return 1;
+        }
+    }
+    const string baseNPPFile = workDir + "/outlier_test_base_npp.bin";
+    const string baseHRFile = workDir + "/outlier_test_base_hr.bin";
+    const string basePFTFile = workDir + "/outlier_test_base_pft_wt.bin";
+
+    int numFailed = 0;
+    for ( int seed = 1; seed <= numCases; seed++ ) {
+        mt19937 random( seed );
+        uniform_real_distribution<double> unitDist( 0.0, 1.0 );
+
+        // Small odd and even grids, with the last few cases on the full 0.9x1.25 grid
+        int numLon = 3 + seed % 7;
+        int numLat = 2 + seed % 5;
+        int numPFT = 1 + seed % 4;
+        if ( seed > numCases - 4 ) {
+            numLon = 288;
+            numLat = 192;
+            numPFT = 17;
+        }
+        const int length = numLon * numLat * numPFT;
+
+        vector<double> baseNPP( length );
+        vector<double> baseHR( length );
+        vector<double> basePFT( length );
+        vector<double> npp( length );
+        vector<double> hr( length );
+        for ( int i = 0; i < length; i++ ) {
+            baseNPP[ i ] = unitDist( random ) < 0.2 ? 0.0 : 0.5 + unitDist( random );
+            baseHR[ i ] = unitDist( random ) < 0.2 ? 0.0 : 0.5 + unitDist( random );
+            npp[ i ] = unitDist( random ) < 0.1 ? 0.0 : baseNPP[ i ] * ( 0.8 + 0.4 * unitDist( random ) );
+            hr[ i ] = baseHR[ i ] * ( 0.8 + 0.4 * unitDist( random ) );
+            if ( unitDist( random ) < 0.03 ) {
+                npp[ i ] *= 50;
+            }
+            if ( unitDist( random ) < 0.03 ) {
+                hr[ i ] *= unitDist( random ) < 0.5 ? 0.01 : 30;
+            }
+            if ( unitDist( random ) < 0.01 ) {
+                npp[ i ] = -npp[ i ];
+            }
+        }
+        writeData( baseNPPFile, baseNPP );
+        writeData( baseHRFile, baseHR );
+        writeData( basePFTFile, basePFT );
+
+        CarbonScalers carbonScalers( numLat, numLon, numPFT );
+        carbonScalers.readBaseYearData( baseNPPFile, baseHRFile, basePFTFile );
+        vector<double> maskedNPP( npp );
+        vector<double> maskedHR( hr );
+        auto start = chrono::steady_clock::now();
+        carbonScalers.excludeOutliers( &maskedNPP[0], &maskedHR[0] );
+        double time = chrono::duration<double, milli>( chrono::steady_clock::now() - start ).count();
+
+        double lower;
+        double upper;
+        double lowerHR;
+        double upperHR;
+        referenceBounds( npp, baseNPP, lower, upper );
+        referenceBounds( hr, baseHR, lowerHR, upperHR );
+        int numMasked = 0;
+        int numDiff = 0;
+        for ( int i = 0; i < length; i++ ) {
+            bool masked = referenceIsOutlier( npp[ i ], baseNPP[ i ], lower, upper ) ||
+                          referenceIsOutlier( hr[ i ], baseHR[ i ], lowerHR, upperHR );
+            numMasked += masked;
+            double expectedNPP = masked ? 0.0 : npp[ i ];
+            double expectedHR = masked ? 0.0 : hr[ i ];
+            if ( memcmp( &expectedNPP, &maskedNPP[ i ], sizeof( double ) ) != 0 ||
+                 memcmp( &expectedHR, &maskedHR[ i ], sizeof( double ) ) != 0 ) {
+                numDiff++;
+            }
+        }
+        if ( numDiff > 0 ) {
+            numFailed++;
+            cout << "Case " << seed << " (" << length << " values): " << numDiff << " cells differ from the reference" << endl;
+        } else if ( length > 100000 ) {
+            cout << "Case " << seed << " (" << length << " values): " << numMasked << " masked, "
+                 << time << " ms" << endl;
+        }
+    }
+    cout << numCases - numFailed << " of " << numCases << " cases match the reference" << endl;
+
+    return numFailed == 0 ? 0 : 1;
+}
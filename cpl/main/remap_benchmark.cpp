@@ -0,0 +1,265 @@
+/*
+* LEGAL NOTICE
+* This computer software was prepared by Battelle Memorial Institute,
+* hereinafter the Contractor, under Contract No. DE-AC05-76RL0 1830
+* with the Department of Energy (DOE). NEITHER THE GOVERNMENT NOR THE
+* CONTRACTOR MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR ASSUMES ANY
+* LIABILITY FOR THE USE OF THIS SOFTWARE. This notice including this
+* sentence must appear on any copies of this computer software.
+* 
+* EXPORT CONTROL
+* User agrees that the Software will not be shipped, transferred or
+* exported into any country or used in any manner prohibited by the
+* United States Export Administration Act or any other applicable
+* export laws, restrictions or regulations (collectively the "Export Laws").
+* Export of the Software may require some form of license or other
+* authority from the U.S. Government, and failure to obtain such
+* export control license may result in criminal liability under
+* U.S. laws. In addition, if the Software is identified as export controlled
+* items under the Export Laws, User represents and warrants that User
+* is not a citizen, or otherwise located within, an embargoed nation
+* (including without limitation Iran, Syria, Sudan, Cuba, and North Korea)
+*     and that User is not otherwise prohibited
+* under the Export Laws from receiving the Software.
+* 
+* Copyright 2011 Battelle Memorial Institute.  All Rights Reserved.
+* Distributed as open-source under the terms of the Educational Community 
+* License version 2.0 (ECL 2.0). http://www.opensource.org/licenses/ecl2.php
+* 
+* For further details, see: http://www.globalchange.umd.edu/models/gcam/
+*
+*/
+
+
+/*!
+* \file remap_benchmark.cpp
+* \brief Times adding values to a ReMapData against the lookups it used to do.
+*
+*        Usage: remap_benchmark [--luc <file>] [--woodharvest <file>] [--periods <n>]
+*
+*        The land use change and wood harvest mappings are read the same way as in
+*        GCAM_E3SM_interface::initGCAM. A value is then added for every land leaf the
+*        mapping could see, that is every land type in every region and basin, with and
+*        without the water and management suffixes, for a number of model periods. This
+*        is done with ReMapData::setData and with a copy of the original lookup, which
+*        split the land name and then searched a std::map for the rename and the output
+*        names linearly in each column. The time per period of each is printed and the
+*        data is checked to be bit-identical.
+*/
+
+// include standard libraries
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+
+#include <xercesc/dom/DOMNode.hpp>
+
+#include "util/base/include/definitions.h"
+#include "util/base/include/iparsable.h"
+#include "util/base/include/xml_helper.h"
+#include "reporting/include/xml_db_outputter.h"
+#include "../include/remap_data.h"
+
+using namespace std;
+using namespace xercesc;
+
+namespace {
+    // The ReMapData lookups as they were done before the columns were hashed.
+    // This is kept as the reference the current implementation must reproduce exactly.
+    class LinearReMapData : public IParsable {
+    public:
+        LinearReMapData( const vector<int>& aYears, const map<int, int>& aYearRemap ):
+        mLandNameColumn( false ),
+        mYears( aYears ),
+        mYearRemap( aYearRemap )
+        {
+        }
+
+        virtual bool XMLParse( const DOMNode* aNode ) {
+            for ( DOMNode* curr = aNode->getFirstChild(); curr; curr = curr->getNextSibling() ) {
+                const string nodeName = XMLHelper<string>::safeTranscode( curr->getNodeName() );
+                if ( nodeName == "column" ) {
+                    ReMapDataHelper<string> column;
+                    column.mDataName = XMLHelper<string>::getAttr( curr, "name" );
+                    for ( DOMNode* child = curr->getFirstChild(); child; child = child->getNextSibling() ) {
+                        const string childName = XMLHelper<string>::safeTranscode( child->getNodeName() );
+                        if ( childName == "output-data" ) {
+                            column.mInOrderOutputNames.push_back( XMLHelper<string>::getValue( child ) );
+                        }
+                        else if ( childName == "map" ) {
+                            column.mGCAMToOutputNameMap[ XMLHelper<string>::getAttr( child, "from" ) ] =
+                                XMLHelper<string>::getAttr( child, "to" );
+                        }
+                    }
+                    mColumns.push_back( column );
+                }
+                else if ( nodeName == "land-name-column" ) {
+                    mLandNameColumn = true;
+                }
+            }
+            size_t size = mYears.size();
+            for ( const auto& col : mColumns ) {
+                size *= col.mInOrderOutputNames.size();
+            }
+            mData.assign( size, 0.0 );
+            return true;
+        }
+
+        void setData( vector<string>& aColValues, const int aYearValue, const double aValue ) {
+            decomposeLandNames( aColValues );
+            if ( aValue != 0 ) {
+                size_t index = findIndex( mYears, mYearRemap, aYearValue );
+                size_t currStride = mYears.size();
+                for ( size_t colIndex = aColValues.size(); colIndex-- > 0; ) {
+                    index += findIndex( mColumns[ colIndex ].mInOrderOutputNames,
+                                        mColumns[ colIndex ].mGCAMToOutputNameMap, aColValues[ colIndex ] ) * currStride;
+                    currStride *= mColumns[ colIndex ].mInOrderOutputNames.size();
+                }
+                if ( index >= currStride ) {
+                    abort();
+                }
+                mData[ index ] += aValue;
+            }
+        }
+
+        const vector<ReMapDataHelper<string> >& getColumns() const {
+            return mColumns;
+        }
+
+        vector<double> mData;
+
+    private:
+        bool mLandNameColumn;
+        vector<ReMapDataHelper<string> > mColumns;
+        vector<int> mYears;
+        map<int, int> mYearRemap;
+
+        template<typename T>
+        static size_t findIndex( const vector<T>& aOutputNames, const map<T, T>& aRenames, const T& aGCAMName ) {
+            T outputName = aGCAMName;
+            auto iter = aRenames.find( aGCAMName );
+            if ( iter != aRenames.end() ) {
+                outputName = ( *iter ).second;
+            }
+            return find( aOutputNames.begin(), aOutputNames.end(), outputName ) - aOutputNames.begin();
+        }
+
+        void decomposeLandNames( vector<string>& aColValues ) const {
+            if ( mLandNameColumn ) {
+                size_t regionIndex = 0;
+                size_t landTypeIndex = 1;
+                for ( size_t colIndex = aColValues.size(); colIndex-- > 0; ) {
+                    if ( mColumns[ colIndex ].mDataName == "region" ) {
+                        regionIndex = colIndex;
+                    }
+                    else if ( mColumns[ colIndex ].mDataName == "land-type" ) {
+                        landTypeIndex = colIndex;
+                    }
+                }
+                map<string, string> landNames = XMLDBOutputter::decomposeLandName( aColValues[ landTypeIndex ] );
+                aColValues[ regionIndex ] = aColValues[ regionIndex ] + "_" + landNames[ "land-region" ];
+                aColValues[ landTypeIndex ] = landNames[ "crop" ];
+            }
+        }
+    };
+
+    // Every land leaf name the mapping can resolve: each GCAM land type in each region
+    // and basin, bare and with the water and management suffixes.
+    vector<vector<string> > makeLandLeaves( const LinearReMapData& aMapping ) {
+        vector<string> regions;
+        vector<string> landTypes;
+        for ( const auto& col : aMapping.getColumns() ) {
+            if ( col.mDataName == "region" ) {
+                regions = col.mInOrderOutputNames;
+            }
+            else {
+                for ( const auto& rename : col.mGCAMToOutputNameMap ) {
+                    landTypes.push_back( rename.first );
+                }
+            }
+        }
+        vector<vector<string> > leaves;
+        for ( const auto& regionBasin : regions ) {
+            const size_t pos = regionBasin.rfind( '_' );
+            const string region = regionBasin.substr( 0, pos );
+            const string basin = regionBasin.substr( pos + 1 );
+            for ( const auto& landType : landTypes ) {
+                leaves.push_back( { region, landType + "_" + basin } );
+                leaves.push_back( { region, landType + "_" + basin + "_IRR_hi" } );
+                leaves.push_back( { region, landType + "_" + basin + "_RFD_lo" } );
+            }
+        }
+        return leaves;
+    }
+
+    template<typename Mapping>
+    double timeSetData( Mapping& aMapping, const vector<vector<string> >& aLeaves, const vector<int>& aModelYears ) {
+        auto start = chrono::steady_clock::now();
+        for ( int year : aModelYears ) {
+            for ( size_t i = 0; i < aLeaves.size(); i++ ) {
+                // setData rewrites the land names so each call needs a fresh copy as from a query
+                vector<string> colValues = aLeaves[ i ];
+                aMapping.setData( colValues, year, 1.0 + i % 7 );
+            }
+        }
+        return chrono::duration<double, milli>( chrono::steady_clock::now() - start ).count() / aModelYears.size();
+    }
+}
+
+int main( int argc, char* argv[] ) {
+    string lucFile = "../mappings/luc.xml";
+    string woodHarvestFile = "../mappings/woodharvest.xml";
+    int numPeriods = 20;
+    for ( int i = 1; i < argc; i++ ) {
+        string arg = argv[i];
+        if ( arg == "--luc" && i + 1 < argc ) {
+            lucFile = argv[++i];
+        } else if ( arg == "--woodharvest" && i + 1 < argc ) {
+            woodHarvestFile = argv[++i];
+        } else if ( arg == "--periods" && i + 1 < argc ) {
+            numPeriods = atoi( argv[++i] );
+        } else {
+            cout << "Usage: " << argv[0] << " [--luc <file>] [--woodharvest <file>] [--periods <n>]" << endl;
+            return 1;
+        }
+    }
+
+    // All model years are remapped to a single year as in GCAM_E3SM_interface::initGCAM
+    vector<int> years{ 0 };
+    map<int, int> yearRemap;
+    vector<int> modelYears;
+    for ( int period = 0; period < numPeriods; period++ ) {
+        modelYears.push_back( 2015 + 5 * period );
+        yearRemap[ modelYears.back() ] = 0;
+    }
+
+    bool allMatch = true;
+    for ( const string& mappingFile : { lucFile, woodHarvestFile } ) {
+        ReMapData mapping;
+        LinearReMapData reference( years, yearRemap );
+        if ( !XMLHelper<void>::parseXML( mappingFile, &mapping ) || !XMLHelper<void>::parseXML( mappingFile, &reference ) ) {
+            cout << "Could not parse " << mappingFile << endl;
+            return 1;
+        }
+        mapping.addYearColumn( "Year", years, yearRemap );
+        mapping.finalizeColumns();
+        const vector<vector<string> > leaves = makeLandLeaves( reference );
+
+        const double refTime = timeSetData( reference, leaves, modelYears );
+        const double newTime = timeSetData( mapping, leaves, modelYears );
+
+        const bool match = mapping.getArrayLength() == reference.mData.size() &&
+            memcmp( mapping.getData(), &reference.mData[ 0 ], reference.mData.size() * sizeof( double ) ) == 0;
+        allMatch = allMatch && match;
+        cout << mappingFile << ": " << leaves.size() << " leaves, " << refTime << " ms -> " << newTime
+             << " ms per period, " << ( match ? "identical" : "DIFFERENT" ) << endl;
+    }
+    XMLHelper<void>::cleanupParser();
+
+    return allMatch ? 0 : 1;
+}
@@ -13,6 +13,9 @@
 #include "../include/set_data_helper.h"
 #include "../include/carbon_scalers.h"
 #include "../include/emiss_downscale.h"
+#include "../include/async_writer.h"
+#include "../include/coupling_timings.h"
+#include "../include/grid_mapping.h"
 #include "util/base/include/xml_helper.h"
 
 ofstream outFile;
@@ -25,7 +28,13 @@ int restartPeriod; // Restart period is set externally and used in manage state
 /*! \brief Constructor
  * \details This is the constructor for the E3SM_driver class.
  */
-GCAM_E3SM_interface::GCAM_E3SM_interface()
+GCAM_E3SM_interface::GCAM_E3SM_interface():
+mNumLon(0),
+mNumLat(0),
+mEmissAllGases(false),
+mEmissBoundPeriod(-1),
+mTimings(new CouplingTimings("./gcam_coupling_timings")),
+mWriter(new AsyncWriter())
 {
 }
 
@@ -127,7 +136,11 @@ void GCAM_E3SM_interface::initGCAM(std::string aCaseName, std::string aGCAMConfi
         yearRemap[modeltime->getper_to_yr(period)] = 0;
     }
 
+    TimerRegistry& timers = TimerRegistry::getInstance();
+    Timer& parseMappingsTimer = timers.getTimer("cpl-parse-mappings");
+
     // Setup the CO2 mappings
+    parseMappingsTimer.start();
     success = XMLHelper<void>::parseXML(aGCAM2ELMCO2Map, &mCO2EmissData);
     mCO2EmissData.addYearColumn("Year", years, yearRemap);
     mCO2EmissData.finalizeColumns();
@@ -135,10 +148,12 @@ void GCAM_E3SM_interface::initGCAM(std::string aCaseName, std::string aGCAMConfi
     ILogger &coupleLog = ILogger::getLogger("coupling_log"); // test
     coupleLog.setLevel(ILogger::NOTICE);                     // test
     coupleLog << aGCAM2ELMCO2Map << endl;                    // test
+    parseMappingsTimer.stop();
     coupleLog << mCO2EmissData << endl;                      // test
     coupleLog << aGCAM2ELMLUCMap << endl;                    // test
 
     // Setup the land use change mappings
+    parseMappingsTimer.start();
     success = XMLHelper<void>::parseXML(aGCAM2ELMLUCMap, &mLUCData);
     mLUCData.addYearColumn("Year", years, yearRemap);
     mLUCData.finalizeColumns();
@@ -147,6 +162,16 @@ void GCAM_E3SM_interface::initGCAM(std::string aCaseName, std::string aGCAMConfi
     success = XMLHelper<void>::parseXML(aGCAM2ELMWHMap, &mWoodHarvestData);
     mWoodHarvestData.addYearColumn("Year", years, yearRemap);
     mWoodHarvestData.finalizeColumns();
+    parseMappingsTimer.stop();
+
+    // Set up the output queries. The year is read rather than fixed so the values for
+    // every year can be bound once and gathered in each runGCAM.
+    // If the emissions mapping has a ghg column the gases in it are read, otherwise just CO2.
+    vector<string> emissColumns = mCO2EmissData.getColumnNames();
+    mEmissAllGases = find(emissColumns.begin(), emissColumns.end(), "ghg") != emissColumns.end();
+    mGetCO2.reset(new GetDataHelper(getEmissionsPath(-1), mCO2EmissData));
+    mGetLUC.reset(new GetDataHelper("world/region[+NamedFilter,MatchesAny]/land-allocator//child-nodes[+NamedFilter,MatchesAny]/land-allocation[+YearFilter,MatchesAny]", mLUCData));
+    mGetWH.reset(new GetDataHelper("world/region[+NamedFilter,MatchesAny]/sector[NamedFilter,StringEquals,Forest]/subsector/technology[+NamedFilter,MatchesAny]//output[IndexFilter,IntEquals,0]/physical-output[+YearFilter,MatchesAny]", mWoodHarvestData));
 
     // Clean up
     XMLHelper<void>::cleanupParser();
@@ -155,10 +180,186 @@ void GCAM_E3SM_interface::initGCAM(std::string aCaseName, std::string aGCAMConfi
     gcamStartYear = modeltime->getStartYear();
     gcamEndYear = modeltime->getEndYear();
 
+    // E3SM reads the CO2 surface and aircraft emissions of each region
+    const vector<size_t> sfcIndex = getEmissionsIndex("CO2", "surface");
+    const vector<size_t> airIndex = getEmissionsIndex("CO2", "aircraft");
+    mCO2EmissIndex.clear();
+    for (size_t reg = 0; reg < sfcIndex.size(); reg++)
+    {
+        mCO2EmissIndex.push_back(sfcIndex[reg]);
+        mCO2EmissIndex.push_back(airIndex[reg]);
+    }
+
     // Stop the timer
     timer.stop();
 }
 
+/*! \brief Initialize GCAM and the emissions downscaling.
+ * \details This is initGCAM followed by initEmissionsDownscaling.
+ */
+void GCAM_E3SM_interface::initGCAM(std::string aCaseName, std::string aGCAMConfig, std::string aGCAM2ELMCO2Map, std::string aGCAM2ELMLUCMap, std::string aGCAM2ELMWHMap,
+                                   std::string aBaseCO2SfcFile, std::string aBaseCO2AirFile, std::string aGCAMBaseCO2EmisFile, std::string aMappingFile,
+                                   int *aNumLon, int *aNumLat)
+{
+    initGCAM(aCaseName, aGCAMConfig, aGCAM2ELMCO2Map, aGCAM2ELMLUCMap, aGCAM2ELMWHMap);
+    initEmissionsDownscaling(aBaseCO2SfcFile, aBaseCO2AirFile, aGCAMBaseCO2EmisFile, aMappingFile, aNumLon, aNumLat);
+}
+
+/*! \brief Set up the emissions downscaling.
+ * \details The gridded base year emissions, the regional mapping, and the regional base
+ *          year emissions do not change, so they are only read once here. The regions, and
+ *          where each region's emissions are, come from the emissions mapping, so this must
+ *          be called after initGCAM.
+ */
+void GCAM_E3SM_interface::initEmissionsDownscaling(std::string aBaseCO2SfcFile, std::string aBaseCO2AirFile, std::string aGCAMBaseCO2EmisFile, std::string aMappingFile,
+                                                   int *aNumLon, int *aNumLat)
+{
+    ILogger &coupleLog = ILogger::getLogger("coupling_log");
+    coupleLog.setLevel(ILogger::NOTICE);
+    TimerRegistry& timers = TimerRegistry::getInstance();
+    Timer& parseMappingsTimer = timers.getTimer("cpl-parse-mappings");
+    Timer& readFilesTimer = timers.getTimer("cpl-read-files");
+
+    mNumLon = *aNumLon;
+    mNumLat = *aNumLat;
+    mSurfaceCO2.reset(new EmissDownscale(mNumLon, mNumLat, 12, 1, true)); // Emissions data is monthly now
+    readFilesTimer.start();
+    mSurfaceCO2->readGriddedBaseYearEmissionData(aBaseCO2SfcFile);
+    readFilesTimer.stop();
+    parseMappingsTimer.start();
+    if (!mGridMapping || mGridMapping->mFileName != aMappingFile)
+    {
+        mGridMapping = GridMapping::readGridMapping(aMappingFile);
+    }
+    mSurfaceCO2->readRegionalMappingData(*mGridMapping, mCO2EmissData.getColumnOutputNames("region"));
+    parseMappingsTimer.stop();
+    readFilesTimer.start();
+    mSurfaceCO2->readRegionalBaseYearEmissionData(aGCAMBaseCO2EmisFile, "surface");
+
+    mAircraftCO2.reset(new EmissDownscale(mNumLon, mNumLat, 12, 2, false)); // Emissions data is monthly now; we're using two different height levels for aircraft
+    mAircraftCO2->readGriddedBaseYearEmissionData(aBaseCO2AirFile);
+    mAircraftCO2->setRegionalMapping(mSurfaceCO2->getRegionalMapping());
+    mAircraftCO2->readRegionalBaseYearEmissionData(aGCAMBaseCO2EmisFile, "aircraft");
+    readFilesTimer.stop();
+
+    // CO2 is downscaled from the emissions runGCAM copies to E3SM, see mCO2EmissIndex
+    vector<size_t> sfcIndex;
+    vector<size_t> airIndex;
+    for (size_t index = 0; index < mCO2EmissIndex.size(); index += 2)
+    {
+        sfcIndex.push_back(index);
+        airIndex.push_back(index + 1);
+    }
+    mSurfaceCO2->setRegionalEmissionsIndex(sfcIndex);
+    mAircraftCO2->setRegionalEmissionsIndex(airIndex);
+
+    const vector<double>& baseSfc = mSurfaceCO2->getRegionalBaseYearEmissions();
+    coupleLog << "Base-Year Surface CO2 emission" << endl;
+    coupleLog << baseSfc.front() << endl;
+    coupleLog << baseSfc[baseSfc.size() / 2] << endl;
+    coupleLog << baseSfc.back() << endl;
+    const vector<double>& baseAir = mAircraftCO2->getRegionalBaseYearEmissions();
+    coupleLog << "Base-Year Aircraft CO2 emission" << endl;
+    coupleLog << baseAir.front() << endl;
+    coupleLog << baseAir[baseAir.size() / 2] << endl;
+    coupleLog << baseAir.back() << endl;
+}
+
+//! Whether initEmissionsDownscaling has been called
+bool GCAM_E3SM_interface::isEmissionsDownscalingInitialized() const
+{
+    return mSurfaceCO2.get() != 0;
+}
+
+/*! \brief Add the downscaling of a gas other than CO2.
+ * \details The regional emissions of the gas are kept apart from the CO2 that runGCAM
+ *          copies to E3SM, see getGasEmissions, and all of the added gases are downscaled
+ *          together by downscaleGasEmissionsGCAM. The emissions mapping must have a ghg
+ *          column with the gas and the sector. This must be called after
+ *          initEmissionsDownscaling, whose regional mapping is shared.
+ * \param aGas output name of the gas in the emissions mapping
+ * \param aSector output name of the sector in the emissions mapping
+ * \param aBaseGriddedFile gridded base year emissions of the gas and sector, monthly for each level
+ * \param aGCAMBaseEmisFile regional base year emissions of the gas by sector
+ * \param aNumLev number of levels in the gridded emissions
+ * \param aNormalizeWeight whether the scaler of a grid cell is normalized by the total weight of its regions
+ */
+void GCAM_E3SM_interface::addGasEmissions(std::string aGas, std::string aSector, std::string aBaseGriddedFile, std::string aGCAMBaseEmisFile,
+                                          int aNumLev, bool aNormalizeWeight)
+{
+    ILogger &coupleLog = ILogger::getLogger("coupling_log");
+    if (!mSurfaceCO2)
+    {
+        coupleLog.setLevel(ILogger::ERROR);
+        coupleLog << "Emissions downscaling has not been set up, initEmissionsDownscaling must be called before adding " << aGas << endl;
+        exit(EXIT_FAILURE);
+    }
+    if (!mEmissAllGases)
+    {
+        coupleLog.setLevel(ILogger::ERROR);
+        coupleLog << "The emissions mapping needs a ghg column to downscale " << aGas << endl;
+        exit(EXIT_FAILURE);
+    }
+    coupleLog.setLevel(ILogger::NOTICE);
+    coupleLog << "Downscaling " << aGas << " " << aSector << " emissions" << endl;
+
+    TimerRegistry& timers = TimerRegistry::getInstance();
+    Timer& readFilesTimer = timers.getTimer("cpl-read-files");
+
+    GasEmissions gas;
+    gas.mGas = aGas;
+    gas.mSector = aSector;
+    gas.mNumLev = aNumLev;
+    gas.mDownscaler.reset(new EmissDownscale(mNumLon, mNumLat, 12, aNumLev, aNormalizeWeight));
+    gas.mDownscaler->setRegionalMapping(mSurfaceCO2->getRegionalMapping());
+    readFilesTimer.start();
+    gas.mDownscaler->readGriddedBaseYearEmissionData(aBaseGriddedFile);
+    gas.mDownscaler->readRegionalBaseYearEmissionData(aGCAMBaseEmisFile, aSector);
+    readFilesTimer.stop();
+    gas.mGCAMIndex = getEmissionsIndex(aGas, aSector);
+
+    // The gas is downscaled from its own block of mGasRegionEmiss
+    const size_t numRegions = gas.mGCAMIndex.size();
+    vector<size_t> regionIndex;
+    for (size_t reg = 0; reg < numRegions; reg++)
+    {
+        regionIndex.push_back(mGases.size() * numRegions + reg);
+    }
+    gas.mDownscaler->setRegionalEmissionsIndex(regionIndex);
+    mGases.push_back(std::move(gas));
+    mGasRegionEmiss.assign(mGases.size() * numRegions, 0.0);
+}
+
+//! Length of the gcamoemiss array runGCAM copies the CO2 emissions to
+int GCAM_E3SM_interface::getCO2EmissionsLength() const
+{
+    return mCO2EmissIndex.size();
+}
+
+//! Length of the regional emissions of the gases added by addGasEmissions
+int GCAM_E3SM_interface::getGasEmissionsLength() const
+{
+    return mGasRegionEmiss.size();
+}
+
+/*! \brief Copy the regional emissions of the added gases from the last runGCAM.
+ * \param aGasEmiss output with the emissions of each region, one block of regions for each
+ *        gas in the order they were added
+ * \param aLength length of aGasEmiss, which must be getGasEmissionsLength()
+ */
+void GCAM_E3SM_interface::getGasEmissions(double *aGasEmiss, const int aLength) const
+{
+    if (aLength != getGasEmissionsLength())
+    {
+        ILogger &coupleLog = ILogger::getLogger("coupling_log");
+        coupleLog.setLevel(ILogger::ERROR);
+        coupleLog << "The gas emissions array has length " << aLength << " but " << mGases.size()
+                  << " gases are downscaled, which need " << getGasEmissionsLength() << endl;
+        exit(EXIT_FAILURE);
+    }
+    std::copy(mGasRegionEmiss.begin(), mGasRegionEmiss.end(), aGasEmiss);
+}
+
 /*!
  * \brief Run GCAM as part of E3SM.
  * \author Kate Calvin
@@ -170,15 +371,15 @@ void GCAM_E3SM_interface::initGCAM(std::string aCaseName, std::string aGCAMConfi
  * \param gcamo array of outputs from GCAM for use in E3SM
  * \param gcamo_fdim1_nflds number of elements in gcamo
  * \param gcamo_fdim2_datasize size of gcamo
- * \param gcamoemis array of emissions outputs from GCAM for use in E3SM
- * \param gcamoemis_fdim1_nflds number of elements in gcamoemis
- * \param gcamoemis_fdim2_datasize size of gcamoemis
+ * \param gcamoemiss array of emissions outputs from GCAM for use in E3SM, the CO2
+ *        surface and aircraft emissions of each region
+ * \param aEmissLength length of gcamoemiss, which must be getCO2EmissionsLength()
  * \param yr1 Year index used in GLM?
  * \param yr2 Year index used in GLM?
  * \param sneakermode integer indicating sneakernet mode is on
  * \param write_rest integer indicating restarts should be written
  */
-void GCAM_E3SM_interface::runGCAM(int *yyyymmdd, double *gcamoluc, double *gcamoemiss)
+void GCAM_E3SM_interface::runGCAM(int *yyyymmdd, double *gcamoluc, double *gcamoemiss, const int aEmissLength)
 {
     // Get year only of the current date
     const Modeltime *modeltime = runner->getInternalScenario()->getModeltime();
@@ -210,9 +411,18 @@ void GCAM_E3SM_interface::runGCAM(int *yyyymmdd, double *gcamoluc, double *gcamo
     }
 
     coupleLog << "Current E3SM Year is " << e3smYear << ", Current GCAM Year is " << gcamYear << endl;
+    mTimings->setYear(e3smYear);
 
     int finalCalibrationYear = modeltime->getper_to_yr(modeltime->getFinalCalibrationPeriod());
 
+    if (aEmissLength != getCO2EmissionsLength())
+    {
+        coupleLog.setLevel(ILogger::ERROR);
+        coupleLog << "The emissions array has length " << aEmissLength << " but the CO2 surface and aircraft emissions of "
+                  << mCO2EmissIndex.size() / 2 << " regions need " << getCO2EmissionsLength() << endl;
+        exit(EXIT_FAILURE);
+    }
+
     if (modeltime->isModelYear(gcamYear))
     {
         // set restart period
@@ -226,22 +436,61 @@ void GCAM_E3SM_interface::runGCAM(int *yyyymmdd, double *gcamoluc, double *gcamo
 
         coupleLog.precision(20);
 
+        TimerRegistry& timers = TimerRegistry::getInstance();
+        Timer& solveTimer = timers.getTimer("cpl-solve");
+        Timer& getOutputsTimer = timers.getTimer("cpl-get-outputs");
+        Timer& outputCopyTimer = timers.getTimer("cpl-output-copy");
+
         // Initialize the timer.  Create an object of the Timer class.
         timer.start();
+        solveTimer.start();
 
         // Run this GCAM period
         success = runner->runScenarios(gcamPeriod, true, timer);
 
         // Stop the timer
+        solveTimer.stop();
         timer.stop();
 
         coupleLog << "Getting CO2 Emissions" << endl;
         double *co2 = mCO2EmissData.getData();
         // be sure to reset any data set previously
+        getOutputsTimer.start();
         fill(co2, co2 + mCO2EmissData.getArrayLength(), 0.0);
-        GetDataHelper getCo2("world/region[+NamedFilter,MatchesAny]/sector[+NamedFilter,MatchesAny]//ghg[NamedFilter,StringEquals,CO2]/emissions[+YearFilter,IntEquals," + util::toString(gcamYear) + "]", mCO2EmissData);
-        getCo2.run(runner->getInternalScenario());
-        std::copy(co2, co2 + mCO2EmissData.getArrayLength(), gcamoemiss);
+        // CO2 is created with each technology when it is read in, but the other gases of a
+        // new vintage are copied from the previous one in TechnologyContainer::initCalc. Those
+        // only exist once their period has started, so the GHGs of each vintage run since the
+        // query was bound are added to it.
+        if (mEmissAllGases && mEmissBoundPeriod >= 0)
+        {
+            for (int period = mEmissBoundPeriod + 1; period <= gcamPeriod; ++period)
+            {
+                GetDataHelper newVintage(getEmissionsPath(modeltime->getper_to_yr(period)), mCO2EmissData);
+                mGetCO2->appendBindings(runner->getInternalScenario(), newVintage);
+            }
+        }
+        mGetCO2->gather(runner->getInternalScenario(), gcamYear);
+        mEmissBoundPeriod = max(mEmissBoundPeriod, gcamPeriod);
+        getOutputsTimer.stop();
+        if (mEmissAllGases && gcamPeriod > 0)
+        {
+            checkGasEmissions(gcamYear);
+        }
+        outputCopyTimer.start();
+        // E3SM only reads the CO2, the other gases are kept for getGasEmissions
+        for (size_t i = 0; i < mCO2EmissIndex.size(); i++)
+        {
+            gcamoemiss[i] = co2[mCO2EmissIndex[i]];
+        }
+        const size_t numEmissRegions = mCO2EmissIndex.size() / 2;
+        for (size_t gas = 0; gas < mGases.size(); gas++)
+        {
+            for (size_t reg = 0; reg < numEmissRegions; reg++)
+            {
+                mGasRegionEmiss[gas * numEmissRegions + reg] = co2[mGases[gas].mGCAMIndex[reg]];
+            }
+        }
+        outputCopyTimer.stop();
         coupleLog << "mCO2EmissData.getArrayLength:" << endl;
         coupleLog << mCO2EmissData.getArrayLength() << endl;
         coupleLog << gcamoemiss[0] << endl;
@@ -252,20 +501,23 @@ void GCAM_E3SM_interface::runGCAM(int *yyyymmdd, double *gcamoluc, double *gcamo
         coupleLog << "Getting LUC" << endl;
         double *luc = mLUCData.getData();
         // be sure to reset any data set previously
+        getOutputsTimer.start();
         fill(luc, luc + mLUCData.getArrayLength(), 0.0);
-        GetDataHelper getLUC("world/region[+NamedFilter,MatchesAny]/land-allocator//child-nodes[+NamedFilter,MatchesAny]/land-allocation[+YearFilter,IntEquals," + util::toString(gcamYear) + "]", mLUCData);
-        getLUC.run(runner->getInternalScenario());
+        mGetLUC->gather(runner->getInternalScenario(), gcamYear);
+        getOutputsTimer.stop();
         //coupleLog << mLUCData << endl;
 
         coupleLog << "Getting Wood harvest" << endl;
         double *woodHarvest = mWoodHarvestData.getData();
         // be sure to reset any data set previously
+        getOutputsTimer.start();
         fill(woodHarvest, woodHarvest + mWoodHarvestData.getArrayLength(), 0.0);
-        GetDataHelper getWH("world/region[+NamedFilter,MatchesAny]/sector[NamedFilter,StringEquals,Forest]/subsector/technology[+NamedFilter,MatchesAny]//output[IndexFilter,IntEquals,0]/physical-output[+YearFilter,IntEquals," + util::toString(gcamYear) + "]", mWoodHarvestData);
-        getWH.run(runner->getInternalScenario());
+        mGetWH->gather(runner->getInternalScenario(), gcamYear);
+        getOutputsTimer.stop();
         //coupleLog << mWoodHarvestData << endl;
 
         // Set data in the gcamoluc* arrays
+        outputCopyTimer.start();
         const Modeltime *modeltime = runner->getInternalScenario()->getModeltime();
         int row = 0;
         int lurow = 0;
@@ -285,6 +537,7 @@ void GCAM_E3SM_interface::runGCAM(int *yyyymmdd, double *gcamoluc, double *gcamo
             gcamoluc[row] = mWoodHarvestData.getData()[r] * 288000000;
             row++;
         }
+        outputCopyTimer.stop();
 
         // Print output
         runner->printOutput(timer);
@@ -312,165 +565,312 @@ void GCAM_E3SM_interface::setDensityGCAM(int *yyyymmdd, double *aELMArea, double
     const int finalCalibrationPeriod = modeltime->getFinalCalibrationPeriod();
     const int finalCalibrationYear = modeltime->getper_to_yr(finalCalibrationPeriod);
 
-    // Create scalar vectors
-    // TODO: Find a better way to determine the length
-    std::vector<int> scalarYears(17722);
-    vector<std::string> scalarRegion(17722);
-    vector<std::string> scalarLandTech(17722);
-    vector<double> aboveScalarData(17722);
-    vector<double> belowScalarData(17722);
-
     // Open the coupling log
     ILogger &coupleLog = ILogger::getLogger("coupling_log");
     coupleLog.setLevel(ILogger::NOTICE);
 
     coupleLog << "In setDensityGCAM, e3smYear is: " << e3smYear << endl;
     coupleLog << "In setDensityGCAM, gcamYear is: " << gcamYear << endl;
+    mTimings->setYear(e3smYear);
 
     // Only set carbon densities during GCAM model years after the first coupled year
     if (modeltime->isModelYear(gcamYear) && e3smYear >= *aFirstCoupledYear)
     {
         coupleLog << "Setting carbon density in year: " << gcamYear << endl;
-        CarbonScalers e3sm2gcam(*aNumLon, *aNumLat, *aNumPFT);
+        TimerRegistry& timers = TimerRegistry::getInstance();
+        Timer& scalersTimer = timers.getTimer("cpl-calc-scalers");
+        Timer& setScalersTimer = timers.getTimer("cpl-set-scalers");
+
+        // Set up the scalers the first time they are needed. The mapping is only read once.
+        if (!mCarbonScalers)
+        {
+            mCarbonScalers.reset(new CarbonScalers(*aNumLon, *aNumLat, *aNumPFT));
+            mScalers.reset(new ScalerTable());
+            if (!aReadScalars)
+            {
+                Timer& parseMappingsTimer = timers.getTimer("cpl-parse-mappings");
+                parseMappingsTimer.start();
+                // The mapping read in initEmissionsDownscaling is reused unless a different file is given
+                if (!mGridMapping || mGridMapping->mFileName != aMappingFile)
+                {
+                    mGridMapping = GridMapping::readGridMapping(aMappingFile);
+                }
+                mCarbonScalers->readRegionalMappingData(*mGridMapping);
+                parseMappingsTimer.stop();
+            }
+        }
 
         // Get scaler information
         if (aReadScalars)
         {
             coupleLog << "Reading scalars from file." << endl;
-            e3sm2gcam.readScalers(scalarYears, scalarRegion, scalarLandTech, aboveScalarData, belowScalarData);
+            Timer& readFilesTimer = timers.getTimer("cpl-read-files");
+            readFilesTimer.start();
+            mCarbonScalers->readScalers(*mScalers);
+            readFilesTimer.stop();
         }
         else
         {
             coupleLog << "Calculating scalers from data." << endl;
-            e3sm2gcam.readRegionalMappingData(aMappingFile);
-            e3sm2gcam.calcScalers(gcamYear, aELMArea, aELMPFTFract, aELMNPP, aELMHR,
-                                  scalarYears, scalarRegion, scalarLandTech, aboveScalarData, belowScalarData,
-                                  aBaseNPPFileName, aBaseHRFileName, aBasePFTWtFileName);
+            scalersTimer.start();
+            mCarbonScalers->calcScalers(gcamYear, aELMArea, aELMPFTFract, aELMNPP, aELMHR, *mScalers,
+                                        aBaseNPPFileName, aBaseHRFileName, aBasePFTWtFileName);
+            scalersTimer.stop();
         }
 
         // Optional: write scaler information to a file
         // TODO: make the file name an input instead of hardcoded
         if (aWriteScalars)
         {
+            Timer& writeTimer = timers.getTimer("cpl-write-diagnostics");
+            writeTimer.start();
             string fName = "./scalers_" + std::to_string(gcamYear) + ".csv";
-            e3sm2gcam.writeScalers(fName, scalarYears, scalarRegion, scalarLandTech, aboveScalarData, belowScalarData, 17722);
+            mCarbonScalers->writeScalers(*mWriter, fName, *mScalers);
+            writeTimer.stop();
         }
 
         // TODO: What happens if there is no scalarData or if the elements are blank?
         // check and then don't call setdatahelper
         if (aScaleCarbon)
         {
-            SetDataHelper setScaler(scalarYears, scalarRegion, scalarLandTech, aboveScalarData, "world/region[+name]/sector/subsector/technology[+name]/period[+year]/yield-scaler");
-            setScaler.run(runner->getInternalScenario());
+            // The yield scalers in the model are found the first time and reused after that
+            if (!mSetScalers)
+            {
+                mSetScalers.reset(new SetDataHelper("world/region[+name]/sector/subsector/technology[+name]/period[+year]/yield-scaler"));
+            }
+            setScalersTimer.start();
+            mSetScalers->run(runner->getInternalScenario(), mScalers->mYear, mScalers->mRegion, *mScalers->mRegionNames,
+                             mScalers->mLandTech, *mScalers->mLandTechNames, mScalers->mAboveScaler);
+            setScalersTimer.stop();
+            timers.addToCounter("cpl-scaler-rows-set", mScalers->size());
         }
     }
 }
 
+/*!
+ * \brief Downscale GCAM's regional CO2 emissions to the E3SM grid.
+ * \param gcamoemiss regional emissions by sector from runGCAM
+ * \param aSurfaceCO2Output one pointer per month to the gridded surface emissions
+ * \param aAircraftCO2Output one pointer per ( month, level ) to the gridded aircraft emissions,
+ *        indexed as [ lev * 12 + mon ]
+ * \param aWriteCO2 if true, the gridded emissions are also written to a file
+ * \param aCurrYear current year, used in diagnostics
+ */
 void GCAM_E3SM_interface::downscaleEmissionsGCAM(double *gcamoemiss,
-                                                 double *gcamoco2sfcjan, double *gcamoco2sfcfeb, double *gcamoco2sfcmar, double *gcamoco2sfcapr,
-                                                 double *gcamoco2sfcmay, double *gcamoco2sfcjun, double *gcamoco2sfcjul, double *gcamoco2sfcaug,
-                                                 double *gcamoco2sfcsep, double *gcamoco2sfcoct, double *gcamoco2sfcnov, double *gcamoco2sfcdec,
-                                                 double *gcamoco2airlojan, double *gcamoco2airlofeb, double *gcamoco2airlomar, double *gcamoco2airloapr,
-                                                 double *gcamoco2airlomay, double *gcamoco2airlojun, double *gcamoco2airlojul, double *gcamoco2airloaug,
-                                                 double *gcamoco2airlosep, double *gcamoco2airlooct, double *gcamoco2airlonov, double *gcamoco2airlodec,
-                                                 double *gcamoco2airhijan, double *gcamoco2airhifeb, double *gcamoco2airhimar, double *gcamoco2airhiapr,
-                                                 double *gcamoco2airhimay, double *gcamoco2airhijun, double *gcamoco2airhijul, double *gcamoco2airhiaug,
-                                                 double *gcamoco2airhisep, double *gcamoco2airhioct, double *gcamoco2airhinov, double *gcamoco2airhidec,
-                                                 std::string aBaseCO2SfcFile, std::string aBaseCO2AirFile, std::string aGCAMBaseCO2EmisFile,
-                                                 std::string aMappingFile,
-                                                 int *aNumLon, int *aNumLat, bool aWriteCO2, int *aCurrYear)
+                                                 const std::vector<double*>& aSurfaceCO2Output,
+                                                 const std::vector<double*>& aAircraftCO2Output,
+                                                 bool aWriteCO2, int *aCurrYear)
 {
-    // Downscale surface CO2 emissions
+    // Downscale CO2 emissions
     ILogger &coupleLog = ILogger::getLogger("coupling_log");
     coupleLog.setLevel(ILogger::NOTICE);
     coupleLog << "Downscaling CO2 emissions" << endl;
+    mTimings->setYear(*aCurrYear);
 
-    // Seperate into surface and aircraft CO2 emission
-    int aNumSec = 2;
-    int aNumReg = 32;
-
-    double gcamoemiss_sfc[32];
-    double gcamoemiss_air[32];
-
-    for (int i = 1; i <= aNumReg; i++)
+    if (!mSurfaceCO2)
     {
-        gcamoemiss_sfc[i - 1] = gcamoemiss[(i - 1) * aNumSec];
-        gcamoemiss_air[i - 1] = gcamoemiss[(i - 1) * aNumSec + 1];
+        coupleLog.setLevel(ILogger::ERROR);
+        coupleLog << "Emissions downscaling has not been set up, initEmissionsDownscaling must be called first" << endl;
+        exit(EXIT_FAILURE);
     }
 
-    for (int tmp = 1; tmp <= aNumReg; tmp++)
+    const vector<size_t>& sfcIndex = mSurfaceCO2->getRegionalEmissionsIndex();
+    const vector<size_t>& airIndex = mAircraftCO2->getRegionalEmissionsIndex();
+    for (size_t reg = 0; reg < sfcIndex.size(); reg++)
     {
-        coupleLog << "Diagnostics: regional surface CO2 Emissions in " << *aCurrYear << " = " << gcamoemiss_sfc[tmp - 1] << endl;
-        coupleLog << "Diagnostics: regional aircraft CO2 Emissions in " << *aCurrYear << " = " << gcamoemiss_air[tmp - 1] << endl;
+        coupleLog << "Diagnostics: regional surface CO2 Emissions in " << *aCurrYear << " = " << gcamoemiss[sfcIndex[reg]] << endl;
+        coupleLog << "Diagnostics: regional aircraft CO2 Emissions in " << *aCurrYear << " = " << gcamoemiss[airIndex[reg]] << endl;
     }
 
 
-    EmissDownscale surfaceCO2(*aNumLon, *aNumLat, 12, 1); // Emissions data is monthly now
-    surfaceCO2.readSpatialData(aBaseCO2SfcFile, true, true, false);
-     coupleLog << "Finish read spatial data" << endl;
-    surfaceCO2.readRegionalMappingData(aMappingFile);
-     coupleLog << "Finish read mapping data" << endl;
-
-    surfaceCO2.readRegionalBaseYearEmissionData(aGCAMBaseCO2EmisFile);
-    
-    coupleLog << "Base-Year Aircraft CO2 emission" << endl;
-    coupleLog << surfaceCO2.aBaseYearEmissions_sfc[0] << endl;
-    coupleLog << surfaceCO2.aBaseYearEmissions_sfc[15] << endl;
-    coupleLog << surfaceCO2.aBaseYearEmissions_sfc[31] << endl;
-    coupleLog << "Base-Year Aircraft CO2 emission" << endl;
-    coupleLog << surfaceCO2.aBaseYearEmissions_air[0] << endl;
-    coupleLog << surfaceCO2.aBaseYearEmissions_air[15] << endl;
-    coupleLog << surfaceCO2.aBaseYearEmissions_air[31] << endl;
     coupleLog << "Start downscaling" << endl;
 
-    surfaceCO2.downscaleSurfaceCO2Emissions(gcamoemiss_sfc);
-    coupleLog << "Diagnostics: Global surface CO2 Emissions in Initial " << *aCurrYear << " = " << gcamoemiss[0] << endl;
-    coupleLog << "Diagnostics: Global surface CO2 Emissions in Initial " << *aCurrYear << " = " << gcamoemiss_sfc[0] << endl;
+    // Surface and aircraft are downscaled together in one pass over the grid
+    vector<EmissDownscale*> downscalers{ mSurfaceCO2.get(), mAircraftCO2.get() };
+    vector<vector<double*> > outputs{ aSurfaceCO2Output, aAircraftCO2Output };
+    TimerRegistry& timers = TimerRegistry::getInstance();
+    Timer& downscaleTimer = timers.getTimer("cpl-downscale");
+    downscaleTimer.start();
+    EmissDownscale::downscaleEmissions(downscalers, gcamoemiss, outputs);
+    downscaleTimer.stop();
+    timers.addToCounter("cpl-cells-downscaled", mSurfaceCO2->getRegionalMapping()->mLandCells.size());
+    coupleLog << "Diagnostics: Global surface CO2 Emissions in Initial " << *aCurrYear << " = " << gcamoemiss[sfcIndex[0]] << endl;
+    coupleLog << "Diagnostics: Global aircraft CO2 Emissions in " << *aCurrYear << " = " << gcamoemiss[airIndex[0]] << endl;
+
     if (aWriteCO2)
     {
+        Timer& writeTimer = timers.getTimer("cpl-write-diagnostics");
+        writeTimer.start();
         // TODO: Set name of file based on case name?
         string fNameSfc = "./gridded_co2_sfc_" + std::to_string(*aCurrYear) + ".txt";
-        surfaceCO2.writeSpatialData(fNameSfc, false);
+        mSurfaceCO2->writeGriddedEmissions(*mWriter, fNameSfc, aSurfaceCO2Output);
+        string fNameAir = "./gridded_co2_air_" + std::to_string(*aCurrYear) + ".txt";
+        mAircraftCO2->writeGriddedEmissions(*mWriter, fNameAir, aAircraftCO2Output);
+        writeTimer.stop();
     }
+}
 
-    // Set the gcamoco2 monthly vector data to the output of this
-    surfaceCO2.separateMonthlyEmissions(gcamoco2sfcjan, gcamoco2sfcfeb, gcamoco2sfcmar, gcamoco2sfcapr,
-                                        gcamoco2sfcmay, gcamoco2sfcjun, gcamoco2sfcjul, gcamoco2sfcaug,
-                                        gcamoco2sfcsep, gcamoco2sfcoct, gcamoco2sfcnov, gcamoco2sfcdec, *aNumLon, *aNumLat);
+/*!
+ * \brief Downscale the regional emissions of the gases added by addGasEmissions to the E3SM grid.
+ * \details All of the gases are downscaled together in one pass over the grid.
+ * \param aGriddedEmiss output with a block of month ( and level ) planes for each gas in the
+ *        order they were added, each plane is mNumLon * mNumLat values
+ * \param aLength length of aGriddedEmiss
+ * \param aWriteEmiss if true, the gridded emissions are also written to a file
+ * \param aCurrYear current year, used in diagnostics
+ */
+void GCAM_E3SM_interface::downscaleGasEmissionsGCAM(double *aGriddedEmiss, const int aLength, bool aWriteEmiss, int *aCurrYear)
+{
+    ILogger &coupleLog = ILogger::getLogger("coupling_log");
+    coupleLog.setLevel(ILogger::NOTICE);
+    coupleLog << "Downscaling " << mGases.size() << " other gas emissions" << endl;
+    mTimings->setYear(*aCurrYear);
+
+    // Point each gas's planes into its block of the output
+    const size_t numCells = mNumLon * mNumLat;
+    vector<EmissDownscale*> downscalers;
+    vector<vector<double*> > outputs;
+    size_t length = 0;
+    for (const auto& gas : mGases)
+    {
+        downscalers.push_back(gas.mDownscaler.get());
+        outputs.push_back(vector<double*>(12 * gas.mNumLev));
+        for (auto& plane : outputs.back())
+        {
+            plane = aGriddedEmiss + length;
+            length += numCells;
+        }
+    }
+    if (static_cast<size_t>(aLength) != length)
+    {
+        coupleLog.setLevel(ILogger::ERROR);
+        coupleLog << "The gridded gas emissions array has length " << aLength << " but " << mGases.size()
+                  << " gases are downscaled, which need " << length << endl;
+        exit(EXIT_FAILURE);
+    }
+    if (mGases.empty())
+    {
+        return;
+    }
 
-    EmissDownscale aircraftCO2(*aNumLon, *aNumLat, 12, 2); // Emissions data is monthly now; we're using two different height levels for aircraft
-    aircraftCO2.readSpatialData(aBaseCO2AirFile, true, true, false);
-    aircraftCO2.readRegionalMappingData(aMappingFile);
-    aircraftCO2.readRegionalBaseYearEmissionData(aGCAMBaseCO2EmisFile);
+    TimerRegistry& timers = TimerRegistry::getInstance();
+    Timer& downscaleTimer = timers.getTimer("cpl-downscale");
+    downscaleTimer.start();
+    EmissDownscale::downscaleEmissions(downscalers, &mGasRegionEmiss[0], outputs);
+    downscaleTimer.stop();
+    timers.addToCounter("cpl-cells-downscaled", mSurfaceCO2->getRegionalMapping()->mLandCells.size());
 
-    coupleLog << "Base-Year Aircraft CO2 emission" << endl;
-    coupleLog << aircraftCO2.aBaseYearEmissions_sfc[0] << endl;
-    coupleLog << aircraftCO2.aBaseYearEmissions_sfc[15] << endl;
-    coupleLog << aircraftCO2.aBaseYearEmissions_sfc[31] << endl;
-    coupleLog << "Base-Year Aircraft CO2 emission" << endl;
-    coupleLog << aircraftCO2.aBaseYearEmissions_air[0] << endl;
-    coupleLog << aircraftCO2.aBaseYearEmissions_air[15] << endl;
-    coupleLog << aircraftCO2.aBaseYearEmissions_air[31] << endl;
-    coupleLog << "Start downscaling" << endl;
+    if (aWriteEmiss)
+    {
+        Timer& writeTimer = timers.getTimer("cpl-write-diagnostics");
+        writeTimer.start();
+        for (size_t gas = 0; gas < mGases.size(); gas++)
+        {
+            string fName = "./gridded_" + mGases[gas].mGas + "_" + mGases[gas].mSector + "_" + std::to_string(*aCurrYear) + ".txt";
+            mGases[gas].mDownscaler->writeGriddedEmissions(*mWriter, fName, outputs[gas]);
+        }
+        writeTimer.stop();
+    }
+}
 
-    aircraftCO2.downscaleAircraftCO2Emissions(gcamoemiss_air);
-    coupleLog << "Diagnostics: Global aircraft CO2 Emissions in " << *aCurrYear << " = " << gcamoemiss[1] << endl;
-    coupleLog << "Diagnostics: Global aircraft CO2 Emissions in " << *aCurrYear << " = " << gcamoemiss[0] << endl;
-    if (aWriteCO2)
+/*!
+ * \brief Warn about any gas in the emissions mapping with no emissions this year.
+ * \details After the first period every gas read should have some emissions. If one
+ *          does not, its GHG objects were most likely not found by the emissions query.
+ * \param aYear The year the emissions were gathered for.
+ */
+void GCAM_E3SM_interface::checkGasEmissions(const int aYear)
+{
+    const vector<string> columns = mCO2EmissData.getColumnNames();
+    const vector<string>& gases = mCO2EmissData.getColumnOutputNames("ghg");
+    const size_t arrayLength = mCO2EmissData.getArrayLength();
+
+    // The stride of the ghg column is the length of the columns after it, including the year
+    size_t gasStride = arrayLength;
+    for (auto column = columns.begin(); *column != "ghg"; ++column)
     {
-        // TODO: Set name of file based on case name?
-        string fNameAir = "./gridded_co2_air_" + std::to_string(*aCurrYear) + ".txt";
-        aircraftCO2.writeSpatialData(fNameAir, false);
+        gasStride /= mCO2EmissData.getColumnOutputNames(*column).size();
+    }
+    gasStride /= gases.size();
+
+    vector<double> gasTotals(gases.size(), 0.0);
+    const double* emissions = mCO2EmissData.getData();
+    for (size_t i = 0; i < arrayLength; ++i)
+    {
+        gasTotals[(i / gasStride) % gases.size()] += fabs(emissions[i]);
+    }
+    for (size_t gas = 0; gas < gases.size(); ++gas)
+    {
+        if (gasTotals[gas] == 0)
+        {
+            ILogger& coupleLog = ILogger::getLogger("coupling_log");
+            coupleLog.setLevel(ILogger::WARNING);
+            coupleLog << "No " << gases[gas] << " emissions were found in " << aYear << endl;
+        }
+    }
+}
+
+/*! \brief The query for the emissions in the emissions mapping.
+ * \details If the mapping has a ghg column the gases in it are read, otherwise just CO2.
+ *          Any other gas would not be in the mapping.
+ * \param aVintage if not -1, only the GHGs of the technologies of this vintage are found
+ * \return the path for a GetDataHelper
+ */
+string GCAM_E3SM_interface::getEmissionsPath(const int aVintage) const
+{
+    string ghgFilter = "NamedFilter,StringEquals,CO2";
+    if (mEmissAllGases)
+    {
+        const string special = ".^$|()[]{}*+?\\";
+        string gasRegex;
+        for (const auto& gas : mCO2EmissData.getColumnGCAMNames("ghg"))
+        {
+            gasRegex += gasRegex.empty() ? "" : "|";
+            for (char c : gas)
+            {
+                if (special.find(c) != string::npos)
+                {
+                    gasRegex += '\\';
+                }
+                gasRegex += c;
+            }
+        }
+        ghgFilter = "+NamedFilter,StringRegexMatches,^(" + gasRegex + ")$";
     }
+    string vintageFilter = aVintage == -1 ? "" : "/period[YearFilter,IntEquals," + std::to_string(aVintage) + "]";
+    return "world/region[+NamedFilter,MatchesAny]/sector[+NamedFilter,MatchesAny]/" + vintageFilter + "/ghg[" + ghgFilter + "]/emissions[+YearFilter,MatchesAny]";
+}
 
-    // Set the gcamoco2 data to the output of this
-    aircraftCO2.separateMonthlyEmissionsWithVertical(gcamoco2airlojan, gcamoco2airlofeb, gcamoco2airlomar, gcamoco2airloapr,
-                                                     gcamoco2airlomay, gcamoco2airlojun, gcamoco2airlojul, gcamoco2airloaug,
-                                                     gcamoco2airlosep, gcamoco2airlooct, gcamoco2airlonov, gcamoco2airlodec,
-                                                     gcamoco2airhijan, gcamoco2airhifeb, gcamoco2airhimar, gcamoco2airhiapr,
-                                                     gcamoco2airhimay, gcamoco2airhijun, gcamoco2airhijul, gcamoco2airhiaug,
-                                                     gcamoco2airhisep, gcamoco2airhioct, gcamoco2airhinov, gcamoco2airhidec,
-                                                     *aNumLon, *aNumLat);
+/*! \brief Find where each region's emissions of a gas and sector are in the GCAM emissions.
+ * \details Regions are in the order of the region column of the emissions mapping. The
+ *          gas is only used if the mapping has a ghg column.
+ * \param aGas name of the gas
+ * \param aSector output name of the sector
+ * \return index into the emissions for each region
+ */
+vector<size_t> GCAM_E3SM_interface::getEmissionsIndex(const string& aGas, const string& aSector)
+{
+    const vector<string> columns = mCO2EmissData.getColumnNames();
+    const vector<string>& regions = mCO2EmissData.getColumnOutputNames("region");
+    vector<size_t> emissIndex;
+    for (const auto& region : regions)
+    {
+        vector<string> colValues;
+        for (const auto& column : columns)
+        {
+            colValues.push_back(column == "region" ? region : column == "sector" ? aSector : column == "ghg" ? aGas : "");
+        }
+        size_t index = mCO2EmissData.findIndex(colValues, gcamStartYear);
+        if (index >= mCO2EmissData.getArrayLength())
+        {
+            ILogger& coupleLog = ILogger::getLogger("coupling_log");
+            coupleLog.setLevel(ILogger::ERROR);
+            coupleLog << "No " << aGas << " " << aSector << " emissions for " << region << " in the emissions mapping" << endl;
+            exit(EXIT_FAILURE);
+        }
+        emissIndex.push_back(index);
+    }
+    return emissIndex;
 }
 
 void GCAM_E3SM_interface::finalizeGCAM()
@@ -481,5 +881,9 @@ void GCAM_E3SM_interface::finalizeGCAM()
     ILogger &coupleLog = ILogger::getLogger("coupling_log");
     coupleLog.setLevel(ILogger::NOTICE);
     coupleLog << "calling finalize" << endl;
+
+    // Make sure the diagnostic files are complete before the run ends
+    mWriter->wait();
+    mTimings->write();
     timer.stop();
 }
@@ -15,6 +15,8 @@ extern "C" {
   }
     
   // Call the GCAM initialization
+  // Note: this keeps the argument list E3SM has always passed. The emissions downscaling is
+  // set up separately, by initcgcamemissions_ or by the first call to downscaleemissionscgcam_.
   void initcgcam_(char* aCaseName, char* aGCAMConfig, char* aGCAM2ELMCO2Map, char* aGCAM2ELMLUCMap, char* aGCAM2ELMWHMap) {
       
       // Convert to string - fortran doesn't handle string
@@ -27,6 +29,21 @@ extern "C" {
     p_obj->initGCAM(CaseName, GCAMConfig, GCAM2ELMCO2Map, GCAM2ELMLUCMap, GCAM2ELMWHMap);
   }
 
+  // Set up the emissions downscaling, reading the base year emissions and the ELM to GCAM
+  // mapping once. This is optional and must be called after initcgcam_.
+  void initcgcamemissions_(char* aBaseCO2SfcFile, char* aBaseCO2AirFile, char* aGCAMBaseCO2EmisFile, char* aMappingFile,
+                           int *aNumLon, int *aNumLat) {
+      
+      // Convert to string - fortran doesn't handle string
+      std::string BaseCO2SfcFile(aBaseCO2SfcFile);
+      std::string BaseCO2AirFile(aBaseCO2AirFile);
+      std::string GCAMBaseCO2EmisFile(aGCAMBaseCO2EmisFile);
+      std::string MappingFile(aMappingFile);
+      
+    p_obj->initEmissionsDownscaling(BaseCO2SfcFile, BaseCO2AirFile, GCAMBaseCO2EmisFile, MappingFile,
+                                    aNumLon, aNumLat);
+  }
+
   // Set Carbon Densities in GCAM using scalers from E3SM
   void setdensitycgcam_(int *yyyymmdd, double *aELMArea, double *aELMPFTFract, double *aELMNPP, double *aELMHR,
                           int *aNumLon, int *aNumLat, int *aNumPFT, char* aMappingFile, int *aFirstCoupledYear, int *aReadScalars, int *aWriteScalars,
@@ -49,12 +66,49 @@ extern "C" {
   }
     
   // Run GCAM
+  // Note: this keeps the argument list E3SM has always passed. E3SM allocates gcamoemiss for
+  // the CO2 surface and aircraft emissions of each region, which is the length runGCAM copies.
+  // runcgcamchecked_ also passes the length so it can be checked.
   void runcgcam_(int *yyyymmdd, double *gcamoluc, double *gcamoemiss) {
     
-      p_obj->runGCAM(yyyymmdd, gcamoluc, gcamoemiss);
+      p_obj->runGCAM(yyyymmdd, gcamoluc, gcamoemiss, p_obj->getCO2EmissionsLength());
+  }
+
+  // Run GCAM, checking the length of gcamoemiss
+  void runcgcamchecked_(int *yyyymmdd, double *gcamoluc, double *gcamoemiss, int *aEmissLength) {
+    
+      p_obj->runGCAM(yyyymmdd, gcamoluc, gcamoemiss, *aEmissLength);
+  }
+
+  // Add the downscaling of a gas other than CO2, such as CH4, BC or SO2. The emissions mapping
+  // must have a ghg column and this must be called after the emissions downscaling is set up.
+  void initcgcamgasemissions_(char* aGas, char* aSector, char* aBaseGriddedFile, char* aGCAMBaseEmisFile,
+                              int *aNumLev, int *aNormalizeWeight) {
+      
+      // Convert to string - fortran doesn't handle string
+      std::string Gas(aGas);
+      std::string Sector(aSector);
+      std::string BaseGriddedFile(aBaseGriddedFile);
+      std::string GCAMBaseEmisFile(aGCAMBaseEmisFile);
+      
+      // Convert to bool - fortran doesn't have a bool
+      bool normalizeWeight = *aNormalizeWeight == 1 ? true : false;
+      
+    p_obj->addGasEmissions(Gas, Sector, BaseGriddedFile, GCAMBaseEmisFile, *aNumLev, normalizeWeight);
+  }
+
+  // Get the regional emissions of the gases added by initcgcamgasemissions_ from the last runcgcam_,
+  // one block of regions per gas in the order they were added
+  void getcgcamgasemissions_(double *gcamoghg, int *aLength) {
+    
+      p_obj->getGasEmissions(gcamoghg, *aLength);
   }
 
   // Downscale Emissions
+  // Note: this keeps the argument list E3SM has always passed. The base year emissions files,
+  // mapping file, and grid size are only used to set up the downscaling on the first call if
+  // initcgcamemissions_ was not called; they are ignored after that. The emissions are written
+  // directly into the E3SM month / level arrays.
   void downscaleemissionscgcam_(double *gcamoemiss,
                               double *gcamoco2sfcjan, double *gcamoco2sfcfeb, double *gcamoco2sfcmar, double *gcamoco2sfcapr,
                               double *gcamoco2sfcmay, double *gcamoco2sfcjun, double *gcamoco2sfcjul, double *gcamoco2sfcaug,
@@ -69,29 +123,43 @@ extern "C" {
                               char* aMappingFile,
                               int *aNumLon, int *aNumLat, int* aWriteCO2, int *aCurrYear) {
       
-      // Convert to string - fortran doesn't handle string
-      std::string BaseCO2SfcFile(aBaseCO2SfcFile);
-      std::string BaseCO2AirFile(aBaseCO2AirFile);
-      std::string MappingFile(aMappingFile);
+      if (!p_obj->isEmissionsDownscalingInitialized()) {
+          // Convert to string - fortran doesn't handle string
+          std::string BaseCO2SfcFile(aBaseCO2SfcFile);
+          std::string BaseCO2AirFile(aBaseCO2AirFile);
+          std::string GCAMBaseCO2EmisFile(aGCAMBaseCO2EmisFile);
+          std::string MappingFile(aMappingFile);
+          
+          p_obj->initEmissionsDownscaling(BaseCO2SfcFile, BaseCO2AirFile, GCAMBaseCO2EmisFile, MappingFile,
+                                          aNumLon, aNumLat);
+      }
       
       // Convert to bool - fortran doesn't have a bool
       bool writeCO2 = *aWriteCO2 == 1 ? true : false;
     
-      p_obj->downscaleEmissionsGCAM(gcamoemiss,
-                                  gcamoco2sfcjan, gcamoco2sfcfeb, gcamoco2sfcmar, gcamoco2sfcapr,
-                                  gcamoco2sfcmay, gcamoco2sfcjun, gcamoco2sfcjul, gcamoco2sfcaug,
-                                  gcamoco2sfcsep, gcamoco2sfcoct, gcamoco2sfcnov, gcamoco2sfcdec,
-                                  gcamoco2airlojan, gcamoco2airlofeb, gcamoco2airlomar, gcamoco2airloapr,
-                                  gcamoco2airlomay, gcamoco2airlojun, gcamoco2airlojul, gcamoco2airloaug,
-                                  gcamoco2airlosep, gcamoco2airlooct, gcamoco2airlonov, gcamoco2airlodec,
-                                  gcamoco2airhijan, gcamoco2airhifeb, gcamoco2airhimar, gcamoco2airhiapr,
-                                  gcamoco2airhimay, gcamoco2airhijun, gcamoco2airhijul, gcamoco2airhiaug,
-                                  gcamoco2airhisep, gcamoco2airhioct, gcamoco2airhinov, gcamoco2airhidec,
-                                  BaseCO2SfcFile, BaseCO2AirFile, aGCAMBaseCO2EmisFile,
-                                  MappingFile,
-                                  aNumLon, aNumLat, writeCO2, aCurrYear);
+      // Build the month / level tables over the E3SM arrays so GCAM writes into them directly
+      std::vector<double*> sfcOutput = { gcamoco2sfcjan, gcamoco2sfcfeb, gcamoco2sfcmar, gcamoco2sfcapr,
+                                         gcamoco2sfcmay, gcamoco2sfcjun, gcamoco2sfcjul, gcamoco2sfcaug,
+                                         gcamoco2sfcsep, gcamoco2sfcoct, gcamoco2sfcnov, gcamoco2sfcdec };
+      std::vector<double*> airOutput = { gcamoco2airlojan, gcamoco2airlofeb, gcamoco2airlomar, gcamoco2airloapr,
+                                         gcamoco2airlomay, gcamoco2airlojun, gcamoco2airlojul, gcamoco2airloaug,
+                                         gcamoco2airlosep, gcamoco2airlooct, gcamoco2airlonov, gcamoco2airlodec,
+                                         gcamoco2airhijan, gcamoco2airhifeb, gcamoco2airhimar, gcamoco2airhiapr,
+                                         gcamoco2airhimay, gcamoco2airhijun, gcamoco2airhijul, gcamoco2airhiaug,
+                                         gcamoco2airhisep, gcamoco2airhioct, gcamoco2airhinov, gcamoco2airhidec };
+
+      p_obj->downscaleEmissionsGCAM(gcamoemiss, sfcOutput, airOutput, writeCO2, aCurrYear);
 }
 
+  // Downscale the emissions of the gases added by initcgcamgasemissions_. The gridded emissions
+  // of each gas are a block of 12 months for each of its levels in the order they were added.
+  void downscalegasemissionscgcam_(double *gcamoghggrid, int *aLength, int *aWriteEmiss, int *aCurrYear) {
+      
+      // Convert to bool - fortran doesn't have a bool
+      bool writeEmiss = *aWriteEmiss == 1 ? true : false;
+      
+      p_obj->downscaleGasEmissionsGCAM(gcamoghggrid, *aLength, writeEmiss, aCurrYear);
+  }
     
   // Finalize GCAM
   void finalizecgcam_() {
@@ -41,12 +41,95 @@
 #include <iostream>
 #include <fstream>
 #include <iomanip>  
+#include <algorithm>
+#include <cstring>
+#include <utility>
+#include <stdint.h>
 
 #include "util/base/include/auto_file.h"
 #include "../include/aspatial_data.h"
 
 using namespace std;
 
+/*
+ Binary spatial data files are a fixed size header followed by the data arrays. All values
+ are little-endian. The header is:
+     char     magic[8]     "GCAMSPD1"
+     uint32_t flags        bit 0: has IDs, bit 1: has longitude/latitude
+     uint32_t reserved     always zero
+     uint64_t numRows      number of rows (grid cells x PFTs/months/levels)
+     uint64_t checksum     checksum of everything after the header (see binaryChecksum)
+ The data follows in this order: int32_t IDs (if present), double longitudes and double
+ latitudes (if present), and then the double values. Files are created from the text format
+ by writeBinarySpatialData (see convert_spatial_data in cpl/main).
+ */
+namespace {
+    const char BINARY_MAGIC[8] = { 'G', 'C', 'A', 'M', 'S', 'P', 'D', '1' };
+    const uint32_t BINARY_HAS_ID = 1;
+    const uint32_t BINARY_HAS_LATLON = 2;
+    const size_t BINARY_HEADER_SIZE = 32;
+
+    bool isLittleEndian() {
+        const uint32_t test = 1;
+        return *reinterpret_cast<const unsigned char*>(&test) == 1;
+    }
+
+    // Reverse the bytes of each element in place. Only needed on big-endian systems.
+    void swapBytes(char* aData, size_t aNumElements, size_t aElementSize) {
+        for (size_t i = 0; i < aNumElements; i++) {
+            std::reverse(aData + i * aElementSize, aData + (i + 1) * aElementSize);
+        }
+    }
+
+    // FNV-1a style hash over 64 bit words (plus any remaining bytes). This is only meant to detect
+    // truncated or corrupted files, so it is cheap enough to check on every read.
+    uint64_t binaryChecksum(const char* aData, size_t aSize) {
+        uint64_t hash = 14695981039346656037ULL;
+        const uint64_t prime = 1099511628211ULL;
+        size_t pos = 0;
+        for (; pos + sizeof(uint64_t) <= aSize; pos += sizeof(uint64_t)) {
+            uint64_t word;
+            memcpy(&word, aData + pos, sizeof(uint64_t));
+            hash = (hash ^ word) * prime;
+        }
+        for (; pos < aSize; pos++) {
+            hash = (hash ^ static_cast<unsigned char>(aData[pos])) * prime;
+        }
+        return hash;
+    }
+
+    void binaryReadError(const std::string& aFileName, const std::string& aMessage) {
+        ILogger& coupleLog = ILogger::getLogger( "coupling_log" );
+        coupleLog.setLevel( ILogger::ERROR );
+        coupleLog << aMessage << ": " << aFileName << endl;
+        exit(EXIT_FAILURE);
+    }
+
+    // Write the header and an already assembled little-endian payload
+    void writeBinaryFile(const std::string& aFileName, uint32_t aFlags, uint64_t aNumRows, const vector<char>& aPayload) {
+        uint32_t flags = aFlags;
+        uint32_t reserved = 0;
+        uint64_t rows = aNumRows;
+        uint64_t checksum = binaryChecksum(aPayload.data(), aPayload.size());
+        if (!isLittleEndian()) {
+            swapBytes(reinterpret_cast<char*>(&flags), 1, sizeof(flags));
+            swapBytes(reinterpret_cast<char*>(&rows), 1, sizeof(rows));
+            swapBytes(reinterpret_cast<char*>(&checksum), 1, sizeof(checksum));
+        }
+        char header[BINARY_HEADER_SIZE];
+        memcpy(header, BINARY_MAGIC, sizeof(BINARY_MAGIC));
+        memcpy(header + 8, &flags, sizeof(flags));
+        memcpy(header + 12, &reserved, sizeof(reserved));
+        memcpy(header + 16, &rows, sizeof(rows));
+        memcpy(header + 24, &checksum, sizeof(checksum));
+
+        ofstream oFile(aFileName, ios::binary);
+        oFile.write(header, BINARY_HEADER_SIZE);
+        oFile.write(aPayload.data(), aPayload.size());
+        oFile.close();
+    }
+}
+
 // Constructor
 ASpatialData::ASpatialData(int aSize):
 mLatVector(aSize, 0),
@@ -63,6 +146,11 @@ ASpatialData::~ASpatialData() {
 // Note: this is used for diagnostics and testing. In fully coupled E3SM-GCAM, this data
 // are passed in code to the wrapper
 double ASpatialData::readSpatialData(std::string aFileName, bool aHasLatLon, bool aHasID, bool aCalcTotal) {
+    // Binary files are read in bulk
+    if ( isBinarySpatialData(aFileName) ) {
+        return readBinarySpatialData(aFileName, aHasLatLon, aHasID, &mValueVector[0]);
+    }
+
     // Create a double to store totals (if aCalcTotal == true)
     double total = 0.0;
     
@@ -123,6 +211,11 @@ double ASpatialData::readSpatialData(std::string aFileName, bool aHasLatLon, boo
 
 // Read in spatial data from a csv file directly into an array
 double ASpatialData::readSpatialData(std::string aFileName, bool aHasLatLon, bool aHasID, bool aCalcTotal, double *aValueArray) {
+    // Binary files are read in bulk
+    if ( isBinarySpatialData(aFileName) ) {
+        return readBinarySpatialData(aFileName, aHasLatLon, aHasID, aValueArray);
+    }
+
     // Create a double to store totals (if aCalcTotal == true)
     double total = 0.0;
     
@@ -154,7 +247,7 @@ double ASpatialData::readSpatialData(std::string aFileName, bool aHasLatLon, boo
         
         if ( aHasLatLon ) {
             double lon;
-            int lat;
+            double lat;
             
             // Parse longitude
             getline(iss, token, ' ');
@@ -195,29 +288,162 @@ void ASpatialData::writeSpatialData(std::string aFileName, bool aWriteID) {
     return;
 }
 
+// Check if a file is in the binary spatial data format
+bool ASpatialData::isBinarySpatialData(std::string aFileName) {
+    ifstream data(aFileName, ios::binary);
+    char magic[sizeof(BINARY_MAGIC)];
+    if (!data.read(magic, sizeof(magic))) {
+        return false;
+    }
+    return memcmp(magic, BINARY_MAGIC, sizeof(BINARY_MAGIC)) == 0;
+}
+
+// Read in spatial data from a binary file directly into an array. IDs and lat/lon are stored in
+// this object if requested and present in the file.
+double ASpatialData::readBinarySpatialData(std::string aFileName, bool aHasLatLon, bool aHasID, double *aValueArray) {
+    ifstream data(aFileName, ios::binary | ios::ate);
+    if (!data.is_open())
+    {
+        binaryReadError(aFileName, "File not found");
+    }
+    const size_t fileSize = data.tellg();
+    data.seekg(0);
+    if (fileSize < BINARY_HEADER_SIZE) {
+        binaryReadError(aFileName, "Truncated binary spatial data header");
+    }
+
+    // Read the header
+    char header[BINARY_HEADER_SIZE];
+    data.read(header, BINARY_HEADER_SIZE);
+    uint32_t flags;
+    uint64_t numRows;
+    uint64_t checksum;
+    memcpy(&flags, header + 8, sizeof(flags));
+    memcpy(&numRows, header + 16, sizeof(numRows));
+    memcpy(&checksum, header + 24, sizeof(checksum));
+    if (!isLittleEndian()) {
+        swapBytes(reinterpret_cast<char*>(&flags), 1, sizeof(flags));
+        swapBytes(reinterpret_cast<char*>(&numRows), 1, sizeof(numRows));
+        swapBytes(reinterpret_cast<char*>(&checksum), 1, sizeof(checksum));
+    }
+    const bool fileHasID = (flags & BINARY_HAS_ID) != 0;
+    const bool fileHasLatLon = (flags & BINARY_HAS_LATLON) != 0;
+    if (numRows > mValueVector.size()) {
+        binaryReadError(aFileName, "Binary spatial data has more rows than expected");
+    }
+    if ((aHasID && !fileHasID) || (aHasLatLon && !fileHasLatLon)) {
+        binaryReadError(aFileName, "Binary spatial data is missing ID or lat/lon columns");
+    }
+
+    // Read the rest of the file in one go and check it is intact
+    const size_t idSize = fileHasID ? numRows * sizeof(int32_t) : 0;
+    const size_t latLonSize = fileHasLatLon ? 2 * numRows * sizeof(double) : 0;
+    const size_t valueSize = numRows * sizeof(double);
+    if (fileSize - BINARY_HEADER_SIZE != idSize + latLonSize + valueSize) {
+        binaryReadError(aFileName, "Binary spatial data has the wrong size");
+    }
+    vector<char> payload(idSize + latLonSize + valueSize);
+    data.read(payload.data(), payload.size());
+    if (!data || binaryChecksum(payload.data(), payload.size()) != checksum) {
+        binaryReadError(aFileName, "Binary spatial data failed checksum");
+    }
+    if (!isLittleEndian()) {
+        swapBytes(payload.data(), idSize / sizeof(int32_t), sizeof(int32_t));
+        swapBytes(payload.data() + idSize, (payload.size() - idSize) / sizeof(double), sizeof(double));
+    }
+
+    // Copy out each of the columns
+    const char* curr = payload.data();
+    if (aHasID) {
+        for (size_t row = 0; row < numRows; row++) {
+            int32_t id;
+            memcpy(&id, curr + row * sizeof(int32_t), sizeof(int32_t));
+            mIDVector[row] = id;
+        }
+    }
+    curr += idSize;
+    if (aHasLatLon) {
+        memcpy(&mLonVector[0], curr, valueSize);
+        memcpy(&mLatVector[0], curr + valueSize, valueSize);
+    }
+    curr += latLonSize;
+    memcpy(aValueArray, curr, valueSize);
+
+    // Calculate the total
+    double total = 0.0;
+    for (size_t row = 0; row < numRows; row++) {
+        total += aValueArray[row];
+    }
+
+    return total;
+}
+
+// Write spatial data to a binary file. Reading this file back with readSpatialData gives
+// the same data as the text file it was created from.
+void ASpatialData::writeBinarySpatialData(std::string aFileName, bool aHasLatLon, bool aHasID) {
+    const uint64_t numRows = mValueVector.size();
+    const size_t idSize = aHasID ? numRows * sizeof(int32_t) : 0;
+    const size_t latLonSize = aHasLatLon ? 2 * numRows * sizeof(double) : 0;
+    const size_t valueSize = numRows * sizeof(double);
+
+    // Assemble the data arrays
+    vector<char> payload(idSize + latLonSize + valueSize);
+    char* curr = payload.data();
+    if (aHasID) {
+        for (size_t row = 0; row < numRows; row++) {
+            int32_t id = mIDVector[row];
+            memcpy(curr + row * sizeof(int32_t), &id, sizeof(int32_t));
+        }
+        curr += idSize;
+    }
+    if (aHasLatLon) {
+        memcpy(curr, mLonVector.data(), valueSize);
+        memcpy(curr + valueSize, mLatVector.data(), valueSize);
+        curr += latLonSize;
+    }
+    memcpy(curr, mValueVector.data(), valueSize);
+    if (!isLittleEndian()) {
+        swapBytes(payload.data(), idSize / sizeof(int32_t), sizeof(int32_t));
+        swapBytes(payload.data() + idSize, (payload.size() - idSize) / sizeof(double), sizeof(double));
+    }
+
+    writeBinaryFile(aFileName, (aHasID ? BINARY_HAS_ID : 0) | (aHasLatLon ? BINARY_HAS_LATLON : 0), numRows, payload);
+}
+
+// Write values, without IDs or lat/lon, in the binary spatial data format
+void ASpatialData::writeBinaryValues(std::string aFileName, const std::vector<double>& aValues) {
+    vector<char> payload(aValues.size() * sizeof(double));
+    memcpy(payload.data(), aValues.data(), payload.size());
+    if (!isLittleEndian()) {
+        swapBytes(payload.data(), aValues.size(), sizeof(double));
+    }
+    writeBinaryFile(aFileName, 0, aValues.size(), payload);
+}
+
 void ASpatialData::readMapping(std::string aFileName) {
     return;
 }
 
 
-void ASpatialData::setValueVector(std::vector<double> aValueVector) {
-    mValueVector = aValueVector;
+// Take ownership of the values without copying
+void ASpatialData::setValueVector(std::vector<double>&& aValueVector) {
+    mValueVector = std::move(aValueVector);
     return;
 }
 
-std::vector<double> ASpatialData::getValueVector() {
+const std::vector<double>& ASpatialData::getValueVector() const {
     return mValueVector;
 }
 
-std::vector<int> ASpatialData::getIDVector() {
+const std::vector<int>& ASpatialData::getIDVector() const {
     return mIDVector;
 }
 
-std::vector<double> ASpatialData::getLatVector() {
+const std::vector<double>& ASpatialData::getLatVector() const {
     return mLatVector;
 }
 
-std::vector<double> ASpatialData::getLonVector() {
+const std::vector<double>& ASpatialData::getLonVector() const {
     return mLonVector;
 }
 
@@ -0,0 +1,119 @@
+/*
+ * LEGAL NOTICE
+ * This computer software was prepared by Battelle Memorial Institute,
+ * hereinafter the Contractor, under Contract No. DE-AC05-76RL0 1830
+ * with the Department of Energy (DOE). NEITHER THE GOVERNMENT NOR THE
+ * CONTRACTOR MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR ASSUMES ANY
+ * LIABILITY FOR THE USE OF THIS SOFTWARE. This notice including this
+ * sentence must appear on any copies of this computer software.
+ *
+ * EXPORT CONTROL
+ * User agrees that the Software will not be shipped, transferred or
+ * exported into any country or used in any manner prohibited by the
+ * United States Export Administration Act or any other applicable
+ * export laws, restrictions or regulations (collectively the "Export Laws").
+ * Export of the Software may require some form of license or other
+ * authority from the U.S. Government, and failure to obtain such
+ * export control license may result in criminal liability under
+ * U.S. laws. In addition, if the Software is identified as export controlled
+ * items under the Export Laws, User represents and warrants that User
+ * is not a citizen, or otherwise located within, an embargoed nation
+ * (including without limitation Iran, Syria, Sudan, Cuba, and North Korea)
+ *     and that User is not otherwise prohibited
+ * under the Export Laws from receiving the Software.
+ *
+ * Copyright 2011 Battelle Memorial Institute.  All Rights Reserved.
+ * Distributed as open-source under the terms of the Educational Community
+ * License version 2.0 (ECL 2.0). http://www.opensource.org/licenses/ecl2.php
+ *
+ * For further details, see: http://www.globalchange.umd.edu/models/gcam/
+ *
+ */
+
+#include <cstdio>
+#include <fstream>
+
+#include "../include/async_writer.h"
+
+using namespace std;
+
+// Constructor, starts the writer thread
+AsyncWriter::AsyncWriter():
+mIsWriting(false),
+mStop(false),
+mThread(&AsyncWriter::run, this)
+{
+}
+
+// Destructor, finishes any queued writes
+AsyncWriter::~AsyncWriter() {
+    {
+        lock_guard<mutex> lock(mMutex);
+        mStop = true;
+    }
+    mQueued.notify_one();
+    mThread.join();
+}
+
+// Queue a write and return without waiting for it
+void AsyncWriter::write(function<void()> aWrite) {
+    {
+        lock_guard<mutex> lock(mMutex);
+        mQueue.push_back(std::move(aWrite));
+    }
+    mQueued.notify_one();
+}
+
+// Wait until all queued writes are done
+void AsyncWriter::wait() {
+    unique_lock<mutex> lock(mMutex);
+    mIdle.wait(lock, [this]() { return mQueue.empty() && !mIsWriting; });
+}
+
+void AsyncWriter::run() {
+    unique_lock<mutex> lock(mMutex);
+    while(true) {
+        mQueued.wait(lock, [this]() { return mStop || !mQueue.empty(); });
+        if(mQueue.empty()) {
+            // only stop once everything queued has been written
+            return;
+        }
+        function<void()> currWrite = std::move(mQueue.front());
+        mQueue.pop_front();
+        mIsWriting = true;
+        lock.unlock();
+        currWrite();
+        lock.lock();
+        mIsWriting = false;
+        if(mQueue.empty()) {
+            mIdle.notify_all();
+        }
+    }
+}
+
+// Write a file in one call
+void AsyncWriter::writeText(const string& aFileName, const string& aText) {
+    ofstream oFile(aFileName, ios::binary);
+    oFile.write(aText.data(), aText.size());
+    oFile.close();
+}
+
+// Write one value per line in the same format as << scientific << setprecision(13). The values
+// are formatted into large blocks instead of writing and flushing each line.
+void AsyncWriter::writeScientific(const string& aFileName, const vector<double>& aValues) {
+    const size_t BLOCK_SIZE = 1 << 20;
+    ofstream oFile(aFileName, ios::binary);
+    string block;
+    block.reserve(BLOCK_SIZE + 32);
+    char buffer[32];
+    for(const double value : aValues) {
+        const int length = snprintf(buffer, sizeof(buffer), "%.13e\n", value);
+        block.append(buffer, length);
+        if(block.size() >= BLOCK_SIZE) {
+            oFile.write(block.data(), block.size());
+            block.clear();
+        }
+    }
+    oFile.write(block.data(), block.size());
+    oFile.close();
+}
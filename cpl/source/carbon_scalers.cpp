@@ -39,14 +39,72 @@
 
 #include <iostream>
 #include <fstream>
-#include <boost/algorithm/string/split.hpp>
-#include <boost/algorithm/string/trim.hpp>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <cstdio>
+
+#if GCAM_PARALLEL_ENABLED
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_invoke.h>
+#endif
 
 #include "util/base/include/auto_file.h"
 #include "../include/carbon_scalers.h"
+#include "../include/async_writer.h"
+#include "../include/csv_reader.h"
 
 using namespace std;
 
+namespace {
+    // Median as used by the outlier filter: the mean of the two middle values. Uses selection
+    // rather than sorting and reorders aValues.
+    double middleValue( std::vector<double>& aValues ) {
+        if( aValues.empty() ) {
+            return std::numeric_limits<double>::quiet_NaN();
+        }
+        if( aValues.size() == 1 ) {
+            return aValues[ 0 ];
+        }
+        auto mid = aValues.begin() + aValues.size() / 2;
+        std::nth_element( aValues.begin(), mid, aValues.end() );
+        return 0.5 * ( *std::max_element( aValues.begin(), mid ) + *mid );
+    }
+
+    // Calculate the bounds median +/- aLimit * MAD of the ratios aValue / aBase. Zero and NaN
+    // ratios are not included -- ocean grid cells weren't included in the original data and
+    // cells with 0 base values were excluded. If there are no ratios the bounds are NaN.
+    // aRatios is scratch space; its capacity is kept so it is only allocated once.
+    void calcOutlierBounds( const double* aValue, const double* aBase, int aLength, double aLimit,
+                            std::vector<double>& aRatios, double& aLowerBound, double& aUpperBound )
+    {
+        aRatios.clear();
+        aRatios.reserve( aLength );
+        for( int i = 0; i < aLength; i++ ) {
+            double ratio = aValue[ i ] / aBase[ i ];
+            if( ratio != 0 && ratio == ratio ) {
+                aRatios.push_back( ratio );
+            }
+        }
+
+        double median = middleValue( aRatios );
+        for( double& ratio : aRatios ) {
+            ratio = std::abs( ratio - median );
+        }
+        double mad = middleValue( aRatios );
+
+        aLowerBound = median - aLimit * mad;
+        aUpperBound = median + aLimit * mad;
+    }
+
+    // Check if the ratio of aValue / aBase is outside of the bounds. Ratios that were not used to
+    // calculate the bounds are never outliers.
+    bool isOutlier( double aValue, double aBase, double aLowerBound, double aUpperBound ) {
+        double ratio = aValue / aBase;
+        return ratio != 0 && ratio == ratio && ( ratio > aUpperBound || ratio < aLowerBound );
+    }
+}
+
 // Constructor
 // TODO: I don't think this needs to be a derived class anymore.
 CarbonScalers::CarbonScalers(int aNumLon, int aNumLat, int aNumPFT):
@@ -58,6 +116,22 @@ mNumLon( aNumLon ),
 mNumLat( aNumLat ),
 mNumPFT( aNumPFT )
 {
+    // Intern the crop names once so the scaler calculation works on dense ids
+    for( const auto& pftCrops : mPFT2GCAMCropMap ) {
+        mCropNames.insert( mCropNames.end(), pftCrops.second.begin(), pftCrops.second.end() );
+    }
+    std::sort( mCropNames.begin(), mCropNames.end() );
+    mCropNames.erase( std::unique( mCropNames.begin(), mCropNames.end() ), mCropNames.end() );
+
+    mPFTCrops.resize( mNumPFT );
+    for( int pft = 0; pft < mNumPFT; pft++ ) {
+        auto currPFT = mPFT2GCAMCropMap.find( pft );
+        if( currPFT != mPFT2GCAMCropMap.end() ) {
+            for( const auto& crop : (*currPFT).second ) {
+                mPFTCrops[pft].push_back( std::lower_bound( mCropNames.begin(), mCropNames.end(), crop ) - mCropNames.begin() );
+            }
+        }
+    }
 }
 
 // Destructor
@@ -65,198 +139,255 @@ CarbonScalers::~CarbonScalers() {
 }
 
 // Read each component of the base year data
-// This is used to calculate the scalar baseline.
-// ASpatialData::readSpatialData method and then copying the vectors.
+// This is used to calculate the scalar baseline. Each file is read directly
+// into its own vector rather than through the ASpatialData value vector.
 void CarbonScalers::readBaseYearData(std::string aBaseNPPFileName, std::string aBaseHRFileName, std::string aBasePFTWtFileName){
     // Read in average NPP
-    readSpatialData(aBaseNPPFileName, true, true, false);
-    mBaseNPPVector = getValueVector();
+    readSpatialData(aBaseNPPFileName, true, true, false, &mBaseNPPVector[0]);
     
     // Read in average HR
-    readSpatialData(aBaseHRFileName, true, true, false);
-    mBaseHRVector = getValueVector();
+    readSpatialData(aBaseHRFileName, true, true, false, &mBaseHRVector[0]);
     
     // Read in PFT weight in grid cell
-    readSpatialData(aBasePFTWtFileName, true, true, false);
-    mBasePFTFractVector = getValueVector();
+    readSpatialData(aBasePFTWtFileName, true, true, false, &mBasePFTFractVector[0]);
 }
 
-// Read in a regional mapping data from a file
+// Read in a regional mapping data from a file and compile it into per region lists of grid cells
 void CarbonScalers::readRegionalMappingData(std::string aFileName) {
-    ifstream data(aFileName);
-    if (!data.is_open())
-    {
-        exit(EXIT_FAILURE);
+    readRegionalMappingData(*GridMapping::readGridMapping(aFileName));
+}
+
+// Compile a mapping that has already been read into per region lists of grid cells
+void CarbonScalers::readRegionalMappingData(const GridMapping& aGridMapping) {
+    // Mapping rows in file order: grid index, region/subregion, and weight
+    vector<int> rowGrid;
+    vector<int> rowRegion;
+    vector<double> rowWeight;
+    std::map<string, int> regionIDs;
+    vector<string> regionsRead;
+    // Region/subregion ID of each ( region, subregion ) pair in the mapping, set when it is first used
+    const size_t numSubregions = aGridMapping.mSubregionNames.size();
+    vector<int> pairIDs( aGridMapping.mRegionNames.size() * numSubregions, -1 );
+
+    for( size_t row = 0; row < aGridMapping.mWeight.size(); row++ ) {
+        int lon = aGridMapping.mLon[ row ];
+        int lat = aGridMapping.mLat[ row ];
+
+        // Grid cells outside of the ELM grid are never used
+        if ( lon < 1 || lon > mNumLon || lat < 1 || lat > mNumLat ) {
+            continue;
+        }
+
+        int& pairID = pairIDs[ aGridMapping.mRegion[ row ] * numSubregions + aGridMapping.mSubregion[ row ] ];
+        if ( pairID < 0 ) {
+            // Create region ID
+            string regID = aGridMapping.mRegionNames[ aGridMapping.mRegion[ row ] ] + "." +
+                           aGridMapping.mSubregionNames[ aGridMapping.mSubregion[ row ] ];
+            auto currReg = regionIDs.find( regID );
+            if ( currReg == regionIDs.end() ) {
+                currReg = regionIDs.insert( std::make_pair( regID, static_cast<int>( regionsRead.size() ) ) ).first;
+                regionsRead.push_back( regID );
+            }
+            pairID = (*currReg).second;
+        }
+
+        rowGrid.push_back( ( lat - 1 ) * mNumLon + ( lon - 1 ) );
+        rowRegion.push_back( pairID );
+        rowWeight.push_back( aGridMapping.mWeight[ row ] );
     }
-    string str;
-    getline(data, str); // skip the first line
-    while (getline(data, str))
-    {
-        istringstream iss(str);
-        string token;
-        double value;
-        int lon;
-        int lat;
-        string region;
-        string subregion;
-            
-        // Skip region & GLU ID
-        getline(iss, token, ',');
-        getline(iss, token, ',');
-        
-        // Parse longitude
-        getline(iss, token, ',');
-        lon = std::stoi(token);
-        
-        // Parse latitude
-        getline(iss, token, ',');
-        lat = std::stoi(token);
-        
-        string gridID = std::to_string(lon) + "_" + std::to_string(lat);
-        
-        // Parse Region ID
-        getline(iss, token, ',');
-        region = token;
-        region.erase( remove( region.begin(), region.end(), '\"' ), region.end() );
-        
-        // Parse SubRegion ID
-        getline(iss, token, ',');
-        subregion = token;
-        subregion.erase( remove( subregion.begin(), subregion.end(), '\"' ), subregion.end() );
 
-        // Create reion ID
-        string regID = region + "." + subregion;
-        
-        // Add region ID to the mapping vector.
-        // Note that there maybe more than one regID per gridID (hence, a vector)
-        if ( mRegionMapping.find(gridID) == mRegionMapping.end() ) {
-            // If gridID is not found, then add it with this regID in its vector
-            vector<string> temp;
-            temp.push_back(regID);
-            mRegionMapping[gridID] = temp;
-        } else {
-            // If gridID is found, then add to the existing regID vector
-            auto currGrid = mRegionMapping.find( gridID );
-            (*currGrid).second.push_back(regID);
+    // Number the regions in sorted order so that the scalers come out sorted by region and crop.
+    // Also split the "region.basin" names here rather than for every scaler.
+    vector<int> regionRank( regionsRead.size() );
+    vector<string> regionOfKey;
+    vector<string> basinOfKey;
+    for( const auto& currReg : regionIDs ) {
+        regionRank[ currReg.second ] = regionOfKey.size();
+        size_t dot = currReg.first.find( '.' );
+        size_t nextDot = currReg.first.find( '.', dot + 1 );
+        regionOfKey.push_back( currReg.first.substr( 0, dot ) );
+        basinOfKey.push_back( currReg.first.substr( dot + 1, nextDot == string::npos ? string::npos : nextDot - dot - 1 ) );
+    }
+    const int numRegions = regionOfKey.size();
+
+    // Order the rows by grid cell, keeping the file order within each cell
+    vector<int> rowOrder( rowGrid.size() );
+    for( size_t row = 0; row < rowOrder.size(); row++ ) {
+        rowOrder[ row ] = row;
+    }
+    std::stable_sort( rowOrder.begin(), rowOrder.end(), [&rowGrid]( int aLeft, int aRight ) {
+        return rowGrid[ aLeft ] < rowGrid[ aRight ];
+    } );
+
+    // Lay out the entries for each region, in grid order
+    mRegionStart.assign( numRegions + 1, 0 );
+    for( size_t row = 0; row < rowRegion.size(); row++ ) {
+        rowRegion[ row ] = regionRank[ rowRegion[ row ] ];
+        mRegionStart[ rowRegion[ row ] + 1 ]++;
+    }
+    for( int region = 0; region < numRegions; region++ ) {
+        mRegionStart[ region + 1 ] += mRegionStart[ region ];
+    }
+    vector<int> regionNext( mRegionStart.begin(), mRegionStart.end() - 1 );
+    mRegionCell.resize( rowGrid.size() );
+    mRegionWeight.resize( rowGrid.size() );
+    for( int row : rowOrder ) {
+        int entry = regionNext[ rowRegion[ row ] ]++;
+        mRegionCell[ entry ] = rowGrid[ row ];
+        mRegionWeight[ entry ] = rowWeight[ row ];
+    }
+
+    // A grid cell can map to the same region more than once (one row per GLU). Each of those entries
+    // is counted, but they all share the weight of the last row read for that grid cell and region.
+    for( int region = 0; region < numRegions; region++ ) {
+        for( int entry = mRegionStart[ region ] + 1; entry < mRegionStart[ region + 1 ]; entry++ ) {
+            int first = entry;
+            while( first > mRegionStart[ region ] && mRegionCell[ first - 1 ] == mRegionCell[ entry ] ) {
+                first--;
+            }
+            std::fill( mRegionWeight.begin() + first, mRegionWeight.begin() + entry, mRegionWeight[ entry ] );
         }
-        
-        // Parse Weight -- this is the fraction of the grid cell in a particular GCAM region
-        getline(iss, token, ',');
-        value = std::stod(token);
-        
-        mRegionWeights[std::make_pair(gridID,regID)] = value;
     }
-    
+
+    // Every crop of every PFT gets data for each region in the grid
+    vector<bool> cropUsed( mCropNames.size(), false );
+    for( const auto& pftCrops : mPFTCrops ) {
+        for( int crop : pftCrops ) {
+            cropUsed[ crop ] = true;
+        }
+    }
+    // Intern the GCAM region and land technology ( "crop_basin" ) names of the keys. These are
+    // shared with the scaler tables, so the names are only built once per mapping.
+    std::shared_ptr<vector<string>> regionNames( new vector<string>( regionOfKey ) );
+    std::sort( regionNames->begin(), regionNames->end() );
+    regionNames->erase( std::unique( regionNames->begin(), regionNames->end() ), regionNames->end() );
+    std::shared_ptr<vector<string>> landTechNames( new vector<string>() );
+    std::map<string, int> landTechIDs;
+    mScalerKeys.clear();
+    mScalerRegion.clear();
+    mScalerLandTech.clear();
+    for( int region = 0; region < numRegions; region++ ) {
+        int regionName = std::lower_bound( regionNames->begin(), regionNames->end(), regionOfKey[ region ] ) - regionNames->begin();
+        for( size_t crop = 0; crop < mCropNames.size(); crop++ ) {
+            if( cropUsed[ crop ] ) {
+                string landTech = mCropNames[ crop ] + "_" + basinOfKey[ region ];
+                auto currTech = landTechIDs.insert( std::make_pair( landTech, static_cast<int>( landTechNames->size() ) ) ).first;
+                if( (*currTech).second == static_cast<int>( landTechNames->size() ) ) {
+                    landTechNames->push_back( landTech );
+                }
+                mScalerKeys.push_back( region * mCropNames.size() + crop );
+                mScalerRegion.push_back( regionName );
+                mScalerLandTech.push_back( (*currTech).second );
+            }
+        }
+    }
+    mRegionNames = regionNames;
+    mLandTechNames = landTechNames;
+
+    const size_t numKeys = numRegions * mCropNames.size();
+    mTotalArea.resize( numKeys );
+    mBaseTotalArea.resize( numKeys );
+    mTotalNPP.resize( numKeys );
+    mBaseTotalNPP.resize( numKeys );
+    mTotalHR.resize( numKeys );
+    mBaseTotalHR.resize( numKeys );
+
     return;
 }
 
 // Calculate scalers
 void CarbonScalers::calcScalers(int aGCAMYear, double *aELMArea, double *aELMPFTFract, double *aELMNPP, double *aELMHR,
-                                std::vector<int>& aYears, std::vector<std::string>& aRegions, std::vector<std::string>& aLandTechs, std::vector<double>& aAboveScalers, std::vector<double>& aBelowScalers, std::string aBaseNPPFileName, std::string aBaseHRFileName, std::string aBasePFTWtFileName) {
+                                ScalerTable& aScalers, std::string aBaseNPPFileName, std::string aBaseHRFileName, std::string aBasePFTWtFileName) {
     // First, read spatial data
     readBaseYearData(aBaseNPPFileName, aBaseHRFileName, aBasePFTWtFileName);
     
     // Exclude outliers from the scalar calculation
     excludeOutliers(aELMNPP, aELMHR);
     
-    // Create mappings to store intermediate information
-    std::map<std::pair<std::string,std::string>, double> totalArea;
-    std::map<std::pair<std::string,std::string>, double> baseTotalArea;
-    std::map<std::pair<std::string,std::string>, double> totalNPP;
-    std::map<std::pair<std::string,std::string>, double> baseTotalNPP;
-    std::map<std::pair<std::string,std::string>, double> aboveScalarMap;
-    std::map<std::pair<std::string,std::string>, double> totalHR;
-    std::map<std::pair<std::string,std::string>, double> baseTotalHR;
-    std::map<std::pair<std::string,std::string>, double> belowScalarMap;
+    // Reset the region/crop totals
+    std::fill( mTotalArea.begin(), mTotalArea.end(), 0.0 );
+    std::fill( mBaseTotalArea.begin(), mBaseTotalArea.end(), 0.0 );
+    std::fill( mTotalNPP.begin(), mTotalNPP.end(), 0.0 );
+    std::fill( mBaseTotalNPP.begin(), mBaseTotalNPP.end(), 0.0 );
+    std::fill( mTotalHR.begin(), mTotalHR.end(), 0.0 );
+    std::fill( mBaseTotalHR.begin(), mBaseTotalHR.end(), 0.0 );
     
-    // Loop over PFTs and grid cells to calculate weighted average NPP for each GCAM region
-    // Note: E3SM data will have longitude moving fastest, then latitude, then pft, so loop in that order
-    int gridIndex = 0; // Index used for Grid vectors
-    int valIndex = 0; // Index used for PFT x Grid vectors
-    double scalar = 0.0; // Define the scalar
-    double base_scalar = 0.0; // Define the base scalar
-    for( int pft = 0; pft < mNumPFT; pft++ ) {
-        for ( int k = 1; k <= mNumLat; k++ ) {
-            for ( int j = 1; j <= mNumLon; j++ ) {
-                gridIndex = ( k - 1 ) * mNumLon + ( j - 1 );
-                valIndex = ( pft ) * mNumLon * mNumLat + ( k - 1 ) * mNumLon + ( j - 1 );
-                // Get region, subregion, and pft for this entry
-                // TODO: What to do about grid cells with multiple entries? - doesn't seem like this should happen
-                string gridID = std::to_string(j) + "_" + std::to_string(k);
-                auto tempGrid = mRegionMapping.find( gridID );
-                if ( mRegionMapping.find(gridID) == mRegionMapping.end() ) {
-                    // Grid isn't found in the mapping. Currently, this probably means it is an ocean grid.
-                    // TODO: set up loop only over land grids, either using the mRegionMapping or one of the files from ELM
-                } else {
-                    vector<string> regInGrd = (*tempGrid).second;
-                    regInGrd = (*tempGrid).second;
-                    // Loop over all regions this grid is mapped to and calculate the scalars
-                    for(auto regID : regInGrd) {
-                        // Calculate total as NPP/HR of the PFT * area of the PFT
-                        // pft value is fraction of grid cell
-                        scalar = mRegionWeights[std::make_pair(gridID,regID)] * aELMPFTFract[valIndex] * aELMArea[gridIndex];
-                        base_scalar = mRegionWeights[std::make_pair(gridID,regID)] * mBasePFTFractVector[valIndex] * aELMArea[gridIndex];
-                       
-                        // Find current PFT in the PFT2Crop map
-                        auto currPFT = mPFT2GCAMCropMap.find( pft );
-                        vector<string> cropsInPFT = (*currPFT).second;
-                        
-                        // Adjust scalars based on number of crops in PFT
-                        // this provides equal weight to each crop since they are not separate in elm
-                        scalar = scalar / cropsInPFT.size();
-                        base_scalar = base_scalar / cropsInPFT.size();
-                        
-                        // Then add the npp and area for both current and base periods to the region/crop totals
-                        // Note: this assumes that if you find the pair in totalArea that it exists for the baseTotalArea,
-                        //       totalNPP/HR and baseTotalNPP/HR. This should be true since they are all created simultaneously.
-                        for(auto currCrop : cropsInPFT) {
-                            if( totalArea.count(std::make_pair(regID,currCrop)) > 0 ) {
-                                totalArea[std::make_pair(regID,currCrop)] += scalar;
-                                baseTotalArea[std::make_pair(regID,currCrop)] += base_scalar;
-                                totalNPP[std::make_pair(regID,currCrop)] += aELMNPP[valIndex] * scalar;
-                                baseTotalNPP[std::make_pair(regID,currCrop)] += mBaseNPPVector[valIndex] * base_scalar;
-                                totalHR[std::make_pair(regID,currCrop)] += aELMHR[valIndex] * scalar;
-                                baseTotalHR[std::make_pair(regID,currCrop)] += mBaseHRVector[valIndex] * base_scalar;
-                            } else {
-                                totalArea[std::make_pair(regID,currCrop)] = scalar;
-                                baseTotalArea[std::make_pair(regID,currCrop)] = base_scalar;
-                                totalNPP[std::make_pair(regID,currCrop)] = aELMNPP[valIndex] * scalar;
-                                baseTotalNPP[std::make_pair(regID,currCrop)] = mBaseNPPVector[valIndex] * base_scalar;
-                                totalHR[std::make_pair(regID,currCrop)] = aELMHR[valIndex] * scalar;
-                                baseTotalHR[std::make_pair(regID,currCrop)] = mBaseHRVector[valIndex] * base_scalar;
-                            }
-                         }
-                    }
+    // Calculate weighted average NPP and HR for each GCAM region/subregion and crop. Each region only
+    // writes its own totals, so regions can be summed in parallel. Within a region the cells are
+    // visited in the same order for every run (PFT, then latitude, then longitude), so the sums are
+    // reproducible regardless of the number of threads.
+    const int numCrops = mCropNames.size();
+    const int gridPerPFT = mNumLat * mNumLon;
+    auto sumRegion = [&]( int aRegion ) {
+        for( int pft = 0; pft < mNumPFT; pft++ ) {
+            const vector<int>& cropsInPFT = mPFTCrops[ pft ];
+            if( cropsInPFT.empty() ) {
+                continue;
+            }
+            for( int entry = mRegionStart[ aRegion ]; entry < mRegionStart[ aRegion + 1 ]; entry++ ) {
+                int gridIndex = mRegionCell[ entry ];
+                int valIndex = pft * gridPerPFT + gridIndex;
+
+                // Calculate total as NPP/HR of the PFT * area of the PFT
+                // pft value is fraction of grid cell
+                double scalar = mRegionWeight[ entry ] * aELMPFTFract[ valIndex ] * aELMArea[ gridIndex ];
+                double base_scalar = mRegionWeight[ entry ] * mBasePFTFractVector[ valIndex ] * aELMArea[ gridIndex ];
+
+                // Adjust scalars based on number of crops in PFT
+                // this provides equal weight to each crop since they are not separate in elm
+                scalar = scalar / cropsInPFT.size();
+                base_scalar = base_scalar / cropsInPFT.size();
+
+                // Then add the npp and area for both current and base periods to the region/crop totals
+                for( int crop : cropsInPFT ) {
+                    int key = aRegion * numCrops + crop;
+                    mTotalArea[ key ] += scalar;
+                    mBaseTotalArea[ key ] += base_scalar;
+                    mTotalNPP[ key ] += aELMNPP[ valIndex ] * scalar;
+                    mBaseTotalNPP[ key ] += mBaseNPPVector[ valIndex ] * base_scalar;
+                    mTotalHR[ key ] += aELMHR[ valIndex ] * scalar;
+                    mBaseTotalHR[ key ] += mBaseHRVector[ valIndex ] * base_scalar;
                 }
             }
         }
+    };
+    const int numRegions = mRegionStart.size() - 1;
+#if GCAM_PARALLEL_ENABLED
+    tbb::parallel_for( tbb::blocked_range<int>( 0, numRegions ), [&sumRegion]( const tbb::blocked_range<int>& aRange ) {
+        for( int region = aRange.begin(); region != aRange.end(); ++region ) {
+            sumRegion( region );
+        }
+    });
+#else
+    for( int region = 0; region < numRegions; region++ ) {
+        sumRegion( region );
     }
+#endif
     
     // Calculate scalars
-    // Loop over all items in the map
-    std::string crop;
-    std::string regID;
+    // Loop over all region/crop keys that received data
+    vector<double> aboveScalarTable( mScalerKeys.size() );
+    vector<double> belowScalarTable( mScalerKeys.size() );
     double avgNPP;
     double baseAvgNPP;
     double avgHR;
     double baseAvgHR;
     double hrScalar;
-    for(const auto &curr : totalArea) {
-        regID = curr.first.first;
-        crop = curr.first.second;
+    for( size_t i = 0; i < mScalerKeys.size(); i++ ) {
+        int key = mScalerKeys[ i ];
         
         // Calculate average NPP and average HR for each region-crop 
-        if ( totalArea[std::make_pair(regID,crop)] > 0.0 ) {
-            avgNPP = totalNPP[std::make_pair(regID,crop)] / totalArea[std::make_pair(regID,crop)];
-            avgHR = totalHR[std::make_pair(regID,crop)] / totalArea[std::make_pair(regID,crop)];
+        if ( mTotalArea[ key ] > 0.0 ) {
+            avgNPP = mTotalNPP[ key ] / mTotalArea[ key ];
+            avgHR = mTotalHR[ key ] / mTotalArea[ key ];
         } else {
             avgNPP = 0.0;
             avgHR = 0.0;
         }
         
-        if ( baseTotalArea[std::make_pair(regID,crop)] > 0.0 ) {
-            baseAvgNPP = baseTotalNPP[std::make_pair(regID,crop)] / baseTotalArea[std::make_pair(regID,crop)];
-            baseAvgHR = baseTotalHR[std::make_pair(regID,crop)] / baseTotalArea[std::make_pair(regID,crop)];
+        if ( mBaseTotalArea[ key ] > 0.0 ) {
+            baseAvgNPP = mBaseTotalNPP[ key ] / mBaseTotalArea[ key ];
+            baseAvgHR = mBaseTotalHR[ key ] / mBaseTotalArea[ key ];
         } else {
             baseAvgNPP = 0.0;
             baseAvgHR = 0.0;
@@ -264,9 +395,9 @@ void CarbonScalers::calcScalers(int aGCAMYear, double *aELMArea, double *aELMPFT
         
         // Calculate scalar
         if ( baseAvgNPP > 0 ) {
-            aboveScalarMap[std::make_pair(regID,crop)] = avgNPP / baseAvgNPP;
+            aboveScalarTable[ i ] = avgNPP / baseAvgNPP;
         } else {
-            aboveScalarMap[std::make_pair(regID,crop)] = 1.0;
+            aboveScalarTable[ i ] = 1.0;
         }
         
         // Calculate scalar
@@ -274,161 +405,144 @@ void CarbonScalers::calcScalers(int aGCAMYear, double *aELMArea, double *aELMPFT
             // The belowground scalar is a combination of NPP and HR...BUT HR needs to be "flipped" around 1
             // This is because higher heterotrophic respiration means lower C density, everything else being equal
             hrScalar = 2.0 - ( avgHR / baseAvgHR );
-            belowScalarMap[std::make_pair(regID,crop)] = ( aboveScalarMap[std::make_pair(regID,crop)] + hrScalar ) / 2.0;
+            belowScalarTable[ i ] = ( aboveScalarTable[ i ] + hrScalar ) / 2.0;
         } else {
-            belowScalarMap[std::make_pair(regID,crop)] = 1.0;
+            belowScalarTable[ i ] = 1.0;
         }
      }
      
-    createScalerVectors(aGCAMYear, aYears, aRegions, aLandTechs, aAboveScalers, aBelowScalers, aboveScalarMap, belowScalarMap);
+    createScalerTable(aGCAMYear, aScalers, aboveScalarTable, belowScalarTable);
 }
 
 
-// This function transforms the mappings used for internal scalar calculation
-// into the vectors needed to set data within GCAM
-void CarbonScalers::createScalerVectors(int aGCAMYear, std::vector<int>& aYears, std::vector<std::string>& aRegions, std::vector<std::string>& aLandTechs,
-                                        std::vector<double>& aAboveScalers, std::vector<double>& aBelowScalers,
-                                        std::map<std::pair<std::string,std::string>, double> aAboveScalarMap,
-                                        std::map<std::pair<std::string,std::string>, double> aBelowScalarMap) {
-    
-    // Loop through the map and create the vectors
-    std::string regID;
-    std::string crop;
-    std::vector<string> strs;
-    int row = 0;
-    for(const auto &curr : aAboveScalarMap) {
-        regID = curr.first.first;
-        crop = curr.first.second;
-
-        // Split the region name into region and basin
-        boost::split(strs, regID, boost::is_any_of("."));
-        
-        // Set values in each vector
-        // Note that we need to combine the basin with the crop name for the `aLandTechs` vector
-        // and separate the region from the basin for the `aRegions` vector.
-        aYears[row] = aGCAMYear;
-        aRegions[row] = strs[0];
-        aLandTechs[row] = crop + "_" + strs[1];
-        aAboveScalers[row] = curr.second;
-        aBelowScalers[row] = aBelowScalarMap[std::make_pair(regID,crop)];
-    
-        row++;
+// This function copies the scalers into the table used to set data within GCAM.
+// The region and land technology columns only depend on the mapping, so they are
+// only set up when the table was last filled from something else.
+void CarbonScalers::createScalerTable(int aGCAMYear, ScalerTable& aScalers,
+                                      const std::vector<double>& aAboveScalarTable,
+                                      const std::vector<double>& aBelowScalarTable) {
+    if( aScalers.mRegionNames != mRegionNames || aScalers.mLandTechNames != mLandTechNames ) {
+        aScalers.mRegionNames = mRegionNames;
+        aScalers.mLandTechNames = mLandTechNames;
+        aScalers.mRegion = mScalerRegion;
+        aScalers.mLandTech = mScalerLandTech;
+        aScalers.mYear.resize( mScalerKeys.size() );
     }
-    
+
+    std::fill( aScalers.mYear.begin(), aScalers.mYear.end(), aGCAMYear );
+    aScalers.mAboveScaler = aAboveScalarTable;
+    aScalers.mBelowScaler = aBelowScalarTable;
 }
 
 // Write scalar data to a file. This is a diagnostic.
-void CarbonScalers::writeScalers(std::string aFileName, std::vector<int>& aYears, std::vector<std::string>& aRegions, std::vector<std::string>& aLandTechs, std::vector<double>& aAboveScalers, std::vector<double>& aBelowScalers, int aLength) {
+void CarbonScalers::writeScalers(std::string aFileName, const ScalerTable& aScalers) {
     // DEBUG: Write output
     // TODO: This should be moved to a separate method that will write output (if the boolean is set)
-    ofstream oFile;
-    oFile.open(aFileName);
-    for(int i = 0; i < aLength; i++) {
-        oFile << aYears[i] << "," << aRegions[i] << "," << aLandTechs[i] << "," << aAboveScalers[i] << "," << aBelowScalers[i] << endl;
+    writeScalerFile(aFileName, aScalers);
+}
+
+// Write the scalers on aWriter's thread. The table is copied before returning so it can be
+// updated in the next coupling step while the file is written.
+void CarbonScalers::writeScalers(AsyncWriter& aWriter, std::string aFileName, const ScalerTable& aScalers) {
+    std::shared_ptr<const ScalerTable> scalers(new ScalerTable(aScalers));
+    aWriter.write([aFileName, scalers]() { writeScalerFile(aFileName, *scalers); });
+}
+
+// Rows are formatted into one block, scalers as << would with the default precision
+void CarbonScalers::writeScalerFile(const std::string& aFileName, const ScalerTable& aScalers) {
+    string text;
+    char buffer[64];
+    for(size_t i = 0; i < aScalers.size(); i++) {
+        snprintf(buffer, sizeof(buffer), "%d,", aScalers.mYear[i]);
+        text += buffer;
+        text += (*aScalers.mRegionNames)[aScalers.mRegion[i]];
+        text += ',';
+        text += (*aScalers.mLandTechNames)[aScalers.mLandTech[i]];
+        snprintf(buffer, sizeof(buffer), ",%g,%g\n", aScalers.mAboveScaler[i], aScalers.mBelowScaler[i]);
+        text += buffer;
     }
-    oFile.close();
+    AsyncWriter::writeText(aFileName, text);
 }
 
 // Read in scalers from a csv file
 // Note: this is used for diagnostics or special experiments. In fully coupled E3SM-GCAM, these scalers
 // are calculated based on data passed in code through the wrapper
-void CarbonScalers::readScalers(std::vector<int>& aYears, std::vector<std::string>& aRegions, std::vector<std::string>& aLandTechs,
-                                 std::vector<double>& aAboveScalers, std::vector<double>& aBelowScalers) {
+void CarbonScalers::readScalers(ScalerTable& aScalers) {
     
     // TODO: Get this file name from either a configuration or passed argument
-    // TODO: Also, do we need to worry about length?
-    ifstream data("../cpl/data/scaler_data.csv");
-    if (!data.is_open())
-    {
-        exit(EXIT_FAILURE);
-    }
-    string str;
-    getline(data, str); // skip the first line
-    int row = 0;
-    while (getline(data, str))
+    CSVReader data("../cpl/data/scaler_data.csv");
+
+    // Region and land technology names are interned in the order they are first read
+    std::shared_ptr<vector<string>> regionNames( new vector<string>() );
+    std::shared_ptr<vector<string>> landTechNames( new vector<string>() );
+    std::map<string, int> regionIDs;
+    std::map<string, int> landTechIDs;
+    aScalers.mYear.clear();
+    aScalers.mRegion.clear();
+    aScalers.mLandTech.clear();
+    aScalers.mAboveScaler.clear();
+    aScalers.mBelowScaler.clear();
+
+    std::string region;
+    std::string tech;
+    data.nextRow(); // skip the first line
+    while (data.nextRow())
     {
-        istringstream iss(str);
-        string token;
-        int year;
-        std::string region;
-        std::string tech;
-        double aboveScaler;
-        double belowScaler;
-        
-        // Parse current year
-        getline(iss, token, ',');
-        year = std::stoi(token);
-        
-        // Parse region
-        getline(iss, region, ',');
+        // Columns are year, region, ag production technology name, above and below scalers
+        int year = data.getInt(0);
+        data.getString(1, region);
+        data.getString(2, tech);
+        double aboveScaler = data.getDouble(3);
+        double belowScaler = data.getDouble(4);
         
-        // Parse ag production technology name
-        getline(iss, tech, ',');
-        
-        // Parse above scaler
-        getline(iss, token, ',');
-        aboveScaler = std::stod(token);
+        auto currReg = regionIDs.find( region );
+        if ( currReg == regionIDs.end() ) {
+            currReg = regionIDs.insert( std::make_pair( region, static_cast<int>( regionNames->size() ) ) ).first;
+            regionNames->push_back( region );
+        }
+        auto currTech = landTechIDs.find( tech );
+        if ( currTech == landTechIDs.end() ) {
+            currTech = landTechIDs.insert( std::make_pair( tech, static_cast<int>( landTechNames->size() ) ) ).first;
+            landTechNames->push_back( tech );
+        }
 
-        // Parse below scaler
-        getline(iss, token, ',');
-        belowScaler = std::stod(token);
-        
-        aYears.at(row) = year;
-        aRegions[row] = region;
-        aLandTechs[row] = tech;
-        aAboveScalers[row] = aboveScaler;
-        aBelowScalers[row] = belowScaler;       
- 
-        row++;
+        aScalers.mYear.push_back( year );
+        aScalers.mRegion.push_back( (*currReg).second );
+        aScalers.mLandTech.push_back( (*currTech).second );
+        aScalers.mAboveScaler.push_back( aboveScaler );
+        aScalers.mBelowScaler.push_back( belowScaler );
     }
-    
+    aScalers.mRegionNames = regionNames;
+    aScalers.mLandTechNames = landTechNames;
     
 }
 
 void CarbonScalers::excludeOutliers( double *aELMNPP, double *aELMHR ) {
     int length = mNumLat * mNumLon * mNumPFT;
-    std::vector<double> scaledNPP(aELMNPP+0, aELMNPP+length);
-    std::vector<double> scaledHR(aELMHR+0, aELMHR+length);
-    
-    // Calculate raw scalars
-    std::transform(scaledNPP.begin(), scaledNPP.end(), mBaseNPPVector.begin(), scaledNPP.begin(), std::divides<double>());
-    std::transform(scaledHR.begin(), scaledHR.end(), mBaseHRVector.begin(), scaledHR.begin(), std::divides<double>());
-    
-    // Remove zero and nan values -- ocean grid cells weren't included in the original data and cells with 0 base values were excluded
-    std::vector<double>::iterator newIter = std::remove_if( scaledNPP.begin(), scaledNPP.end(), [](double x){return x == 0 || x != x;});
-    std::vector<double>::iterator newHRIter = std::remove_if( scaledHR.begin(), scaledHR.end(), [](double x){return x == 0 || x != x;});
-    scaledNPP.resize( newIter -  scaledNPP.begin() );
-    scaledHR.resize( newHRIter -  scaledHR.begin() );
 
-    // Compute the median and median absolute deviation
+    // Compute the median and median absolute deviation of the raw scalars
     // See: Davies, P.L. and Gather, U. (1993), "The identification of multiple outliers"
     // J. Amer. Statist. Assoc., 88:782-801.
     double madLimit = 5.2;
 
-    // First, sort the scaler and find median
-    std::sort(scaledNPP.begin(), scaledNPP.end());
-    std::sort(scaledHR.begin(), scaledHR.end());
-    double median = 0.5 * (scaledNPP[scaledNPP.size() / 2 - 1] + scaledNPP[scaledNPP.size() / 2]);
-    double medianHR = 0.5 * (scaledHR[scaledHR.size() / 2 - 1] + scaledHR[scaledHR.size() / 2]);
-    
-    // Then, find the median absolute deviation
-    transform(scaledNPP.begin(), scaledNPP.end(), scaledNPP.begin(), [median](double x){return abs(x - median);});
-    transform(scaledHR.begin(), scaledHR.end(), scaledHR.begin(), [medianHR](double x){return abs(x - medianHR);});
-    std::sort(scaledNPP.begin(), scaledNPP.end());
-    std::sort(scaledHR.begin(), scaledHR.end());
-    double mad = 0.5 * (scaledNPP[scaledNPP.size() / 2 - 1] + scaledNPP[scaledNPP.size() / 2]);
-    double madHR = 0.5 * (scaledHR[scaledHR.size() / 2 - 1] + scaledHR[scaledHR.size() / 2]);
-
-    // Now, calculate upper and lower bounds as median +/- madLimit * mad
-    double upperBound = median + madLimit * mad;
-    double lowerBound = median - madLimit * mad;
-    double upperBoundHR = medianHR + madLimit * madHR;
-    double lowerBoundHR = medianHR - madLimit * madHR;
+    // Calculate upper and lower bounds as median +/- madLimit * mad. NPP and HR are independent.
+    double upperBound;
+    double lowerBound;
+    double upperBoundHR;
+    double lowerBoundHR;
+#if GCAM_PARALLEL_ENABLED
+    tbb::parallel_invoke(
+        [&]() { calcOutlierBounds( aELMNPP, &mBaseNPPVector[0], length, madLimit, mNPPRatios, lowerBound, upperBound ); },
+        [&]() { calcOutlierBounds( aELMHR, &mBaseHRVector[0], length, madLimit, mHRRatios, lowerBoundHR, upperBoundHR ); } );
+#else
+    calcOutlierBounds( aELMNPP, &mBaseNPPVector[0], length, madLimit, mNPPRatios, lowerBound, upperBound );
+    calcOutlierBounds( aELMHR, &mBaseHRVector[0], length, madLimit, mHRRatios, lowerBoundHR, upperBoundHR );
+#endif
     
     // Remove Outliers. These are set to zero so they will be excluded from scaler calculation
     for( int i = 0; i < length; i++ ) {
-        if( scaledNPP[i] > upperBound || scaledNPP[i] < lowerBound ||
-            scaledHR[i] > upperBoundHR || scaledHR[i] < lowerBoundHR ) {
+        if( isOutlier( aELMNPP[i], mBaseNPPVector[i], lowerBound, upperBound ) ||
+            isOutlier( aELMHR[i], mBaseHRVector[i], lowerBoundHR, upperBoundHR ) ) {
             aELMNPP[i] = 0;
             mBaseNPPVector[i] = 0;
             aELMHR[i] = 0;
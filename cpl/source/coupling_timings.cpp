@@ -0,0 +1,123 @@
+/*
+ * LEGAL NOTICE
+ * This computer software was prepared by Battelle Memorial Institute,
+ * hereinafter the Contractor, under Contract No. DE-AC05-76RL0 1830
+ * with the Department of Energy (DOE). NEITHER THE GOVERNMENT NOR THE
+ * CONTRACTOR MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR ASSUMES ANY
+ * LIABILITY FOR THE USE OF THIS SOFTWARE. This notice including this
+ * sentence must appear on any copies of this computer software.
+ *
+ * EXPORT CONTROL
+ * User agrees that the Software will not be shipped, transferred or
+ * exported into any country or used in any manner prohibited by the
+ * United States Export Administration Act or any other applicable
+ * export laws, restrictions or regulations (collectively the "Export Laws").
+ * Export of the Software may require some form of license or other
+ * authority from the U.S. Government, and failure to obtain such
+ * export control license may result in criminal liability under
+ * U.S. laws. In addition, if the Software is identified as export controlled
+ * items under the Export Laws, User represents and warrants that User
+ * is not a citizen, or otherwise located within, an embargoed nation
+ * (including without limitation Iran, Syria, Sudan, Cuba, and North Korea)
+ *     and that User is not otherwise prohibited
+ * under the Export Laws from receiving the Software.
+ *
+ * Copyright 2011 Battelle Memorial Institute.  All Rights Reserved.
+ * Distributed as open-source under the terms of the Educational Community
+ * License version 2.0 (ECL 2.0). http://www.opensource.org/licenses/ecl2.php
+ *
+ * For further details, see: http://www.globalchange.umd.edu/models/gcam/
+ *
+ */
+
+#include <fstream>
+
+#include "util/base/include/definitions.h"
+#include "util/base/include/timer.h"
+#include "../include/coupling_timings.h"
+
+using namespace std;
+
+namespace {
+    const int OUTPUT_PRECISION = 10;
+
+    // Quote a name for JSON
+    string jsonString(const string& aName) {
+        string quoted = "\"";
+        for(const char c : aName) {
+            if(c == '"' || c == '\\') {
+                quoted += '\\';
+            }
+            quoted += c;
+        }
+        return quoted + "\"";
+    }
+
+    // Change from the last totals, updating them to the current totals
+    map<string, double> getChange(const map<string, double>& aCurrent, map<string, double>& aLast) {
+        map<string, double> change;
+        for(const auto& total : aCurrent) {
+            change[total.first] = total.second - aLast[total.first];
+        }
+        aLast = aCurrent;
+        return change;
+    }
+
+    // Open a file to append to. True is returned if the file is empty.
+    bool openAppend(const string& aFileName, ofstream& aFile) {
+        aFile.open(aFileName, ios::app | ios::ate);
+        return aFile.tellp() == 0;
+    }
+}
+
+// Constructor, anything recorded before the first year is set is written as year 0
+CouplingTimings::CouplingTimings(const string& aFileName):
+mFileName(aFileName),
+mYear(0),
+mLastTimes(TimerRegistry::getInstance().getAllTimes()),
+mLastCounters(TimerRegistry::getInstance().getAllCounters())
+{
+}
+
+// Start recording the given year. If it is not the year being recorded, the row for that
+// year is written first.
+void CouplingTimings::setYear(int aYear) {
+    if(aYear != mYear) {
+        write();
+        mYear = aYear;
+    }
+}
+
+// Write the row for the year being recorded
+void CouplingTimings::write() {
+    const TimerRegistry& timers = TimerRegistry::getInstance();
+    map<string, double> times = getChange(timers.getAllTimes(), mLastTimes);
+    map<string, double> counters = getChange(timers.getAllCounters(), mLastCounters);
+
+    ofstream csvFile;
+    csvFile.precision(OUTPUT_PRECISION);
+    if(openAppend(mFileName + ".csv", csvFile)) {
+        csvFile << "year,type,name,value" << endl;
+    }
+    for(const auto& time : times) {
+        csvFile << mYear << ",time," << time.first << "," << time.second << "\n";
+    }
+    for(const auto& counter : counters) {
+        csvFile << mYear << ",counter," << counter.first << "," << counter.second << "\n";
+    }
+    csvFile.close();
+
+    ofstream jsonFile;
+    jsonFile.precision(OUTPUT_PRECISION);
+    openAppend(mFileName + ".json", jsonFile);
+    jsonFile << "{\"year\":" << mYear << ",\"times\":{";
+    for(auto it = times.begin(); it != times.end(); ++it) {
+        jsonFile << (it == times.begin() ? "" : ",") << jsonString(it->first) << ":" << it->second;
+    }
+    jsonFile << "},\"counters\":{";
+    for(auto it = counters.begin(); it != counters.end(); ++it) {
+        jsonFile << (it == counters.begin() ? "" : ",") << jsonString(it->first) << ":" << it->second;
+    }
+    jsonFile << "}}" << endl;
+    jsonFile.close();
+}
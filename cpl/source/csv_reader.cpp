@@ -0,0 +1,270 @@
+/*
+ * LEGAL NOTICE
+ * This computer software was prepared by Battelle Memorial Institute,
+ * hereinafter the Contractor, under Contract No. DE-AC05-76RL0 1830
+ * with the Department of Energy (DOE). NEITHER THE GOVERNMENT NOR THE
+ * CONTRACTOR MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR ASSUMES ANY
+ * LIABILITY FOR THE USE OF THIS SOFTWARE. This notice including this
+ * sentence must appear on any copies of this computer software.
+ *
+ * EXPORT CONTROL
+ * User agrees that the Software will not be shipped, transferred or
+ * exported into any country or used in any manner prohibited by the
+ * United States Export Administration Act or any other applicable
+ * export laws, restrictions or regulations (collectively the "Export Laws").
+ * Export of the Software may require some form of license or other
+ * authority from the U.S. Government, and failure to obtain such
+ * export control license may result in criminal liability under
+ * U.S. laws. In addition, if the Software is identified as export controlled
+ * items under the Export Laws, User represents and warrants that User
+ * is not a citizen, or otherwise located within, an embargoed nation
+ * (including without limitation Iran, Syria, Sudan, Cuba, and North Korea)
+ *     and that User is not otherwise prohibited
+ * under the Export Laws from receiving the Software.
+ *
+ * Copyright 2011 Battelle Memorial Institute.  All Rights Reserved.
+ * Distributed as open-source under the terms of the Educational Community
+ * License version 2.0 (ECL 2.0). http://www.opensource.org/licenses/ecl2.php
+ *
+ * For further details, see: http://www.globalchange.umd.edu/models/gcam/
+ *
+ */
+
+#include <fstream>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+
+#include "util/logger/include/ilogger.h"
+#include "../include/csv_reader.h"
+
+using namespace std;
+
+namespace {
+    // Parse a plain decimal number (no exponent) whose digits fit exactly in a double. Both the
+    // digits and the power of ten are then exact, so a single division or multiplication gives
+    // the correctly rounded result, the same as strtod. Returns false for anything else so it
+    // can be left to strtod.
+    bool parseShortDecimal(const char* aStart, const char* aEnd, double& aResult)
+    {
+        static const double POWERS_OF_TEN[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                                1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+        const uint64_t MAX_EXACT = uint64_t(1) << 53;
+        const char* curr = aStart;
+        const bool isNegative = curr < aEnd && *curr == '-';
+        if (curr < aEnd && (*curr == '-' || *curr == '+'))
+        {
+            ++curr;
+        }
+        uint64_t digits = 0;
+        bool hasDigits = false;
+        int numDigits = 0;
+        int fractionDigits = 0;
+        bool inFraction = false;
+        for (; curr < aEnd; ++curr)
+        {
+            if (*curr >= '0' && *curr <= '9')
+            {
+                // Leading zeros do not use up precision
+                if (digits > 0 || *curr != '0')
+                {
+                    ++numDigits;
+                }
+                if (numDigits > 16)
+                {
+                    return false;
+                }
+                digits = digits * 10 + (*curr - '0');
+                hasDigits = true;
+                fractionDigits += inFraction;
+            }
+            else if (*curr == '.' && !inFraction)
+            {
+                inFraction = true;
+            }
+            else
+            {
+                return false;
+            }
+        }
+        if (!hasDigits || digits > MAX_EXACT || fractionDigits > 22)
+        {
+            return false;
+        }
+        aResult = static_cast<double>(digits) / POWERS_OF_TEN[fractionDigits];
+        if (isNegative)
+        {
+            aResult = -aResult;
+        }
+        return true;
+    }
+}
+
+// Constructor, reads the file into memory. The program exits if the file cannot be read.
+CSVReader::CSVReader(const string& aFileName, char aDelimiter):
+mFileName(aFileName),
+mDelimiter(aDelimiter),
+mNextRow(0),
+mLineNumber(0)
+{
+    ifstream data(aFileName, ios::binary | ios::ate);
+    if (!data.is_open())
+    {
+        ILogger& coupleLog = ILogger::getLogger("coupling_log");
+        coupleLog.setLevel(ILogger::ERROR);
+        coupleLog << "File not found: " << aFileName << endl;
+        exit(EXIT_FAILURE);
+    }
+    mBuffer.resize(static_cast<size_t>(data.tellg()) + 1);
+    data.seekg(0);
+    data.read(mBuffer.data(), mBuffer.size() - 1);
+    mBuffer.back() = '\0';
+}
+
+// Split the next row into fields, skipping blank lines. Returns false at the end of the file.
+bool CSVReader::nextRow()
+{
+    const size_t fileEnd = mBuffer.size() - 1;
+    char* row;
+    char* rowEnd;
+    do
+    {
+        if (mNextRow >= fileEnd)
+        {
+            return false;
+        }
+        ++mLineNumber;
+        row = mBuffer.data() + mNextRow;
+        rowEnd = static_cast<char*>(memchr(row, '\n', fileEnd - mNextRow));
+        if (!rowEnd)
+        {
+            rowEnd = mBuffer.data() + fileEnd;
+        }
+        mNextRow = rowEnd - mBuffer.data() + 1;
+        if (rowEnd > row && *(rowEnd - 1) == '\r')
+        {
+            --rowEnd;
+        }
+    } while (rowEnd == row);
+    mFieldStart.clear();
+    mFieldEnd.clear();
+
+    char* field = row;
+    while (true)
+    {
+        char* fieldEnd = static_cast<char*>(memchr(field, mDelimiter, rowEnd - field));
+        const bool isLast = !fieldEnd;
+        if (isLast)
+        {
+            fieldEnd = rowEnd;
+        }
+        char* start = field;
+        char* end = fieldEnd;
+        if (end - start >= 2 && *start == '"' && *(end - 1) == '"')
+        {
+            ++start;
+            --end;
+        }
+        *end = '\0';
+        mFieldStart.push_back(start);
+        mFieldEnd.push_back(end);
+        if (isLast)
+        {
+            break;
+        }
+        field = fieldEnd + 1;
+    }
+    return true;
+}
+
+size_t CSVReader::getNumFields() const
+{
+    return mFieldStart.size();
+}
+
+int CSVReader::getLineNumber() const
+{
+    return mLineNumber;
+}
+
+// Get a field of the current row. The pointer is valid until the next row is read.
+const char* CSVReader::getField(size_t aField) const
+{
+    if (aField >= mFieldStart.size())
+    {
+        error(aField, "Missing column");
+    }
+    return mFieldStart[aField];
+}
+
+string CSVReader::getString(size_t aField) const
+{
+    const char* value = getField(aField);
+    return string(value, mFieldEnd[aField]);
+}
+
+// Copy a field into aValue, reusing its storage
+void CSVReader::getString(size_t aField, string& aValue) const
+{
+    const char* value = getField(aField);
+    aValue.assign(value, mFieldEnd[aField]);
+}
+
+int CSVReader::getInt(size_t aField) const
+{
+    const char* value = getField(aField);
+    char* end;
+    long result = strtol(value, &end, 10);
+    if (end == value || end != mFieldEnd[aField])
+    {
+        error(aField, "Expected an integer but found \"" + string(value) + "\"");
+    }
+    return static_cast<int>(result);
+}
+
+double CSVReader::getDouble(size_t aField) const
+{
+    const char* value = getField(aField);
+    double result;
+    if (parseShortDecimal(value, mFieldEnd[aField], result))
+    {
+        return result;
+    }
+    char* end;
+    result = strtod(value, &end);
+    if (end == value || end != mFieldEnd[aField])
+    {
+        error(aField, "Expected a number but found \"" + string(value) + "\"");
+    }
+    return result;
+}
+
+// Booleans can be written as true/false or as a number, where anything but 0 is true
+bool CSVReader::getBool(size_t aField) const
+{
+    const char* value = getField(aField);
+    if (strcmp(value, "true") == 0 || strcmp(value, ".true.") == 0)
+    {
+        return true;
+    }
+    if (strcmp(value, "false") == 0 || strcmp(value, ".false.") == 0)
+    {
+        return false;
+    }
+    char* end;
+    long result = strtol(value, &end, 10);
+    if (end == value || end != mFieldEnd[aField])
+    {
+        error(aField, "Expected true or false but found \"" + string(value) + "\"");
+    }
+    return result != 0;
+}
+
+// Log an error in a field of the current row and exit
+void CSVReader::error(size_t aField, const string& aMessage) const
+{
+    ILogger& coupleLog = ILogger::getLogger("coupling_log");
+    coupleLog.setLevel(ILogger::ERROR);
+    coupleLog << mFileName << ":" << mLineNumber << ": column " << aField + 1 << ": " << aMessage << endl;
+    exit(EXIT_FAILURE);
+}
@@ -39,20 +39,27 @@
 
 #include <iostream>
 #include <fstream>
+#include <cassert>
+#include <algorithm>
+
+#if GCAM_PARALLEL_ENABLED
+#include <tbb/parallel_for.h>
+#endif
 
 #include "util/base/include/auto_file.h"
 #include "../include/emiss_downscale.h"
+#include "../include/async_writer.h"
+#include "../include/csv_reader.h"
 
 using namespace std;
 
 // Constructor
-EmissDownscale::EmissDownscale(int aNumLon, int aNumLat, int aNumMon, int aNumLev) : ASpatialData(aNumLat * aNumLon * aNumMon * aNumLev),
-                                            mBaseYearEmissVector(aNumLat * aNumLon * aNumMon * aNumLev, 0),
-                                            mCurrYearEmissVector(aNumLat * aNumLon * aNumMon * aNumLev, 0),
+EmissDownscale::EmissDownscale(int aNumLon, int aNumLat, int aNumMon, int aNumLev, bool aNormalizeWeight) : ASpatialData(aNumLat * aNumLon * aNumMon * aNumLev),
                                             mNumLon( aNumLon ),
                                             mNumLat( aNumLat ),
                                             mNumMon( aNumMon ),
-                                            mNumLev( aNumLev )
+                                            mNumLev( aNumLev ),
+                                            mNormalizeWeight( aNormalizeWeight )
 {
 }
 
@@ -61,351 +68,328 @@ EmissDownscale::~EmissDownscale()
 {
 }
 
-// Read in a regional mapping data from a file
-void EmissDownscale::readRegionalMappingData(std::string aFileName)
-{
-    ifstream data(aFileName);
-    if (!data.is_open())
+namespace {
+    // Region names are written without spaces in the mapping and base year files
+    string removeSpaces(string aName)
     {
-        exit(EXIT_FAILURE);
+        aName.erase(remove(aName.begin(), aName.end(), ' '), aName.end());
+        return aName;
     }
-    string str;
-    getline(data, str); // skip the first line
-    while (getline(data, str))
+
+    // Find the index of a region in the mapping, exiting if it is not there
+    int getRegionIndex(const RegionalMapping& aMapping, const string& aRegion, const string& aFileName)
     {
-        istringstream iss(str);
-        string token;
-        double value;
-        int lon;
-        int lat;
-        string region;
-        string subregion;
-
-        // Skip region & GLU ID
-        getline(iss, token, ',');
-        getline(iss, token, ',');
-
-        // Parse longitude
-        getline(iss, token, ',');
-        lon = std::stoi(token);
-
-        // Parse latitude
-        getline(iss, token, ',');
-        lat = std::stoi(token);
-
-        string gridID = std::to_string(lon) + "_" + std::to_string(lat);
-
-        // Parse Region Name
-        getline(iss, token, ',');
-        region = token;
-        region.erase(remove(region.begin(), region.end(), '\"'), region.end());
-
-        // Skip SubRegion Name
-        getline(iss, token, ',');
-
-        // Create region ID
-        string regID = region;
-
-        // Add region ID to the mapping vector.
-        // Note that there maybe more than one regID per gridID (hence, a vector)
-        if (mRegionMapping.find(gridID) == mRegionMapping.end())
+        auto currReg = find(aMapping.mRegionNames.begin(), aMapping.mRegionNames.end(), aRegion);
+        if (currReg == aMapping.mRegionNames.end())
         {
-            // If gridID is not found, then add it with this regID in its vector
-            vector<string> temp;
-            temp.push_back(regID);
-            mRegionMapping[gridID] = temp;
+            ILogger& coupleLog = ILogger::getLogger( "coupling_log" );
+            coupleLog.setLevel( ILogger::ERROR );
+            coupleLog << "Unknown region " << aRegion << " in " << aFileName << endl;
+            exit(EXIT_FAILURE);
         }
-        else
-        {
-            // If gridID is found, then add to the existing regID vector
-            auto currGrid = mRegionMapping.find(gridID);
-            (*currGrid).second.push_back(regID);
-        }
-
-        // Parse Weight -- this is the fraction of the grid cell in a particular GCAM region
-        getline(iss, token, ',');
-        value = std::stod(token);
-
-        mRegionWeights[std::make_pair(gridID, regID)] = value;
+        return currReg - aMapping.mRegionNames.begin();
     }
+}
 
-    return;
+// Read in a regional mapping data from a file and compile it into a sparse grid -> region operator.
+// Regions are indexed by their position in aRegionNames.
+void EmissDownscale::readRegionalMappingData(std::string aFileName, const std::vector<std::string>& aRegionNames)
+{
+    readRegionalMappingData(*GridMapping::readGridMapping(aFileName), aRegionNames);
 }
 
-// Read in regional Base-Year Emission Data from a file
-void EmissDownscale::readRegionalBaseYearEmissionData(std::string aFileName)
+// Compile a mapping that has already been read into a sparse grid -> region operator.
+// Regions are indexed by their position in aRegionNames.
+void EmissDownscale::readRegionalMappingData(const GridMapping& aGridMapping, const std::vector<std::string>& aRegionNames)
 {
-    ifstream data(aFileName);
-    if (!data.is_open())
+    std::shared_ptr<RegionalMapping> mapping(new RegionalMapping());
+    for (const auto& region : aRegionNames)
     {
-        exit(EXIT_FAILURE);
-    }
-    string str;
-    getline(data, str); // skip the first line
-    while (getline(data, str))
-    {
-        istringstream iss(str);
-        string token;
-        double value;
-        string regID;
-        string sectorID;
-
-        // Parse Region Name
-        getline(iss, token, ',');
-        regID = token;
-        regID.erase(remove(regID.begin(), regID.end(), '\"'), regID.end());
-
-        // Parse Sector
-        getline(iss, token, ',');
-        sectorID = token;
-        sectorID.erase(remove(sectorID.begin(), sectorID.end(), '\"'), sectorID.end());
-
-        // Skip Year
-        getline(iss, token, ',');
-
-        // Parse Base-Year Emission
-        getline(iss, token, ',');
-        value = std::stod(token);
-
-       // Get the index of the region
-        auto currReg = mRegionIDName.find(regID);
-        int regIndex = (*currReg).second - 1;
-        
-        if (sectorID == "surface")
-        { aBaseYearEmissions_sfc[regIndex] = value;}
-        else if (sectorID == "aircraft")
-        { aBaseYearEmissions_air[regIndex] = value;}
-        
+        mapping->mRegionNames.push_back(removeSpaces(region));
     }
 
-    return;
-}
+    // Mapping rows in file order: grid index, region index, and weight
+    vector<int> rowGrid;
+    vector<int> rowRegion;
+    vector<double> rowWeight;
+    // Number of mapping rows per grid cell, used to lay out the sparse operator
+    vector<int> rowsInGrid(mNumLat * mNumLon, 0);
+    // Index in aRegionNames of each region in the mapping file, found when it is first used
+    vector<int> regionIndex(aGridMapping.mRegionNames.size(), -1);
 
-// Downscale emissions
-void EmissDownscale::downscaleSurfaceCO2Emissions(double *aCurrYearEmissions)
-{ // baseYearEmission need to be updated
+    for (size_t row = 0; row < aGridMapping.mWeight.size(); row++)
+    {
+        int lon = aGridMapping.mLon[row];
+        int lat = aGridMapping.mLat[row];
 
-    // First, set the values that were read in as the BaseYearEmissions
-    mBaseYearEmissVector = getValueVector();
+        // Skip grid cells outside of the grid being downscaled to
+        if (lon < 1 || lon > mNumLon || lat < 1 || lat > mNumLat)
+        {
+            continue;
+        }
 
-    // Calculate current year emissions vector by scaling base year emissions up
-    mCurrYearEmissVector = mBaseYearEmissVector;
-    // double scaler = aCurrYearEmissions / aBaseYearEmissions;
-    // std::transform(mCurrYearEmissVector.begin(), mCurrYearEmissVector.end(),
-    //                 mCurrYearEmissVector.begin(), [scaler](double i) { return i * scaler; });
+        int region = aGridMapping.mRegion[row];
+        if (regionIndex[region] < 0)
+        {
+            regionIndex[region] = getRegionIndex(*mapping, aGridMapping.mRegionNames[region], aGridMapping.mFileName);
+        }
 
-    int gridIndex = 0;   // Index used for Grid vectors
-    int valIndex = 0;    // Index used for PFT x Grid vectors
-    double scalar = 0.0; // Define the scalar
-    double weight = 0.0; // Define the weight
+        int gridIndex = (lat - 1) * mNumLon + (lon - 1);
+        rowGrid.push_back(gridIndex);
+        rowRegion.push_back(regionIndex[region]);
+        rowWeight.push_back(aGridMapping.mWeight[row]);
+        rowsInGrid[gridIndex]++;
+    }
 
-    for (int k = 1; k <= mNumLat; k++)
+    // Lay out the land cells in grid order with the start of each cell's entries
+    mapping->mCellStart.assign(1, 0);
+    vector<int> gridStart(mNumLat * mNumLon, -1);
+    for (int grid = 0; grid < mNumLat * mNumLon; grid++)
     {
-        for (int j = 1; j <= mNumLon; j++)
+        if (rowsInGrid[grid] > 0)
         {
+            gridStart[grid] = mapping->mCellStart.back();
+            mapping->mLandCells.push_back(grid);
+            mapping->mCellStart.push_back(mapping->mCellStart.back() + rowsInGrid[grid]);
+        }
+    }
 
-            gridIndex = (k - 1) * mNumLon + (j - 1);
+    // Scatter the rows into the operator, keeping the file order within each cell
+    mapping->mCellRegion.resize(rowGrid.size());
+    mapping->mCellWeight.resize(rowGrid.size());
+    for (size_t row = 0; row < rowGrid.size(); row++)
+    {
+        int entry = gridStart[rowGrid[row]]++;
+        mapping->mCellRegion[entry] = rowRegion[row];
+        mapping->mCellWeight[entry] = rowWeight[row];
+    }
 
-            // Get region for this entry
-            string gridID = std::to_string(j) + "_" + std::to_string(k);
-            auto tempGrid = mRegionMapping.find(gridID);
-            if (mRegionMapping.find(gridID) == mRegionMapping.end())
-            {
-                // Grid isn't found in the mapping. Currently, this probably means it is an ocean grid.
-                // TODO: set up loop only over land grids, either using the mRegionMapping or one of the files from ELM
-            }
-            else
+    // Grid cells can map to the same region more than once (one row per GLU). Each of those entries
+    // is counted, but they all share the weight of the last row read for that grid cell and region.
+    for (size_t cell = 0; cell < mapping->mLandCells.size(); cell++)
+    {
+        for (int entry = mapping->mCellStart[cell]; entry < mapping->mCellStart[cell + 1]; entry++)
+        {
+            for (int later = entry + 1; later < mapping->mCellStart[cell + 1]; later++)
             {
-                vector<string> regInGrd = (*tempGrid).second;
-                scalar = 0;
-                weight = 0;
-                // Loop over all regions this grid is mapped to and calculate the scalars
-                for (auto regID : regInGrd)
+                if (mapping->mCellRegion[later] == mapping->mCellRegion[entry])
                 {
-                    // Calculate total as NPP/HR of the PFT * area of the PFT
-                    // pft value is fraction of grid cell
-                    auto currReg = mRegionIDName.find(regID);
-                    int regIndex = (*currReg).second - 1;
-
-                    scalar += aCurrYearEmissions[regIndex] / aBaseYearEmissions_sfc[regIndex] * mRegionWeights[std::make_pair(gridID, regID)];
-                    weight + = mRegionWeights[std::make_pair(gridID, regID)];
-                }
-                scalar = scalar / weight; // normalized by the total eright
-                for (int mon = 1; mon <= mNumMon; mon++)
-                {
-                    valIndex = (mon - 1) * mNumLon * mNumLat + (k - 1) * mNumLon + (j - 1);
-                    mCurrYearEmissVector[valIndex] = mBaseYearEmissVector[valIndex] * scalar;
+                    mapping->mCellWeight[entry] = mapping->mCellWeight[later];
                 }
             }
         }
     }
 
-    // Finally, re-set the value vector to be the final emissions, since this will be written out
-    setValueVector(mCurrYearEmissVector);
+    mMapping = mapping;
 
     return;
 }
 
-// Downscale emissions
-void EmissDownscale::downscaleAircraftCO2Emissions(double *aCurrYearEmissions)
-{ // baseYearEmission need to be updated
+// Use a mapping that has already been read (e.g., by the surface downscaler) instead of re-reading the file.
+// Both downscalers must be on the same grid.
+void EmissDownscale::setRegionalMapping(std::shared_ptr<const RegionalMapping> aMapping)
+{
+    mMapping = aMapping;
+}
 
-    // First, set the values that were read in as the BaseYearEmissions
-    mBaseYearEmissVector = getValueVector();
+// Get the compiled regional mapping so that it can be shared
+std::shared_ptr<const RegionalMapping> EmissDownscale::getRegionalMapping() const
+{
+    return mMapping;
+}
 
-    // Calculate current year emissions vector by scaling base year emissions up
-    mCurrYearEmissVector = mBaseYearEmissVector;
-    // double scaler = aCurrYearEmissions / aBaseYearEmissions;
-    // std::transform(mCurrYearEmissVector.begin(), mCurrYearEmissVector.end(),
-    //                 mCurrYearEmissVector.begin(), [scaler](double i) { return i * scaler; });
+// Read in regional Base-Year Emission Data from a file. Only rows for aSector are used and
+// the regions are indexed as in the regional mapping, so that must be set first.
+void EmissDownscale::readRegionalBaseYearEmissionData(std::string aFileName, const std::string& aSector)
+{
+    mBaseYearRegionEmiss.assign(mMapping->mRegionNames.size(), 0.0);
+    CSVReader data(aFileName);
+    data.nextRow(); // skip the first line
+    while (data.nextRow())
+    {
+        // Columns are region, sector, year, and base-year emissions
+        if (aSector == data.getField(1))
+        {
+            mBaseYearRegionEmiss[getRegionIndex(*mMapping, data.getField(0), aFileName)] = data.getDouble(3);
+        }
+    }
+
+    return;
+}
 
-    int gridIndex = 0;   // Index used for Grid vectors
-    int valIndex = 0;    // Index used for PFT x Grid vectors
-    double scalar = 0.0; // Define the scalar
+// Read in the gridded base-year emissions. These are kept in the value vector for all years
+// and scaled by the ratio of current to base year regional emissions when downscaling.
+void EmissDownscale::readGriddedBaseYearEmissionData(std::string aFileName)
+{
+    readSpatialData(aFileName, true, true, false);
+}
+
+// Set where the current year emissions of each region are in the GCAM emissions passed to downscaleEmissions
+void EmissDownscale::setRegionalEmissionsIndex(const std::vector<size_t>& aRegionEmissIndex)
+{
+    mRegionEmissIndex = aRegionEmissIndex;
+}
 
-    for (int k = 1; k <= mNumLat; k++)
+const std::vector<size_t>& EmissDownscale::getRegionalEmissionsIndex() const
+{
+    return mRegionEmissIndex;
+}
+
+const std::vector<double>& EmissDownscale::getRegionalBaseYearEmissions() const
+{
+    return mBaseYearRegionEmiss;
+}
+
+// Downscale emissions
+void EmissDownscale::downscaleEmissions(const double *aCurrYearEmissions, const std::vector<double*>& aOutput)
+{
+    downscaleEmissions(std::vector<EmissDownscale*>(1, this), aCurrYearEmissions,
+                       std::vector<std::vector<double*> >(1, aOutput));
+}
+
+// Downscale the emissions of several gases and sectors that share a regional mapping. The grid cell
+// scalars for all of them are calculated in a single pass over the land cells, then every
+// ( month, level ) plane is scaled as a contiguous multiply. The planes are independent of each other.
+void EmissDownscale::downscaleEmissions(const std::vector<EmissDownscale*>& aDownscalers, const double *aCurrYearEmissions,
+                                        const std::vector<std::vector<double*> >& aOutputs)
+{
+    assert(aDownscalers.size() == aOutputs.size());
+    if (aDownscalers.empty())
     {
-        for (int j = 1; j <= mNumLon; j++)
-        {
+        return;
+    }
 
-            gridIndex = (k - 1) * mNumLon + (j - 1);
+    const RegionalMapping& mapping = *aDownscalers[0]->mMapping;
+    const size_t numDownscalers = aDownscalers.size();
+    const size_t numRegions = mapping.mRegionNames.size();
 
-            // Get region for this entry
-            string gridID = std::to_string(j) + "_" + std::to_string(k);
-            auto tempGrid = mRegionMapping.find(gridID);
-            if (mRegionMapping.find(gridID) == mRegionMapping.end())
-            {
-                // Grid isn't found in the mapping. Currently, this probably means it is an ocean grid.
-                // TODO: set up loop only over land grids, either using the mRegionMapping or one of the files from ELM
-            }
-            else
-            {
-                vector<string> regInGrd = (*tempGrid).second;
-                scalar = 0;
-                // Loop over all regions this grid is mapped to and calculate the scalars
-                for (auto regID : regInGrd)
-                {
-                    // Calculate total as NPP/HR of the PFT * area of the PFT
-                    // pft value is fraction of grid cell
-                    auto currReg = mRegionIDName.find(regID);
-                    int regIndex = (*currReg).second - 1;
+    // Ratio of current to base year emissions of each region, for each downscaler
+    std::vector<double> regionRatio(numRegions * numDownscalers);
+    for (size_t ds = 0; ds < numDownscalers; ds++)
+    {
+        EmissDownscale* downscaler = aDownscalers[ds];
+        if (downscaler->mMapping.get() != &mapping || downscaler->mRegionEmissIndex.size() != numRegions)
+        {
+            ILogger& coupleLog = ILogger::getLogger( "coupling_log" );
+            coupleLog.setLevel( ILogger::ERROR );
+            coupleLog << "Emissions downscaled together must share a regional mapping" << endl;
+            exit(EXIT_FAILURE);
+        }
+        for (size_t reg = 0; reg < numRegions; reg++)
+        {
+            regionRatio[reg * numDownscalers + ds] = aCurrYearEmissions[downscaler->mRegionEmissIndex[reg]] /
+                                                     downscaler->mBaseYearRegionEmiss[reg];
+        }
+        // Ocean cells are not scaled
+        downscaler->mCellScaler.assign(downscaler->mNumLat * downscaler->mNumLon, 1.0);
+    }
 
-                    scalar += aCurrYearEmissions[regIndex] / aBaseYearEmissions_air[regIndex] * mRegionWeights[std::make_pair(gridID, regID)];
-                }
-                for (int mon = 1; mon <= mNumMon; mon++)
+    // Loop over land grid cells only and calculate the scalars
+    auto calcCellScalers = [&](size_t aBegin, size_t aEnd) {
+        std::vector<double> scalar(numDownscalers);
+        for (size_t cell = aBegin; cell < aEnd; cell++)
+        {
+            std::fill(scalar.begin(), scalar.end(), 0.0);
+            double weight = 0.0;
+            // Loop over all regions this grid is mapped to and calculate the scalars
+            for (int entry = mapping.mCellStart[cell]; entry < mapping.mCellStart[cell + 1]; entry++)
+            {
+                const double* ratio = &regionRatio[mapping.mCellRegion[entry] * numDownscalers];
+                for (size_t ds = 0; ds < numDownscalers; ds++)
                 {
-                    for (int lev = 1; lev <= mNumLev; lev++)
-                    {
-                        valIndex = (lev - 1) * mNumMon * mNumLon * mNumLat + (mon - 1) * mNumLon * mNumLat + (k - 1) * mNumLon + (j - 1);
-                        mCurrYearEmissVector[valIndex] = mBaseYearEmissVector[valIndex] * scalar;
-                    }
+                    scalar[ds] += ratio[ds] * mapping.mCellWeight[entry];
                 }
+                weight += mapping.mCellWeight[entry];
+            }
+            int gridIndex = mapping.mLandCells[cell];
+            for (size_t ds = 0; ds < numDownscalers; ds++)
+            {
+                // normalized by the total weight if needed
+                aDownscalers[ds]->mCellScaler[gridIndex] = aDownscalers[ds]->mNormalizeWeight ? scalar[ds] / weight : scalar[ds];
             }
         }
+    };
+
+    // Every ( downscaler, plane ) pair to scale
+    std::vector<std::pair<size_t, int> > planes;
+    for (size_t ds = 0; ds < numDownscalers; ds++)
+    {
+        assert(aOutputs[ds].size() == static_cast<size_t>(aDownscalers[ds]->mNumMon * aDownscalers[ds]->mNumLev));
+        for (int plane = 0; plane < aDownscalers[ds]->mNumMon * aDownscalers[ds]->mNumLev; plane++)
+        {
+            planes.push_back(std::make_pair(ds, plane));
+        }
     }
 
-    // Finally, re-set the value vector to be the final emissions, since this will be written out
-    setValueVector(mCurrYearEmissVector);
+#if GCAM_PARALLEL_ENABLED
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, mapping.mLandCells.size()), [&calcCellScalers](const tbb::blocked_range<size_t>& aRange) {
+        calcCellScalers(aRange.begin(), aRange.end());
+    });
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, planes.size()), [&](const tbb::blocked_range<size_t>& aRange) {
+        for (size_t i = aRange.begin(); i != aRange.end(); ++i)
+        {
+            aDownscalers[planes[i].first]->scalePlane(planes[i].second, aOutputs[planes[i].first][planes[i].second]);
+        }
+    });
+#else
+    calcCellScalers(0, mapping.mLandCells.size());
+    for (size_t i = 0; i < planes.size(); i++)
+    {
+        aDownscalers[planes[i].first]->scalePlane(planes[i].second, aOutputs[planes[i].first][planes[i].second]);
+    }
+#endif
+}
 
-    return;
+// Scale one ( month, level ) plane of the base year emissions by the grid cell scalars
+void EmissDownscale::scalePlane(int aPlane, double *aOutput) const
+{
+    const int gridPerMonth = mNumLat * mNumLon;
+    const double* base = &getValueVector()[aPlane * gridPerMonth];
+    const double* scaler = &mCellScaler[0];
+    for (int gridIndex = 0; gridIndex < gridPerMonth; gridIndex++)
+    {
+        aOutput[gridIndex] = base[gridIndex] * scaler[gridIndex];
+    }
 }
 
-// Separate the emissions vectors into individual months
-void EmissDownscale::separateMonthlyEmissions(double *gcamoco2sfcjan, double *gcamoco2sfcfeb, double *gcamoco2sfcmar,
-                                              double *gcamoco2sfcapr, double *gcamoco2sfcmay, double *gcamoco2sfcjun,
-                                              double *gcamoco2sfcjul, double *gcamoco2sfcaug, double *gcamoco2sfcsep,
-                                              double *gcamoco2sfcoct, double *gcamoco2sfcnov, double *gcamoco2sfcdec,
-                                              int aNumLon, int aNumLat)
+// Write the downscaled emissions to a file. This is a diagnostic.
+// The values are written in the same order and format as ASpatialData::writeSpatialData, or in
+// the binary spatial data format (values only) if the file name ends in .bin.
+void EmissDownscale::writeGriddedEmissions(std::string aFileName, const std::vector<double*>& aOutput)
 {
+    writeGriddedValues(aFileName, copyPlanes(aOutput));
+}
 
-    int gridPerMonth = aNumLat * aNumLon;
-    std::copy(mCurrYearEmissVector.begin(),
-              mCurrYearEmissVector.begin() + gridPerMonth, gcamoco2sfcjan);
-    std::copy(mCurrYearEmissVector.begin() + gridPerMonth,
-              mCurrYearEmissVector.begin() + gridPerMonth * 2, gcamoco2sfcfeb);
-    std::copy(mCurrYearEmissVector.begin() + gridPerMonth * 2,
-              mCurrYearEmissVector.begin() + gridPerMonth * 3, gcamoco2sfcmar);
-    std::copy(mCurrYearEmissVector.begin() + gridPerMonth * 3,
-              mCurrYearEmissVector.begin() + gridPerMonth * 4, gcamoco2sfcapr);
-    std::copy(mCurrYearEmissVector.begin() + gridPerMonth * 4,
-              mCurrYearEmissVector.begin() + gridPerMonth * 5, gcamoco2sfcmay);
-    std::copy(mCurrYearEmissVector.begin() + gridPerMonth * 5,
-              mCurrYearEmissVector.begin() + gridPerMonth * 6, gcamoco2sfcjun);
-    std::copy(mCurrYearEmissVector.begin() + gridPerMonth * 6,
-              mCurrYearEmissVector.begin() + gridPerMonth * 7, gcamoco2sfcjul);
-    std::copy(mCurrYearEmissVector.begin() + gridPerMonth * 7,
-              mCurrYearEmissVector.begin() + gridPerMonth * 8, gcamoco2sfcaug);
-    std::copy(mCurrYearEmissVector.begin() + gridPerMonth * 8,
-              mCurrYearEmissVector.begin() + gridPerMonth * 9, gcamoco2sfcsep);
-    std::copy(mCurrYearEmissVector.begin() + gridPerMonth * 9,
-              mCurrYearEmissVector.begin() + gridPerMonth * 10, gcamoco2sfcoct);
-    std::copy(mCurrYearEmissVector.begin() + gridPerMonth * 10,
-              mCurrYearEmissVector.begin() + gridPerMonth * 11, gcamoco2sfcnov);
-    std::copy(mCurrYearEmissVector.begin() + gridPerMonth * 11,
-              mCurrYearEmissVector.begin() + gridPerMonth * 12, gcamoco2sfcdec);
+// Write the downscaled emissions on aWriter's thread. The planes are copied before returning
+// so they can be overwritten by the next coupling step while the file is written.
+void EmissDownscale::writeGriddedEmissions(AsyncWriter& aWriter, std::string aFileName, const std::vector<double*>& aOutput)
+{
+    std::shared_ptr<const std::vector<double> > values(new std::vector<double>(copyPlanes(aOutput)));
+    aWriter.write([aFileName, values]() { writeGriddedValues(aFileName, *values); });
 }
 
-// Separate the emissions vectors into individual months
-void EmissDownscale::separateMonthlyEmissionsWithVertical(double *gcamoco2airlojan, double *gcamoco2airlofeb, double *gcamoco2airlomar,
-                                                          double *gcamoco2airloapr, double *gcamoco2airlomay, double *gcamoco2airlojun,
-                                                          double *gcamoco2airlojul, double *gcamoco2airloaug, double *gcamoco2airlosep,
-                                                          double *gcamoco2airlooct, double *gcamoco2airlonov, double *gcamoco2airlodec,
-                                                          double *gcamoco2airhijan, double *gcamoco2airhifeb, double *gcamoco2airhimar,
-                                                          double *gcamoco2airhiapr, double *gcamoco2airhimay, double *gcamoco2airhijun,
-                                                          double *gcamoco2airhijul, double *gcamoco2airhiaug, double *gcamoco2airhisep,
-                                                          double *gcamoco2airhioct, double *gcamoco2airhinov, double *gcamoco2airhidec,
-                                                          int aNumLon, int aNumLat)
+// Copy the planes into one vector in the order they are written
+std::vector<double> EmissDownscale::copyPlanes(const std::vector<double*>& aOutput) const
 {
+    int gridPerMonth = mNumLat * mNumLon;
+    std::vector<double> values(aOutput.size() * gridPerMonth);
+    for (size_t plane = 0; plane < aOutput.size(); plane++)
+    {
+        std::copy(aOutput[plane], aOutput[plane] + gridPerMonth, values.begin() + plane * gridPerMonth);
+    }
+    return values;
+}
 
-    int gridPerMonth = aNumLat * aNumLon;
-    std::copy(mCurrYearEmissVector.begin(),
-              mCurrYearEmissVector.begin() + gridPerMonth, gcamoco2airlojan);
-    std::copy(mCurrYearEmissVector.begin() + gridPerMonth,
-              mCurrYearEmissVector.begin() + gridPerMonth * 2, gcamoco2airlofeb);
-    std::copy(mCurrYearEmissVector.begin() + gridPerMonth * 2,
-              mCurrYearEmissVector.begin() + gridPerMonth * 3, gcamoco2airlomar);
-    std::copy(mCurrYearEmissVector.begin() + gridPerMonth * 3,
-              mCurrYearEmissVector.begin() + gridPerMonth * 4, gcamoco2airloapr);
-    std::copy(mCurrYearEmissVector.begin() + gridPerMonth * 4,
-              mCurrYearEmissVector.begin() + gridPerMonth * 5, gcamoco2airlomay);
-    std::copy(mCurrYearEmissVector.begin() + gridPerMonth * 5,
-              mCurrYearEmissVector.begin() + gridPerMonth * 6, gcamoco2airlojun);
-    std::copy(mCurrYearEmissVector.begin() + gridPerMonth * 6,
-              mCurrYearEmissVector.begin() + gridPerMonth * 7, gcamoco2airlojul);
-    std::copy(mCurrYearEmissVector.begin() + gridPerMonth * 7,
-              mCurrYearEmissVector.begin() + gridPerMonth * 8, gcamoco2airloaug);
-    std::copy(mCurrYearEmissVector.begin() + gridPerMonth * 8,
-              mCurrYearEmissVector.begin() + gridPerMonth * 9, gcamoco2airlosep);
-    std::copy(mCurrYearEmissVector.begin() + gridPerMonth * 9,
-              mCurrYearEmissVector.begin() + gridPerMonth * 10, gcamoco2airlooct);
-    std::copy(mCurrYearEmissVector.begin() + gridPerMonth * 10,
-              mCurrYearEmissVector.begin() + gridPerMonth * 11, gcamoco2airlonov);
-    std::copy(mCurrYearEmissVector.begin() + gridPerMonth * 11,
-              mCurrYearEmissVector.begin() + gridPerMonth * 12, gcamoco2airlodec);
-
-    int gridPerYear = gridPerMonth * 12; // Offset for the second height emissions
-    std::copy(gridPerYear + mCurrYearEmissVector.begin(),
-              gridPerYear + mCurrYearEmissVector.begin() + gridPerMonth, gcamoco2airhijan);
-    std::copy(gridPerYear + mCurrYearEmissVector.begin() + gridPerMonth,
-              gridPerYear + mCurrYearEmissVector.begin() + gridPerMonth * 2, gcamoco2airhifeb);
-    std::copy(gridPerYear + mCurrYearEmissVector.begin() + gridPerMonth * 2,
-              gridPerYear + mCurrYearEmissVector.begin() + gridPerMonth * 3, gcamoco2airhimar);
-    std::copy(gridPerYear + mCurrYearEmissVector.begin() + gridPerMonth * 3,
-              gridPerYear + mCurrYearEmissVector.begin() + gridPerMonth * 4, gcamoco2airhiapr);
-    std::copy(gridPerYear + mCurrYearEmissVector.begin() + gridPerMonth * 4,
-              gridPerYear + mCurrYearEmissVector.begin() + gridPerMonth * 5, gcamoco2airhimay);
-    std::copy(gridPerYear + mCurrYearEmissVector.begin() + gridPerMonth * 5,
-              gridPerYear + mCurrYearEmissVector.begin() + gridPerMonth * 6, gcamoco2airhijun);
-    std::copy(gridPerYear + mCurrYearEmissVector.begin() + gridPerMonth * 6,
-              gridPerYear + mCurrYearEmissVector.begin() + gridPerMonth * 7, gcamoco2airhijul);
-    std::copy(gridPerYear + mCurrYearEmissVector.begin() + gridPerMonth * 7,
-              gridPerYear + mCurrYearEmissVector.begin() + gridPerMonth * 8, gcamoco2airhiaug);
-    std::copy(gridPerYear + mCurrYearEmissVector.begin() + gridPerMonth * 8,
-              gridPerYear + mCurrYearEmissVector.begin() + gridPerMonth * 9, gcamoco2airhisep);
-    std::copy(gridPerYear + mCurrYearEmissVector.begin() + gridPerMonth * 9,
-              gridPerYear + mCurrYearEmissVector.begin() + gridPerMonth * 10, gcamoco2airhioct);
-    std::copy(gridPerYear + mCurrYearEmissVector.begin() + gridPerMonth * 10,
-              gridPerYear + mCurrYearEmissVector.begin() + gridPerMonth * 11, gcamoco2airhinov);
-    std::copy(gridPerYear + mCurrYearEmissVector.begin() + gridPerMonth * 11,
-              gridPerYear + mCurrYearEmissVector.begin() + gridPerMonth * 12, gcamoco2airhidec);
+void EmissDownscale::writeGriddedValues(const std::string& aFileName, const std::vector<double>& aValues)
+{
+    const string binaryExt = ".bin";
+    if (aFileName.size() >= binaryExt.size() &&
+        aFileName.compare(aFileName.size() - binaryExt.size(), binaryExt.size(), binaryExt) == 0)
+    {
+        writeBinaryValues(aFileName, aValues);
+    }
+    else
+    {
+        AsyncWriter::writeScientific(aFileName, aValues);
+    }
 }
@@ -35,6 +35,8 @@
 #include "util/base/include/gcam_fusion.hpp"
 #include "util/base/include/gcam_data_containers.h"
 
+#include <unordered_set>
+
 using namespace std;
 
 class MatchesAny : public AMatchesValue {
@@ -108,6 +110,129 @@ void GetDataHelper::run(Scenario* aScenario) {
   fusion.startFilter(aScenario);
 }
 
+/*!
+ * \brief Add the data for one year using the values bound in the scenario.
+ * \details The values are added in the same order a traversal of the scenario
+ *          would find them so the result is the same as calling run with the
+ *          year fixed in the path. Values added by appendBindings come last.
+ * \param aScenario The scenario to get data from, bound again if it has changed.
+ * \param aYear The year of the data to add.
+ */
+void GetDataHelper::gather(Scenario* aScenario, const int aYear) {
+  if(aScenario != mScenario) {
+    bind(aScenario);
+  }
+
+  auto yearIter = mBindings.find(aYear);
+  if(yearIter == mBindings.end()) {
+    return;
+  }
+
+  double* data = mDataMapper.getData();
+  const size_t arrayLength = mDataMapper.getArrayLength();
+  for(const Binding& binding : (*yearIter).second) {
+    const double value = binding.mValue ? double(*binding.mValue) :
+                         binding.mDouble ? *binding.mDouble : *binding.mInt;
+    if(binding.mIndex < arrayLength) {
+      data[binding.mIndex] += value;
+    }
+    else if(value != 0) {
+      // not in the mapping, let setData report the error
+      vector<string> colValues = mUnmappedColValues[binding.mIndex - arrayLength];
+      mDataMapper.setData(colValues, aYear, value);
+    }
+  }
+}
+
+/*!
+ * \brief Add the values another query finds to the bound values.
+ * \details This is used when objects are created after the values were bound, such as
+ *          the GHGs a new vintage copies from the previous one in TechnologyContainer::initCalc.
+ *          aNewValues should find just those objects, for instance by fixing the vintage,
+ *          so only they are traversed. Values that are already bound are skipped and the
+ *          others are added after the bound values of each year. aNewValues must read the
+ *          same columns into the same ReMapData.
+ * \param aScenario The scenario the values are bound in. Nothing is added if it has
+ *        changed since the next gather binds the whole path again.
+ * \param aNewValues The query to find the new values with.
+ */
+void GetDataHelper::appendBindings(Scenario* aScenario, GetDataHelper& aNewValues) {
+  if(aScenario != mScenario) {
+    return;
+  }
+
+  aNewValues.bind(aScenario);
+
+  // The objects a new vintage copies are new, so look for the values the path also
+  // finds in objects that were already there
+  unordered_set<const void*> newValues;
+  for(const auto& yearBindings : aNewValues.mBindings) {
+    for(const Binding& binding : yearBindings.second) {
+      newValues.insert(getBoundValue(binding));
+    }
+  }
+  for(const auto& yearBindings : mBindings) {
+    for(const Binding& binding : yearBindings.second) {
+      newValues.erase(getBoundValue(binding));
+    }
+  }
+
+  const size_t arrayLength = mDataMapper.getArrayLength();
+  for(const auto& yearBindings : aNewValues.mBindings) {
+    vector<Binding>& bindings = mBindings[yearBindings.first];
+    for(Binding binding : yearBindings.second) {
+      if(newValues.count(getBoundValue(binding))) {
+        if(binding.mIndex >= arrayLength) {
+          mUnmappedColValues.push_back(aNewValues.mUnmappedColValues[binding.mIndex - arrayLength]);
+          binding.mIndex = arrayLength + mUnmappedColValues.size() - 1;
+        }
+        bindings.push_back(binding);
+      }
+    }
+  }
+}
+
+/*!
+ * \brief Traverse the scenario once and record every value the path finds.
+ * \param aScenario The scenario to bind.
+ */
+void GetDataHelper::bind(Scenario* aScenario) {
+  mBindings.clear();
+  mUnmappedColValues.clear();
+
+  mIsBinding = true;
+  run(aScenario);
+  mIsBinding = false;
+
+  mScenario = aScenario;
+}
+
+//! The address of the value a binding reads
+const void* GetDataHelper::getBoundValue(const Binding& aBinding) {
+  return aBinding.mValue ? static_cast<const void*>(aBinding.mValue) :
+         aBinding.mDouble ? static_cast<const void*>(aBinding.mDouble) : static_cast<const void*>(aBinding.mInt);
+}
+
+void GetDataHelper::addData(const Value* aValue, const double* aDouble, const int* aInt, const double aData) {
+  for(auto path: mPathTracker) {
+    path->recordPath();
+  }
+  if(mIsBinding) {
+    Binding binding = { aValue, aDouble, aInt, 0 };
+    binding.mIndex = mDataMapper.findIndex(mCurrColValues, mCurrYearValue);
+    const size_t arrayLength = mDataMapper.getArrayLength();
+    if(binding.mIndex >= arrayLength) {
+      binding.mIndex = arrayLength + mUnmappedColValues.size();
+      mUnmappedColValues.push_back(mCurrColValues);
+    }
+    mBindings[mCurrYearValue].push_back(binding);
+  }
+  else {
+    mCurrDataValue = aData;
+    mDataMapper.setData(mCurrColValues, mCurrYearValue, mCurrDataValue);
+  }
+}
+
 GetDataHelper::~GetDataHelper() {
   // note mPathTracker's memory is managed by mFilterSteps
   for(auto step : mFilterSteps) {
@@ -117,27 +242,15 @@ GetDataHelper::~GetDataHelper() {
 
 template<>
 void GetDataHelper::processData(double& aData) {
-    mCurrDataValue = aData;
-    for(auto path: mPathTracker) {
-        path->recordPath();
-    }
-    mDataMapper.setData(mCurrColValues, mCurrYearValue, mCurrDataValue);
+    addData(0, &aData, 0, aData);
 }
 template<>
 void GetDataHelper::processData(Value& aData) {
-    mCurrDataValue = aData;
-    for(auto path: mPathTracker) {
-        path->recordPath();
-    }
-    mDataMapper.setData(mCurrColValues, mCurrYearValue, mCurrDataValue);
+    addData(&aData, 0, 0, aData);
 }
 template<>
 void GetDataHelper::processData(int& aData) {
-    mCurrDataValue = aData;
-    for(auto path: mPathTracker) {
-        path->recordPath();
-    }
-    mDataMapper.setData(mCurrColValues, mCurrYearValue, mCurrDataValue);
+    addData(0, 0, &aData, aData);
 }
 template<>
 void GetDataHelper::processData(std::vector<int>& aData) {
@@ -0,0 +1,85 @@
+/*
+ * LEGAL NOTICE
+ * This computer software was prepared by Battelle Memorial Institute,
+ * hereinafter the Contractor, under Contract No. DE-AC05-76RL0 1830
+ * with the Department of Energy (DOE). NEITHER THE GOVERNMENT NOR THE
+ * CONTRACTOR MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR ASSUMES ANY
+ * LIABILITY FOR THE USE OF THIS SOFTWARE. This notice including this
+ * sentence must appear on any copies of this computer software.
+ *
+ * EXPORT CONTROL
+ * User agrees that the Software will not be shipped, transferred or
+ * exported into any country or used in any manner prohibited by the
+ * United States Export Administration Act or any other applicable
+ * export laws, restrictions or regulations (collectively the "Export Laws").
+ * Export of the Software may require some form of license or other
+ * authority from the U.S. Government, and failure to obtain such
+ * export control license may result in criminal liability under
+ * U.S. laws. In addition, if the Software is identified as export controlled
+ * items under the Export Laws, User represents and warrants that User
+ * is not a citizen, or otherwise located within, an embargoed nation
+ * (including without limitation Iran, Syria, Sudan, Cuba, and North Korea)
+ *     and that User is not otherwise prohibited
+ * under the Export Laws from receiving the Software.
+ *
+ * Copyright 2011 Battelle Memorial Institute.  All Rights Reserved.
+ * Distributed as open-source under the terms of the Educational Community
+ * License version 2.0 (ECL 2.0). http://www.opensource.org/licenses/ecl2.php
+ *
+ * For further details, see: http://www.globalchange.umd.edu/models/gcam/
+ *
+ */
+
+#include <unordered_map>
+
+#include "../include/grid_mapping.h"
+#include "../include/csv_reader.h"
+
+using namespace std;
+
+namespace {
+    // Get the index of a name, adding it if it has not been read before. Rows for the same
+    // region and GLU are usually together, so the name of the last row is checked first.
+    int internName(const char* aName, string& aKey, unordered_map<string, int>& aIDs, vector<string>& aNames, int& aLast)
+    {
+        if (aLast >= 0 && aNames[aLast] == aName)
+        {
+            return aLast;
+        }
+        aKey.assign(aName);
+        auto currName = aIDs.find(aKey);
+        if (currName == aIDs.end())
+        {
+            currName = aIDs.insert(make_pair(aKey, static_cast<int>(aNames.size()))).first;
+            aNames.push_back(aKey);
+        }
+        aLast = (*currName).second;
+        return aLast;
+    }
+}
+
+// Read the mapping file. The columns are region ID, GLU ID, longitude, latitude, region name,
+// GLU name, and weight, after one header line.
+shared_ptr<const GridMapping> GridMapping::readGridMapping(const string& aFileName)
+{
+    shared_ptr<GridMapping> mapping(new GridMapping());
+    mapping->mFileName = aFileName;
+    unordered_map<string, int> regionIDs;
+    unordered_map<string, int> subregionIDs;
+    string key;
+    int lastRegion = -1;
+    int lastSubregion = -1;
+
+    CSVReader data(aFileName);
+    data.nextRow(); // skip the first line
+    while (data.nextRow())
+    {
+        mapping->mLon.push_back(data.getInt(2));
+        mapping->mLat.push_back(data.getInt(3));
+        mapping->mRegion.push_back(internName(data.getField(4), key, regionIDs, mapping->mRegionNames, lastRegion));
+        mapping->mSubregion.push_back(internName(data.getField(5), key, subregionIDs, mapping->mSubregionNames, lastSubregion));
+        mapping->mWeight.push_back(data.getDouble(6));
+    }
+
+    return mapping;
+}
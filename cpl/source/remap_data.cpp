@@ -50,6 +50,29 @@ using namespace xercesc;
 // Find the index of a particular item in the mapping
 template<typename T>
 size_t ReMapDataHelper<T>::getIndex(const T& aGCAMName) const {
+    size_t index = findIndex(aGCAMName);
+
+    // Ensure the item exists in the ordered list of names
+    if(index == mInOrderOutputNames.size()) {
+        auto iter = mGCAMToOutputNameMap.find(aGCAMName);
+        ILogger& mainLog = ILogger::getLogger( "main_log" );
+        mainLog.setLevel( ILogger::SEVERE );
+        mainLog << "Can't find " << (iter != mGCAMToOutputNameMap.end() ? (*iter).second : aGCAMName)
+                << " in " << mDataName << " mapping." << endl;
+        abort();
+    }
+
+    return index;
+}
+
+// Find the index of a particular item in the mapping, or the stride length if it is not mapped
+template<typename T>
+size_t ReMapDataHelper<T>::findIndex(const T& aGCAMName) const {
+    if(!mIndexMap.empty()) {
+        auto iter = mIndexMap.find(aGCAMName);
+        return iter != mIndexMap.end() ? (*iter).second : getStrideLength();
+    }
+
     T outputName = aGCAMName;
 
     // If the output map isn't empty, loop over it until you find the right item.
@@ -60,18 +83,30 @@ size_t ReMapDataHelper<T>::getIndex(const T& aGCAMName) const {
         }
     }
 
-    // Ensure the item exists in the ordered list of names
-    auto iter = find(mInOrderOutputNames.begin(), mInOrderOutputNames.end(), outputName);
-    if(iter == mInOrderOutputNames.end()) {
-        ILogger& mainLog = ILogger::getLogger( "main_log" );
-        mainLog.setLevel( ILogger::SEVERE );
-        mainLog << "Can't find " << outputName << " in " << mDataName << " mapping." << endl;
-        abort();
-    }
-    
     // Return the index (i.e., the difference between where the item is in mInOrderOutputNames and
     // the beginning of mInOrderOutputNames)
-    return iter - mInOrderOutputNames.begin();
+    return find(mInOrderOutputNames.begin(), mInOrderOutputNames.end(), outputName) - mInOrderOutputNames.begin();
+}
+
+// Build the table used by findIndex from the output names and renames
+template<typename T>
+void ReMapDataHelper<T>::buildIndexMap() {
+    unordered_map<T, size_t> indexMap;
+    for(size_t index = 0; index < mInOrderOutputNames.size(); ++index) {
+        // keep the first if a name is repeated
+        indexMap.emplace(mInOrderOutputNames[index], index);
+    }
+
+    // A renamed item is only found by its new name, even if the old name is also an output
+    unordered_map<T, size_t> renamed;
+    for(const auto& rename : mGCAMToOutputNameMap) {
+        auto iter = indexMap.find(rename.second);
+        renamed[rename.first] = iter != indexMap.end() ? (*iter).second : getStrideLength();
+    }
+    for(const auto& rename : renamed) {
+        indexMap[rename.first] = rename.second;
+    }
+    mIndexMap.swap(indexMap);
 }
 
 template<typename T>
@@ -246,7 +281,7 @@ void ReMapData::finalizeColumns() {
     // TODO: Error checking (if no year column or mColumns error?)
     // Calculate total size by multiplying length of each column
     size_t size = mYearColumn.getStrideLength();
-    for(auto col : mColumns) {
+    for(const auto& col : mColumns) {
         size *= col.getStrideLength();
     }
     mData = new double[size];
@@ -254,6 +289,13 @@ void ReMapData::finalizeColumns() {
     // Initalize all elements to zero and set the flag indicating data has been initialized
     fill(mData, mData+size, 0.0);
     mIsInitialized = true;
+
+    // Build the name lookups, any indices found before are no longer valid
+    mYearColumn.buildIndexMap();
+    for(auto& col : mColumns) {
+        col.buildIndexMap();
+    }
+    mIndexCache.clear();
 }
 
 /*! \brief Set data in the data map
@@ -271,8 +313,76 @@ void ReMapData::finalizeColumns() {
 void ReMapData::setData(vector<string>& aColValues, const int aYearValue, const double aValue) {
     // TODO: assume columns are in order?  If not we will want a vector<pair> and map column to index
     // TODO: error checking such as column lengths match
-    
-    // For land allocation, we need to split and recombine column names.
+
+    // Only set data if value is non-zero
+    if ( aValue != 0 ) {
+        // Find the index for this particular data element
+        size_t index = findIndex(aColValues, aYearValue);
+
+        // If index isn't found, then report which name is missing and abort
+        if(index >= getArrayLength()) {
+            decomposeLandNames(aColValues);
+            mYearColumn.getIndex(aYearValue);
+            for(size_t colIndex = aColValues.size(); colIndex-- > 0; ) {
+                mColumns[colIndex].getIndex(aColValues[colIndex]);
+            }
+            abort();
+        }
+        
+        // Add the value to the appropriate index in mData
+        mData[index] += aValue;
+    }
+}
+
+/*! \brief Find the index in the data array for a set of column values
+ *
+ * The column values are adjusted the same way as in setData. Unlike setData
+ * names missing from the mapping are not an error, instead the array length
+ * is returned. The offset for the column values is cached so looking up the
+ * same values again, for any year, is a single hash lookup.
+ *
+ * \param aColValues
+ * \param aYearValue year of the data
+ * \return index into mData, or getArrayLength() if any column is not mapped
+ */
+size_t ReMapData::findIndex(const vector<string>& aColValues, const int aYearValue) {
+    const size_t arrayLength = getArrayLength();
+    const size_t yearIndex = mYearColumn.findIndex(aYearValue);
+    if(yearIndex >= mYearColumn.getStrideLength()) {
+        return arrayLength;
+    }
+
+    // The year is the fastest changing index so the offset for the other columns
+    // is cached separately. Column values can not contain a newline so use it to
+    // separate them in the key.
+    mCacheKey.clear();
+    for(const auto& colValue : aColValues) {
+        mCacheKey += colValue;
+        mCacheKey += '\n';
+    }
+    auto cacheIter = mIndexCache.find(mCacheKey);
+    if(cacheIter == mIndexCache.end()) {
+        vector<string> colValues = aColValues;
+        decomposeLandNames(colValues);
+
+        size_t offset = 0;
+        size_t currStride = mYearColumn.getStrideLength();
+        bool found = true;
+        for(size_t colIndex = colValues.size(); colIndex-- > 0; ) {
+            const size_t colStride = mColumns[colIndex].getStrideLength();
+            const size_t colIndexValue = mColumns[colIndex].findIndex(colValues[colIndex]);
+            found = found && colIndexValue < colStride;
+            offset += colIndexValue * currStride;
+            currStride *= colStride;
+        }
+        cacheIter = mIndexCache.emplace(mCacheKey, found ? offset : arrayLength).first;
+    }
+
+    return (*cacheIter).second < arrayLength ? yearIndex + (*cacheIter).second : arrayLength;
+}
+
+// For land allocation, we need to split and recombine column names.
+void ReMapData::decomposeLandNames(vector<string>& aColValues) const {
     if( mLandNameColumn ) {
         // First figure out which column has the region names and which has the land types
         size_t regionIndex = 0;
@@ -292,25 +402,6 @@ void ReMapData::setData(vector<string>& aColValues, const int aYearValue, const
         aColValues[regionIndex] = aColValues[regionIndex] + "_" + landNames["land-region"];
         aColValues[landTypeIndex] = landNames["crop"];
     }
-
-    // Only set data if value is non-zero
-    if ( aValue != 0 ) {
-        // Find the index for this particular data element
-        size_t index = mYearColumn.getIndex(aYearValue);
-        size_t currStride = mYearColumn.getStrideLength();
-        for(size_t colIndex = aColValues.size(); colIndex-- > 0; ) {
-            index += mColumns[colIndex].getIndex(aColValues[colIndex]) * currStride;
-            currStride *= mColumns[colIndex].getStrideLength();
-        }
-        
-        // If index isn't found, then abort
-        if(index >= currStride) {
-            abort();
-        }
-        
-        // Add the value to the appropriate index in mData
-        mData[index] += aValue;
-    }
 }
 
 /*! \brief Get data
@@ -331,13 +422,61 @@ double* ReMapData::getData() {
  */
 size_t ReMapData::getArrayLength() const {
     size_t size = mYearColumn.getStrideLength();
-    for(auto col : mColumns) {
+    for(const auto& col : mColumns) {
         size *= col.getStrideLength();
     }
     
     return size;
 }
 
+/*! \brief Get the names of the columns in order
+ *
+ * \return names of each column, not including the year column
+ */
+vector<string> ReMapData::getColumnNames() const {
+    vector<string> names;
+    for(const auto& col : mColumns) {
+        names.push_back(col.getName());
+    }
+    return names;
+}
+
+/*! \brief Get the output names of a column
+ *
+ * \param aColumnName name of the column
+ * \return output names of the column in order, empty if there is no such column
+ */
+const vector<string>& ReMapData::getColumnOutputNames(const string& aColumnName) const {
+    static const vector<string> noNames;
+    for(const auto& col : mColumns) {
+        if(col.getName() == aColumnName) {
+            return col.mInOrderOutputNames;
+        }
+    }
+    return noNames;
+}
+
+/*! \brief Get every GCAM name that is mapped to one of a column's outputs
+ *
+ * \param aColumnName name of the column
+ * \return the output names of the column followed by the names renamed to them,
+ *         empty if there is no such column
+ */
+vector<string> ReMapData::getColumnGCAMNames(const string& aColumnName) const {
+    vector<string> names;
+    for(const auto& col : mColumns) {
+        if(col.getName() == aColumnName) {
+            names = col.mInOrderOutputNames;
+            for(const auto& rename : col.mGCAMToOutputNameMap) {
+                if(find(names.begin(), names.end(), rename.first) == names.end()) {
+                    names.push_back(rename.first);
+                }
+            }
+        }
+    }
+    return names;
+}
+
 /*!
  * \brief The print the data as a table which may be useful for
  *        diagnostics.
@@ -353,7 +492,7 @@ ostream& ReMapData::printAsTable( ostream& aOut ) const {
     }
     else {
         // print a header
-        for(auto col : mColumns) {
+        for(const auto& col : mColumns) {
             aOut << col.getName() << DELIM;
         }
         aOut << mYearColumn.getName() << DELIM << "value" << endl;
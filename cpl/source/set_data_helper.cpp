@@ -34,49 +34,91 @@
 #include "util/base/include/gcam_fusion.hpp"
 #include "util/base/include/gcam_data_containers.h"
 #include <boost/algorithm/string/predicate.hpp>
+#include <algorithm>
 
 using namespace std;
 
-class StringVecEquals : public AMatchesValue {
+// Matches anything and keeps the last name or year matched, which is the one
+// currently being traversed.
+class RecordPath : public AMatchesValue {
 public:
-    StringVecEquals( const vector<string>& aStr, size_t& row ):mStr( aStr ), mRow( row ) {}
-    virtual ~StringVecEquals() {}
+    RecordPath( string* aCurrStr, int* aCurrInt ):mCurrStr( aCurrStr ), mCurrInt( aCurrInt ) {}
+    virtual ~RecordPath() {}
     virtual bool matchesString( const std::string& aStrToTest ) const {
-        return mStr[mRow] == aStrToTest;
+        *mCurrStr = aStrToTest;
+        return true;
     }
-protected:
-    const vector<string>& mStr;
-    size_t& mRow;
+    virtual bool matchesInt( const int aIntToTest ) const {
+        *mCurrInt = aIntToTest;
+        return true;
+    }
+private:
+    string* mCurrStr;
+    int* mCurrInt;
 };
 
-class StringVecStartsWith : public StringVecEquals {
-public:
-    StringVecStartsWith( const vector<string>& aStr, size_t& row ):StringVecEquals( aStr, row ) { }
-    virtual ~StringVecStartsWith() { }
-    virtual bool matchesString( const std::string& aStrToTest ) const {
-        return boost::starts_with( aStrToTest, mStr[mRow] );
+void SetDataHelper::run( Scenario* aScenario, const vector<int>& aYearColumn,
+                         const vector<int>& aRegionColumn, const vector<string>& aRegionNames,
+                         const vector<int>& aLandTechColumn, const vector<string>& aLandTechNames,
+                         const vector<double>& aDataVector )
+{
+    // The model structure does not change during a run so the targets are only found once
+    if( aScenario != mScenario ) {
+        findTargets( aScenario );
     }
-};
 
-class IntVecEquals : public AMatchesValue {
-public:
-    IntVecEquals( const vector<int>& aInt, size_t& row ):mInt( aInt ), mRow( row ) {}
-    virtual ~IntVecEquals() {}
-    virtual bool matchesInt( const int aIntToTest ) const {
-        return mInt[mRow] == aIntToTest;
+    auto byName = []( const Target& aTarget, const string& aName ) {
+        return *aTarget.mLandTech < aName;
+    };
+    for( size_t row = 0; row < aDataVector.size(); ++row ) {
+        auto currRegion = mTargets.find( aRegionNames[ aRegionColumn[ row ] ] );
+        if( currRegion == mTargets.end() ) {
+            continue;
+        }
+        auto currYear = (*currRegion).second.find( aYearColumn[ row ] );
+        if( currYear == (*currRegion).second.end() ) {
+            continue;
+        }
+
+        // Set every technology that starts with the land technology name
+        const string& landTech = aLandTechNames[ aLandTechColumn[ row ] ];
+        const vector<Target>& targets = (*currYear).second;
+        for( auto iter = std::lower_bound( targets.begin(), targets.end(), landTech, byName );
+             iter != targets.end() && boost::starts_with( *(*iter).mLandTech, landTech ); ++iter )
+        {
+            if( (*iter).mValue ) {
+                *(*iter).mValue = aDataVector[ row ];
+            }
+            else if( (*iter).mDouble ) {
+                *(*iter).mDouble = aDataVector[ row ];
+            }
+            else {
+                *(*iter).mInt = aDataVector[ row ];
+            }
+        }
     }
-private:
-    const vector<int>& mInt;
-    size_t& mRow;
-};
+}
 
-void SetDataHelper::run(Scenario* aScenario) {
-  GCAMFusion<SetDataHelper> fusion(*this, mFilterSteps);
-    mRow = 0;
-    for(auto row : mDataVector) {
-        fusion.startFilter(aScenario);
-        mRow++;
+// Traverse the scenario once and store every value the path can set
+void SetDataHelper::findTargets( Scenario* aScenario ) {
+    mTargets.clear();
+    mTargetNames.clear();
+    GCAMFusion<SetDataHelper> fusion( *this, mFilterSteps );
+    fusion.startFilter( aScenario );
+    for( auto& currRegion : mTargets ) {
+        for( auto& currYear : currRegion.second ) {
+            std::stable_sort( currYear.second.begin(), currYear.second.end(), []( const Target& aLeft, const Target& aRight ) {
+                return *aLeft.mLandTech < *aRight.mLandTech;
+            } );
+        }
     }
+    mScenario = aScenario;
+}
+
+void SetDataHelper::addTarget( const Target& aTarget ) {
+    Target target = aTarget;
+    target.mLandTech = &*mTargetNames.insert( mCurrLandTech ).first;
+    mTargets[ mCurrRegion ][ mCurrYear ].push_back( target );
 }
 
 SetDataHelper::~SetDataHelper() {
@@ -87,15 +129,18 @@ SetDataHelper::~SetDataHelper() {
 
 template<>
 void SetDataHelper::processData(double& aData) {
-    aData = mDataVector[mRow];
+    Target target = { 0, 0, &aData, 0 };
+    addTarget( target );
 }
 template<>
 void SetDataHelper::processData(Value& aData) {
-    aData = mDataVector[mRow];
+    Target target = { 0, &aData, 0, 0 };
+    addTarget( target );
 }
 template<>
 void SetDataHelper::processData(int& aData) {
-    aData = mDataVector[mRow];
+    Target target = { 0, 0, 0, &aData };
+    addTarget( target );
 }
 template<typename T>
 void SetDataHelper::processData(T& aData) {
@@ -118,15 +163,15 @@ FilterStep* SetDataHelper::parseFilterStepStr( const std::string& aFilterStepStr
         AMatchesValue* matcher = 0;
         FilterStep* filterStep = 0;
         if( filterStr == "name" && aCol == 0) {
-            matcher = new StringVecEquals( mRegionColumn, mRow );
+            matcher = new RecordPath( &mCurrRegion, 0 );
             filterStep = new FilterStep( dataName, new NamedFilter( matcher ) );
         }
         else if( filterStr == "name" && aCol == 1) {
-            matcher = new StringVecStartsWith( mLandTechColumn, mRow );
+            matcher = new RecordPath( &mCurrLandTech, 0 );
             filterStep = new FilterStep( dataName, new NamedFilter( matcher ) );
         }
         else if( filterStr == "year" ) {
-            matcher = new IntVecEquals( mYearColumn, mRow );
+            matcher = new RecordPath( 0, &mCurrYear );
             filterStep = new FilterStep( dataName, new YearFilter( matcher ) );
         }
         else {
@@ -73,8 +73,12 @@ class IVisitor;
  *
  *          The wrapper keeps track of the last year we ran up to.  If
  *          the input year is less than or equal to the last year we
- *          ran to, then we re-initialize Hector, re-run its spin-up,
- *          and run up to the requested date.  This allows us to use
+ *          ran to, then we roll the Hector core back to the start of
+ *          the GCAM period containing that year, using the state
+ *          Hector keeps for each year it has run, and run forward to
+ *          the requested date.  Only if that is not possible do we
+ *          re-initialize Hector, re-run its spin-up, and run up to
+ *          the requested date.  This allows us to use
  *          the Hector module in a batch run (where we will reset at
  *          the beginning of each new scenario) or in a stabilization
  *          run (where we might have to run each stabilization period
@@ -103,6 +107,9 @@ public:
     virtual double getTotalForcing( const int aYear ) const;
     virtual double getNetTerrestrialUptake( const int aYear ) const;
     virtual double getNetOceanUptake( const int aYear ) const;
+    virtual int getGasIndex( const std::string& aGasName ) const;
+    virtual double getConcentrationByIndex( const int aGasIndex, const int aYear ) const;
+    virtual double getForcingByIndex( const int aGasIndex, const int aYear ) const;
     virtual void accept( IVisitor *aVisitor, const int aPeriod ) const;
 
     // xml name
@@ -148,17 +155,31 @@ private:
     //! table of emissions passed in from GCAM
     std::map<std::string, std::vector<double> > mEmissionsTable;
 
-    //! table of concentrations retrieved from Hector
-    std::map<std::string, std::vector<double> > mConcTable;
+    //! index of each gas known to the wrapper in the per gas results
+    //! tables, set up in completeInit
+    std::map<std::string, int> mGasIndex;
+
+    //! table of concentrations retrieved from Hector, stored by year
+    //! with the values for all gasses in a year contiguous
+    std::vector<double> mConcTable;
 
     //! Some Hector components store their forcing in a time series.
     //! This is a lookup table for the message strings used to
     //! retrieve them.
     std::map<std::string, std::string> mHectorRFTseriesMsg;
 
-    //! table of forcings retrieved from Hector, by gas (for those
-    //! that don't keep their data in a time series)
-    std::map<std::string, std::vector<double> > mGasRFTable;
+    //! mHectorRFTseriesMsg by gas index, empty for gasses whose
+    //! forcing is stored in mGasRFTable
+    std::vector<std::string> mRFTseriesMsgByIndex;
+
+    //! table of forcings retrieved from Hector (for those gasses that
+    //! don't keep their data in a time series), laid out as mConcTable
+    std::vector<double> mGasRFTable;
+
+    //! gas indices of the concentrations and forcings retrieved from
+    //! Hector each year, in the order of the tables in hector_model.cpp
+    std::vector<int> mStoredConcIndices;
+    std::vector<int> mStoredRFIndices;
 
     //! total forcings retrieved from Hector
     std::vector<double> mTotRFTable;
@@ -190,6 +211,9 @@ private:
     //! reset the Hector GCAM component and the Hector model for a new run
     void reset( const int aPeriod );
 
+    //! roll the existing Hector core back to the start of a period
+    bool restoreToPeriodStart( const int aPeriod );
+
     //! worker routine for setting emissions
     bool setEmissionsByYear( const std::string& aGasName, const int aYear, double aEmissions );
 
@@ -199,8 +223,8 @@ private:
     void storeGlobals( const int aYear, const bool aHadError );
 
     //! set up the tables used by the functions in the previous block
-    void setupConcTbl();
-    void setupRFTbl();
+    void setupGasTables();
+    int addGasIndex( const std::string& aGasName );
 
     int yearlyDataIndex( const int aYear ) const;
 };
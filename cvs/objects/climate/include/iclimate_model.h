@@ -256,6 +256,35 @@ public:
     *         unavailable.
     */
     virtual double getNetOceanUptake( const int aYear ) const = 0;
+    /*! \brief Returns the index of a gas for use with the indexed getters.
+    * \details Callers which query the same gas repeatedly, such as
+    *          targets searching over years, can look up the index once and
+    *          avoid a lookup by name for each query. The index is only valid
+    *          until the climate model is initialized again.
+    * \note Implementing this method is optional. A climate model that does
+    *       not implement it returns -1 for every gas, in which case the
+    *       caller must use the getters by name.
+    * \param aGasName The name of the gas.
+    * \return The index of the gas, -1 if the gas is unknown or the model
+    *         does not support indexed access.
+    */
+    virtual int getGasIndex( const std::string& aGasName ) const { return -1; }
+    /*! \brief Returns the concentration for a gas given its index from
+    *          getGasIndex.
+    * \param aGasIndex The index of the gas, which must not be -1.
+    * \param aYear The year for which to return the concentration.
+    * \return The concentration for the year, -1 if the climate model does
+    *         not support indexed access.
+    */
+    virtual double getConcentrationByIndex( const int aGasIndex, const int aYear ) const { return -1; }
+    /*! \brief Returns the forcing for a gas given its index from
+    *          getGasIndex.
+    * \param aGasIndex The index of the gas, which must not be -1.
+    * \param aYear The year for which to return the forcing.
+    * \return The forcing for the year, -1 if the climate model does not
+    *         support indexed access.
+    */
+    virtual double getForcingByIndex( const int aGasIndex, const int aYear ) const { return -1; }
     
     /*! \brief Returns a boolean indicating whether there is a climate model.
     *         This is true for Hector & MAGICC, but false for NoClimateModel
@@ -83,6 +83,53 @@ namespace {
 
     // don't ask
     bool hector_log_is_init = false;
+
+    // Roll a Hector core back to a date it has already run past if the
+    // version of Hector we were built against supports it.  Versions
+    // which do not have Core::reset pick up the overload below and
+    // report that the core has to be rebuilt instead.
+    template<typename CoreType>
+    auto resetCoreToDate( CoreType& aCore, const double aDate, int ) -> decltype( aCore.reset( aDate ), bool() ) {
+        aCore.reset( aDate );
+        return true;
+    }
+
+    template<typename CoreType>
+    bool resetCoreToDate( CoreType&, const double, long ) {
+        return false;
+    }
+
+    // The concentrations and forcings we retrieve from Hector every
+    // year, by GCAM gas name and the Hector message used to get them.
+    struct HectorOutput {
+        const char* mGasName;
+        const char* mMessage;
+        bool mByDate;
+    };
+
+    // These are all of the atmospheric concentrations that Hector is
+    // set up to provide.  Hector doesn't actually compute
+    // concentrations for CO, NOX, and NMVOC (we use their emissions to
+    // compute O3 concentration, but don't compute the concentrations of
+    // the original gasses.)
+    const HectorOutput STORED_CONC[] = {
+        { "CH4", D_ATMOSPHERIC_CH4, true },
+        { "N2O", D_ATMOSPHERIC_N2O, true },
+        { "O3",  D_ATMOSPHERIC_O3,  true },
+        { "CO2", D_ATMOSPHERIC_CO2, false }
+    };
+
+    // Forcings requested by GCAM.  Hector can also provide H2O, SO2d,
+    // SO2i and O3 but in the interests of keeping memory usage down we
+    // won't store these unless someone wants them.
+    const HectorOutput STORED_RF[] = {
+        { "CO2", D_RF_CO2, false },
+        { "CH4", D_RF_CH4, false },
+        { "N2O", D_RF_N2O, false },
+        { "BC",  D_RF_BC,  false },
+        { "OC",  D_RF_OC,  false },
+        { "SO2", D_RF_SO2, false }
+    };
 } 
 
 HectorModel::HectorModel()
@@ -267,10 +314,6 @@ void HectorModel::completeInit( const string& aScenarioName ) {
         mUnitConvFac[ it->first ] = 1.0; // default value; will set exceptions below
         mHectorUnits[ it->first ] = Hector::U_GG; // This is the default; exceptions below
 
-        // per-gas results tables
-        mConcTable[ it->first ].resize( nrslt );
-        mGasRFTable[ it->first ].resize( nrslt ); 
-        
         climatelog << "Tracking GCAM gas " << it->first << " as Hector gas "
                    << it->second << endl;
     }
@@ -282,9 +325,8 @@ void HectorModel::completeInit( const string& aScenarioName ) {
     mTemperatureTable.resize( nrslt );
     mLandFlux.resize( nrslt );
     mOceanFlux.resize( nrslt );
-    // set up the other results tables
-    setupConcTbl();
-    setupRFTbl();
+    // set up the per-gas results tables
+    setupGasTables();
     
     // Set conversion factors for gasses that require them
     mUnitConvFac["SO2tot"] = TG_TO_GG / S_TO_SO2; // GCAM in Tg-SO2; Hector in Tg-S
@@ -393,6 +435,73 @@ void HectorModel::reset( const int aPeriod ) {
     mHcore->run( static_cast<double>( mLastYear ) );
 }
 
+/*!
+ * \brief Roll the Hector core back to the start of a period.
+ * \details Hector keeps the state of each of its components for every
+ *          year it has run, so rather than rebuilding the core and
+ *          spinning it up again we can restore it to the last year of
+ *          the period before aPeriod.  That is the latest year which
+ *          does not depend on the emissions for aPeriod, which may
+ *          since have changed.  The emissions up to and including
+ *          aPeriod are then sent again so the core matches
+ *          mEmissionsTable, and runModel only has to integrate
+ *          forward from there.
+ * \param aPeriod The period which is about to be run again.
+ * \return Whether the core could be restored, if not the caller
+ *         should fall back to reset.
+ */
+bool HectorModel::restoreToPeriodStart( const int aPeriod ) {
+    if( !mHcore.get() ) {
+        return false;
+    }
+
+    const Modeltime* modeltime = scenario->getModeltime();
+    const int restoreYear = max( modeltime->getStartYear(), modeltime->getper_to_yr( aPeriod - 1 ) );
+    try {
+        if( !resetCoreToDate( *mHcore, static_cast<double>( restoreYear ), 0 ) ) {
+            return false;
+        }
+    }
+    catch( const h_exception& e ) {
+        ILogger& climatelog = ILogger::getLogger( "climate-log" );
+        climatelog.setLevel( ILogger::WARNING );
+        climatelog << "Could not restore Hector to year " << restoreYear
+                   << ", rebuilding the core instead: " << e << endl;
+        return false;
+    }
+
+    ILogger& climatelog = ILogger::getLogger( "climate-log" );
+    climatelog.setLevel( ILogger::DEBUG );
+    climatelog << "Hector restored to year= " << restoreYear << " for period= " << aPeriod << endl;
+    if( mOfile.get() ) {
+        (*mOfile) << "\n\n################ Hector Core Restored to " << restoreYear << " ################\n\n";
+    }
+
+    // Send the emissions after the restore year again, only these can
+    // affect the years we are about to run.
+    map<std::string, std::vector<double> >::iterator it;
+    for( it = mEmissionsTable.begin(); it != mEmissionsTable.end(); ++it ) {
+        const string& gas = it->first;
+        vector<double>& emissions = it->second;
+        if( gas != "CO2NetLandUse" ) {
+            if( util::isValidNumber( emissions[ aPeriod ] ) ) {
+                setEmissions( gas, aPeriod, emissions[ aPeriod ] );
+            }
+        }
+        else {
+            int ymax = modeltime->getper_to_yr( aPeriod );
+            for( int yr = restoreYear + 1; yr <= ymax; ++yr ) {
+                int i = yearlyDataIndex( yr );
+                if( util::isValidNumber( emissions[ i ] ) ) {
+                    setLUCEmissions( gas, yr, emissions[ i ] );
+                }
+            }
+        }
+    }
+    mLastYear = restoreYear;
+    return true;
+}
+
 /*! \brief Set emissions for hector model 
  *  \details Set emissions for the requested gas, unless the year is
  *           before the historical switch-over year, in which case we
@@ -511,7 +620,11 @@ IClimateModel::runModelStatus HectorModel::runModel( const int aYear ) {
             period = modeltime->getyr_to_per( aYear );
         }
 
-        reset( period );
+        // Prefer rolling the existing core back over rebuilding it,
+        // which would mean running again from the start year.
+        if( !restoreToPeriodStart( period ) ) {
+            reset( period );
+        }
     }
 
     // TODO: We have to run in one-year steps so that we can record
@@ -575,13 +688,11 @@ double HectorModel::getConcentration( const string& aGasName, const int aYear) c
     ILogger& climatelog = ILogger::getLogger( "climate-log" );
     climatelog.setLevel( ILogger::DEBUG );
     
-    map<string, vector<double> >::const_iterator it =
-        mConcTable.find( aGasName );
-    if( it != mConcTable.end() ) {
-        int idx = yearlyDataIndex( aYear );
-        double conc = (it->second)[ idx ];
+    const int gasIndex = getGasIndex( aGasName );
+    if( gasIndex >= 0 ) {
+        double conc = getConcentrationByIndex( gasIndex, aYear );
         climatelog << "\tgetConcentration:  gas= " << aGasName
-                   << "\tyear= " << aYear << "  index= " << idx
+                   << "\tyear= " << aYear << "  index= " << yearlyDataIndex( aYear )
                    << "\tconc= " << conc << endl;
         return conc;
     }
@@ -592,6 +703,21 @@ double HectorModel::getConcentration( const string& aGasName, const int aYear) c
     }
 }
 
+/* \brief return the index of a gas for the indexed getters, or -1 if
+ *         the gas is unknown
+ */
+int HectorModel::getGasIndex( const string& aGasName ) const {
+    map<string, int>::const_iterator it = mGasIndex.find( aGasName );
+    return it != mGasIndex.end() ? it->second : -1;
+}
+
+/* \brief return the atmospheric concentration for a gas given its
+ *         index from getGasIndex
+ */
+double HectorModel::getConcentrationByIndex( const int aGasIndex, const int aYear ) const {
+    return mConcTable[ yearlyDataIndex( aYear ) * mGasIndex.size() + aGasIndex ];
+}
+
 /* \brief return the global temperature anomaly
  */
 double HectorModel::getTemperature( const int aYear ) const {
@@ -629,8 +755,25 @@ double HectorModel::getTotalForcing( const int aYear ) const {
 double HectorModel::getForcing( const string& aGas, int aYear ) const {
     ILogger& climatelog = ILogger::getLogger( "climate-log" );
     climatelog.setLevel( ILogger::DEBUG );
-    
+
+    const int gasIndex = getGasIndex( aGas );
+    if( gasIndex < 0 ) {
+        climatelog << "getForcing(): invalid gas: " << aGas << endl;
+        return 0.0;
+    }
+
+    double forcing = getForcingByIndex( gasIndex, aYear );
+    climatelog.setLevel( ILogger::DEBUG );
+    climatelog << "\tgetForcing:  gas= " << aGas
+               << "\tyear= " << aYear << "\tforcing= " << forcing << endl;
+    return forcing;
+}
+
+/* \brief return the forcing for a gas given its index from getGasIndex
+ */
+double HectorModel::getForcingByIndex( const int aGasIndex, const int aYear ) const {
     if( aYear > mHectorEndYear ) {
+        ILogger& climatelog = ILogger::getLogger( "climate-log" );
         climatelog.setLevel( ILogger::WARNING ); 
         climatelog << "getForcing():  invalid year: " << aYear << endl;
         return 0.0;
@@ -640,18 +783,16 @@ double HectorModel::getForcing( const string& aGas, int aYear ) const {
     // don't have to make a table for them in the GCAM component.  We
     // can just ask the hector core for them by name and date. 
     // TODO: make all hector components work this way.
-
-    map<std::string, std::string>::const_iterator ittseries =
-        mHectorRFTseriesMsg.find( aGas ); 
-    // If the gas is a halocarbon, grab the RF request string and send
-    // it to the Hector core.
-    if( ittseries != mHectorRFTseriesMsg.end() ) {
+    const string& tseriesMsg = mRFTseriesMsgByIndex[ aGasIndex ];
+    // If the gas is a halocarbon, send the RF request string to the
+    // Hector core.
+    if( !tseriesMsg.empty() ) {
         double haloForcing = -1.0;
         // We might get an error trying to retrieve halocarbon RF if
         // hector had crashed trying to run up the given year.
         // In that case issue a warning and return an invalid result.
         try {
-            haloForcing = mHcore->sendMessage( M_GETDATA, ittseries->second, aYear );
+            haloForcing = mHcore->sendMessage( M_GETDATA, tseriesMsg, aYear );
         }
         catch( const h_exception& e ) {
             ILogger& climatelog = ILogger::getLogger( "climate-log" );
@@ -662,20 +803,7 @@ double HectorModel::getForcing( const string& aGas, int aYear ) const {
     }
 
     // For other RF components, 
-    map<std::string, std::vector<double> >::const_iterator it =
-        mGasRFTable.find( aGas );
-
-    if( it == mGasRFTable.end() ) {
-        climatelog << "getForcing(): invalid gas: " << aGas << endl;
-        return 0.0;
-    }
-
-    int idx = yearlyDataIndex( aYear );
-    double forcing = (it->second)[ idx ];
-    climatelog << "\tgetForcing:  gas= " << aGas
-               << "\tyear= " << aYear << "  index= " << idx
-               << "\tforcing= " << forcing << endl;
-    return forcing;
+    return mGasRFTable[ yearlyDataIndex( aYear ) * mGasIndex.size() + aGasIndex ];
 }
 
 
@@ -685,103 +813,90 @@ int HectorModel::yearlyDataIndex( const int year ) const {
 
 void HectorModel::storeConc( const int aYear, const bool aHadError ) {
     ILogger& climatelog = ILogger::getLogger( "climate-log" );
+    climatelog.setLevel( ILogger::DEBUG );
 
     // No need to check the index because we checked it in runModel
     int i = yearlyDataIndex( aYear );
+    double* conc = &mConcTable[ i * mGasIndex.size() ];
+    climatelog << "\tstoreConc: year= " << aYear << "  index= " << i << endl;
 
-    // These are all of the atmospheric concentrations that Hector is
-    // set up to provide.
     Hector::message_data date( aYear );
-    mConcTable["CH4"][i]   = aHadError ? numeric_limits<double>::quiet_NaN() : mHcore->sendMessage( M_GETDATA, D_ATMOSPHERIC_CH4,date );
-    mConcTable["N2O"][i]   = aHadError ? numeric_limits<double>::quiet_NaN() : mHcore->sendMessage( M_GETDATA, D_ATMOSPHERIC_N2O,date );
-    mConcTable["O3"][i]    = aHadError ? numeric_limits<double>::quiet_NaN() : mHcore->sendMessage( M_GETDATA, D_ATMOSPHERIC_O3, date );
-    mConcTable["CO2"][i]   = aHadError ? numeric_limits<double>::quiet_NaN() : mHcore->sendMessage( M_GETDATA, D_ATMOSPHERIC_CO2 );
-
-    // Hector doesn't actually compute concentrations for these
-    // gasses. (we use their emissions to compute O3 concentration,
-    // but don't compute the concentrations of the original gasses.) 
-    // mConcTable["CO"][i]    = mHcore->sendMessage(M_GETDATA, D_ATMOSPHERIC_CO);
-    // mConcTable["NOX"][i]   = mHcore->sendMessage(M_GETDATA, D_ATMOSPHERIC_NOX);
-    // mConcTable["NMVOC"][i] = mHcore->sendMessage(M_GETDATA, D_ATMOSPHERIC_NMVOC);
-
-    // Log the concentrations we are seeing here
-    climatelog.setLevel( ILogger::DEBUG );
-    climatelog << "\tstoreConc: year= " << aYear << "  index= " << i << endl
-               << "\t\tCO2 = " << mConcTable["CO2"][i] << endl
-               << "\t\tCH4 = " << mConcTable["CH4"][i] << endl
-               << "\t\tN2O = " << mConcTable["N2O"][i] << endl
-               << "\t\tO3  = " << mConcTable["O3"][i] << endl;
-    
+    for( size_t j = 0; j < mStoredConcIndices.size(); ++j ) {
+        const HectorOutput& output = STORED_CONC[ j ];
+        double& value = conc[ mStoredConcIndices[ j ] ];
+        value = aHadError ? numeric_limits<double>::quiet_NaN() :
+            output.mByDate ? mHcore->sendMessage( M_GETDATA, output.mMessage, date ) :
+                             mHcore->sendMessage( M_GETDATA, output.mMessage );
+        climatelog << "\t\t" << output.mGasName << " = " << value << endl;
+    }
 }
 
-void HectorModel::setupConcTbl() {
-    int size = yearlyDataIndex( mHectorEndYear ) + 1;
-
-    mConcTable["CH4"].resize( size );
-    mConcTable["N2O"].resize( size );
-    mConcTable["O3"].resize( size );
-    //mConcTable["CO"].resize( size );
-    //mConcTable["NOX"].resize( size );
-    mConcTable["CO2"].resize( size );
-    //mConcTable["NMVOC"].resize( size ); 
-}    
-
-// Be sure to keep this in sync with setupRFTbl.  If you add a gas
-// here, you need to add it there too!
 void HectorModel::storeRF(const int aYear, const bool aHadError ) {
     ILogger& climatelog = ILogger::getLogger( "climate-log" );
     int i = yearlyDataIndex( aYear );
-    
+    double* forcing = &mGasRFTable[ i * mGasIndex.size() ];
+
     // total
-    mTotRFTable[i]             = aHadError ? numeric_limits<double>::quiet_NaN() : mHcore->sendMessage( M_GETDATA, D_RF_TOTAL );
+    mTotRFTable[i] = aHadError ? numeric_limits<double>::quiet_NaN() : mHcore->sendMessage( M_GETDATA, D_RF_TOTAL );
+    climatelog << "\tstoreRF:  year= " << aYear << "\tindex= " << i << endl
+               << "\t\ttotal RF  = " << mTotRFTable[i] << endl;
 
     // misc gases requested by GCAM
-    mGasRFTable["CO2"][i]      = aHadError ? numeric_limits<double>::quiet_NaN() : mHcore->sendMessage( M_GETDATA, D_RF_CO2 );
-    mGasRFTable["CH4"][i]      = aHadError ? numeric_limits<double>::quiet_NaN() : mHcore->sendMessage( M_GETDATA, D_RF_CH4 );
-    mGasRFTable["N2O"][i]      = aHadError ? numeric_limits<double>::quiet_NaN() : mHcore->sendMessage( M_GETDATA, D_RF_N2O );
-    mGasRFTable["BC"][i]       = aHadError ? numeric_limits<double>::quiet_NaN() : mHcore->sendMessage( M_GETDATA, D_RF_BC );
-    mGasRFTable["OC"][i]       = aHadError ? numeric_limits<double>::quiet_NaN() : mHcore->sendMessage( M_GETDATA, D_RF_OC );
-    mGasRFTable["SO2"][i]       = aHadError ? numeric_limits<double>::quiet_NaN() : mHcore->sendMessage( M_GETDATA, D_RF_SO2 );
-
-#if 0
-    // Forcings that hector can provide, but which are not currently
-    // requested by GCAM.  In the interests of keeping memory usage
-    // down, we won't actually store these unless someone wants them.
-    // Remember, if you enable them here, then you also have to add
-    // them in setupRFTbl below.
-
-    // Water vapor
-    mGasRFTable["H2O"][i]   = mHcore->sendMessage( M_GETDATA, D_RF_H2O );
-    // SO2: direct and indirect
-    mGasRFTable["SO2d"][i]   = mHcore->sendMessage( M_GETDATA, D_RF_SO2d );
-    mGasRFTable["SO2i"][i]   = mHcore->sendMessage( M_GETDATA, D_RF_SO2i );
-    // Ozone
-    mGasRFTable["O3"][i]    = mHcore->sendMessage( M_GETDATA, D_RF_O3 );
-
-    // Volcanoes!  <- ?
-    mGasRFTable["HFC125"][i]   = mHcore->sendMessage( M_GETDATA, D_RF_HFC125 );
-    
-#endif
-
-    // Log what we saw here in the debugging log
-    climatelog << "\tstoreRF:  year= " << aYear << "\tindex= " << i << endl
-               << "\t\ttotal RF  = " << mTotRFTable[i] << endl
-               << "\t\t     CO2  = " << mGasRFTable["CO2"][i] << endl
-               << "\t\t     CH4  = " << mGasRFTable["CH4"][i] << endl
-               << "\t\t     N2O  = " << mGasRFTable["N2O"][i] << endl
-               << "\t\t      BC  = " << mGasRFTable["BC"][i] << endl
-               << "\t\t      OC  = " << mGasRFTable["OC"][i] << endl;
+    for( size_t j = 0; j < mStoredRFIndices.size(); ++j ) {
+        const HectorOutput& output = STORED_RF[ j ];
+        double& value = forcing[ mStoredRFIndices[ j ] ];
+        value = aHadError ? numeric_limits<double>::quiet_NaN() : mHcore->sendMessage( M_GETDATA, output.mMessage );
+        climatelog << "\t\t     " << output.mGasName << "  = " << value << endl;
+    }
 }
 
-void HectorModel::setupRFTbl() {
-    int size = yearlyDataIndex( mHectorEndYear ) + 1;
+/*!
+ * \brief Set up the per-gas results tables.
+ * \details Every gas the wrapper knows about, whether through its
+ *          emissions, the concentrations and forcings we store, or a
+ *          Hector forcing time series, is given an index.  The tables
+ *          then hold one contiguous row of values for all gasses per
+ *          year so that storing a year is a single pass and lookups by
+ *          index need no string comparisons.
+ */
+void HectorModel::setupGasTables() {
+    mGasIndex.clear();
+    mStoredConcIndices.clear();
+    mStoredRFIndices.clear();
 
-    mGasRFTable["CO2"].resize( size );
-    mGasRFTable["CH4"].resize( size );
-    mGasRFTable["N2O"].resize( size );
-    mGasRFTable["BC"].resize( size );
-    mGasRFTable["OC"].resize( size );
-    mGasRFTable["SO2"].resize( size );
+    map<std::string, std::string>::const_iterator it;
+    for( it = mHectorEmissionsMsg.begin(); it != mHectorEmissionsMsg.end(); ++it ) {
+        addGasIndex( it->first );
+    }
+    for( const HectorOutput& output : STORED_CONC ) {
+        mStoredConcIndices.push_back( addGasIndex( output.mGasName ) );
+    }
+    for( const HectorOutput& output : STORED_RF ) {
+        mStoredRFIndices.push_back( addGasIndex( output.mGasName ) );
+    }
+    for( it = mHectorRFTseriesMsg.begin(); it != mHectorRFTseriesMsg.end(); ++it ) {
+        addGasIndex( it->first );
+    }
+
+    mRFTseriesMsgByIndex.assign( mGasIndex.size(), "" );
+    for( it = mHectorRFTseriesMsg.begin(); it != mHectorRFTseriesMsg.end(); ++it ) {
+        mRFTseriesMsgByIndex[ mGasIndex[ it->first ] ] = it->second;
+    }
+
+    const size_t size = ( yearlyDataIndex( mHectorEndYear ) + 1 ) * mGasIndex.size();
+    mConcTable.assign( size, 0.0 );
+    mGasRFTable.assign( size, 0.0 );
+}
+
+//! Get the index of a gas in the per-gas results tables, adding it if it is new.
+int HectorModel::addGasIndex( const string& aGasName ) {
+    map<string, int>::const_iterator it = mGasIndex.find( aGasName );
+    if( it != mGasIndex.end() ) {
+        return it->second;
+    }
+    const int index = static_cast<int>( mGasIndex.size() );
+    mGasIndex[ aGasName ] = index;
+    return index;
 }
 
 //! Store the global quantities retrieved from Hector, except total
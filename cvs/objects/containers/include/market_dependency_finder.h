@@ -48,8 +48,10 @@
 #include <vector>
 #include <string>
 #include <set>
+#include <map>
 
 class Marketplace;
+class Market;
 class IActivity;
 #if GCAM_PARALLEL_ENABLED
 class GcamFlowGraph;
@@ -96,6 +98,9 @@ public:
 
     const std::vector<IActivity*> getOrdering( const int aMarketNumber = -1 ) const;
 
+    void getActivityMarkets( const int aPeriod,
+                             std::map<const IActivity*, std::set<const Market*> >& aActivityMarkets ) const;
+
 #if GCAM_PARALLEL_ENABLED
     GcamFlowGraph* getFlowGraph( const int aMarketNumber = -1 );
 #endif
@@ -40,6 +40,7 @@
 
 #include "util/base/include/definitions.h"
 #include <cassert>
+#include <algorithm>
 #include <boost/algorithm/string/predicate.hpp>
 #include "containers/include/market_dependency_finder.h"
 #include "util/logger/include/ilogger.h"
@@ -48,6 +49,7 @@
 #include "marketplace/include/market_locator.h"
 #include "marketplace/include/market.h"
 #include "marketplace/include/linked_market.h"
+#include "marketplace/include/price_market.h"
 #include "containers/include/iactivity.h"
 
 #if GCAM_PARALLEL_ENABLED
@@ -257,6 +259,57 @@ const vector<IActivity*> MarketDependencyFinder::getOrdering( const int aMarketN
     }
 }
 
+/*!
+ * \brief Find the markets which each activity may add supply or demand to or
+ *        set the price of in a period.
+ * \details The activities of a dependency item set the price of and add supply
+ *          to the market of that item and add demand to the markets of the items
+ *          it depends on.  A market which passes supply and demand on to another
+ *          market, such as a linked market or a trial price market, brings that
+ *          market along too.  Markets which an activity adds to without having
+ *          registered a dependency on them will not be found.
+ * \param aPeriod The model period of the markets to find.
+ * \param aActivityMarkets A map to fill with the markets of each activity.
+ */
+void MarketDependencyFinder::getActivityMarkets( const int aPeriod,
+                                                 map<const IActivity*, set<const Market*> >& aActivityMarkets ) const
+{
+    aActivityMarkets.clear();
+    for( CItemIterator it = mDependencyItems.begin(); it != mDependencyItems.end(); ++it ) {
+        if( (*it)->mLinkedMarket == MarketLocator::MARKET_NOT_FOUND ) {
+            continue;
+        }
+
+        // Follow the chain of markets supply and demand are passed on to.
+        vector<const Market*> markets;
+        const Market* market = mMarketplace->mMarkets[ (*it)->mLinkedMarket ]->getMarket( aPeriod );
+        while( market && find( markets.begin(), markets.end(), market ) == markets.end() ) {
+            markets.push_back( market );
+            if( market->getType() == IMarketType::LINKED ) {
+                market = static_cast<const LinkedMarket*>( market )->mLinkedMarket;
+            }
+            else if( market->getType() == IMarketType::PRICE ) {
+                market = static_cast<const PriceMarket*>( market )->mDemandMarketPointer;
+            }
+            else {
+                market = 0;
+            }
+        }
+
+        // The item itself and everything that depends on it.
+        vector<const DependencyItem*> items( 1, *it );
+        items.insert( items.end(), (*it)->mDependentList.begin(), (*it)->mDependentList.end() );
+        for( vector<const DependencyItem*>::const_iterator itemIter = items.begin(); itemIter != items.end(); ++itemIter ) {
+            const VertexList* vertexLists[] = { &(*itemIter)->mPriceVertices, &(*itemIter)->mDemandVertices };
+            for( size_t list = 0; list < 2; ++list ) {
+                for( CVertexIterator vertexIter = vertexLists[ list ]->begin(); vertexIter != vertexLists[ list ]->end(); ++vertexIter ) {
+                    aActivityMarkets[ (*vertexIter)->mCalcItem ].insert( markets.begin(), markets.end() );
+                }
+            }
+        }
+    }
+}
+
 #if GCAM_PARALLEL_ENABLED
 /*!
  * \brief Get flow graph which can be used to calculate the model in parallel.
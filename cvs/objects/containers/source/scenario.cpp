@@ -62,6 +62,8 @@
 #include "reporting/include/land_allocator_printer.h"
 #include "solution/solvers/include/solver_factory.h"
 #include "solution/solvers/include/bisection_nr_solver.h"
+#include "solution/solvers/include/solver_component.h"
+#include "solution/solvers/include/logbroyden.hpp"
 #include "solution/util/include/solution_info_param_parser.h" 
 #include "containers/include/imodel_feedback_calc.h"
 #include "util/base/include/manage_state_variables.hpp"
@@ -728,7 +730,8 @@ void Scenario::writeOutputFiles() const {
  *          each period to make sure we have a solver for that period, if
  *          not we will set it to the default solver.  The default solver
  *          is currently BisectionNRSolver.  Finally we call init for
- *          each solver.
+ *          each solver and discard any Jacobians the broyden solvers saved
+ *          for a previous scenario.
  */
 void Scenario::initSolvers() {
     // check the config file for a solver config file
@@ -754,6 +757,9 @@ void Scenario::initSolvers() {
         // Complete the init of the solution object.
         (*solverIt)->init();
     }
+
+    // Jacobians saved while solving a previous scenario describe different markets.
+    LogBroyden::clearJacobianCache();
 }
 
 /*!
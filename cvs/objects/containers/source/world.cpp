@@ -358,7 +358,14 @@ void World::calc( const int aPeriod, GcamFlowGraph *aWorkGraph, const vector<IAc
         // calc list which is used to skip uncessary activities that are not contained in
         // the given calc list.
         aWorkGraph = mTBBGraphGlobal;
-        aWorkGraph->mCalcList = aCalcList;
+        aWorkGraph->mCalcList = 0;
+        if( aCalcList ) {
+            // Sort a copy of the calc list so that the flow graph can quickly
+            // look up whether each activity needs to be calculated.
+            aWorkGraph->mSortedCalcList.assign( aCalcList->begin(), aCalcList->end() );
+            sort( aWorkGraph->mSortedCalcList.begin(), aWorkGraph->mSortedCalcList.end() );
+            aWorkGraph->mCalcList = &aWorkGraph->mSortedCalcList;
+        }
     }
     else {
         // When a work graph is provided we assume all items in that graph should be
@@ -225,6 +225,10 @@ protected:
     
     //! Flag indicating whether the next call to world->calc() will be part of a partial derivative calculation 
     static bool mIsDerivativeCalc;
+
+    //! Flag indicating whether a partial derivative calculation is shared by
+    //! several threads, in which case markets must still be locked.
+    static bool mIsSharedDerivativeCalc;
 };
 
 #endif
@@ -60,6 +60,7 @@ class Tabs;
 */
 
 class PriceMarket: public Market {
+    friend class MarketDependencyFinder;
 public:
     PriceMarket( Market& marketIn, Market* demandMarketIn );
 
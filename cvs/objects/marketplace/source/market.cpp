@@ -327,7 +327,7 @@ void Market::nullDemand() {
 */
 void Market::addToDemand( const double demandIn ) {
 #if GCAM_PARALLEL_ENABLED
-    if( !Marketplace::mIsDerivativeCalc ) {
+    if( !Marketplace::mIsDerivativeCalc || Marketplace::mIsSharedDerivativeCalc ) {
         Mutex::scoped_lock writeLock( mDemandMutex, true );
         mDemand += demandIn;
     }
@@ -348,7 +348,7 @@ void Market::addToDemand( const double demandIn ) {
 */
 double Market::getRawDemand() const {
 #if GCAM_PARALLEL_ENABLED
-    if( !Marketplace::mIsDerivativeCalc ) {
+    if( !Marketplace::mIsDerivativeCalc || Marketplace::mIsSharedDerivativeCalc ) {
         Mutex::scoped_lock readLock( mDemandMutex, false );
         return mDemand;
     }
@@ -369,7 +369,7 @@ double Market::getRawDemand() const {
  */
 double Market::getSolverDemand() const {
 #if GCAM_PARALLEL_ENABLED
-    if( !Marketplace::mIsDerivativeCalc ) {
+    if( !Marketplace::mIsDerivativeCalc || Marketplace::mIsSharedDerivativeCalc ) {
         Mutex::scoped_lock readLock( mDemandMutex, false );
         return mDemand;
     }
@@ -387,7 +387,7 @@ double Market::getSolverDemand() const {
 */
 double Market::getDemand() const {
 #if GCAM_PARALLEL_ENABLED
-    if( !Marketplace::mIsDerivativeCalc ) {
+    if( !Marketplace::mIsDerivativeCalc || Marketplace::mIsSharedDerivativeCalc ) {
         Mutex::scoped_lock readLock( mDemandMutex, false );
         return mDemand;
     }
@@ -415,7 +415,7 @@ void Market::nullSupply() {
 */
 double Market::getRawSupply() const {
 #if GCAM_PARALLEL_ENABLED
-    if( !Marketplace::mIsDerivativeCalc ) {
+    if( !Marketplace::mIsDerivativeCalc || Marketplace::mIsSharedDerivativeCalc ) {
         Mutex::scoped_lock readLock( mSupplyMutex, false );
         return mSupply;
     }
@@ -437,7 +437,7 @@ double Market::getRawSupply() const {
 */
 double Market::getSolverSupply() const {
 #if GCAM_PARALLEL_ENABLED
-    if( !Marketplace::mIsDerivativeCalc ) {
+    if( !Marketplace::mIsDerivativeCalc || Marketplace::mIsSharedDerivativeCalc ) {
         Mutex::scoped_lock readLock( mSupplyMutex, false );
         return mSupply;
     }
@@ -455,7 +455,7 @@ double Market::getSolverSupply() const {
 */
 double Market::getSupply() const {
 #if GCAM_PARALLEL_ENABLED
-    if( !Marketplace::mIsDerivativeCalc ) {
+    if( !Marketplace::mIsDerivativeCalc || Marketplace::mIsSharedDerivativeCalc ) {
         Mutex::scoped_lock readLock( mSupplyMutex, false );
         return mSupply;
     }
@@ -475,7 +475,7 @@ double Market::getSupply() const {
 */
 void Market::addToSupply( const double supplyIn ) {
 #if GCAM_PARALLEL_ENABLED
-    if( !Marketplace::mIsDerivativeCalc ) {
+    if( !Marketplace::mIsDerivativeCalc || Marketplace::mIsSharedDerivativeCalc ) {
         Mutex::scoped_lock writeLock( mSupplyMutex, true );
         mSupply += supplyIn;
     }
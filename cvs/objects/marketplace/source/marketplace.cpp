@@ -70,6 +70,7 @@ using namespace std;
 extern Scenario* scenario;
 const double Marketplace::NO_MARKET_PRICE = util::getLargeNumber();
 bool Marketplace::mIsDerivativeCalc = false;
+bool Marketplace::mIsSharedDerivativeCalc = false;
 
 /*! \brief Default constructor 
 *
@@ -73,8 +73,11 @@ private:
     //! A list of items which actually need to be calculated which may be a subset
     //! of the total activities.  This can be used when individual flow graphs have
     //! not be calculated for sub-graphs.  Note when null it implies all activities
-    //! will be calculated.
+    //! will be calculated.  The list must be sorted by address.
     const std::vector<IActivity*>* mCalcList;
+
+    //! Storage for a sorted copy of the list of items to calculate.
+    std::vector<IActivity*> mSortedCalcList;
 };
 
 /*!
@@ -32,6 +32,7 @@
 
 #if GCAM_PARALLEL_ENABLED
 #include <map>
+#include <algorithm>
 /* gcam headers */
 #include "parallel/include/gcam_parallel.hpp"
 #include "util/base/include/configuration.h"
@@ -323,7 +324,7 @@ void GcamParallel::TBBFlowGraphBody::operator()( tbb::flow::continue_msg aMessag
          nodeIt != mNodes.end(); ++nodeIt )
     {
         if( !mGraph.mCalcList ||
-            find( mGraph.mCalcList->begin(), mGraph.mCalcList->end(), *nodeIt ) != mGraph.mCalcList->end() )
+            binary_search( mGraph.mCalcList->begin(), mGraph.mCalcList->end(), *nodeIt ) )
         {
             (*nodeIt)->calc( mGraph.mPeriod );
         }
@@ -49,6 +49,9 @@
 #include <boost/numeric/ublas/matrix.hpp>
 #include "solution/util/include/solvable_nr_solution_info_filter.h"
 #include "solution/util/include/edfun.hpp"
+#include "solution/util/include/fdjac.hpp"
+#include "solution/util/include/linear_solver.hpp"
+#include "solution/util/include/jacobian_cache.hpp"
 
 #define UBLAS boost::numeric::ublas
 #if USE_LAPACK
@@ -83,7 +86,9 @@ public:
   LogBroyden(Marketplace *mktplc, World *world, CalcCounter *ccounter, int itmax=250,
              double ftol=1.0e-4) :
       SolverComponent(mktplc,world,ccounter), mMaxIter( itmax ), mFTOL( ftol ),
-      mLogPricep( true ) {}
+      mLogPricep( true ), mFactoredSolver( 0 ), mSparseJacobian( false ),
+      mParallelLinesearch( false ), mLinesearchCandidates( 0 ), mUseJacobianCache( false ),
+      mJacobianCacheMaxAge( 2 ), mStaleTolerance( 0.5 ) {}
   virtual ~LogBroyden() {}
 
   // SolverComponent methods
@@ -99,6 +104,9 @@ public:
   
   static const std::string & getXMLNameStatic( void ) {return SOLVER_NAME;}
 
+  //! Discard the Jacobians saved by all logbroyden solvers; they don't carry over to a new scenario.
+  static void clearJacobianCache() {mJacobianCache.clear();}
+
 protected:
   //! Perform the Broyden's method iterations.
   int bsolve(VecFVec<double,double> &F, UBLAS::vector<double> &x, UBLAS::vector<double> &fx,
@@ -107,6 +115,20 @@ protected:
   void reportVec(const std::string &aname, const UBLAS::vector<double> &av, const std::vector<int> &amktids,
                  const std::vector<bool> &aissolvable);
   void reportPSD(UBLAS::vector<double> &arptvec, const std::vector<int> &amktids, const std::vector<bool> &aissolvable);
+  //! Compute a finite-difference Jacobian, grouping columns if the sparse Jacobian is enabled.
+  int calcJacobian(VecFVec<double,double> &F, const UBLAS::vector<double> &x, UBMATRIX &J);
+  int calcJacobian(VecFVec<double,double> &F, const UBLAS::vector<double> &x, const UBLAS::vector<double> &fx,
+                   UBMATRIX &J);
+  //! Start the Jacobian from mJacobianCache, calculating only the columns it can't supply.
+  int warmStartJacobian(VecFVec<double,double> &F, const UBLAS::vector<double> &x,
+                        const UBLAS::vector<double> &fx, UBMATRIX &J, const std::vector<int> &aMarketIDs,
+                        const int aPeriod);
+  //! Recalculate the columns of the Jacobian that failed to predict the last step.
+  int refreshStaleColumns(VecFVec<double,double> &F, const UBLAS::vector<double> &x, UBMATRIX &B,
+                          const std::vector<int> &aStale);
+  //! Solve for the Newton step using mLinearSolver.
+  int linearSolve(VecFVec<double,double> &F, UBLAS::vector<double> &x, UBLAS::vector<double> &fx, UBMATRIX &B,
+                  UBLAS::vector<double> &dx, bool &aFactored);
 
   //! Maximum number of main-loop iterations for the root-finding algorithm
   unsigned int mMaxIter;
@@ -125,10 +147,29 @@ protected:
 
   bool mLogPricep;              //<! flag indicating whether we should work in price or log-price
 
-  // These next two have to be class variables because we sometimes
+  //! Backend for the linear solves; if null, the dense SVD (with LAPACK) or LU
+  //! decomposition is recomputed every iteration.
+  std::auto_ptr<LinearSolver> mLinearSolver;
+  //! Factors B for the sparse backends once B is no longer sparse
+  DenseLUSolver mDenseSolver;
+  //! mLinearSolver or mDenseSolver, whichever holds the factorization of B
+  LinearSolver* mFactoredSolver;
+
+  bool mSparseJacobian;         //<! flag indicating whether to group independent Jacobian columns
+  JacobianPattern mJacobianPattern; //<! Jacobian sparsity pattern used when mSparseJacobian is set; kept across periods
+  CSRMatrix<double> mJacobianCSR; //<! structural entries of the last Jacobian computed with mJacobianPattern
+  bool mParallelLinesearch;     //<! flag indicating whether to evaluate line search steps in parallel
+  int mLinesearchCandidates;    //<! step lengths per parallel line search batch (0 = one per thread)
+  bool mUseJacobianCache;       //<! flag indicating whether to reuse Jacobians through mJacobianCache
+  int mJacobianCacheMaxAge;     //<! periods a cached Jacobian column may be reused before recalculating it
+  double mStaleTolerance;       //<! secant error above which a Jacobian column is considered stale
+  std::vector<bool> mCalculatedColumns; //<! columns calculated by finite differences in the current solve
+
+  // These next three have to be class variables because we sometimes
   // have multiple logbroyden solvers operating.
   static int mLastPer;                 //<! used to detect when the period has changed, so we can reset mPerIter.
   static int mPerIter;                 //<! total iteration count within the period
+  static JacobianCache mJacobianCache; //<! Jacobians shared by all logbroyden solvers
 
 private:
   static std::string SOLVER_NAME;
@@ -49,6 +49,7 @@
 #include <boost/numeric/ublas/matrix.hpp>
 #include "solution/util/include/solvable_nr_solution_info_filter.h"
 #include "solution/util/include/edfun.hpp"
+#include "solution/util/include/linear_solver.hpp"
 
 #define UBLAS boost::numeric::ublas
 #if USE_LAPACK
@@ -129,6 +130,10 @@ protected:
 
   bool mLogPricep;              //<! flag indicating whether we should work in price or log-price 
 
+    //! Backend for the linear solves; if null, the dense SVD (with LAPACK) or
+    //! LU decomposition is used.
+    std::auto_ptr<LinearSolver> mLinearSolver;
+
 private:
     static std::string SOLVER_NAME;
 };
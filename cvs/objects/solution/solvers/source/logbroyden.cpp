@@ -68,6 +68,7 @@
 #include "solution/util/include/ublas-helpers.hpp"
 #include "util/base/include/fltcmp.hpp"
 #include "solution/util/include/jacobian-precondition.hpp"
+#include "solution/util/include/linear_solver.hpp"
 
 #if USE_LAPACK
 #include <boost/numeric/bindings/traits/ublas_vector.hpp>
@@ -127,6 +128,7 @@ namespace {
 
 int LogBroyden::mLastPer = 0;
 int LogBroyden::mPerIter = 0;
+JacobianCache LogBroyden::mJacobianCache;
 
 bool LogBroyden::XMLParse( const DOMNode* aNode ) {
     // assume we were passed a valid node.
@@ -159,6 +161,39 @@ bool LogBroyden::XMLParse( const DOMNode* aNode ) {
         else if(nodeName == "log-price") {
           mLogPricep = true;    // not strictly necessary, as this is the default.
         }
+        else if(nodeName == "linear-solver") {
+          std::string solverName = XMLHelper<std::string>::getValue( curr );
+          LinearSolver* linearSolver = LinearSolver::create( solverName );
+          if( linearSolver || solverName == "dense" ) {
+            mLinearSolver.reset( linearSolver );
+          }
+          else {
+            ILogger& mainLog = ILogger::getLogger( "main_log" );
+            mainLog.setLevel( ILogger::WARNING );
+            mainLog << "Unknown linear solver " << solverName << " in " << getXMLName()
+                    << "; using the dense solver." << std::endl;
+          }
+        }
+        else if(nodeName == "sparse-jacobian") {
+          mSparseJacobian = true;
+          // optional number of grouped Jacobians between dense refreshes of the pattern
+          int refresh = XMLHelper<int>::getAttr( curr, "refresh" );
+          mJacobianPattern = refresh > 0 ? JacobianPattern( refresh ) : JacobianPattern();
+        }
+        else if(nodeName == "parallel-linesearch") {
+          mParallelLinesearch = true;
+          mLinesearchCandidates = XMLHelper<int>::getAttr( curr, "candidates" );
+        }
+        else if(nodeName == "jacobian-cache") {
+          mUseJacobianCache = true;
+          // optional attributes; keep the defaults unless they are given
+          if( XMLHelper<std::string>::getAttr( curr, "max-age" ) != "" ) {
+            mJacobianCacheMaxAge = XMLHelper<int>::getAttr( curr, "max-age" );
+          }
+          if( XMLHelper<std::string>::getAttr( curr, "stale-tolerance" ) != "" ) {
+            mStaleTolerance = XMLHelper<double>::getAttr( curr, "stale-tolerance" );
+          }
+        }
         else if( SolutionInfoFilterFactory::hasSolutionInfoFilter( nodeName ) ) {
             mSolutionInfoFilter.reset( SolutionInfoFilterFactory::createAndParseSolutionInfoFilter( nodeName, curr ) );
         }
@@ -293,7 +328,15 @@ SolverComponent::ReturnCode LogBroyden::solve(SolutionInfoSet &solnset, int peri
     // Precondition the x values to avoid singular columns in the Jacobian
     solverLog.setLevel(ILogger::DEBUG);
     UBMATRIX J(F.narg(), F.nrtn());
-    fdjac(F, x, fx, J, true);
+    mCalculatedColumns.assign(nsolv, false);
+    std::vector<int> mktids;
+    if(mUseJacobianCache) {
+      solnset.getMarketIDs(mktids, true);
+      warmStartJacobian(F, x, fx, J, mktids, period);
+    }
+    else {
+      calcJacobian(F, x, fx, J);
+    }
 
     solverLog << ">>>> Main loop jacobian called.\n";
     int pcfail = jacobian_precondition(x, fx, J, F, &solverLog, mLogPricep);
@@ -313,6 +356,22 @@ SolverComponent::ReturnCode LogBroyden::solve(SolutionInfoSet &solnset, int peri
     int bstatus = bsolve(F, x, fx, J, neval);
     mPerIter++;                 // increment the iteration count.  This should produce a visible gap in the trace plots.
 
+    if(mUseJacobianCache) {
+      if(bstatus == 0) {
+        UBVECTOR xscl, fxscl;
+        F.getInputScale(xscl);
+        F.getOutputScale(fxscl);
+        mJacobianCache.store(mktids, mLogPricep, xscl, fxscl, period,
+                             boost::numeric::ublas::matrix<double>(J), mCalculatedColumns);
+      }
+      else {
+        // the reused columns may be to blame
+        mJacobianCache.markStale(mktids, mLogPricep);
+      }
+      solverLog.setLevel(ILogger::NOTICE);
+      mJacobianCache.printCounters(solverLog);
+    }
+
     solverTimer.stop(); 
 
     solverLog.setLevel(ILogger::NOTICE);
@@ -378,6 +437,10 @@ int LogBroyden::bsolve(VecFVec<double,double> &F, UBVECTOR &x, UBVECTOR &fx,
   using boost::numeric::ublas::inner_prod;
   int nrow = B.size1(), ncol = B.size2();
   int ageB = 0;   // number of iterations since the last reset on B
+  if(std::find(mCalculatedColumns.begin(), mCalculatedColumns.end(), false) != mCalculatedColumns.end()) {
+    // B was started from the Jacobian cache, so treat it as already aged
+    ageB = 1;
+  }
   // svd decomposition elements (note nrow == ncol)
 #if USE_LAPACK
   UBMATRIX Usv(nrow,ncol),VTsv(ncol,ncol);
@@ -450,6 +513,8 @@ int LogBroyden::bsolve(VecFVec<double,double> &F, UBVECTOR &x, UBVECTOR &fx,
   }
 
   bool lsfail = false;        // flag indicating whether we have had a line-search failure
+  bool factored = false;      // flag indicating whether mLinearSolver holds a factorization of B
+  bool staleRefresh = false;  // flag indicating whether B was last reset by refreshing only its stale columns
   for(int iter=0; iter<mMaxIter; ++iter) {
     // log some debug info
     
@@ -484,78 +549,90 @@ int LogBroyden::bsolve(VecFVec<double,double> &F, UBVECTOR &x, UBVECTOR &fx,
     }
 
     Btmp = B;                   // save the jacobian approximant
-#if USE_LAPACK /* Solve using SVD */
-    int ierr = boost::numeric::bindings::lapack::gesvd('O','A','A', // control parameters
-                                                       B,           // input matrix
-                                                       Ssv,Usv,VTsv); // outputs
-    if(ierr>0) {
-      // svd failed.  It's not even clear under what circumstances
-      // this can happen
-      solverLog.setLevel(ILogger::SEVERE);
-      solverLog << "****************SVD failed.  This shouldn't happen.  It can't mean anything good.\n";
-      return ierr;
+    if(mLinearSolver.get()) {
+      int sing = linearSolve(F, x, fx, B, dx, factored);
+      if(sing) {
+        return sing;
+      }
+      // the Jacobian salvage may have moved x and replaced B
+      f0 = inner_prod(fx,fx);
+      Btmp = B;
+      solverLog << "dx: " << dx << "\n";
     }
+    else {
+#if USE_LAPACK /* Solve using SVD */
+      int ierr = boost::numeric::bindings::lapack::gesvd('O','A','A', // control parameters
+                                                         B,           // input matrix
+                                                         Ssv,Usv,VTsv); // outputs
+      if(ierr>0) {
+        // svd failed.  It's not even clear under what circumstances
+        // this can happen
+        solverLog.setLevel(ILogger::SEVERE);
+        solverLog << "****************SVD failed.  This shouldn't happen.  It can't mean anything good.\n";
+        return ierr;
+      }
 
-    // At this point, U, S, and VT contain the SVD of the original Jacobian
-    solverLog.setLevel(ILogger::DEBUG);
-    dx = -1.0*fx; 
-    int nsing = svdInvertSolve(Usv,Ssv,VTsv,dx, solverLog);
+      // At this point, U, S, and VT contain the SVD of the original Jacobian
+      solverLog.setLevel(ILogger::DEBUG);
+      dx = -1.0*fx; 
+      int nsing = svdInvertSolve(Usv,Ssv,VTsv,dx, solverLog);
 
-    solverLog << "\nIteration " << iter << "\nf0= " << f0
-              << "\tnsing= " << nsing
-              << "\nx: " << x << "\nF( x ): " << fx << "\ndx: " << dx << "\n";
+      solverLog << "\nIteration " << iter << "\nf0= " << f0
+                << "\tnsing= " << nsing
+                << "\nx: " << x << "\nF( x ): " << fx << "\ndx: " << dx << "\n";
 
 #else /* No USE_LAPACK.  Solve using L-U decomposition */
-    int itrial = 0;
-    /* If the L-U decomposition fails the first time around, we will
-       invoke the jacobian preconditioner and try again.  If it fails
-       a second time, we bail out */
-    do {
-      for(size_t i=0; i<p.size(); ++i) {
-        p[i] = i;
-      }
-      int sing = lu_factorize(B,p);
-      if(sing>0) {
-        int fail=1;
-        B = Btmp;           // restore Jacobian
-        if(itrial == 0) {
-            solverLog << "Salvaging Jacobian.\n";
-            fail = jacobian_precondition(x, fx, B, F, &solverLog, mLogPricep);
-            f0 = inner_prod(fx,fx);
-
-            // log the diagonal of the new jacobian
-            for(int j=0; j<F.narg(); ++j) {
-                jdiag[j] = B(j,j); 
-            }
-            solverLog << "After jacobian salvage.  diag( B )=\n" << jdiag << "\n";
-
+      int itrial = 0;
+      /* If the L-U decomposition fails the first time around, we will
+         invoke the jacobian preconditioner and try again.  If it fails
+         a second time, we bail out */
+      do {
+        for(size_t i=0; i<p.size(); ++i) {
+          p[i] = i;
         }
+        int sing = lu_factorize(B,p);
+        if(sing>0) {
+          int fail=1;
+          B = Btmp;           // restore Jacobian
+          if(itrial == 0) {
+              solverLog << "Salvaging Jacobian.\n";
+              fail = jacobian_precondition(x, fx, B, F, &solverLog, mLogPricep);
+              f0 = inner_prod(fx,fx);
+
+              // log the diagonal of the new jacobian
+              for(int j=0; j<F.narg(); ++j) {
+                  jdiag[j] = B(j,j); 
+              }
+              solverLog << "After jacobian salvage.  diag( B )=\n" << jdiag << "\n";
+
+          }
         
-        if( fail ) {
-            solverLog.setLevel(ILogger::WARNING);
-            solverLog << "Singular Jacobian:\n" << B << "\n";
-            return sing;
+          if( fail ) {
+              solverLog.setLevel(ILogger::WARNING);
+              solverLog << "Singular Jacobian:\n" << B << "\n";
+              return sing;
+          }
+        }
+        else {
+          // L-U decomp was successful.  Continue with the next phase of the algorithm.
+          break;
         }
+      } while(++itrial < 2);
+    
+      // J now holds the L-U decomposition of the Jacobian.  Attempt backsubstitution
+      dx = -1.0*fx;
+      try {
+        lu_substitute(B,p,dx);    // solve dx = J^-1 F
       }
-      else {
-        // L-U decomp was successful.  Continue with the next phase of the algorithm.
-        break;
+      catch (const boost::numeric::ublas::internal_logic &err) {
+        // This error seems to be thrown when the Jacobian is
+        // ill-conditioned.  We let it go because often the solver will
+        // muddle through to a solution.  If not, then it will
+        // eventually stop with a genuinely singular matrix.
       }
-    } while(++itrial < 2);
-    
-    // J now holds the L-U decomposition of the Jacobian.  Attempt backsubstitution
-    dx = -1.0*fx;
-    try {
-      lu_substitute(B,p,dx);    // solve dx = J^-1 F
-    }
-    catch (const boost::numeric::ublas::internal_logic &err) {
-      // This error seems to be thrown when the Jacobian is
-      // ill-conditioned.  We let it go because often the solver will
-      // muddle through to a solution.  If not, then it will
-      // eventually stop with a genuinely singular matrix.
-    }
-    solverLog << "dx: " << dx << "\n"; 
+      solverLog << "dx: " << dx << "\n"; 
 #endif /* USE_LAPACK */
+    }
 
     // log the proposal step
     solverLog << "Proposal step magnitude dxmag= " << sqrt(inner_prod(dx,dx)) << "\n\n";
@@ -565,7 +642,9 @@ int LogBroyden::bsolve(VecFVec<double,double> &F, UBVECTOR &x, UBVECTOR &fx,
     // dx now holds the newton step.  Execute the line search along
     // that direction.
     double fnew;
-    int lserr = linesearch(fnorm,x,f0,gx,dx, xnew,fnew, neval, &solverLog);
+    int lserr = mParallelLinesearch ?
+        parallel_linesearch(fnorm,x,f0,gx,dx, xnew,fnew, neval, mLinesearchCandidates, &solverLog) :
+        linesearch(fnorm,x,f0,gx,dx, xnew,fnew, neval, &solverLog);
 
     if(lserr != 0) {
       // line search failed.  There are a couple of things that could
@@ -580,9 +659,9 @@ int LogBroyden::bsolve(VecFVec<double,double> &F, UBVECTOR &x, UBVECTOR &fx,
         // call fdjac such that it re-calculates the model at x as linesearch will
         // have left off on some other price vector thus we could have bad state
         // data from which we calculate derivatives
-        fdjac(F,x,B);
-        neval += x.size();
+        neval += calcJacobian(F,x,B);
         ageB = 0;  // reset the age on B
+        factored = false;
 
         // Log the diagonal of the new jacobian after the failed line search
         for(int j=0; j<F.narg(); ++j) {
@@ -603,6 +682,7 @@ int LogBroyden::bsolve(VecFVec<double,double> &F, UBVECTOR &x, UBVECTOR &fx,
       if(msf < mFTOL) {
         // basically, we're letting ourselves converge to the sqrt of
         // our intended tolerance.
+        B = Btmp;               // B itself may hold a factorization
         return 0;
       }
 
@@ -660,6 +740,7 @@ int LogBroyden::bsolve(VecFVec<double,double> &F, UBVECTOR &x, UBVECTOR &fx,
       solverLog << "Solution successful.\n";
       x = xnew;
       fx = fxnew;
+      B = Btmp;                 // B itself may hold a factorization
       return 0;                 // SUCCESS 
     }
 
@@ -696,18 +777,45 @@ int LogBroyden::bsolve(VecFVec<double,double> &F, UBVECTOR &x, UBVECTOR &fx,
       fxstep /= dx2;
       B += outer_prod(fxstep, xstep);
       ageB++;                // increment the age of B
+      staleRefresh = false;
+      if(factored && !mFactoredSolver->update(fxstep, xstep)) {
+        // too many updates, or the update is degenerate; refactor B next time
+        factored = false;
+      }
     }
     else {
       // Progress using the Broyden formula is anemic.  This usually
       // happens near discontinuities in the Jacobian matrix.  If B is
       // old, try a finite-difference jacobian to get us back on track.
-      if(ageB > 0) {
+      // If only some of its columns mispredicted the step, try refreshing
+      // just those first.
+      std::vector<int> stale;
+      if(ageB > 0 && mUseJacobianCache) {
+        JacobianCache::findStaleColumns(boost::numeric::ublas::matrix<double>(Btmp), xstep, fxstep, mStaleTolerance, stale);
+      }
+      if(!stale.empty() && stale.size() <= x.size()/2) {
+        solverLog << "Insufficient progress with Broyden formula.  Refreshing " << stale.size()
+                  << " stale Jacobian columns.\n(f0= " << f0 << ", fnew= " << fnew << ")\n";
+        B = Btmp;
+        neval += refreshStaleColumns(F,xnew,B,stale);
+        ageB = 0;
+        factored = false;
+        staleRefresh = true;
+
+        for(int j=0; j<F.narg(); ++j) {
+            jdiag[j] = B(j,j);
+        }
+        solverLog << "New Jacobian:  diag( B )=\n" << jdiag << "\n";
+        static_cast<LogEDFun&>(F).setSlope(jdiag);
+      }
+      else if(ageB > 0 || staleRefresh) {
         solverLog << "Insufficient progress with Broyden formula.  Resetting the Jacobian.\n(f0= " << f0 << ", fnew= " << fnew << ")\n";
         // just in case call fdjac such that it re-calculates the model at xnew
         // otherwise we could have bad state data from which we calculate derivatives
-        fdjac(F,xnew,B);
-        neval += x.size();
+        neval += calcJacobian(F,xnew,B);
         ageB = 0;
+        factored = false;
+        staleRefresh = false;
 
         // Log the results of the Jacobian reset
         for(int j=0; j<F.narg(); ++j) {
@@ -833,3 +941,171 @@ void LogBroyden::reportPSD(UBVECTOR &arptvec, const std::vector<int> &amktids, c
 }
 
     
+
+/*!
+ * \brief Compute a finite-difference Jacobian at x.
+ * \details When the sparse Jacobian is enabled, structurally independent
+ *          columns are evaluated together using mJacobianPattern and the
+ *          structural entries are kept in mJacobianCSR; otherwise every column
+ *          is evaluated separately.
+ * \param F The excess demand function.
+ * \param x The point at which to calculate the Jacobian.
+ * \param fx F(x)
+ * \param J The Jacobian (output).
+ * \return The number of model evaluations performed.
+ */
+int LogBroyden::calcJacobian(VecFVec<double,double> &F, const UBVECTOR &x, const UBVECTOR &fx, UBMATRIX &J)
+{
+    mCalculatedColumns.assign(x.size(), true);
+    if(mUseJacobianCache) {
+        mJacobianCache.countFullRefresh();
+    }
+    if(mSparseJacobian) {
+        return fdjac(F, x, fx, J, mJacobianPattern, &mJacobianCSR);
+    }
+    fdjac(F, x, fx, J, true);
+    return x.size();
+}
+
+/*!
+ * \brief Compute a finite-difference Jacobian at x, evaluating F(x) first.
+ * \details This recalculates the model at x, which is necessary when the
+ *          model was last evaluated at some other point (e.g., during a line
+ *          search).
+ */
+int LogBroyden::calcJacobian(VecFVec<double,double> &F, const UBVECTOR &x, UBMATRIX &J)
+{
+    UBVECTOR fx(F.nrtn());
+    F(x,fx);
+    return calcJacobian(F, x, fx, J);
+}
+
+/*!
+ * \brief Start the Jacobian from the columns saved in mJacobianCache.
+ * \details Columns the cache can't supply are calculated by finite
+ *          differences.  If that is most of them, the whole Jacobian is
+ *          calculated with calcJacobian instead.
+ * \param F The excess demand function.
+ * \param x The point at which to calculate the Jacobian.
+ * \param fx F(x)
+ * \param J The Jacobian (output).
+ * \param aMarketIDs Market ids of the solvable markets.
+ * \param aPeriod Current model period.
+ * \return The number of model evaluations performed.
+ */
+int LogBroyden::warmStartJacobian(VecFVec<double,double> &F, const UBVECTOR &x, const UBVECTOR &fx,
+                                  UBMATRIX &J, const std::vector<int> &aMarketIDs, const int aPeriod)
+{
+    std::vector<int> recalc;
+    boost::numeric::ublas::matrix<double> cached(J.size1(), J.size2());
+    UBVECTOR xscl, fxscl;
+    F.getInputScale(xscl);
+    F.getOutputScale(fxscl);
+    mJacobianCache.retrieve(aMarketIDs, mLogPricep, xscl, fxscl, aPeriod, mJacobianCacheMaxAge,
+                            cached, recalc);
+    if(recalc.size() == x.size()) {
+        return calcJacobian(F, x, fx, J);
+    }
+
+    J = cached;
+    if(!recalc.empty()) {
+        fdjac(F, x, fx, J, recalc);
+        for(size_t k=0; k<recalc.size(); ++k) {
+            mCalculatedColumns[recalc[k]] = true;
+        }
+    }
+    ILogger &solverLog = ILogger::getLogger("solver_log");
+    solverLog << "Reused " << x.size() - recalc.size() << " cached Jacobian columns; recalculated "
+              << recalc.size() << ".\n";
+    return recalc.size();
+}
+
+/*!
+ * \brief Recalculate the given columns of B at x, evaluating F(x) first.
+ * \param F The excess demand function.
+ * \param x The point at which to calculate the columns.
+ * \param B The Jacobian approximation to update.
+ * \param aStale Indices of the columns to recalculate.
+ * \return The number of model evaluations performed.
+ */
+int LogBroyden::refreshStaleColumns(VecFVec<double,double> &F, const UBVECTOR &x, UBMATRIX &B,
+                                    const std::vector<int> &aStale)
+{
+    UBVECTOR fx(F.nrtn());
+    F(x,fx);
+    fdjac(F, x, fx, B, aStale);
+    for(size_t k=0; k<aStale.size(); ++k) {
+        mCalculatedColumns[aStale[k]] = true;
+    }
+    mJacobianCache.countStaleRefresh(aStale.size());
+    return 1 + aStale.size();
+}
+
+/*!
+ * \brief Solve B . dx = -fx with mLinearSolver.
+ * \details B is factored only if aFactored is false; otherwise the existing
+ *          factorization, with the Broyden updates applied to it since, is
+ *          used.  If the factorization fails, the Jacobian is salvaged with
+ *          the preconditioner (which may change x, fx, and B) and factored
+ *          once more.
+ *
+ *          mLinearSolver is given the structural entries of B only while B
+ *          is still the Jacobian last computed with mJacobianPattern.  Once
+ *          B has been filled in, by Broyden updates, cached or refreshed
+ *          columns, or the preconditioner, it is factored with mDenseSolver
+ *          instead, unless mLinearSolver is itself dense.
+ * \param F The excess demand function.
+ * \param x Current point.
+ * \param fx F(x)
+ * \param B Jacobian approximation.
+ * \param dx The solution step (output).
+ * \param aFactored Whether mLinearSolver holds a factorization of B (input and output).
+ * \return 0 on success, or the 1-based index of the column at which the
+ *         matrix was found to be singular.
+ */
+int LogBroyden::linearSolve(VecFVec<double,double> &F, UBVECTOR &x, UBVECTOR &fx, UBMATRIX &B,
+                            UBVECTOR &dx, bool &aFactored)
+{
+    ILogger &solverLog = ILogger::getLogger("solver_log");
+    for(int itrial = 0; !aFactored; ++itrial) {
+        LinearSolver* solver = mLinearSolver.get();
+        const CSRMatrix<double>* Bsparse = &mJacobianCSR;
+        CSRMatrix<double> Bfull;
+        if(!matchesCSR(B, mJacobianCSR)) {
+            denseToCSR(B, Bfull);
+            Bsparse = &Bfull;
+            if(solver->getName() != DenseLUSolver::getNameStatic()) {
+                solver = &mDenseSolver;
+            }
+        }
+        int sing = solver->factor(*Bsparse);
+        if(sing == 0) {
+            solverLog << "Factored Jacobian (" << Bsparse->mValue.size() << " nonzeros) with "
+                      << solver->getName() << ".\n";
+            mFactoredSolver = solver;
+            aFactored = true;
+            break;
+        }
+        int fail = 1;
+        if(itrial == 0) {
+            solverLog << "Salvaging Jacobian.\n";
+            fail = jacobian_precondition(x, fx, B, F, &solverLog, mLogPricep);
+        }
+        if(fail) {
+            solverLog.setLevel(ILogger::WARNING);
+            solverLog << "Singular Jacobian:\n" << B << "\n";
+            solverLog.setLevel(ILogger::DEBUG);
+            return sing;
+        }
+    }
+
+    dx = -1.0*fx;
+    if(!mFactoredSolver->solve(dx)) {
+        solverLog.setLevel(ILogger::WARNING);
+        solverLog << "Linear solve with " << mFactoredSolver->getName() << " failed.\n";
+        solverLog.setLevel(ILogger::DEBUG);
+        aFactored = false;
+        return 1;
+    }
+    return 0;
+}
@@ -65,6 +65,7 @@
 #include "solution/util/include/edfun.hpp"
 #include "solution/util/include/ublas-helpers.hpp"
 #include "solution/util/include/jacobian-precondition.hpp" 
+#include "solution/util/include/linear_solver.hpp"
 #include "util/base/include/fltcmp.hpp"
 
 #if USE_LAPACK
@@ -131,6 +132,19 @@ bool LogNRbt::XMLParse( const DOMNode* aNode ) {
         else if(nodeName == "log-price") {
           mLogPricep = true;    // not strictly necessary, as this is the default.
         } 
+        else if(nodeName == "linear-solver") {
+          string solverName = XMLHelper<string>::getValue( curr );
+          LinearSolver* linearSolver = LinearSolver::create( solverName );
+          if( linearSolver || solverName == "dense" ) {
+            mLinearSolver.reset( linearSolver );
+          }
+          else {
+            ILogger& mainLog = ILogger::getLogger( "main_log" );
+            mainLog.setLevel( ILogger::WARNING );
+            mainLog << "Unknown linear solver " << solverName << " in " << getXMLName()
+                    << "; using the dense solver." << endl;
+          }
+        }
         else if( SolutionInfoFilterFactory::hasSolutionInfoFilter( nodeName ) ) {
             mSolutionInfoFilter.reset( SolutionInfoFilterFactory::createAndParseSolutionInfoFilter( nodeName, curr ) );
         }
@@ -341,96 +355,128 @@ int LogNRbt::nrsolve(VecFVec<double,double> &F, UBVECTOR &x, UBVECTOR &fx, UBMAT
 
     Jtmp = J;                   // save the Jacobian, since gesvd destroys it.
 
+    if(mLinearSolver.get()) {
+      // The Jacobian is new every iteration, so factor it every time.
+      // If that fails, try once to salvage it with the preconditioner.
+      int itrial = 0;
+      while(true) {
+        CSRMatrix<double> Jsparse;
+        denseToCSR(J, Jsparse);
+        int sing = mLinearSolver->factor(Jsparse);
+        if(sing == 0) {
+          break;
+        }
+        int fail = 1;
+        if(itrial++ == 0) {
+          fail = jacobian_precondition(x, fx, J, F, &solverLog, mLogPricep);
+          f0 = inner_prod(fx,fx);
+          axpy_prod(fx,J,gx);
+        }
+        if(fail) {
+          solverLog.setLevel(ILogger::WARNING);
+          solverLog << "Singular Jacobian:\n" << J << "\n";
+          return sing;
+        }
+      }
+      dx = -1.0*fx;
+      if(!mLinearSolver->solve(dx)) {
+        solverLog.setLevel(ILogger::WARNING);
+        solverLog << "Linear solve with " << mLinearSolver->getName() << " failed.\n";
+        return 1;
+      }
+    }
+    else {
 #if USE_LAPACK
-    int ierr =
-      boost::numeric::bindings::lapack::gesvd('O','A','A', // control parameters
-                                              J,           // input matrix
-                                              Ssv,Usv,VTsv); // output matrices
-    if(ierr != 0) {
-      // svd failed.  It's not even clear under what circumstances
-      // this can happen
-      solverLog.setLevel(ILogger::SEVERE);
-      solverLog << "****************SVD failed.  This shouldn't happen.  It can't mean anything good.\n";
-      return ierr;
-    } 
+      int ierr =
+        boost::numeric::bindings::lapack::gesvd('O','A','A', // control parameters
+                                                J,           // input matrix
+                                                Ssv,Usv,VTsv); // output matrices
+      if(ierr != 0) {
+        // svd failed.  It's not even clear under what circumstances
+        // this can happen
+        solverLog.setLevel(ILogger::SEVERE);
+        solverLog << "****************SVD failed.  This shouldn't happen.  It can't mean anything good.\n";
+        return ierr;
+      } 
     
-    // At this point, U, S, and VT contain the SVD of the original Jacobian
-    solverLog.setLevel(ILogger::DEBUG);
-    dx = -1.0*fx; 
-    int nsing = svdInvertSolve(Usv,Ssv,VTsv,dx, solverLog);
+      // At this point, U, S, and VT contain the SVD of the original Jacobian
+      solverLog.setLevel(ILogger::DEBUG);
+      dx = -1.0*fx; 
+      int nsing = svdInvertSolve(Usv,Ssv,VTsv,dx, solverLog);
     
-    solverLog.setLevel(ILogger::DEBUG);
-    solverLog << "\n****************Iteration " << iter << "\nf0= " << f0
-              << "\tnsing= " << nsing
-              << "\nx: " << x << "\nF(x): " << fx << "\ndx: " << dx << "\n";
-
-
-    if(nsing > 0) {
-      singcount += nsing;
-      if(singcount < scmax) {
-        // Try to reset the x value using the preconditioner
-        solverLog << "Resetting singular matrix, singcount = " << singcount << "\n";
-        J = Jtmp;
-        int fail = jacobian_precondition(x, fx, J, F, &solverLog, mLogPricep);
-        if(fail)
-          return nsing;
-
-        // re-evaluate f0 and gx at the new guess
-        double f0 = inner_prod(fx,fx);
-        axpy_prod(fx,J,gx);         // compute the gradient of F*F (= fx^T * J == J^T * fx)
+      solverLog.setLevel(ILogger::DEBUG);
+      solverLog << "\n****************Iteration " << iter << "\nf0= " << f0
+                << "\tnsing= " << nsing
+                << "\nx: " << x << "\nF(x): " << fx << "\ndx: " << dx << "\n";
+
+
+      if(nsing > 0) {
+        singcount += nsing;
+        if(singcount < scmax) {
+          // Try to reset the x value using the preconditioner
+          solverLog << "Resetting singular matrix, singcount = " << singcount << "\n";
+          J = Jtmp;
+          int fail = jacobian_precondition(x, fx, J, F, &solverLog, mLogPricep);
+          if(fail)
+            return nsing;
+
+          // re-evaluate f0 and gx at the new guess
+          double f0 = inner_prod(fx,fx);
+          axpy_prod(fx,J,gx);         // compute the gradient of F*F (= fx^T * J == J^T * fx)
         
-        // re-solve for dx using the new Jacobian
-        ierr = boost::numeric::bindings::lapack::gesvd('O','A','A', // control parameters
-                                                       J,           // input matrix
-                                                       Ssv,Usv,VTsv); // output matrices
-        if(ierr)
+          // re-solve for dx using the new Jacobian
+          ierr = boost::numeric::bindings::lapack::gesvd('O','A','A', // control parameters
+                                                         J,           // input matrix
+                                                         Ssv,Usv,VTsv); // output matrices
+          if(ierr)
+            return nsing;
+          dx = -1.0*fx;
+          svdInvertSolve(Usv, Ssv, VTsv, dx, solverLog);
+        }
+        else {
           return nsing;
-        dx = -1.0*fx;
-        svdInvertSolve(Usv, Ssv, VTsv, dx, solverLog);
-      }
-      else {
-        return nsing;
+        }
       }
-    }
-    else
-      singcount = 0;
+      else
+        singcount = 0;
 #else  /* No USE_LAPACK.  Use L-U decomposition to do the solution. */
-    int itrial = 0;
-    /* If the L-U decomposition fails the first time around, we will
-       invoke the jacobian preconditioner and try again.  If it fails
-       a second time, we bail out */
-    do {
-      for(size_t i=0; i<p.size(); ++i) p[i] = i;
-      int sing = lu_factorize(J,p);
-      if(sing>0) {
-        int fail=1;
-        if(itrial == 0)
-          fail = jacobian_precondition(x, fx, J, F, &solverLog, mLogPricep);
+      int itrial = 0;
+      /* If the L-U decomposition fails the first time around, we will
+         invoke the jacobian preconditioner and try again.  If it fails
+         a second time, we bail out */
+      do {
+        for(size_t i=0; i<p.size(); ++i) p[i] = i;
+        int sing = lu_factorize(J,p);
+        if(sing>0) {
+          int fail=1;
+          if(itrial == 0)
+            fail = jacobian_precondition(x, fx, J, F, &solverLog, mLogPricep);
         
-        if(fail) {
-          solverLog.setLevel(ILogger::WARNING);
-          solverLog << "Singular Jacobian:\n" << Jtmp << "\n";
-          return sing;
+          if(fail) {
+            solverLog.setLevel(ILogger::WARNING);
+            solverLog << "Singular Jacobian:\n" << Jtmp << "\n";
+            return sing;
+          }
         }
+        else {
+          // L-U decomp was successful.  Continue with the next phase of the algorithm.
+          break;
+        }
+      } while(++itrial < 2);
+    
+      // J now holds the L-U decomposition of the Jacobian.  Attempt backsubstitution
+      dx = -1.0*fx;
+      try {
+        lu_substitute(J,p,dx);    // solve dx = J^-1 F
       }
-      else {
-        // L-U decomp was successful.  Continue with the next phase of the algorithm.
-        break;
+      catch (const boost::numeric::ublas::internal_logic &err) {
+        // This error seems to be thrown when the Jacobian is
+        // ill-conditioned.  We let it go because often the solver will
+        // muddle through to a solution.  If not, then it will
+        // eventually stop with a genuinely singular matrix.
       }
-    } while(++itrial < 2);
-    
-    // J now holds the L-U decomposition of the Jacobian.  Attempt backsubstitution
-    dx = -1.0*fx;
-    try {
-      lu_substitute(J,p,dx);    // solve dx = J^-1 F
-    }
-    catch (const boost::numeric::ublas::internal_logic &err) {
-      // This error seems to be thrown when the Jacobian is
-      // ill-conditioned.  We let it go because often the solver will
-      // muddle through to a solution.  If not, then it will
-      // eventually stop with a genuinely singular matrix.
-    }
 #endif /* USE_LAPACK */
+    }
     
     // dx now holds the newton step.  Execute the line search along
     // that direction.
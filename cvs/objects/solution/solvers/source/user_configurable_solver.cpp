@@ -56,6 +56,7 @@
 #include "util/base/include/xml_helper.h"
 #include "util/base/include/util.h"
 #include "util/base/include/auto_file.h"
+#include "util/base/include/timer.h"
 
 using namespace std;
 using namespace xercesc;
@@ -177,6 +178,7 @@ bool UserConfigurableSolver::solve( const int aPeriod, const SolutionInfoParamPa
     
     mainLog << "Starting Solution. Solving for " << solution_set.getNumSolvable()
         << " markets." << endl;
+    TimerRegistry::getInstance().addToCounter( "markets-solved", solution_set.getNumSolvable() );
     solution_set.printMarketInfo( "Begin Solve", mCalcCounter->getPeriodCount(), singleLog );
     
     // If no markets to solve, break out of solution.
@@ -0,0 +1,111 @@
+#ifndef CSR_MATRIX_HPP_
+#define CSR_MATRIX_HPP_
+
+
+/*
+* LEGAL NOTICE
+* This computer software was prepared by Battelle Memorial Institute,
+* hereinafter the Contractor, under Contract No. DE-AC05-76RL0 1830
+* with the Department of Energy (DOE). NEITHER THE GOVERNMENT NOR THE
+* CONTRACTOR MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR ASSUMES ANY
+* LIABILITY FOR THE USE OF THIS SOFTWARE. This notice including this
+* sentence must appear on any copies of this computer software.
+* 
+* EXPORT CONTROL
+* User agrees that the Software will not be shipped, transferred or
+* exported into any country or used in any manner prohibited by the
+* United States Export Administration Act or any other applicable
+* export laws, restrictions or regulations (collectively the "Export Laws").
+* Export of the Software may require some form of license or other
+* authority from the U.S. Government, and failure to obtain such
+* export control license may result in criminal liability under
+* U.S. laws. In addition, if the Software is identified as export controlled
+* items under the Export Laws, User represents and warrants that User
+* is not a citizen, or otherwise located within, an embargoed nation
+* (including without limitation Iran, Syria, Sudan, Cuba, and North Korea)
+*     and that User is not otherwise prohibited
+* under the Export Laws from receiving the Software.
+* 
+* Copyright 2011 Battelle Memorial Institute.  All Rights Reserved.
+* Distributed as open-source under the terms of the Educational Community 
+* License version 2.0 (ECL 2.0). http://www.opensource.org/licenses/ecl2.php
+* 
+* For further details, see: http://www.globalchange.umd.edu/models/gcam/
+*
+*/
+
+
+/*!
+ * \file csr_matrix.hpp
+ * \ingroup Solution
+ * \brief Compressed sparse row storage for solver Jacobians
+ */
+
+#include <vector>
+#include <boost/numeric/ublas/matrix.hpp>
+
+/*!
+ * \brief A Jacobian stored in compressed sparse row format.
+ * \details Row i has its entries in mColumn/mValue at positions
+ *          mRowStart[i] through mRowStart[i+1]-1, ordered by column.
+ */
+template<class FTYPE>
+struct CSRMatrix {
+  int mNumRows;
+  int mNumCols;
+  std::vector<int> mRowStart;
+  std::vector<int> mColumn;
+  std::vector<FTYPE> mValue;
+
+  CSRMatrix():mNumRows(0), mNumCols(0) {}
+};
+
+/*!
+ * \brief Copy the nonzero entries of a dense matrix into aCSR.
+ */
+template<class FTYPE, class MTRAIT>
+void denseToCSR(const boost::numeric::ublas::matrix<FTYPE,MTRAIT> &aMatrix, CSRMatrix<FTYPE> &aCSR)
+{
+  aCSR.mNumRows = aMatrix.size1();
+  aCSR.mNumCols = aMatrix.size2();
+  aCSR.mRowStart.assign(1, 0);
+  aCSR.mColumn.clear();
+  aCSR.mValue.clear();
+  for(int i=0; i<aCSR.mNumRows; ++i) {
+    for(int j=0; j<aCSR.mNumCols; ++j) {
+      if(aMatrix(i,j) != 0.0) {
+        aCSR.mColumn.push_back(j);
+        aCSR.mValue.push_back(aMatrix(i,j));
+      }
+    }
+    aCSR.mRowStart.push_back(aCSR.mColumn.size());
+  }
+}
+
+/*!
+ * \brief Check whether a dense matrix has exactly the entries of aCSR and is
+ *        zero everywhere else.
+ */
+template<class FTYPE, class MTRAIT>
+bool matchesCSR(const boost::numeric::ublas::matrix<FTYPE,MTRAIT> &aMatrix, const CSRMatrix<FTYPE> &aCSR)
+{
+  if(int(aMatrix.size1()) != aCSR.mNumRows || int(aMatrix.size2()) != aCSR.mNumCols) {
+    return false;
+  }
+  for(int i=0; i<aCSR.mNumRows; ++i) {
+    int k = aCSR.mRowStart[i];
+    for(int j=0; j<aCSR.mNumCols; ++j) {
+      if(k < aCSR.mRowStart[i+1] && aCSR.mColumn[k] == j) {
+        if(aMatrix(i,j) != aCSR.mValue[k++]) {
+          return false;
+        }
+      }
+      else if(aMatrix(i,j) != 0.0) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+#endif
@@ -94,9 +94,18 @@ class LogEDFun : public VecFVec<double,double>
                        //!required.
   int period;
   bool mLogPricep;               //!< Flag indicating whether inputs are prices or log-prices
+  bool mNestedPartials;          //!< Flag indicating whether partials use the flow graph
 
   // diagnostic variables
   std::vector<double> mstate;
+
+  //! Ids handed out by partialDomain, assigned as activities are first seen
+  mutable std::map<const IActivity*, int> mActivityIds;
+  //! Outputs each partial can change, filled in by the first call to partialRows
+  mutable std::vector<std::vector<int> > mPartialRows;
+
+  void evaluate(const UBVECTOR<double> &ax, UBVECTOR<double> &fx, const int* aPartials,
+                const size_t aNumPartials, const bool aIsTrial);
 public:
   LogEDFun(SolutionInfoSet &sisin, World *w, Marketplace *m, int per, bool aLogPricep=true);
   
@@ -104,8 +113,19 @@ public:
   virtual void operator()(const UBVECTOR<double> &x, UBVECTOR<double> &fx, const int partj=-1);
   virtual void partial(int ip);
   virtual double partialSize(int ip) const;
+  virtual void partialGroup(const UBVECTOR<double> &x, UBVECTOR<double> &fx, const std::vector<int> &aPartials);
+  virtual void partialDomain(int ip, std::vector<int> &aDomain) const;
+  virtual void partialRows(int ip, std::vector<int> &aRows) const;
+  virtual std::string partialName(int ip) const;
+  virtual bool trialSupported() const;
+  virtual void trial(const UBVECTOR<double> &x, UBVECTOR<double> &fx);
+  virtual bool nestedPartials(bool aNested);
   void scaleInitInputs(UBVECTOR<double> &ax);
   void setSlope(UBVECTOR<double> &adx);
+  //! Factors the inputs are multiplied by to get the (log) prices
+  virtual void getInputScale(UBVECTOR<double> &aScale) const {aScale = mxscl;}
+  //! Factors the excess demands are multiplied by to get the outputs
+  virtual void getOutputScale(UBVECTOR<double> &aScale) const {aScale = mfxscl;}
 
   // Constants to protect against overflow: 
   static const double PMAX;            //!< Greatest allowable price
@@ -50,16 +50,24 @@
 #include <boost/numeric/ublas/matrix.hpp>
 #include "functor.hpp"
 #include <iostream>
+#include <vector>
+#include <string>
+#include <map>
+#include <algorithm>
 #include "solution/util/include/ublas-helpers.hpp"
+#include "solution/util/include/csr_matrix.hpp"
 
 #define UBLAS boost::numeric::ublas
 
 #if GCAM_PARALLEL_ENABLED
+#include <atomic>
 #include <tbb/task_group.h>
+#include <tbb/parallel_for.h>
 #include <tbb/parallel_for_each.h>
 #endif
 
 #include "util/base/include/timer.h"
+#include "util/base/include/configuration.h"
 #include "containers/include/scenario.h"
 #include "util/base/include/manage_state_variables.hpp"
 
@@ -104,6 +112,453 @@ inline void jacol(VecFVec<FTYPE,FTYPE> &F, const UBLAS::vector<FTYPE> &x,
 }
 
 
+/*!
+ * \brief Cost model used to schedule the columns of a finite-difference Jacobian.
+ * \details The cost of a column is the time its partial derivative took the
+ *          last few times it was calculated, remembered by the column name
+ *          (see VecFVec::partialName).  Columns which have not been timed yet
+ *          are estimated from VecFVec::partialSize using the average time per
+ *          unit of size seen so far.  Columns are handed to the worker threads
+ *          largest first so that the expensive ones don't all end up at the
+ *          tail of the Jacobian.
+ *
+ *          When the NestedPartialDerivatives configuration flag is set, columns
+ *          which on their own cost more than an even share of the Jacobian are
+ *          evaluated one at a time with the flow graph instead (see
+ *          VecFVec::nestedPartials).  A nested column is charged its wall
+ *          time multiplied by the number of threads, which keeps it comparable
+ *          with the other columns and lets a column move back to serial
+ *          evaluation once it no longer dominates.
+ */
+class PartialDerivativeSchedule {
+public:
+  static PartialDerivativeSchedule& getInstance() {
+    static PartialDerivativeSchedule sInstance;
+    return sInstance;
+  }
+
+  /*!
+   * Order columns by decreasing estimated cost.
+   * \param F The function the columns belong to.
+   * \param aColumns Columns to schedule.
+   * \param aNumThreads Number of threads that will evaluate the columns.
+   * \param aOrder Receives the columns in the order they should be started.
+   * \param aNested Receives the columns (a prefix of aOrder) that should be nested.
+   */
+  template<class FTYPE>
+  void schedule(const VecFVec<FTYPE,FTYPE> &F, const std::vector<int> &aColumns,
+                const int aNumThreads, std::vector<int> &aOrder, std::vector<int> &aNested) const {
+    std::vector<double> cost(aColumns.size());
+    double total = 0.0;
+    for(size_t k=0; k<aColumns.size(); ++k) {
+      cost[k] = getCost(F, aColumns[k]);
+      total += cost[k];
+    }
+    std::vector<size_t> index(aColumns.size());
+    for(size_t k=0; k<index.size(); ++k) {
+      index[k] = k;
+    }
+    std::stable_sort(index.begin(), index.end(), [&](size_t a, size_t b) {
+        return cost[a] > cost[b];
+    });
+    aOrder.resize(aColumns.size());
+    for(size_t k=0; k<index.size(); ++k) {
+      aOrder[k] = aColumns[index[k]];
+    }
+
+    aNested.clear();
+    const bool allowNested = aNumThreads > 1 &&
+        Configuration::getInstance()->getBool("NestedPartialDerivatives", false, false);
+    for(size_t k=0; allowNested && k<index.size() && cost[index[k]] > total / aNumThreads; ++k) {
+      aNested.push_back(aOrder[k]);
+    }
+  }
+
+  /*!
+   * Estimated cost of column j.  The units are seconds once any column
+   * has been timed and partialSize units before that.
+   */
+  template<class FTYPE>
+  double getCost(const VecFVec<FTYPE,FTYPE> &F, const int j) const {
+    const std::string name = F.partialName(j);
+    std::map<std::string, double>::const_iterator it = name.empty() ? mSeconds.end() : mSeconds.find(name);
+    if(it != mSeconds.end()) {
+      return it->second;
+    }
+    const double size = F.partialSize(j);
+    return mSecondsPerSize > 0.0 ? size * mSecondsPerSize : size;
+  }
+
+  /*!
+   * Record the time it took to calculate column j.  This is not thread safe
+   * and should be called once the columns have all been calculated.
+   */
+  template<class FTYPE>
+  void record(const VecFVec<FTYPE,FTYPE> &F, const int j, const double aSeconds) {
+    const std::string name = F.partialName(j);
+    if(!name.empty()) {
+      std::map<std::string, double>::iterator it = mSeconds.find(name);
+      if(it == mSeconds.end()) {
+        mSeconds[name] = aSeconds;
+      }
+      else {
+        it->second += WEIGHT * (aSeconds - it->second);
+      }
+    }
+    const double size = F.partialSize(j);
+    if(size > 0.0) {
+      const double rate = aSeconds / size;
+      mSecondsPerSize = mSecondsPerSize > 0.0 ? mSecondsPerSize + WEIGHT * (rate - mSecondsPerSize) : rate;
+    }
+  }
+
+private:
+  PartialDerivativeSchedule(): mSecondsPerSize(0.0) {}
+
+  //! Weight given to the newest timing in the moving averages
+  static constexpr double WEIGHT = 0.3;
+
+  //! Moving average of the time taken by each named column
+  std::map<std::string, double> mSeconds;
+  //! Moving average of the time per unit of partialSize
+  double mSecondsPerSize;
+};
+
+#if GCAM_PARALLEL_ENABLED
+/*!
+ * Evaluate aCalc(k) for each k in [0, aNumTasks) in the thread pool, handing
+ * out the tasks strictly in order as threads become free.
+ */
+template<class CALC>
+inline void runInOrder(const size_t aNumTasks, CALC aCalc) {
+  tbb::task_arena& threadPool = scenario->getManageStateVariables()->mThreadPool;
+  std::atomic<size_t> next(0);
+  tbb::task_group tg;
+  threadPool.execute([&](){
+      tg.run([&](){
+          tbb::parallel_for(0, threadPool.max_concurrency(), [&](int) {
+              for(size_t k = next++; k < aNumTasks; k = next++) {
+                  aCalc(k);
+              }
+          });
+      });
+  });
+  threadPool.execute([&tg](){ tg.wait(); });
+}
+#endif
+
+/*!
+ * Calculate the listed Jacobian columns using partial evaluation, largest first.
+ * \sa PartialDerivativeSchedule
+ */
+template<class FTYPE,class MTRAIT>
+inline void jacols(VecFVec<FTYPE,FTYPE> &F, const UBLAS::vector<FTYPE> &x,
+                   const UBLAS::vector<FTYPE> &fx, const std::vector<int> &aColumns,
+                   UBLAS::matrix<FTYPE,MTRAIT> &J) {
+#if !GCAM_PARALLEL_ENABLED
+  scenario->getManageStateVariables()->setPartialDeriv(true);
+  for(size_t k=0; k<aColumns.size(); ++k) {
+    jacol(F, x, fx, aColumns[k], J);
+  }
+#else
+  PartialDerivativeSchedule& schedule = PartialDerivativeSchedule::getInstance();
+  tbb::task_arena& threadPool = scenario->getManageStateVariables()->mThreadPool;
+  std::vector<int> order;
+  std::vector<int> nested;
+  schedule.schedule(F, aColumns, threadPool.max_concurrency(), order, nested);
+
+  // The big columns are each spread over the whole thread pool.
+  size_t start = 0;
+  std::vector<double> seconds(order.size());
+  if(!nested.empty() && F.nestedPartials(true)) {
+    scenario->getManageStateVariables()->setSharedPartialDeriv();
+    threadPool.execute([&](){
+        for(size_t k=0; k<nested.size(); ++k) {
+            Timer timer;
+            timer.start();
+            jacol(F, x, fx, nested[k], J);
+            timer.stop();
+            seconds[k] = timer.getTotalTimeDifference();
+        }
+    });
+    F.nestedPartials(false);
+    start = nested.size();
+  }
+
+  scenario->getManageStateVariables()->setPartialDeriv(true);
+  runInOrder(order.size() - start, [&](size_t k) {
+      Timer timer;
+      timer.start();
+      jacol(F, x, fx, order[start+k], J);
+      timer.stop();
+      seconds[start+k] = timer.getTotalTimeDifference();
+  });
+  // A nested column kept every thread busy, so charge it the time of all of
+  // them to keep its cost comparable to the serially calculated columns.
+  for(size_t k=0; k<start; ++k) {
+    schedule.record(F, order[k], seconds[k] * threadPool.max_concurrency());
+  }
+  for(size_t k=start; k<order.size(); ++k) {
+    schedule.record(F, order[k], seconds[k]);
+  }
+#endif
+}
+
+/*!
+ * \brief Sparsity pattern of a finite-difference Jacobian and the column
+ *        groups derived from it.
+ * \details The pattern is recorded along with a dense Jacobian: column j's
+ *          rows are the outputs the structure of F says x[j] can change (see
+ *          VecFVec::partialRows), plus the outputs that changed when x[j] was
+ *          perturbed, plus the diagonal.  Columns are then colored greedily (Curtis, Powell & Reid) so that
+ *          the columns in a group have disjoint rows and disjoint partial
+ *          domains (see VecFVec::partialDomain).  A group can be evaluated with
+ *          a single call to VecFVec::partialGroup, and each changed output is
+ *          attributed to the one column in the group that owns its row.
+ *
+ *          The pattern is tied to the column names it was recorded with and is
+ *          rebuilt from a dense Jacobian when those change, when reset() is
+ *          called, when a grouped evaluation changes an output that no column
+ *          in the group owns, or every mRefreshInterval Jacobians.  An entry
+ *          outside the structural rows that was exactly zero when the pattern
+ *          was recorded but becomes nonzero in a row owned by another column
+ *          of its group can't be detected; the periodic refresh bounds how
+ *          long such an entry is missed.
+ */
+class JacobianPattern {
+public:
+  //! \param aRefreshInterval Number of grouped Jacobians between dense refreshes (0 = never)
+  explicit JacobianPattern(const int aRefreshInterval = 10):
+      mRefreshInterval(aRefreshInterval), mNumSinceRefresh(0), mValid(false) {}
+
+  //! Discard the pattern so that the next Jacobian is computed densely.
+  void reset() {mValid = false;}
+
+  /*!
+   * Check whether the pattern can be used for the columns named in aNames.
+   * This counts as a use of the pattern toward the refresh interval.
+   */
+  bool isUsable(const std::vector<std::string> &aNames) {
+    if(!mValid || aNames != mNames ||
+       (mRefreshInterval > 0 && mNumSinceRefresh >= mRefreshInterval)) {
+      return false;
+    }
+    ++mNumSinceRefresh;
+    return true;
+  }
+
+  template<class FTYPE, class MTRAIT>
+  void record(const VecFVec<FTYPE,FTYPE> &F, const std::vector<std::string> &aNames,
+              const boost::numeric::ublas::matrix<FTYPE,MTRAIT> &J);
+
+  //! Rows with a structural nonzero in column j, in increasing order.
+  const std::vector<int>& getRows(int j) const {return mRows[j];}
+  //! Groups of columns that can be evaluated together.
+  const std::vector<std::vector<int> >& getGroups() const {return mGroups;}
+
+  template<class FTYPE, class MTRAIT>
+  void fillCSR(const boost::numeric::ublas::matrix<FTYPE,MTRAIT> &J, CSRMatrix<FTYPE> &aCSR) const;
+
+private:
+  //! Number of grouped Jacobians allowed between dense refreshes
+  int mRefreshInterval;
+  //! Number of grouped Jacobians since the pattern was recorded
+  int mNumSinceRefresh;
+  //! Whether the pattern may be used
+  bool mValid;
+  //! Column names the pattern was recorded for
+  std::vector<std::string> mNames;
+  //! Structural rows of each column
+  std::vector<std::vector<int> > mRows;
+  //! Column groups
+  std::vector<std::vector<int> > mGroups;
+};
+
+/*!
+ * \brief Record the pattern of F and the dense Jacobian J and group its columns.
+ * \param F The function J was computed for; supplies the structural rows and
+ *          the partial domains.
+ * \param aNames Names of the columns of J.
+ * \param J A Jacobian computed column by column.
+ */
+template<class FTYPE, class MTRAIT>
+void JacobianPattern::record(const VecFVec<FTYPE,FTYPE> &F, const std::vector<std::string> &aNames,
+                             const boost::numeric::ublas::matrix<FTYPE,MTRAIT> &J)
+{
+  const int n = aNames.size();
+  mNames = aNames;
+  mRows.assign(n, std::vector<int>());
+  std::vector<int> structural;
+  std::vector<bool> isRow(n);
+  for(int j=0; j<n; ++j) {
+    F.partialRows(j, structural);
+    isRow.assign(n, false);
+    isRow[j] = true;
+    for(size_t r=0; r<structural.size(); ++r) {
+      if(structural[r] >= 0 && structural[r] < n) {
+        isRow[structural[r]] = true;
+      }
+    }
+    for(int i=0; i<n; ++i) {
+      if(isRow[i] || J(i,j) != 0.0) {
+        mRows[j].push_back(i);
+      }
+    }
+  }
+
+  std::vector<std::vector<int> > domains(n);
+  int domainSize = 0;
+  for(int j=0; j<n; ++j) {
+    F.partialDomain(j, domains[j]);
+    for(size_t k=0; k<domains[j].size(); ++k) {
+      domainSize = std::max(domainSize, domains[j][k]+1);
+    }
+  }
+
+  // Color the densest columns first; they are the hardest to place.
+  std::vector<int> order(n);
+  for(int j=0; j<n; ++j) {
+    order[j] = j;
+  }
+  std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+      return mRows[a].size() + domains[a].size() > mRows[b].size() + domains[b].size();
+  });
+
+  // rows and domain entries already claimed by each group
+  std::vector<std::vector<bool> > groupRows;
+  std::vector<std::vector<bool> > groupDomain;
+  mGroups.clear();
+  for(int k=0; k<n; ++k) {
+    const int j = order[k];
+    const std::vector<int> &rows = mRows[j];
+    const std::vector<int> &dom = domains[j];
+    size_t g = mGroups.size();
+    // a column with an unknown domain always gets a group of its own
+    if(!dom.empty()) {
+      for(g=0; g<mGroups.size(); ++g) {
+        if(groupDomain[g].empty()) {
+          continue;
+        }
+        bool fits = true;
+        for(size_t r=0; fits && r<rows.size(); ++r) {
+          fits = !groupRows[g][rows[r]];
+        }
+        for(size_t d=0; fits && d<dom.size(); ++d) {
+          fits = !groupDomain[g][dom[d]];
+        }
+        if(fits) {
+          break;
+        }
+      }
+    }
+    if(g == mGroups.size()) {
+      mGroups.push_back(std::vector<int>());
+      groupRows.push_back(std::vector<bool>(n, false));
+      groupDomain.push_back(std::vector<bool>(dom.empty() ? 0 : domainSize, false));
+    }
+    mGroups[g].push_back(j);
+    for(size_t r=0; r<rows.size(); ++r) {
+      groupRows[g][rows[r]] = true;
+    }
+    for(size_t d=0; d<dom.size(); ++d) {
+      groupDomain[g][dom[d]] = true;
+    }
+  }
+  for(size_t g=0; g<mGroups.size(); ++g) {
+    std::sort(mGroups[g].begin(), mGroups[g].end());
+  }
+
+  mNumSinceRefresh = 0;
+  mValid = true;
+}
+
+/*!
+ * \brief Copy the structural entries of J into aCSR.
+ */
+template<class FTYPE, class MTRAIT>
+void JacobianPattern::fillCSR(const boost::numeric::ublas::matrix<FTYPE,MTRAIT> &J,
+                              CSRMatrix<FTYPE> &aCSR) const
+{
+  const int n = mRows.size();
+  aCSR.mNumRows = aCSR.mNumCols = n;
+  aCSR.mRowStart.assign(n+1, 0);
+  for(int j=0; j<n; ++j) {
+    for(size_t r=0; r<mRows[j].size(); ++r) {
+      ++aCSR.mRowStart[mRows[j][r]+1];
+    }
+  }
+  for(int i=0; i<n; ++i) {
+    aCSR.mRowStart[i+1] += aCSR.mRowStart[i];
+  }
+  aCSR.mColumn.resize(aCSR.mRowStart[n]);
+  aCSR.mValue.resize(aCSR.mRowStart[n]);
+  // walking the columns in order leaves each row sorted by column
+  std::vector<int> next(aCSR.mRowStart.begin(), aCSR.mRowStart.end()-1);
+  for(int j=0; j<n; ++j) {
+    for(size_t r=0; r<mRows[j].size(); ++r) {
+      const int i = mRows[j][r];
+      aCSR.mColumn[next[i]] = j;
+      aCSR.mValue[next[i]] = J(i,j);
+      ++next[i];
+    }
+  }
+}
+
+
+/*!
+ * Compute the Jacobian columns for a group of structurally independent
+ * columns with a single partial evaluation.  Entries outside the pattern
+ * are left untouched, so J should be zeroed beforehand.
+ * \return false if an output outside the group's pattern changed.  In that
+ *         case the columns have been recomputed one at a time and the
+ *         pattern should be rebuilt.
+ */
+template<class FTYPE,class MTRAIT>
+inline bool jacgroup(VecFVec<FTYPE,FTYPE> &F, const UBLAS::vector<FTYPE> &x,
+                     const UBLAS::vector<FTYPE> &fx, const std::vector<int> &group,
+                     const JacobianPattern &aPattern, UBLAS::matrix<FTYPE,MTRAIT> &J) {
+  if(group.size() == 1) {
+    jacol(F, x, fx, group[0], J);
+    return true;
+  }
+  const FTYPE heps = 1.0e-6;
+  const FTYPE TINY = 1.0e-6;
+  UBLAS::vector<FTYPE> xx(x);
+  UBLAS::vector<FTYPE> fxx(fx.size());
+  std::vector<FTYPE> hinv(group.size());
+  for(size_t k=0; k<group.size(); ++k) {
+    const int j = group[k];
+    FTYPE t = xx[j];
+    FTYPE h = heps * (fabs(t)+TINY);
+    xx[j] = t+h;
+    hinv[k] = 1.0/(xx[j]-t);
+  }
+
+  F.partial(group[0]);
+  F.partialGroup(xx, fxx, group);
+
+  std::vector<bool> owned(fx.size(), false);
+  for(size_t k=0; k<group.size(); ++k) {
+    const int j = group[k];
+    const std::vector<int> &rows = aPattern.getRows(j);
+    for(size_t r=0; r<rows.size(); ++r) {
+      const int i = rows[r];
+      J(i,j) = (fxx[i] - fx[i]) * hinv[k];
+      owned[i] = true;
+    }
+  }
+  for(size_t i=0; i<fxx.size(); ++i) {
+    if(!owned[i] && fxx[i] != fx[i]) {
+      for(size_t k=0; k<group.size(); ++k) {
+        jacol(F, x, fx, group[k], J);
+      }
+      return false;
+    }
+  }
+  return true;
+}
+
+
 /*!
  * Compute the Jacobian of a vector function F at point x.
  * \param[in] F: The function to have its Jacobian calculated
@@ -149,13 +604,20 @@ void fdjac(VecFVec<FTYPE,FTYPE> &F, const UBLAS::vector<FTYPE> &x,
 
   Timer& jacTimer = TimerRegistry::getInstance().getTimer( TimerRegistry::JACOBIAN );
   jacTimer.start();
-    if(usepartial) { scenario->getManageStateVariables()->setPartialDeriv(true); }
-  
 #if !GCAM_PARALLEL_ENABLED
+    if(usepartial) { scenario->getManageStateVariables()->setPartialDeriv(true); }
   for(size_t j=0; j<x.size(); ++j) {
     jacol(F, x, fx, j, J, usepartial, diagnostic);
   }
 #else
+  if(usepartial) {
+    std::vector<int> columns(x.size());
+    for(size_t j=0; j<x.size(); ++j) {
+      columns[j] = j;
+    }
+    jacols(F, x, fx, columns, J);
+  }
+  else {
     tbb::task_arena& threadPool = scenario->getManageStateVariables()->mThreadPool;
     tbb::task_group tg;
     threadPool.execute([&](){
@@ -166,6 +628,7 @@ void fdjac(VecFVec<FTYPE,FTYPE> &F, const UBLAS::vector<FTYPE> &x,
         });
     });
     threadPool.execute([&tg](){ tg.wait(); });
+  }
 #endif
     if(usepartial) { F.partial(-1); }
 
@@ -173,6 +636,125 @@ void fdjac(VecFVec<FTYPE,FTYPE> &F, const UBLAS::vector<FTYPE> &x,
 }
 
 
+/*!
+ * Recompute selected columns of the Jacobian of a vector function F at point x.
+ * \param[in] F: The function to have its Jacobian calculated
+ * \param[in] x: The point at which to calculate the Jacobian
+ * \param[in] fx: F(x)
+ * \param[in,out] J: The Jacobian of F; only the listed columns are changed
+ * \param[in] aColumns: Indices of the columns to calculate
+ * \remark Partial evaluation is always used.
+ */
+template<class FTYPE, class MTRAIT>
+void fdjac(VecFVec<FTYPE,FTYPE> &F, const UBLAS::vector<FTYPE> &x,
+           const UBLAS::vector<FTYPE> &fx, UBLAS::matrix<FTYPE,MTRAIT> &J,
+           const std::vector<int> &aColumns)
+{
+  Timer& jacTimer = TimerRegistry::getInstance().getTimer( TimerRegistry::JACOBIAN );
+  jacTimer.start();
+  jacols(F, x, fx, aColumns, J);
+  F.partial(-1);
+  jacTimer.stop();
+}
+
+
+/*!
+ * Compute the Jacobian of a vector function F at point x, evaluating
+ * structurally independent columns together.
+ * \param[in] F: The function to have its Jacobian calculated
+ * \param[in] x: The point at which to calculate the Jacobian
+ * \param[in] fx: F(x)
+ * \param[out] J: The Jacobian of F; entries outside the pattern are zero
+ * \param[in,out] aPattern: Sparsity pattern and column groups.  It is
+ *                (re)recorded from a dense Jacobian whenever it can't be used.
+ * \param[out] aCSR: (optional) receives the structural entries of J
+ * \return The number of function evaluations performed.
+ * \remark Partial evaluation is always used.
+ */
+template<class FTYPE, class MTRAIT>
+int fdjac(VecFVec<FTYPE,FTYPE> &F, const UBLAS::vector<FTYPE> &x,
+          const UBLAS::vector<FTYPE> &fx, UBLAS::matrix<FTYPE,MTRAIT> &J,
+          JacobianPattern &aPattern, CSRMatrix<FTYPE> *aCSR=NULL)
+{
+  std::vector<std::string> names(x.size());
+  for(size_t j=0; j<x.size(); ++j) {
+    names[j] = F.partialName(j);
+  }
+
+  if(!aPattern.isUsable(names)) {
+    fdjac(F, x, fx, J, true);
+    aPattern.record(F, names, J);
+    if(aCSR) {
+      aPattern.fillCSR(J, *aCSR);
+    }
+    return x.size();
+  }
+
+  Timer& jacTimer = TimerRegistry::getInstance().getTimer( TimerRegistry::JACOBIAN );
+  jacTimer.start();
+  scenario->getManageStateVariables()->setPartialDeriv(true);
+
+  J.clear();
+  const std::vector<std::vector<int> > &groups = aPattern.getGroups();
+  // one flag per group so that the parallel tasks don't share a variable
+  std::vector<char> consistent(groups.size(), true);
+#if !GCAM_PARALLEL_ENABLED
+  for(size_t g=0; g<groups.size(); ++g) {
+    consistent[g] = jacgroup(F, x, fx, groups[g], aPattern, J);
+  }
+#else
+  // Start the most expensive groups first.
+  const PartialDerivativeSchedule& schedule = PartialDerivativeSchedule::getInstance();
+  std::vector<double> cost(groups.size(), 0.0);
+  std::vector<size_t> order(groups.size());
+  for(size_t g=0; g<groups.size(); ++g) {
+    for(size_t k=0; k<groups[g].size(); ++k) {
+      cost[g] += schedule.getCost(F, groups[g][k]);
+    }
+    order[g] = g;
+  }
+  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+      return cost[a] > cost[b];
+  });
+  runInOrder(order.size(), [&](size_t k) {
+      const size_t g = order[k];
+      consistent[g] = jacgroup(F, x, fx, groups[g], aPattern, J);
+  });
+#endif
+  F.partial(-1);
+
+  int neval = groups.size();
+  for(size_t g=0; g<groups.size(); ++g) {
+    if(!consistent[g]) {
+      neval += groups[g].size();
+    }
+  }
+  if(aCSR) {
+    aPattern.fillCSR(J, *aCSR);
+  }
+  if(neval > int(groups.size())) {
+    aPattern.reset();
+  }
+
+  jacTimer.stop();
+  return neval;
+}
+
+/*!
+ * Compute the Jacobian of F at x using a sparsity pattern.  This version
+ * evaluates F(x) first; see the version above for the arguments.
+ */
+template <class FTYPE, class MTRAIT>
+int fdjac(VecFVec<FTYPE,FTYPE> &F, const UBLAS::vector<FTYPE> &x,
+          UBLAS::matrix<FTYPE,MTRAIT> &J, JacobianPattern &aPattern)
+{
+  UBLAS::vector<FTYPE> fx(F.nrtn());
+
+  F(x,fx);                      // fx = F(x)
+  return fdjac(F,x,fx,J,aPattern);
+}
+
+
 #undef UBLAS
 
 #endif
@@ -66,6 +66,14 @@ public:
     F(x,lstF);
     return inner_prod(lstF,lstF);
   }
+  virtual void partial(int ip) {F.partial(ip);}
+  virtual bool trialSupported() const {return F.trialSupported();}
+  //! lastF() is not updated by a trial evaluation
+  virtual Tr trial(const UBLAS::vector<Ta> &x) {
+    UBLAS::vector<Tr> fx(F.nrtn());
+    F.trial(x,fx);
+    return inner_prod(fx,fx);
+  }
   virtual void prn_diagnostic(std::ostream *out) {
     int ifmax=0;
     double fmax=fabs(lstF[0]);
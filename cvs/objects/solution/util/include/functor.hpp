@@ -45,6 +45,9 @@
  */
 
 #include <iostream>
+#include <string>
+#include <vector>
+#include <cassert>
 #include <boost/numeric/ublas/vector.hpp> 
 
 #define UBVECTOR boost::numeric::ublas::vector
@@ -110,6 +113,90 @@ public:
    * derivative.
    */
   virtual double partialSize(int ip) const {return 1.0;}
+  /*!
+   * Evaluate the function for several partial derivatives at once.
+   *
+   * Every element of the input vector listed in aPartials has been
+   * changed.  The caller guarantees that the partials are
+   * structurally independent -- no part of the calculation is shared
+   * between them, and no output depends on more than one of them --
+   * so a subclass may perform all of them in a single evaluation.
+   * The default implementation handles only a single partial.
+   *
+   * \param arg: argument vector
+   * \param rval: return value vector
+   * \param aPartials: indices of the elements of the input vector that have changed
+   */
+  virtual void partialGroup(const UBVECTOR<Ta> &arg, UBVECTOR<Tr> &rval, const std::vector<int> &aPartials) {
+    assert(aPartials.size() == 1);
+    (*this)(arg, rval, aPartials.front());
+  }
+  /*!
+   * Identify the parts of the calculation performed in a partial derivative evaluation
+   *
+   * Fills aDomain with implementation-defined, nonnegative ids of the
+   * pieces of the calculation that are redone when computing the
+   * partial derivative with respect to ip.  Two partials whose domains
+   * do not intersect may be grouped with partialGroup.  The default
+   * implementation leaves aDomain empty, meaning the domain is unknown
+   * and the partial can't be grouped with any other.
+   */
+  virtual void partialDomain(int ip, std::vector<int> &aDomain) const {aDomain.clear();}
+  /*!
+   * Identify the outputs that a partial derivative can change
+   *
+   * Fills aRows with the indices of the elements of the return
+   * vector that the structure of the calculation allows to change
+   * when element ip of the input vector changes.  The list need not
+   * be complete; callers combine it with the outputs they observed
+   * changing.  The default implementation leaves aRows empty.
+   */
+  virtual void partialRows(int ip, std::vector<int> &aRows) const {aRows.clear();}
+  /*!
+   * Returns a name for element ip of the input vector.  This allows
+   * callers to recognize when information saved from a previous
+   * function (such as a Jacobian sparsity pattern) still applies.
+   */
+  virtual std::string partialName(int ip) const {return std::string();}
+  /*!
+   * Fills aScale with the factors the inputs are multiplied by to get
+   * the quantities the function works with.  Callers that save a
+   * Jacobian use these to reuse it with a differently scaled
+   * function.  The default implementation reports unscaled inputs.
+   */
+  virtual void getInputScale(UBVECTOR<Ta> &aScale) const {
+    aScale = boost::numeric::ublas::scalar_vector<Ta>(na, Ta(1));
+  }
+  /*!
+   * Fills aScale with the factors the underlying results are
+   * multiplied by to get the return vector.  The default
+   * implementation reports unscaled results.
+   */
+  virtual void getOutputScale(UBVECTOR<Tr> &aScale) const {
+    aScale = boost::numeric::ublas::scalar_vector<Tr>(nr, Tr(1));
+  }
+  /*!
+   * Returns true if trial() is supported (default is false)
+   */
+  virtual bool trialSupported() const {return false;}
+  /*!
+   * Evaluate the function at a trial point without disturbing the
+   * results of the last normal evaluation.
+   *
+   * Subclasses that return true from trialSupported() must allow
+   * several trial evaluations to run concurrently, each in a thread
+   * that has been prepared for partial derivative evaluations.  The
+   * default implementation just calls the paren operator.
+   */
+  virtual void trial(const UBVECTOR<Ta> &arg, UBVECTOR<Tr> &rval) {(*this)(arg, rval);}
+  /*!
+   * Request that subsequent partial derivatives parallelize their own
+   * evaluation (aNested = true) or run serially (aNested = false).
+   * Nested partials are evaluated one at a time by the caller, which
+   * must have prepared the shared partial derivative state.  Returns
+   * false if nesting is not supported (the default).
+   */
+  virtual bool nestedPartials(bool aNested) {return false;}
   /*!
    * Turns on implementation-defined diagnostics (default is no-op)
    */
@@ -154,6 +241,12 @@ public:
    * Returns the length of the argument vector required by the function
    */
   int narg() const {return na;}
+  //! Partial derivative hint; see VecFVec::partial (default is no-op)
+  virtual void partial(int ip) {}
+  //! Returns true if trial() is supported; see VecFVec::trialSupported
+  virtual bool trialSupported() const {return false;}
+  //! Evaluate at a trial point; see VecFVec::trial
+  virtual Tr trial(const UBVECTOR<Ta> &arg) {return (*this)(arg);}
   //! diagnostic output does nothing by default
   virtual void prn_diagnostic(std::ostream *out) {}
 };
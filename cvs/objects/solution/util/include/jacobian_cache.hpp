@@ -0,0 +1,135 @@
+#ifndef JACOBIAN_CACHE_HPP_
+#define JACOBIAN_CACHE_HPP_
+
+
+/*
+* LEGAL NOTICE
+* This computer software was prepared by Battelle Memorial Institute,
+* hereinafter the Contractor, under Contract No. DE-AC05-76RL0 1830
+* with the Department of Energy (DOE). NEITHER THE GOVERNMENT NOR THE
+* CONTRACTOR MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR ASSUMES ANY
+* LIABILITY FOR THE USE OF THIS SOFTWARE. This notice including this
+* sentence must appear on any copies of this computer software.
+* 
+* EXPORT CONTROL
+* User agrees that the Software will not be shipped, transferred or
+* exported into any country or used in any manner prohibited by the
+* United States Export Administration Act or any other applicable
+* export laws, restrictions or regulations (collectively the "Export Laws").
+* Export of the Software may require some form of license or other
+* authority from the U.S. Government, and failure to obtain such
+* export control license may result in criminal liability under
+* U.S. laws. In addition, if the Software is identified as export controlled
+* items under the Export Laws, User represents and warrants that User
+* is not a citizen, or otherwise located within, an embargoed nation
+* (including without limitation Iran, Syria, Sudan, Cuba, and North Korea)
+*     and that User is not otherwise prohibited
+* under the Export Laws from receiving the Software.
+* 
+* Copyright 2011 Battelle Memorial Institute.  All Rights Reserved.
+* Distributed as open-source under the terms of the Educational Community 
+* License version 2.0 (ECL 2.0). http://www.opensource.org/licenses/ecl2.php
+* 
+* For further details, see: http://www.globalchange.umd.edu/models/gcam/
+*
+*/
+
+
+/*!
+ * \file jacobian_cache.hpp
+ * \ingroup Solution
+ * \brief Storage for Jacobians so that they can be reused by later solver
+ *        components and periods.
+ */
+
+#include <map>
+#include <vector>
+#include <iosfwd>
+#include <boost/shared_ptr.hpp>
+#include <boost/numeric/ublas/vector.hpp>
+#include <boost/numeric/ublas/matrix.hpp>
+
+#define UBVECTOR boost::numeric::ublas::vector<double>
+#define UBMATRIX boost::numeric::ublas::matrix<double>
+
+/*!
+ * \class JacobianCache "solution/util/include/jacobian_cache.hpp"
+ * \brief Jacobian columns saved by market id.
+ * \details Columns are identified by the serial number of the market whose
+ *          price was perturbed (see SolutionInfoSet::getMarketIDs) and rows by
+ *          the serial number of the market whose excess demand responded, so
+ *          the entries can be reused by any solver component in any period
+ *          whose markets overlap with the ones that were stored.
+ *
+ *          A solver's Jacobian is in the units of its scaled inputs and
+ *          outputs (see LogEDFun), and the scales follow each period's
+ *          forecast prices and demands.  The entries are therefore stored
+ *          unscaled and put in the caller's units when they are retrieved.
+ *          Derivatives with respect to price and to log price are kept apart.
+ *
+ *          A column is recalculated rather than reused when:
+ *          - it has not been stored, or was stored for only some of the
+ *            rows now being solved,
+ *          - its last finite-difference calculation was more than a given
+ *            number of periods ago, or
+ *          - it was marked stale, for instance because the solver that
+ *            last used it failed.
+ *          Columns that are reused keep the Broyden updates made to them
+ *          while they were in use.
+ */
+class JacobianCache {
+public:
+  JacobianCache();
+
+  void retrieve(const std::vector<int> &aMarketIDs, const bool aLogPrice, const UBVECTOR &aXScale,
+                const UBVECTOR &aFXScale, const int aPeriod, const int aMaxAge,
+                UBMATRIX &aJ, std::vector<int> &aRecalc);
+  void store(const std::vector<int> &aMarketIDs, const bool aLogPrice, const UBVECTOR &aXScale,
+             const UBVECTOR &aFXScale, const int aPeriod, const UBMATRIX &aJ,
+             const std::vector<bool> &aCalculated);
+  void markStale(const std::vector<int> &aMarketIDs, const bool aLogPrice);
+  void clear();
+
+  static void findStaleColumns(const UBMATRIX &aB, const UBVECTOR &aStep, const UBVECTOR &aFStep,
+                               const double aTolerance, std::vector<int> &aStale);
+
+  void countStaleRefresh(const int aNumColumns);
+  void countFullRefresh();
+  void printCounters(std::ostream &aOut) const;
+
+private:
+  //! A stored column
+  struct Column {
+    //! Nonzero unscaled entries as (row market id, value)
+    std::vector<std::pair<int, double> > mEntries;
+    //! Sorted ids of the rows that were calculated, shared by the columns stored together
+    boost::shared_ptr<const std::vector<int> > mRows;
+    //! Period of the last finite-difference calculation of the column
+    int mPeriod;
+    //! Whether the column must be recalculated before it is used again
+    bool mStale;
+  };
+
+  //! Whether the columns are with respect to log price, and the market id
+  typedef std::pair<bool, int> ColumnKey;
+
+  //! Stored columns by price type and market id
+  std::map<ColumnKey, Column> mColumns;
+
+  //! Columns supplied by retrieve
+  int mNumReused;
+
+  //! Columns that retrieve asked to be recalculated
+  int mNumRecalc;
+
+  //! Columns recalculated because findStaleColumns reported them
+  int mNumStaleRefresh;
+
+  //! Complete finite-difference Jacobians calculated instead of using the cache
+  int mNumFullRefresh;
+};
+
+#undef UBVECTOR
+#undef UBMATRIX
+
+#endif // JACOBIAN_CACHE_HPP_
@@ -0,0 +1,199 @@
+#ifndef LINEAR_SOLVER_HPP_
+#define LINEAR_SOLVER_HPP_
+
+
+/*
+* LEGAL NOTICE
+* This computer software was prepared by Battelle Memorial Institute,
+* hereinafter the Contractor, under Contract No. DE-AC05-76RL0 1830
+* with the Department of Energy (DOE). NEITHER THE GOVERNMENT NOR THE
+* CONTRACTOR MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR ASSUMES ANY
+* LIABILITY FOR THE USE OF THIS SOFTWARE. This notice including this
+* sentence must appear on any copies of this computer software.
+* 
+* EXPORT CONTROL
+* User agrees that the Software will not be shipped, transferred or
+* exported into any country or used in any manner prohibited by the
+* United States Export Administration Act or any other applicable
+* export laws, restrictions or regulations (collectively the "Export Laws").
+* Export of the Software may require some form of license or other
+* authority from the U.S. Government, and failure to obtain such
+* export control license may result in criminal liability under
+* U.S. laws. In addition, if the Software is identified as export controlled
+* items under the Export Laws, User represents and warrants that User
+* is not a citizen, or otherwise located within, an embargoed nation
+* (including without limitation Iran, Syria, Sudan, Cuba, and North Korea)
+*     and that User is not otherwise prohibited
+* under the Export Laws from receiving the Software.
+* 
+* Copyright 2011 Battelle Memorial Institute.  All Rights Reserved.
+* Distributed as open-source under the terms of the Educational Community 
+* License version 2.0 (ECL 2.0). http://www.opensource.org/licenses/ecl2.php
+* 
+* For further details, see: http://www.globalchange.umd.edu/models/gcam/
+*
+*/
+
+
+/*!
+ * \file linear_solver.hpp
+ * \ingroup Solution
+ * \brief Solvers for the linear systems J . dx = -F that arise in the
+ *        Newton-type solver components.
+ */
+
+#include <string>
+#include <vector>
+#include <boost/numeric/ublas/vector.hpp>
+#include <boost/numeric/ublas/matrix.hpp>
+#include "solution/util/include/csr_matrix.hpp"
+
+#define UBVECTOR boost::numeric::ublas::vector<double>
+
+/*!
+ * \class LinearSolver "solution/util/include/linear_solver.hpp"
+ * \brief Base class for factor-and-solve backends.
+ * \details A backend is given a Jacobian in sparse form, factors it once, and
+ *          can then solve any number of systems with it.  Broyden-style rank-1
+ *          updates J' = J + u v^T are folded into the existing factorization
+ *          with the Sherman-Morrison formula, so a new factorization is needed
+ *          only after a fresh Jacobian or after MAX_UPDATES updates.
+ *
+ *          The backends are selected by name (see create()):
+ *          - dense-lu:  LU decomposition of the dense matrix with partial pivoting.
+ *          - sparse-lu: Left-looking sparse LU with threshold partial pivoting
+ *                       that prefers the diagonal.
+ *          - gmres:     Restarted GMRES preconditioned with ILU(0).  If it fails
+ *                       to converge the system is solved with a dense LU instead.
+ */
+class LinearSolver {
+public:
+  static LinearSolver* create(const std::string &aName);
+  virtual ~LinearSolver() {}
+
+  //! Name of the backend as used in the solver configuration
+  virtual const std::string& getName() const = 0;
+
+  int factor(const CSRMatrix<double> &aJ);
+  bool solve(UBVECTOR &aRHS) const;
+  bool update(const UBVECTOR &aU, const UBVECTOR &aV);
+
+  //! Number of rank-1 updates applied since the last factorization
+  int getNumUpdates() const {return mUpdateBeta.size();}
+
+  //! Maximum number of rank-1 updates kept before a refactorization is required
+  static const int MAX_UPDATES;
+
+protected:
+  /*!
+   * \brief Factor aJ.
+   * \return 0 on success, or k+1 if the factorization broke down at column k.
+   */
+  virtual int factorBase(const CSRMatrix<double> &aJ) = 0;
+  /*!
+   * \brief Solve the factored system in place.
+   * \return Whether the solve succeeded.
+   */
+  virtual bool solveBase(UBVECTOR &aRHS) const = 0;
+
+private:
+  //! J^-1 u for each update, computed with the updates that preceded it
+  std::vector<UBVECTOR> mUpdateJinvU;
+  //! v for each update
+  std::vector<UBVECTOR> mUpdateV;
+  //! 1 + v^T J^-1 u for each update
+  std::vector<double> mUpdateBeta;
+};
+
+/*!
+ * \brief LU decomposition of the dense matrix.
+ */
+class DenseLUSolver : public LinearSolver {
+public:
+  static const std::string& getNameStatic();
+  virtual const std::string& getName() const {return getNameStatic();}
+protected:
+  virtual int factorBase(const CSRMatrix<double> &aJ);
+  virtual bool solveBase(UBVECTOR &aRHS) const;
+private:
+  //! L and U factors
+  boost::numeric::ublas::matrix<double> mLU;
+  //! Row permutation
+  std::vector<size_t> mPermutation;
+};
+
+/*!
+ * \brief Left-looking sparse LU factorization.
+ * \details Follows Gilbert & Peierls: each column of L and U is found with a
+ *          sparse triangular solve whose nonzero pattern is computed by a
+ *          depth-first search of the columns of L already computed.  Rows are
+ *          pivoted for stability, taking the diagonal whenever it is within
+ *          PIVOT_TOLERANCE of the largest candidate.  Columns are ordered
+ *          beforehand by minimum degree on the pattern of J + J^T to limit
+ *          fill-in, and the diagonal preference follows that ordering.
+ */
+class SparseLUSolver : public LinearSolver {
+public:
+  static const std::string& getNameStatic();
+  virtual const std::string& getName() const {return getNameStatic();}
+  //! Number of nonzeros in L and U from the last factorization
+  int getFactorSize() const {return mLValue.size() + mUValue.size();}
+protected:
+  virtual int factorBase(const CSRMatrix<double> &aJ);
+  virtual bool solveBase(UBVECTOR &aRHS) const;
+private:
+  static void minimumDegreeOrder(const CSRMatrix<double> &aJ, std::vector<int> &aOrder);
+
+  static const double PIVOT_TOLERANCE;
+  //! Size of the factored matrix, or 0 if the factorization failed
+  int mSize;
+  //! Unit lower-triangular factor by column; the diagonal is stored first
+  std::vector<int> mLStart, mLRow;
+  std::vector<double> mLValue;
+  //! Upper-triangular factor by column; the diagonal is stored last
+  std::vector<int> mUStart, mURow;
+  std::vector<double> mUValue;
+  //! Pivot position of each row of the original matrix
+  std::vector<int> mRowPivot;
+  //! Original column factored at each position
+  std::vector<int> mColumnOrder;
+};
+
+/*!
+ * \brief Restarted GMRES with an ILU(0) preconditioner.
+ */
+class GMRESSolver : public LinearSolver {
+public:
+  GMRESSolver();
+  static const std::string& getNameStatic();
+  virtual const std::string& getName() const {return getNameStatic();}
+protected:
+  virtual int factorBase(const CSRMatrix<double> &aJ);
+  virtual bool solveBase(UBVECTOR &aRHS) const;
+private:
+  void precondition(UBVECTOR &aVec) const;
+  void multiply(const UBVECTOR &aVec, UBVECTOR &aResult) const;
+
+  //! Restart length
+  static const int RESTART;
+  //! Maximum total number of iterations
+  static const int MAX_ITERATIONS;
+  //! Convergence tolerance relative to the norm of the right-hand side
+  static const double TOLERANCE;
+
+  //! The matrix
+  CSRMatrix<double> mMatrix;
+  //! ILU(0) factors, in the sparsity pattern of mMatrix
+  std::vector<double> mILU;
+  //! Position of the diagonal in each row of mMatrix
+  std::vector<int> mDiagonal;
+  //! Whether mILU could be computed
+  bool mHasPreconditioner;
+  //! Dense solver used when GMRES fails to converge; factored on first use
+  mutable DenseLUSolver mFallback;
+  mutable bool mFallbackFactored;
+};
+
+#undef UBVECTOR
+
+#endif // LINEAR_SOLVER_HPP_
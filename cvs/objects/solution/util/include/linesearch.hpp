@@ -47,10 +47,68 @@
 #include "functor.hpp"
 #include <boost/numeric/ublas/vector.hpp>
 #include <algorithm>
+#include <cmath>
+#include <cstdlib>
 #include <iostream>
+#include <vector>
 
 #define UBLAS boost::numeric::ublas
 
+#if GCAM_PARALLEL_ENABLED
+#include <tbb/task_group.h>
+#include <tbb/parallel_for.h>
+
+#include "containers/include/scenario.h"
+#include "util/base/include/manage_state_variables.hpp"
+
+extern Scenario* scenario;
+#endif
+
+/*!
+ * Minimum admissable step length for a line search.  When lambda gets
+ * this small, even the fastest changing x is changing by less than TOLX.
+ */
+template <class FTYPE>
+FTYPE linesearch_lmin(const UBLAS::vector<FTYPE> &x0, const UBLAS::vector<FTYPE> &dx)
+{
+  const FTYPE TOLX = 1.0e-6;    // tolerance for x values
+  // NB: This value of TOLX is way too small for single-precision,
+  // but we're running GCAM in double precision anyhow, and the small
+  // tolerance seems to be necessary for solving global unconventional
+  // oil, which has a nasty step function in its demand.  If we ever
+  // contemplate using this function in a single-precision
+  // application, we are going to have to adjust this tolerance.
+  FTYPE maxval = 0.0;
+  for(size_t i=0; i<x0.size(); ++i) {
+    FTYPE tmp = fabs(dx[i] / (x0[i] + TOLX)); // fractional change in ith component of x over a unit step
+    maxval = std::max(tmp,maxval);          // pick the largest
+  }
+  return TOLX / maxval;
+}
+
+/*!
+ * Next step length to try after the step lambda, which gave f = fx, was rejected.
+ */
+template <class FTYPE>
+FTYPE linesearch_backtrack(FTYPE lambda, FTYPE fx, FTYPE f0, FTYPE g0dx)
+{
+  FTYPE tl0 = 0.1*lambda; // never decrease lambda by more than a factor of 10
+  FTYPE tl1 = 0.5*lambda; // always decrease lambda by at least half
+  // We fit a quadratic approximation to f(lambda) using the values
+  // we've computed already, and we try the minimum of the quadratic
+  // as our next lambda (subject to the constraints above).  NR
+  // suggests that on iterations after the first we fit a cubic, but
+  // it's not clear that that buys us a whole lot, so we'll try just
+  // using the quadratic every time for now.
+  FTYPE denom = fx - f0 - g0dx*lambda;
+  if(denom != 0.0)
+    lambda = -g0dx * (lambda*lambda)/(2.0 * denom);
+  else
+    lambda = 0.5*lambda;
+
+  return std::max(tl0, std::min(tl1,lambda));
+}
+
 /*!
  * Perform a line search for use in multidimensional root finders.  This is NOT a 1-D
  * minimization routine!
@@ -76,17 +134,8 @@ int linesearch(SclFVec<FTYPE,FTYPE> &f, const UBLAS::vector<FTYPE> &x0,
                FTYPE &fx, int &neval, std::ostream *solverlog = 0)
 {
   const FTYPE lseps = 1.0e-7;   // part of the definition of "sufficient" decrease
-  const FTYPE TOLX = 1.0e-6;    // tolerance for x values
-  // NB: This value of TOLX is way too small for single-precision,
-  // but we're running GCAM in double precision anyhow, and the small
-  // tolerance seems to be necessary for solving global unconventional
-  // oil, which has a nasty step function in its demand.  If we ever
-  // contemplate using this function in a single-precision
-  // application, we are going to have to adjust this tolerance.
-  int n = x0.size();
   FTYPE g0dx=inner_prod(g0,dx); // initial rate of decrease, df/dlambda
   FTYPE lambda = 1.0;           // start with full step
-  FTYPE maxval = 0.0;
 
   if(g0dx >= 0) {
     if(solverlog)
@@ -98,13 +147,7 @@ int linesearch(SclFVec<FTYPE,FTYPE> &f, const UBLAS::vector<FTYPE> &x0,
   }
   
   // set lmin (minimum admissable value for lambda)
-  for(int i=0; i<n; ++i) {
-    FTYPE tmp = fabs(dx[i] / (x0[i] + TOLX)); // fractional change in ith component of x over a unit step
-    maxval = std::max(tmp,maxval);          // pick the largest
-  }
-  FTYPE lmin = TOLX / maxval;     // when lambda gets this small, even
-                                // the fastest changing x is changing
-                                // by less than TOLX
+  FTYPE lmin = linesearch_lmin(x0, dx);
 
   if(solverlog)
     (*solverlog) << "Beginning linesearch: lmin = " << lmin << "  f0 = " << f0 << "\n";
@@ -131,21 +174,7 @@ int linesearch(SclFVec<FTYPE,FTYPE> &f, const UBLAS::vector<FTYPE> &x0,
       return 0;
 
     // last step increased or decreased too slowly --- backtrack
-    FTYPE tl0 = 0.1*lambda; // never decrease lambda by more than a factor of 10
-    FTYPE tl1 = 0.5*lambda; // always decrease lambda by at least half
-    // We fit a quadratic approximation to f(lambda) using the values
-    // we've computed already, and we try the minimum of the quadratic
-    // as our next lambda (subject to the constraints above).  NR
-    // suggests that on iterations after the first we fit a cubic, but
-    // it's not clear that that buys us a whole lot, so we'll try just
-    // using the quadratic every time for now.
-    FTYPE denom = fx - f0 - g0dx*lambda;
-    if(denom != 0.0)
-      lambda = -g0dx * (lambda*lambda)/(2.0 * denom);
-    else
-      lambda = 0.5*lambda;
-
-    lambda = std::max(tl0, std::min(tl1,lambda));
+    lambda = linesearch_backtrack(lambda, fx, f0, g0dx);
   }
   
   // If we get here, then the line search failed.  Depending on the
@@ -154,6 +183,143 @@ int linesearch(SclFVec<FTYPE,FTYPE> &f, const UBLAS::vector<FTYPE> &x0,
   return 1;              
 }
 
+/*!
+ * Line search that evaluates several backtracking steps at once.
+ *
+ * The full step is tried first, just as in linesearch(), since it is
+ * usually accepted.  If it is rejected, the next ncand step lengths
+ * (the quadratic backtrack, then successive halvings of it) are
+ * evaluated concurrently with SclFVec::trial, each in its own partial
+ * derivative scratch state.  Of the candidates that give a sufficient
+ * decrease the one with the smallest f is chosen, and it is evaluated
+ * once more normally so that the state left behind in f corresponds
+ * to the returned x.  The sufficient decrease test is repeated on that
+ * value, and if it fails the next best candidate is tried.  If no
+ * candidate qualifies, the search backtracks from the smallest one.
+ *
+ * Falls back to linesearch() if f does not support trial evaluations
+ * or the model was not built with parallel support.
+ * \param[in] ncand: number of step lengths to evaluate at once; if
+ *                   nonpositive, use one per thread.
+ * \remark The other parameters and the return value are the same as
+ *         for linesearch().
+ */
+template <class FTYPE>
+int parallel_linesearch(SclFVec<FTYPE,FTYPE> &f, const UBLAS::vector<FTYPE> &x0,
+                        FTYPE f0, const UBLAS::vector<FTYPE> &g0,
+                        const UBLAS::vector<FTYPE> &dx, UBLAS::vector<FTYPE> &x,
+                        FTYPE &fx, int &neval, int ncand, std::ostream *solverlog = 0)
+{
+#if !GCAM_PARALLEL_ENABLED
+  return linesearch(f, x0, f0, g0, dx, x, fx, neval, solverlog);
+#else
+  tbb::task_arena& threadPool = scenario->getManageStateVariables()->mThreadPool;
+  if(ncand <= 0)
+    ncand = threadPool.max_concurrency();
+  if(!f.trialSupported() || ncand < 2)
+    return linesearch(f, x0, f0, g0, dx, x, fx, neval, solverlog);
+
+  const FTYPE lseps = 1.0e-7;   // part of the definition of "sufficient" decrease
+  FTYPE g0dx=inner_prod(g0,dx); // initial rate of decrease, df/dlambda
+  FTYPE lambda = 1.0;           // start with full step
+
+  if(g0dx >= 0) {
+    if(solverlog)
+      (*solverlog) << "Linesearch aborted.  Not an initial descent direction.  g0dx= "
+                   << g0dx << "\n";
+    return 1;
+  }
+
+  FTYPE lmin = linesearch_lmin(x0, dx);
+
+  if(solverlog)
+    (*solverlog) << "Beginning parallel linesearch: lmin = " << lmin << "  f0 = " << f0
+                 << "  candidates = " << ncand << "\n";
+
+  x  = x0 + lambda*dx;
+  fx = f(x);
+  neval++;
+  if(solverlog)
+    (*solverlog) << "\tlambda = " << lambda << "  fx = " << fx << std::endl;
+  if(fx <= f0 + lseps*lambda*g0dx)
+    return 0;
+  lambda = linesearch_backtrack(lambda, fx, f0, g0dx);
+
+  std::vector<FTYPE> lambdas;
+  std::vector<FTYPE> ftrial;
+  while(lambda > lmin) {
+    lambdas.clear();
+    for(FTYPE l = lambda; l > lmin && int(lambdas.size()) < ncand; l *= 0.5)
+      lambdas.push_back(l);
+    ftrial.assign(lambdas.size(), 0.0);
+
+    scenario->getManageStateVariables()->setPartialDeriv(true);
+    tbb::task_group tg;
+    threadPool.execute([&](){
+        tg.run([&](){
+            tbb::parallel_for( size_t(0), lambdas.size(), [&]( size_t k ) {
+                UBLAS::vector<FTYPE> xk(x0 + lambdas[k]*dx);
+                ftrial[k] = f.trial(xk);
+            });
+        });
+    });
+    threadPool.execute([&tg](){ tg.wait(); });
+    f.partial(-1);
+    neval += lambdas.size();
+#if DEBUG_STATE
+    // Each trial must give the same result as a normal evaluation at
+    // the same point; a difference means some state was shared between
+    // the trials and the base state.
+    for(size_t k=0; k<lambdas.size(); ++k) {
+      UBLAS::vector<FTYPE> xk(x0 + lambdas[k]*dx);
+      const FTYPE fk = f(xk);
+      if(std::fabs(fk - ftrial[k]) > 1.0e-10 * std::max(FTYPE(1), std::fabs(fk))) {
+        std::cout << "Trial evaluation at lambda = " << lambdas[k] << " gave " << ftrial[k]
+                  << " but a normal evaluation gave " << fk << std::endl;
+        abort();
+      }
+    }
+#endif
+
+    std::vector<size_t> passed;
+    for(size_t k=0; k<lambdas.size(); ++k) {
+      if(solverlog)
+        (*solverlog) << "\tlambda = " << lambdas[k] << "  fx = " << ftrial[k] << " (trial)\n";
+      if(ftrial[k] <= f0 + lseps*lambdas[k]*g0dx)
+        passed.push_back(k);
+    }
+    std::stable_sort(passed.begin(), passed.end(),
+                     [&ftrial](size_t a, size_t b) {return ftrial[a] < ftrial[b];});
+
+    for(size_t c=0; c<passed.size(); ++c) {
+      // Redo the evaluation so that the model is left at x, and make
+      // sure the step still qualifies.
+      const size_t k = passed[c];
+      x  = x0 + lambdas[k]*dx;
+      fx = f(x);
+      neval++;
+      if(fx <= f0 + lseps*lambdas[k]*g0dx) {
+        // SUCCESS
+        if(solverlog)
+          (*solverlog) << "\taccepted lambda = " << lambdas[k] << "  fx = " << fx << std::endl;
+        return 0;
+      }
+      if(solverlog)
+        (*solverlog) << "\trejected lambda = " << lambdas[k] << "  fx = " << fx
+                     << " differs from trial fx = " << ftrial[k] << std::endl;
+      ftrial[k] = fx;
+    }
+
+    lambda = linesearch_backtrack(lambdas.back(), ftrial.back(), f0, g0dx);
+  }
+
+  // the model was last evaluated normally at one of the rejected
+  // steps, as it would be after a failed linesearch() that the caller
+  // has to recover from.
+  return 1;
+#endif
+}
+
 #undef UBLAS
 
 #endif
@@ -38,6 +38,8 @@
 #include "solution/util/include/edfun.hpp"
 #include "util/base/include/fltcmp.hpp"
 #include "containers/include/iactivity.h"
+#include "containers/include/market_dependency_finder.h"
+#include "marketplace/include/market.h"
 #include "util/base/include/util.h"
 #include "util/logger/include/ilogger.h"
 #include "containers/include/scenario.h"
@@ -60,6 +62,7 @@ LogEDFun::LogEDFun(SolutionInfoSet &sisin,
     solnset(sisin),
     world(w), mktplc(m), period(per),
     mLogPricep(aLogPricep),
+    mNestedPartials(false),
     slope(mkts.size(), 1.0)
 {
     na=nr=mkts.size();
@@ -185,6 +188,145 @@ void LogEDFun::setSlope(UBVECTOR<double>& adx) {
 }
 
 void LogEDFun::operator()(const UBVECTOR<double> &ax, UBVECTOR<double> &fx, const int partj)
+{
+  if(partj < 0) {
+    evaluate(ax, fx, 0, 0, false);
+  }
+  else {
+    evaluate(ax, fx, &partj, 1, false);
+  }
+}
+
+/*!
+ * \brief Evaluate a group of structurally independent partial derivatives in a single model calculation.
+ * \details The dependencies of the markets in aPartials must be disjoint (see
+ *          partialDomain) so that each affected activity sees exactly one
+ *          perturbed price.  Because the dependency lists are disjoint no
+ *          activity in one list reads results from an activity in another,
+ *          so the lists may simply be concatenated.
+ */
+void LogEDFun::partialGroup(const UBVECTOR<double> &ax, UBVECTOR<double> &fx, const std::vector<int> &aPartials)
+{
+  assert(!aPartials.empty());
+  evaluate(ax, fx, &aPartials[0], aPartials.size(), false);
+}
+
+/*!
+ * \brief Fill in the ids of the activities recalculated for partial derivative ip.
+ * \details Ids are assigned the first time an activity is seen, so they are only
+ *          meaningful for a single LogEDFun.
+ */
+void LogEDFun::partialDomain(int ip, std::vector<int> &aDomain) const
+{
+  const std::vector<IActivity*>& deps = mkts[ip].getDependencies();
+  aDomain.resize(deps.size());
+  for(size_t i=0; i<deps.size(); ++i) {
+    std::map<const IActivity*, int>::const_iterator it = mActivityIds.find(deps[i]);
+    if(it == mActivityIds.end()) {
+      it = mActivityIds.insert(std::make_pair(deps[i], int(mActivityIds.size()))).first;
+    }
+    aDomain[i] = it->second;
+  }
+}
+
+/*!
+ * \brief Fill in the markets whose excess demand can change for partial derivative ip.
+ * \details These are the solvable markets that the activities recalculated for
+ *          the partial add supply or demand to or set the price of, as found by
+ *          the market dependency finder.  Markets an activity adds to without
+ *          having registered a dependency on them, such as policy markets, are
+ *          not included.
+ */
+void LogEDFun::partialRows(int ip, std::vector<int> &aRows) const
+{
+  if(mPartialRows.empty()) {
+    std::map<int, int> rowOfMarket;
+    for(size_t i=0; i<mkts.size(); ++i) {
+      rowOfMarket[mkts[i].getSerialNumber()] = i;
+    }
+    std::map<const IActivity*, std::set<const Market*> > activityMarkets;
+    mktplc->getDependencyFinder()->getActivityMarkets(period, activityMarkets);
+
+    mPartialRows.resize(mkts.size());
+    for(size_t j=0; j<mkts.size(); ++j) {
+      std::set<int> rows;
+      const std::vector<IActivity*>& deps = mkts[j].getDependencies();
+      for(size_t k=0; k<deps.size(); ++k) {
+        std::map<const IActivity*, std::set<const Market*> >::const_iterator markets =
+          activityMarkets.find(deps[k]);
+        if(markets == activityMarkets.end()) {
+          continue;
+        }
+        for(std::set<const Market*>::const_iterator mkt = markets->second.begin();
+            mkt != markets->second.end(); ++mkt) {
+          std::map<int, int>::const_iterator row = rowOfMarket.find((*mkt)->getSerialNumber());
+          if(row != rowOfMarket.end()) {
+            rows.insert(row->second);
+          }
+        }
+      }
+      mPartialRows[j].assign(rows.begin(), rows.end());
+    }
+  }
+  aRows = mPartialRows[ip];
+}
+
+std::string LogEDFun::partialName(int ip) const
+{
+  return mkts[ip].getName();
+}
+
+bool LogEDFun::trialSupported() const
+{
+  return true;
+}
+
+/*!
+ * \brief Evaluate the model at a trial point in the calling thread's scratch state.
+ * \details Every solvable price may differ from the base state, so this
+ *          is a partial derivative calculation that perturbs all of the
+ *          markets and recalculates the entire model.  The base state is
+ *          left untouched, which allows several trial points to be
+ *          evaluated concurrently.  The caller must have switched on partial
+ *          derivative state before calling this and must call partial(-1)
+ *          once all the trials are done.
+ */
+void LogEDFun::trial(const UBVECTOR<double> &ax, UBVECTOR<double> &fx)
+{
+  scenario->mManageStateVars->copyState();
+  evaluate(ax, fx, 0, 0, true);
+}
+
+/*!
+ * \brief Switch partial derivatives between serial and flow graph evaluation.
+ * \details Nested partials calculate their affected activities with the
+ *          global flow graph.  They all share one scratch state so the
+ *          markets must lock their supplies and demands as usual.
+ * \param aNested Whether partial derivatives should be nested.
+ * \return Whether nesting is available, which requires a parallel build.
+ */
+bool LogEDFun::nestedPartials(bool aNested)
+{
+#if GCAM_PARALLEL_ENABLED
+  mNestedPartials = aNested;
+  mktplc->mIsSharedDerivativeCalc = aNested;
+  return true;
+#else
+  return false;
+#endif
+}
+
+/*!
+ * \brief Evaluate the model and collect the excess demands.
+ * \param ax Scaled inputs.
+ * \param fx Scaled outputs.
+ * \param aPartials Indices of the markets being perturbed for a partial
+ *        derivative calculation, or null for a full evaluation.
+ * \param aNumPartials Number of entries in aPartials.
+ * \param aIsTrial Whether this is a trial point evaluation (see trial).
+ */
+void LogEDFun::evaluate(const UBVECTOR<double> &ax, UBVECTOR<double> &fx, const int* aPartials,
+                        const size_t aNumPartials, const bool aIsTrial)
 {
   assert(ax.size() == mkts.size());
   assert(fx.size() == mkts.size());
@@ -210,7 +352,7 @@ void LogEDFun::operator()(const UBVECTOR<double> &ax, UBVECTOR<double> &fx, cons
    **** point.
    ****/
   
-  if(partj < 0) {               // not a partial derivative calculation
+  if(aNumPartials == 0 && !aIsTrial) { // not a partial derivative calculation
     /****
      * 1A Set the model inputs using the solutionInfo objects (full eval version)
      ****/
@@ -264,14 +406,17 @@ void LogEDFun::operator()(const UBVECTOR<double> &ax, UBVECTOR<double> &fx, cons
       ILogger &solverlog = ILogger::getLogger("solver_log");
       solverlog.setLevel(ILogger::DEBUG);
 
-      solverlog << "j= " << partj <<"\tprice  \tsupply \tdemand\tmarket"
-                << "old   \t" << mkts[partj].getPrice() << "\t" << mkts[partj].getSupply()
-                << "\t" << mkts[partj].getDemand()
-                << "\t" << mkts[partj].getName() << "\n";
+      for(size_t k=0; k<aNumPartials; ++k) {
+        const int partj = aPartials[k];
+        solverlog << "j= " << partj <<"\tprice  \tsupply \tdemand\tmarket"
+                  << "old   \t" << mkts[partj].getPrice() << "\t" << mkts[partj].getSupply()
+                  << "\t" << mkts[partj].getDemand()
+                  << "\t" << mkts[partj].getName() << "\n";
+      }
     }
     
     // In theory the loop over markets is unnecessary, and we need
-    // only to set mkts[partj].  We should try that sometime.
+    // only to set the perturbed markets.  We should try that sometime.
     if(mLogPricep) {            
       /***** In part 3 we make some exceptions for certain market
        ***** types.  Perhaps we should consider doing that here too.
@@ -285,37 +430,73 @@ void LogEDFun::operator()(const UBVECTOR<double> &ax, UBVECTOR<double> &fx, cons
           mkts[i].setPrice(exp(x[i])); // input vector = log(price)
       }
     }
+    else if(aIsTrial) {
+      for(size_t i=0; i<x.size(); ++i) {
+        mkts[i].setPrice(x[i]);
+      }
+    }
     else {
-        // During a partial calc only the price of the partj'th element should
+        // During a partial calc only the prices of the perturbed elements should
         // change and the rest were reset from stored values.  In theory
         // those reset prices are the same as in x however there may be some
         // slight differences due to roundoff error.
-        mkts[partj].setPrice(x[partj]);
+        for(size_t k=0; k<aNumPartials; ++k) {
+            mkts[aPartials[k]].setPrice(x[aPartials[k]]);
+        }
     }
 
     /****
      * 2B Evaluate the model (partial derivative version)
      ****/
-    const std::vector<IActivity*>& affectedNodes = mkts[partj].getDependencies();
-    /* \invariant At least one node is affected */
-    assert(!affectedNodes.empty());
     edfunMiscTimer.stop();
     edfunPreTimer.stop();
     Timer& evalPartTimer = TimerRegistry::getInstance().getTimer( TimerRegistry::EVAL_PART );
     evalPartTimer.start();
-    // Note even when running with GCAM_PARALLEL_ENABLED we still run in serial
-    // mode for partial derivatives.  This is because the loop over each partial
-    // derivative to run is a parallel_for.
-    world->calc(period, affectedNodes);
+    if(aIsTrial) {
+      // All of the prices may have changed so everything is recalculated.
+      // As with partial derivatives this runs in serial because the trial
+      // points themselves are evaluated in parallel.
+      world->calc(period);
+    }
+    else {
+      std::vector<IActivity*> groupNodes;
+      if(aNumPartials > 1) {
+        for(size_t k=0; k<aNumPartials; ++k) {
+          const std::vector<IActivity*>& deps = mkts[aPartials[k]].getDependencies();
+          groupNodes.insert(groupNodes.end(), deps.begin(), deps.end());
+        }
+      }
+      const std::vector<IActivity*>& affectedNodes = aNumPartials > 1 ? groupNodes :
+          mkts[aPartials[0]].getDependencies();
+      /* \invariant At least one node is affected */
+      assert(!affectedNodes.empty());
+      // Note even when running with GCAM_PARALLEL_ENABLED we usually run in serial
+      // mode for partial derivatives.  This is because the loop over each partial
+      // derivative to run is a parallel_for.  Large partials which are evaluated
+      // one at a time may instead be nested and use the flow graph.
+#if GCAM_PARALLEL_ENABLED
+      if(mNestedPartials) {
+        world->calc(period, 0, &affectedNodes);
+      }
+      else {
+        world->calc(period, affectedNodes);
+      }
+#else
+      world->calc(period, affectedNodes);
+#endif
+    }
     evalPartTimer.stop();
 
     if(mdiagnostic) {
       ILogger &solverlog = ILogger::getLogger("solver_log");
       solverlog.setLevel(ILogger::DEBUG);
       
-      solverlog << "new   \t" << mkts[partj].getPrice() << "\t" << mkts[partj].getSupply()
-                << "\t" << mkts[partj].getDemand()
-                << "\t" << mkts[partj].getName() << "\n";
+      for(size_t k=0; k<aNumPartials; ++k) {
+        const int partj = aPartials[k];
+        solverlog << "new   \t" << mkts[partj].getPrice() << "\t" << mkts[partj].getSupply()
+                  << "\t" << mkts[partj].getDemand()
+                  << "\t" << mkts[partj].getName() << "\n";
+      }
     }
   }
 
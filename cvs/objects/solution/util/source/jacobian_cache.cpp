@@ -0,0 +1,280 @@
+
+/*
+* LEGAL NOTICE
+* This computer software was prepared by Battelle Memorial Institute,
+* hereinafter the Contractor, under Contract No. DE-AC05-76RL0 1830
+* with the Department of Energy (DOE). NEITHER THE GOVERNMENT NOR THE
+* CONTRACTOR MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR ASSUMES ANY
+* LIABILITY FOR THE USE OF THIS SOFTWARE. This notice including this
+* sentence must appear on any copies of this computer software.
+* 
+* EXPORT CONTROL
+* User agrees that the Software will not be shipped, transferred or
+* exported into any country or used in any manner prohibited by the
+* United States Export Administration Act or any other applicable
+* export laws, restrictions or regulations (collectively the "Export Laws").
+* Export of the Software may require some form of license or other
+* authority from the U.S. Government, and failure to obtain such
+* export control license may result in criminal liability under
+* U.S. laws. In addition, if the Software is identified as export controlled
+* items under the Export Laws, User represents and warrants that User
+* is not a citizen, or otherwise located within, an embargoed nation
+* (including without limitation Iran, Syria, Sudan, Cuba, and North Korea)
+*     and that User is not otherwise prohibited
+* under the Export Laws from receiving the Software.
+* 
+* Copyright 2011 Battelle Memorial Institute.  All Rights Reserved.
+* Distributed as open-source under the terms of the Educational Community 
+* License version 2.0 (ECL 2.0). http://www.opensource.org/licenses/ecl2.php
+* 
+* For further details, see: http://www.globalchange.umd.edu/models/gcam/
+*
+*/
+
+/*!
+ * \file jacobian_cache.cpp
+ * \ingroup Solution
+ * \brief Implementation of the JacobianCache.
+ */
+
+#include <cmath>
+#include <algorithm>
+#include <iostream>
+
+#include "solution/util/include/jacobian_cache.hpp"
+
+#define UBVECTOR boost::numeric::ublas::vector<double>
+#define UBMATRIX boost::numeric::ublas::matrix<double>
+
+namespace {
+  //! Entries smaller than this fraction of the largest in their column are not stored
+  const double DROP_TOLERANCE = 1.0e-12;
+
+  //! Fraction of the columns above which retrieve gives up on the cache
+  const double MAX_RECALC_FRACTION = 0.5;
+}
+
+JacobianCache::JacobianCache():
+    mNumReused( 0 ),
+    mNumRecalc( 0 ),
+    mNumStaleRefresh( 0 ),
+    mNumFullRefresh( 0 )
+{
+}
+
+/*!
+ * \brief Fill in a Jacobian from the cache.
+ * \details Entries of aJ for columns that can't be reused are left at zero,
+ *          and the indices of those columns are returned in aRecalc so that
+ *          the caller can calculate them.  If more than half of the columns
+ *          would need to be recalculated the cache is not used at all: aJ is
+ *          left alone and aRecalc lists every column.
+ * \param aMarketIDs Market ids of the columns (and rows) of aJ.
+ * \param aLogPrice Whether the columns of aJ are with respect to log price.
+ * \param aXScale Scale of each input of aJ's function.
+ * \param aFXScale Scale of each output of aJ's function.
+ * \param aPeriod Current model period.
+ * \param aMaxAge Number of periods after which a column is recalculated;
+ *        zero allows reuse only within a period.
+ * \param aJ The Jacobian to fill; it must already be sized.
+ * \param aRecalc Indices of the columns to recalculate (output).
+ */
+void JacobianCache::retrieve(const std::vector<int> &aMarketIDs, const bool aLogPrice, const UBVECTOR &aXScale,
+                             const UBVECTOR &aFXScale, const int aPeriod, const int aMaxAge,
+                             UBMATRIX &aJ, std::vector<int> &aRecalc)
+{
+  const size_t n = aMarketIDs.size();
+  std::map<int, int> index;
+  for(size_t i=0; i<n; ++i) {
+    index[aMarketIDs[i]] = i;
+  }
+  std::vector<int> sortedIDs(aMarketIDs);
+  std::sort(sortedIDs.begin(), sortedIDs.end());
+
+  // columns stored together share their row set, so check each set only once
+  std::map<const std::vector<int>*, bool> covered;
+  std::vector<const Column*> reuse(n, static_cast<const Column*>(0));
+  aRecalc.clear();
+  for(size_t j=0; j<n; ++j) {
+    std::map<ColumnKey, Column>::const_iterator col = mColumns.find(ColumnKey(aLogPrice, aMarketIDs[j]));
+    if(col != mColumns.end() && !col->second.mStale &&
+       std::abs(aPeriod - col->second.mPeriod) <= aMaxAge)
+    {
+      const std::vector<int>* rows = col->second.mRows.get();
+      std::map<const std::vector<int>*, bool>::iterator cov = covered.find(rows);
+      if(cov == covered.end()) {
+        cov = covered.insert(std::make_pair(rows, std::includes(rows->begin(), rows->end(),
+                                                                sortedIDs.begin(), sortedIDs.end()))).first;
+      }
+      if(cov->second) {
+        reuse[j] = &col->second;
+        continue;
+      }
+    }
+    aRecalc.push_back(j);
+  }
+
+  if(aRecalc.size() > MAX_RECALC_FRACTION * n) {
+    aRecalc.resize(n);
+    for(size_t j=0; j<n; ++j) {
+      aRecalc[j] = j;
+    }
+    return;
+  }
+
+  aJ.clear();
+  for(size_t j=0; j<n; ++j) {
+    if(reuse[j]) {
+      const std::vector<std::pair<int, double> > &entries = reuse[j]->mEntries;
+      for(size_t k=0; k<entries.size(); ++k) {
+        std::map<int, int>::const_iterator row = index.find(entries[k].first);
+        if(row != index.end()) {
+          aJ(row->second, j) = entries[k].second * aFXScale[row->second] * aXScale[j];
+        }
+      }
+    }
+  }
+  mNumReused += n - aRecalc.size();
+  mNumRecalc += aRecalc.size();
+}
+
+/*!
+ * \brief Save a Jacobian in the cache, replacing the columns already stored for these markets.
+ * \param aMarketIDs Market ids of the columns (and rows) of aJ.
+ * \param aLogPrice Whether the columns of aJ are with respect to log price.
+ * \param aXScale Scale of each input of aJ's function.
+ * \param aFXScale Scale of each output of aJ's function.
+ * \param aPeriod Current model period.
+ * \param aJ The Jacobian to save.
+ * \param aCalculated Flags for the columns that were calculated by finite
+ *        differences in this period; the other columns keep their age.
+ */
+void JacobianCache::store(const std::vector<int> &aMarketIDs, const bool aLogPrice, const UBVECTOR &aXScale,
+                          const UBVECTOR &aFXScale, const int aPeriod, const UBMATRIX &aJ,
+                          const std::vector<bool> &aCalculated)
+{
+  std::vector<int>* sortedIDs = new std::vector<int>(aMarketIDs);
+  std::sort(sortedIDs->begin(), sortedIDs->end());
+  boost::shared_ptr<const std::vector<int> > rows(sortedIDs);
+
+  for(size_t j=0; j<aMarketIDs.size(); ++j) {
+    std::pair<std::map<ColumnKey, Column>::iterator, bool> ins =
+        mColumns.insert(std::make_pair(ColumnKey(aLogPrice, aMarketIDs[j]), Column()));
+    Column &col = ins.first->second;
+    if(ins.second || aCalculated[j]) {
+      col.mPeriod = aPeriod;
+      col.mStale = false;
+    }
+    col.mRows = rows;
+
+    double colmax = 0.0;
+    for(size_t i=0; i<aJ.size1(); ++i) {
+      colmax = std::max(colmax, std::fabs(aJ(i,j)));
+    }
+    col.mEntries.clear();
+    for(size_t i=0; i<aJ.size1(); ++i) {
+      if(std::fabs(aJ(i,j)) > DROP_TOLERANCE * colmax) {
+        col.mEntries.push_back(std::make_pair(aMarketIDs[i], aJ(i,j) / (aFXScale[i] * aXScale[j])));
+      }
+    }
+  }
+}
+
+/*!
+ * \brief Mark the columns for the given markets as needing recalculation.
+ * \param aMarketIDs Market ids of the columns.
+ * \param aLogPrice Whether the columns are with respect to log price.
+ */
+void JacobianCache::markStale(const std::vector<int> &aMarketIDs, const bool aLogPrice)
+{
+  for(size_t j=0; j<aMarketIDs.size(); ++j) {
+    std::map<ColumnKey, Column>::iterator col = mColumns.find(ColumnKey(aLogPrice, aMarketIDs[j]));
+    if(col != mColumns.end()) {
+      col->second.mStale = true;
+    }
+  }
+}
+
+//! Remove all of the stored columns.
+void JacobianCache::clear()
+{
+  mColumns.clear();
+}
+
+/*!
+ * \brief Identify the columns of a Jacobian approximation that failed to predict the last step.
+ * \details The secant error of each row, e = aFStep - aB . aStep, is taken
+ *          relative to the size of the actual and predicted changes, giving
+ *          a value between zero and one.  Each row's relative error is
+ *          shared among the columns in proportion to their contribution
+ *          |B(i,j) * aStep(j)| to the predicted change.  A row whose
+ *          prediction was missing altogether has nothing to share, so each
+ *          column is also charged the error of its own market's row, scaled
+ *          by how far that market's price moved relative to the largest
+ *          price change.  Columns charged more than aTolerance are reported.
+ * \param aB Jacobian approximation used to take the step.
+ * \param aStep The step taken in x.
+ * \param aFStep The resulting change in F(x).
+ * \param aTolerance Relative error, between zero and one, above which a column is stale.
+ * \param aStale Indices of the stale columns (output).
+ */
+void JacobianCache::findStaleColumns(const UBMATRIX &aB, const UBVECTOR &aStep, const UBVECTOR &aFStep,
+                                     const double aTolerance, std::vector<int> &aStale)
+{
+  const double TINY = 1.0e-20;
+  const size_t n = aStep.size();
+  double stepmax = 0.0;
+  for(size_t j=0; j<n; ++j) {
+    stepmax = std::max(stepmax, std::fabs(aStep[j]));
+  }
+
+  std::vector<double> score(n, 0.0);
+  for(size_t i=0; i<n; ++i) {
+    double pred = 0.0;
+    double total = 0.0;
+    for(size_t j=0; j<n; ++j) {
+      pred += aB(i,j) * aStep[j];
+      total += std::fabs(aB(i,j) * aStep[j]);
+    }
+    double relerr = std::fabs(aFStep[i] - pred) / (std::fabs(aFStep[i]) + std::fabs(pred) + TINY);
+    if(total > 0.0) {
+      for(size_t j=0; j<n; ++j) {
+        score[j] = std::max(score[j], relerr * std::fabs(aB(i,j) * aStep[j]) / total);
+      }
+    }
+    if(stepmax > 0.0) {
+      score[i] = std::max(score[i], relerr * std::fabs(aStep[i]) / stepmax);
+    }
+  }
+
+  aStale.clear();
+  for(size_t j=0; j<n; ++j) {
+    if(score[j] > aTolerance) {
+      aStale.push_back(j);
+    }
+  }
+}
+
+//! Count columns recalculated because findStaleColumns reported them.
+void JacobianCache::countStaleRefresh(const int aNumColumns)
+{
+  mNumStaleRefresh += aNumColumns;
+}
+
+//! Count a complete finite-difference Jacobian calculated in place of the cache.
+void JacobianCache::countFullRefresh()
+{
+  ++mNumFullRefresh;
+}
+
+/*!
+ * \brief Write the running totals of cache activity.
+ * \param aOut Stream to write to.
+ */
+void JacobianCache::printCounters(std::ostream &aOut) const
+{
+  aOut << "Jacobian cache: " << mColumns.size() << " columns stored, "
+       << mNumReused << " reused, " << mNumRecalc << " recalculated on retrieval, "
+       << mNumStaleRefresh << " stale columns refreshed, "
+       << mNumFullRefresh << " full Jacobians calculated\n";
+}
@@ -0,0 +1,624 @@
+
+/*
+* LEGAL NOTICE
+* This computer software was prepared by Battelle Memorial Institute,
+* hereinafter the Contractor, under Contract No. DE-AC05-76RL0 1830
+* with the Department of Energy (DOE). NEITHER THE GOVERNMENT NOR THE
+* CONTRACTOR MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR ASSUMES ANY
+* LIABILITY FOR THE USE OF THIS SOFTWARE. This notice including this
+* sentence must appear on any copies of this computer software.
+* 
+* EXPORT CONTROL
+* User agrees that the Software will not be shipped, transferred or
+* exported into any country or used in any manner prohibited by the
+* United States Export Administration Act or any other applicable
+* export laws, restrictions or regulations (collectively the "Export Laws").
+* Export of the Software may require some form of license or other
+* authority from the U.S. Government, and failure to obtain such
+* export control license may result in criminal liability under
+* U.S. laws. In addition, if the Software is identified as export controlled
+* items under the Export Laws, User represents and warrants that User
+* is not a citizen, or otherwise located within, an embargoed nation
+* (including without limitation Iran, Syria, Sudan, Cuba, and North Korea)
+*     and that User is not otherwise prohibited
+* under the Export Laws from receiving the Software.
+* 
+* Copyright 2011 Battelle Memorial Institute.  All Rights Reserved.
+* Distributed as open-source under the terms of the Educational Community 
+* License version 2.0 (ECL 2.0). http://www.opensource.org/licenses/ecl2.php
+* 
+* For further details, see: http://www.globalchange.umd.edu/models/gcam/
+*
+*/
+
+/*!
+ * \file linear_solver.cpp
+ * \ingroup Solution
+ * \brief Dense LU, sparse LU, and GMRES backends for the Newton-type solvers.
+ */
+
+#include <cmath>
+#include <algorithm>
+#include <boost/numeric/ublas/lu.hpp>
+
+#include "solution/util/include/linear_solver.hpp"
+
+namespace ublas = boost::numeric::ublas;
+
+#define UBVECTOR boost::numeric::ublas::vector<double>
+
+const int LinearSolver::MAX_UPDATES = 50;
+
+/*!
+ * \brief Create the backend with the given name.
+ * \param aName Name of the backend.
+ * \return A new backend which the caller owns, or null if the name is not recognized.
+ */
+LinearSolver* LinearSolver::create(const std::string &aName)
+{
+  if(aName == DenseLUSolver::getNameStatic()) {
+    return new DenseLUSolver();
+  }
+  else if(aName == SparseLUSolver::getNameStatic()) {
+    return new SparseLUSolver();
+  }
+  else if(aName == GMRESSolver::getNameStatic()) {
+    return new GMRESSolver();
+  }
+  return 0;
+}
+
+/*!
+ * \brief Factor a new matrix, discarding any rank-1 updates.
+ * \param aJ The matrix, which must be square.
+ * \return 0 on success, or k+1 if the factorization broke down at column k.
+ */
+int LinearSolver::factor(const CSRMatrix<double> &aJ)
+{
+  mUpdateJinvU.clear();
+  mUpdateV.clear();
+  mUpdateBeta.clear();
+  return factorBase(aJ);
+}
+
+/*!
+ * \brief Solve J . x = b, where J is the factored matrix plus any updates.
+ * \details Each update J_{k+1} = J_k + u_k v_k^T is applied with
+ *          J_{k+1}^-1 b = J_k^-1 b - J_k^-1 u_k (v_k . J_k^-1 b) / (1 + v_k . J_k^-1 u_k).
+ * \param aRHS On input b; on output x.
+ * \return Whether the solve succeeded.
+ */
+bool LinearSolver::solve(UBVECTOR &aRHS) const
+{
+  if(!solveBase(aRHS)) {
+    return false;
+  }
+  for(size_t k=0; k<mUpdateBeta.size(); ++k) {
+    aRHS -= (ublas::inner_prod(mUpdateV[k], aRHS) / mUpdateBeta[k]) * mUpdateJinvU[k];
+  }
+  return true;
+}
+
+/*!
+ * \brief Apply the rank-1 update J += u v^T to the factorization.
+ * \details Costs one solve.
+ * \return false if the update could not be applied, either because the
+ *         updated matrix would be singular or because MAX_UPDATES have
+ *         already been applied; the caller should refactor.
+ */
+bool LinearSolver::update(const UBVECTOR &aU, const UBVECTOR &aV)
+{
+  if(getNumUpdates() >= MAX_UPDATES) {
+    return false;
+  }
+  UBVECTOR jinvu(aU);
+  if(!solve(jinvu)) {
+    return false;
+  }
+  const double beta = 1.0 + ublas::inner_prod(aV, jinvu);
+  if(!(fabs(beta) > 1.0e-10)) {
+    return false;
+  }
+  mUpdateJinvU.push_back(jinvu);
+  mUpdateV.push_back(aV);
+  mUpdateBeta.push_back(beta);
+  return true;
+}
+
+
+const std::string& DenseLUSolver::getNameStatic()
+{
+  static const std::string NAME = "dense-lu";
+  return NAME;
+}
+
+int DenseLUSolver::factorBase(const CSRMatrix<double> &aJ)
+{
+  const int n = aJ.mNumRows;
+  mLU.resize(n, n, false);
+  mLU.clear();
+  for(int i=0; i<n; ++i) {
+    for(int p=aJ.mRowStart[i]; p<aJ.mRowStart[i+1]; ++p) {
+      mLU(i, aJ.mColumn[p]) = aJ.mValue[p];
+    }
+  }
+  ublas::permutation_matrix<size_t> perm(n);
+  int sing = ublas::lu_factorize(mLU, perm);
+  mPermutation.assign(perm.begin(), perm.end());
+  return sing;
+}
+
+bool DenseLUSolver::solveBase(UBVECTOR &aRHS) const
+{
+  ublas::permutation_matrix<size_t> perm(mPermutation.size());
+  std::copy(mPermutation.begin(), mPermutation.end(), perm.begin());
+  try {
+    ublas::lu_substitute(mLU, perm, aRHS);
+  }
+  catch(const ublas::singular &err) {
+    return false;
+  }
+  catch(const ublas::internal_logic &err) {
+    // Thrown when the matrix is ill-conditioned.  As in the solvers
+    // themselves, we keep the result and let the solver muddle through.
+  }
+  return true;
+}
+
+
+const double SparseLUSolver::PIVOT_TOLERANCE = 0.1;
+
+namespace {
+  //! Number of bits set in aWords[0..aNumWords-1]
+  int popcount(const unsigned long long* aWords, const int aNumWords)
+  {
+    int count = 0;
+    for(int w=0; w<aNumWords; ++w) {
+      for(unsigned long long bits = aWords[w]; bits; bits &= bits-1) {
+        ++count;
+      }
+    }
+    return count;
+  }
+}
+
+const std::string& SparseLUSolver::getNameStatic()
+{
+  static const std::string NAME = "sparse-lu";
+  return NAME;
+}
+
+/*!
+ * \brief Order the columns of aJ by minimum degree on the graph of J + J^T.
+ * \details The elimination graph is kept as a dense bit matrix, which is
+ *          small at the sizes we solve and makes forming each clique cheap.
+ */
+void SparseLUSolver::minimumDegreeOrder(const CSRMatrix<double> &aJ, std::vector<int> &aOrder)
+{
+  typedef unsigned long long Word;
+  const int WORDBITS = 64;
+  const int n = aJ.mNumRows;
+  const int nword = (n + WORDBITS - 1) / WORDBITS;
+  std::vector<Word> graph(size_t(n) * nword, 0);
+  for(int i=0; i<n; ++i) {
+    for(int p=aJ.mRowStart[i]; p<aJ.mRowStart[i+1]; ++p) {
+      const int j = aJ.mColumn[p];
+      if(i != j) {
+        graph[size_t(i)*nword + j/WORDBITS] |= Word(1) << (j%WORDBITS);
+        graph[size_t(j)*nword + i/WORDBITS] |= Word(1) << (i%WORDBITS);
+      }
+    }
+  }
+  std::vector<int> degree(n);
+  for(int i=0; i<n; ++i) {
+    degree[i] = popcount(&graph[size_t(i)*nword], nword);
+  }
+
+  std::vector<bool> eliminated(n, false);
+  std::vector<int> nbrs;
+  aOrder.resize(n);
+  for(int k=0; k<n; ++k) {
+    int v = -1;
+    for(int i=0; i<n; ++i) {
+      if(!eliminated[i] && (v < 0 || degree[i] < degree[v])) {
+        v = i;
+      }
+    }
+    aOrder[k] = v;
+    eliminated[v] = true;
+
+    // the neighbors of v become a clique, and v leaves the graph
+    Word* vrow = &graph[size_t(v)*nword];
+    nbrs.clear();
+    for(int j=0; j<n; ++j) {
+      if(vrow[j/WORDBITS] & (Word(1) << (j%WORDBITS))) {
+        nbrs.push_back(j);
+      }
+    }
+    for(size_t a=0; a<nbrs.size(); ++a) {
+      const int u = nbrs[a];
+      Word* urow = &graph[size_t(u)*nword];
+      for(int w=0; w<nword; ++w) {
+        urow[w] |= vrow[w];
+      }
+      urow[u/WORDBITS] &= ~(Word(1) << (u%WORDBITS));
+      urow[v/WORDBITS] &= ~(Word(1) << (v%WORDBITS));
+      degree[u] = popcount(urow, nword);
+    }
+    std::fill(vrow, vrow+nword, Word(0));
+  }
+}
+
+int SparseLUSolver::factorBase(const CSRMatrix<double> &aJ)
+{
+  const int n = aJ.mNumRows;
+  mSize = n;
+
+  // The factorization works column by column, so transpose to compressed columns.
+  std::vector<int> colStart(n+1, 0);
+  for(size_t p=0; p<aJ.mColumn.size(); ++p) {
+    ++colStart[aJ.mColumn[p]+1];
+  }
+  for(int j=0; j<n; ++j) {
+    colStart[j+1] += colStart[j];
+  }
+  std::vector<int> rowIdx(aJ.mColumn.size());
+  std::vector<double> val(aJ.mColumn.size());
+  std::vector<int> next(colStart.begin(), colStart.end()-1);
+  for(int i=0; i<n; ++i) {
+    for(int p=aJ.mRowStart[i]; p<aJ.mRowStart[i+1]; ++p) {
+      const int q = next[aJ.mColumn[p]]++;
+      rowIdx[q] = i;
+      val[q] = aJ.mValue[p];
+    }
+  }
+
+  mLStart.assign(n+1, 0);
+  mUStart.assign(n+1, 0);
+  mLRow.clear();
+  mLValue.clear();
+  mURow.clear();
+  mUValue.clear();
+  mRowPivot.assign(n, -1);
+
+  std::vector<double> x(n, 0.0);          // dense work column
+  std::vector<int> reach(n);              // rows reached, in topological order from top
+  std::vector<int> stack(n), stackPos(n);
+  std::vector<int> mark(n, -1);           // column being factored when the row was last reached
+
+  minimumDegreeOrder(aJ, mColumnOrder);
+
+  for(int k=0; k<n; ++k) {
+    mLStart[k] = mLRow.size();
+    mUStart[k] = mURow.size();
+    const int col = mColumnOrder[k];
+
+    // Find the rows reachable from A(:,col) through the columns of L found so far.
+    int top = n;
+    for(int p=colStart[col]; p<colStart[col+1]; ++p) {
+      if(mark[rowIdx[p]] == k) {
+        continue;
+      }
+      int head = 0;
+      stack[0] = rowIdx[p];
+      while(head >= 0) {
+        const int i = stack[head];
+        const int lcol = mRowPivot[i];
+        if(mark[i] != k) {
+          mark[i] = k;
+          stackPos[head] = lcol < 0 ? 0 : mLStart[lcol]+1;
+        }
+        bool done = true;
+        if(lcol >= 0) {
+          for(int q=stackPos[head]; q<mLStart[lcol+1]; ++q) {
+            const int r = mLRow[q];
+            if(mark[r] != k) {
+              stackPos[head] = q+1;
+              stack[++head] = r;
+              done = false;
+              break;
+            }
+          }
+        }
+        if(done) {
+          --head;
+          reach[--top] = i;
+        }
+      }
+    }
+
+    // x = L \ A(:,col) on the reached rows
+    for(int p=top; p<n; ++p) {
+      x[reach[p]] = 0.0;
+    }
+    for(int p=colStart[col]; p<colStart[col+1]; ++p) {
+      x[rowIdx[p]] = val[p];
+    }
+    for(int p=top; p<n; ++p) {
+      const int i = reach[p];
+      const int lcol = mRowPivot[i];
+      if(lcol < 0) {
+        continue;
+      }
+      const double xi = x[i];
+      for(int q=mLStart[lcol]+1; q<mLStart[lcol+1]; ++q) {
+        x[mLRow[q]] -= mLValue[q] * xi;
+      }
+    }
+
+    // Split into U(:,k) and candidates for the pivot.
+    int pivotRow = -1;
+    double pivotMag = -1.0;
+    for(int p=top; p<n; ++p) {
+      const int i = reach[p];
+      if(mRowPivot[i] < 0) {
+        if(fabs(x[i]) > pivotMag) {
+          pivotMag = fabs(x[i]);
+          pivotRow = i;
+        }
+      }
+      else {
+        mURow.push_back(mRowPivot[i]);
+        mUValue.push_back(x[i]);
+      }
+    }
+    if(pivotRow < 0 || pivotMag <= 0.0) {
+      mSize = 0;
+      return k+1;
+    }
+    if(mRowPivot[col] < 0 && mark[col] == k && fabs(x[col]) >= PIVOT_TOLERANCE * pivotMag) {
+      pivotRow = col;
+    }
+    const double pivot = x[pivotRow];
+    mURow.push_back(k);
+    mUValue.push_back(pivot);
+    mRowPivot[pivotRow] = k;
+    mLRow.push_back(pivotRow);
+    mLValue.push_back(1.0);
+    for(int p=top; p<n; ++p) {
+      const int i = reach[p];
+      if(mRowPivot[i] < 0) {
+        mLRow.push_back(i);
+        mLValue.push_back(x[i] / pivot);
+      }
+      x[i] = 0.0;
+    }
+  }
+  mLStart[n] = mLRow.size();
+  mUStart[n] = mURow.size();
+
+  // renumber the rows of L into pivot order
+  for(size_t p=0; p<mLRow.size(); ++p) {
+    mLRow[p] = mRowPivot[mLRow[p]];
+  }
+  return 0;
+}
+
+bool SparseLUSolver::solveBase(UBVECTOR &aRHS) const
+{
+  const int n = mSize;
+  if(n != int(aRHS.size())) {
+    // the last factorization failed
+    return false;
+  }
+  UBVECTOR y(n);
+  for(int i=0; i<n; ++i) {
+    y[mRowPivot[i]] = aRHS[i];
+  }
+  for(int j=0; j<n; ++j) {
+    const double yj = y[j];
+    for(int p=mLStart[j]+1; p<mLStart[j+1]; ++p) {
+      y[mLRow[p]] -= mLValue[p] * yj;
+    }
+  }
+  for(int j=n-1; j>=0; --j) {
+    y[j] /= mUValue[mUStart[j+1]-1];
+    const double yj = y[j];
+    for(int p=mUStart[j]; p<mUStart[j+1]-1; ++p) {
+      y[mURow[p]] -= mUValue[p] * yj;
+    }
+  }
+  for(int k=0; k<n; ++k) {
+    aRHS[mColumnOrder[k]] = y[k];
+  }
+  return true;
+}
+
+
+const int GMRESSolver::RESTART = 30;
+const int GMRESSolver::MAX_ITERATIONS = 300;
+const double GMRESSolver::TOLERANCE = 1.0e-10;
+
+GMRESSolver::GMRESSolver():
+mHasPreconditioner(false),
+mFallbackFactored(false)
+{
+}
+
+const std::string& GMRESSolver::getNameStatic()
+{
+  static const std::string NAME = "gmres";
+  return NAME;
+}
+
+/*!
+ * \brief Store the matrix and compute its ILU(0) preconditioner.
+ * \details Nothing can fail here: if an ILU(0) pivot vanishes GMRES runs
+ *          without a preconditioner, and a singular matrix shows up as a
+ *          failure of the dense fallback.
+ */
+int GMRESSolver::factorBase(const CSRMatrix<double> &aJ)
+{
+  mMatrix = aJ;
+  mFallbackFactored = false;
+  const int n = mMatrix.mNumRows;
+
+  mILU = mMatrix.mValue;
+  mDiagonal.assign(n, -1);
+  for(int i=0; i<n; ++i) {
+    for(int p=mMatrix.mRowStart[i]; p<mMatrix.mRowStart[i+1]; ++p) {
+      if(mMatrix.mColumn[p] == i) {
+        mDiagonal[i] = p;
+      }
+    }
+  }
+
+  mHasPreconditioner = true;
+  std::vector<int> pos(n, -1);
+  for(int i=0; i<n && mHasPreconditioner; ++i) {
+    for(int p=mMatrix.mRowStart[i]; p<mMatrix.mRowStart[i+1]; ++p) {
+      pos[mMatrix.mColumn[p]] = p;
+    }
+    for(int p=mMatrix.mRowStart[i]; p<mMatrix.mRowStart[i+1] && mMatrix.mColumn[p] < i; ++p) {
+      const int k = mMatrix.mColumn[p];
+      if(mDiagonal[k] < 0 || mILU[mDiagonal[k]] == 0.0) {
+        mHasPreconditioner = false;
+        break;
+      }
+      mILU[p] /= mILU[mDiagonal[k]];
+      for(int q=mDiagonal[k]+1; q<mMatrix.mRowStart[k+1]; ++q) {
+        if(pos[mMatrix.mColumn[q]] >= 0) {
+          mILU[pos[mMatrix.mColumn[q]]] -= mILU[p] * mILU[q];
+        }
+      }
+    }
+    for(int p=mMatrix.mRowStart[i]; p<mMatrix.mRowStart[i+1]; ++p) {
+      pos[mMatrix.mColumn[p]] = -1;
+    }
+    if(mDiagonal[i] < 0 || mILU[mDiagonal[i]] == 0.0) {
+      mHasPreconditioner = false;
+    }
+  }
+  return 0;
+}
+
+//! Apply the ILU(0) preconditioner in place.
+void GMRESSolver::precondition(UBVECTOR &aVec) const
+{
+  if(!mHasPreconditioner) {
+    return;
+  }
+  const int n = mMatrix.mNumRows;
+  for(int i=0; i<n; ++i) {
+    for(int p=mMatrix.mRowStart[i]; p<mDiagonal[i]; ++p) {
+      aVec[i] -= mILU[p] * aVec[mMatrix.mColumn[p]];
+    }
+  }
+  for(int i=n-1; i>=0; --i) {
+    for(int p=mDiagonal[i]+1; p<mMatrix.mRowStart[i+1]; ++p) {
+      aVec[i] -= mILU[p] * aVec[mMatrix.mColumn[p]];
+    }
+    aVec[i] /= mILU[mDiagonal[i]];
+  }
+}
+
+void GMRESSolver::multiply(const UBVECTOR &aVec, UBVECTOR &aResult) const
+{
+  for(int i=0; i<mMatrix.mNumRows; ++i) {
+    double sum = 0.0;
+    for(int p=mMatrix.mRowStart[i]; p<mMatrix.mRowStart[i+1]; ++p) {
+      sum += mMatrix.mValue[p] * aVec[mMatrix.mColumn[p]];
+    }
+    aResult[i] = sum;
+  }
+}
+
+/*!
+ * \brief Solve with right-preconditioned restarted GMRES, falling back to a
+ *        dense LU if it does not converge.
+ */
+bool GMRESSolver::solveBase(UBVECTOR &aRHS) const
+{
+  const int n = mMatrix.mNumRows;
+  const double bnorm = ublas::norm_2(aRHS);
+  if(bnorm == 0.0) {
+    return true;
+  }
+  const double target = TOLERANCE * bnorm;
+
+  UBVECTOR x = ublas::zero_vector<double>(n);
+  UBVECTOR r(aRHS);
+  UBVECTOR w(n), z(n);
+  std::vector<UBVECTOR> v(RESTART+1, UBVECTOR(n));
+  ublas::matrix<double> h(RESTART+1, RESTART);
+  std::vector<double> cs(RESTART), sn(RESTART), g(RESTART+1);
+  double rnorm = bnorm;
+  int iter = 0;
+  while(iter < MAX_ITERATIONS && rnorm > target) {
+    v[0] = r / rnorm;
+    std::fill(g.begin(), g.end(), 0.0);
+    g[0] = rnorm;
+    int m = 0;
+    while(m < RESTART && iter < MAX_ITERATIONS) {
+      z = v[m];
+      precondition(z);
+      multiply(z, w);
+      // modified Gram-Schmidt
+      for(int i=0; i<=m; ++i) {
+        h(i,m) = ublas::inner_prod(w, v[i]);
+        w -= h(i,m) * v[i];
+      }
+      h(m+1,m) = ublas::norm_2(w);
+      if(h(m+1,m) != 0.0) {
+        v[m+1] = w / h(m+1,m);
+      }
+      // apply the previous rotations to the new column, then eliminate h(m+1,m)
+      for(int i=0; i<m; ++i) {
+        const double t = cs[i]*h(i,m) + sn[i]*h(i+1,m);
+        h(i+1,m) = -sn[i]*h(i,m) + cs[i]*h(i+1,m);
+        h(i,m) = t;
+      }
+      const double d = sqrt(h(m,m)*h(m,m) + h(m+1,m)*h(m+1,m));
+      if(d == 0.0) {
+        break;
+      }
+      cs[m] = h(m,m) / d;
+      sn[m] = h(m+1,m) / d;
+      h(m,m) = d;
+      h(m+1,m) = 0.0;
+      g[m+1] = -sn[m]*g[m];
+      g[m] *= cs[m];
+      ++m;
+      ++iter;
+      if(fabs(g[m]) <= target) {
+        break;
+      }
+    }
+    if(m == 0) {
+      break;
+    }
+    // back substitution for the Krylov coefficients
+    std::vector<double> y(m);
+    for(int i=m-1; i>=0; --i) {
+      double sum = g[i];
+      for(int j=i+1; j<m; ++j) {
+        sum -= h(i,j) * y[j];
+      }
+      y[i] = sum / h(i,i);
+    }
+    z = ublas::zero_vector<double>(n);
+    for(int i=0; i<m; ++i) {
+      z += y[i] * v[i];
+    }
+    precondition(z);
+    x += z;
+    // recompute the true residual
+    multiply(x, w);
+    r = aRHS - w;
+    rnorm = ublas::norm_2(r);
+  }
+
+  if(rnorm <= target) {
+    aRHS = x;
+    return true;
+  }
+
+  // GMRES stalled; solve directly.
+  if(!mFallbackFactored) {
+    if(mFallback.factor(mMatrix) != 0) {
+      return false;
+    }
+    mFallbackFactored = true;
+  }
+  return mFallback.solve(aRHS);
+}
@@ -70,6 +70,10 @@ private:
     //! The name of the target gas.
     std::string mTargetGas;
 
+    //! The index of the target gas in the climate model, -1 if the climate
+    //! model must be queried by name.
+    int mTargetGasIndex;
+
     //! The climate model.
     const IClimateModel* mClimateModel;
 
@@ -79,5 +83,7 @@ private:
     //! The first policy year which would be the first valid year to check
     //! getStatus in.
     const int mFirstTaxYear;
+
+    double getConcentration( const int aYear ) const;
 };
 #endif // _CONCENTRATION_TARGET_H_
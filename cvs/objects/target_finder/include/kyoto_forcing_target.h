@@ -46,6 +46,7 @@
 
 #include "target_finder/include/itarget.h"
 #include <string>
+#include <vector>
 
 class IClimateModel;
 
@@ -74,6 +75,10 @@ private:
     //! The first policy year which would be the first valid year to check
     //! getStatus in.
     const int mFirstTaxYear;
+
+    //! The index of each Kyoto gas in the climate model, -1 for gasses which
+    //! must be queried by name.
+    std::vector<int> mKyotoGasIndices;
     
     double calcKyotoForcing( const int aYear ) const;
 };
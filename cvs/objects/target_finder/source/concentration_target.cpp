@@ -68,6 +68,7 @@ mFirstTaxYear( aFirstTaxYear )
     // Store configuration variables.
     const Configuration* conf = Configuration::getInstance();
     mTargetGas = conf->getString( "concentration-target-gas", "CO2" );
+    mTargetGasIndex = mClimateModel->getGasIndex( mTargetGas );
 }
 
 /*! \brief Return the static name of the object.
@@ -94,7 +95,7 @@ double ConcentrationTarget::getStatus( const int aYear ) const
      *      ability to change the status in that year.
      */
     assert( year >= mFirstTaxYear );
-    const double currConcentration = mClimateModel->getConcentration( mTargetGas, year );
+    const double currConcentration = getConcentration( year );
 
     // Determine how how far away from the target the current estimate is.
     double percentOff = ( currConcentration - mTargetValue ) / mTargetValue * 100;
@@ -121,10 +122,22 @@ int ConcentrationTarget::getYearOfMaxTargetValue() const {
     
     // Loop over possible year and find the max concentration and the year it occurs in.
     for( int year = mFirstTaxYear; year <= finalYearToCheck; ++year ) {
-        if( maxConc < mClimateModel->getConcentration( mTargetGas, year ) ) {
-            maxConc = mClimateModel->getConcentration( mTargetGas, year );
+        const double conc = getConcentration( year );
+        if( maxConc < conc ) {
+            maxConc = conc;
             maxYear = year;
         }
     }
     return maxYear;
 }
+
+/*!
+ * \brief Get the concentration of the target gas, by index if the climate
+ *        model supports it.
+ * \param aYear The year in which to get the concentration.
+ * \return The concentration of the target gas in the given year.
+ */
+double ConcentrationTarget::getConcentration( const int aYear ) const {
+    return mTargetGasIndex != -1 ? mClimateModel->getConcentrationByIndex( mTargetGasIndex, aYear )
+        : mClimateModel->getConcentration( mTargetGas, aYear );
+}
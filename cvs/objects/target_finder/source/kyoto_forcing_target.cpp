@@ -51,6 +51,12 @@ using namespace std;
 
 extern Scenario* scenario;
 
+namespace {
+    // The gasses which make up the Kyoto forcing.
+    const char* KYOTO_GASES[] = { "CO2", "CH4", "N2O", "HCFC125", "HCFC134A", "HCFC143A",
+                                  "HFC227ea", "HCFC245fa", "SF6", "CF4", "C2F6", "OtherHC" };
+}
+
 /*!
  * \brief Constructor
  * \param aClimateModel The climate model.
@@ -64,6 +70,9 @@ mClimateModel( aClimateModel ),
 mTargetValue( aTargetValue ),
 mFirstTaxYear( aFirstTaxYear )
 {
+    for( const char* gas : KYOTO_GASES ) {
+        mKyotoGasIndices.push_back( mClimateModel->getGasIndex( gas ) );
+    }
 }
 
 /*! \brief Return the static name of the object.
@@ -130,16 +139,10 @@ double KyotoForcingTarget::calcKyotoForcing( const int aYear ) const {
      */
     assert( aYear != ITarget::getUseMaxTargetYearFlag() );
     
-    return mClimateModel->getForcing( "CO2", aYear )
-        + mClimateModel->getForcing( "CH4", aYear )
-        + mClimateModel->getForcing( "N2O", aYear )
-        + mClimateModel->getForcing( "HCFC125", aYear )
-        + mClimateModel->getForcing( "HCFC134A", aYear )
-        + mClimateModel->getForcing( "HCFC143A", aYear )
-        + mClimateModel->getForcing( "HFC227ea", aYear )
-        + mClimateModel->getForcing( "HCFC245fa", aYear )
-        + mClimateModel->getForcing( "SF6", aYear )
-        + mClimateModel->getForcing( "CF4", aYear )
-        + mClimateModel->getForcing( "C2F6", aYear )
-        + mClimateModel->getForcing( "OtherHC", aYear );
+    double kyotoForcing = 0;
+    for( size_t i = 0; i < mKyotoGasIndices.size(); ++i ) {
+        kyotoForcing += mKyotoGasIndices[ i ] != -1 ? mClimateModel->getForcingByIndex( mKyotoGasIndices[ i ], aYear )
+            : mClimateModel->getForcing( KYOTO_GASES[ i ], aYear );
+    }
+    return kyotoForcing;
 }
@@ -78,6 +78,8 @@ public:
     
     void setPartialDeriv( const bool aIsPartialDeriv );
     
+    void setSharedPartialDeriv();
+    
 #if GCAM_PARALLEL_ENABLED
     //! A tbb task arena which is the closest tbb comes to a thread pool which we
     //! will insist parallel calculations use so that we can ensure that we have
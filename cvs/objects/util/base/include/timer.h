@@ -121,6 +121,12 @@ public:
     Timer& getTimer( const PredefinedTimers aTimerName );
     
     void printAllTimers( std::ostream& aOut ) const;
+    
+    std::map<std::string, double> getAllTimes() const;
+    
+    void addToCounter( const std::string& aCounterName, const double aAmount );
+    
+    const std::map<std::string, double>& getAllCounters() const;
 private:
     //! Private constructor to prevent multiple registries
     TimerRegistry();
@@ -134,6 +140,11 @@ private:
     
     //! A map for named timers.
     std::map<std::string, Timer> mNamedTimers;
+    
+    //! A map for named counters such as the number of items processed.
+    std::map<std::string, double> mNamedCounters;
+    
+    static std::string getPredefinedTimerName( const int aTimer );
 };
 
 #endif // _TIMER_H_
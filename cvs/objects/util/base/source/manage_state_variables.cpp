@@ -284,6 +284,21 @@ void ManageStateVariables::setPartialDeriv( const bool aIsPartialDeriv ) {
 #endif
 }
 
+/*!
+ * \brief Set up the Value classes static references so that every thread uses
+ *        the same "scratch" space.
+ * \details This allows a single partial derivative to be calculated by several
+ *          threads at once, for instance with the TBB flow graph.  Only one such
+ *          partial derivative may be calculated at a time.
+ */
+void ManageStateVariables::setSharedPartialDeriv() {
+#if !GCAM_PARALLEL_ENABLED
+    Value::sCentralValue = mStateData[ 1 ];
+#else
+    Value::sCentralValue = Value::CentralValueType( mStateData[ 1 ] );
+#endif
+}
+
 /*!
  * \brief Generate the appropriate restart file name to use.
  * \details This method will append the model period this instance was created
@@ -155,57 +155,90 @@ Timer& TimerRegistry::getTimer( const string& aTimerName ) {
     return mNamedTimers[ aTimerName ];
 }
 
+/*!
+ * \brief Get the label to use for a predefined timer.
+ * \param aTimer The predefined timer.
+ * \return The label for the timer.
+ */
+string TimerRegistry::getPredefinedTimerName( const int aTimer ) {
+    switch( aTimer ) {
+        case FULLSCENARIO:
+            return "Full Scenario";
+        case BISECT:
+            return "Bisection solver";
+        case SOLVER:
+            return "Broyden Solver";
+        case JACOBIAN:
+            return "Jacobian calcs";
+        case EVAL_PART:
+            return "Partial function evaluations";
+        case EVAL_FULL:
+            return "Full function evaluations";
+        case JAC_PRE:
+            return "Jacobian Preconditioner (overlaps with Jacobian)";
+        case JAC_PRE_JAC:
+            return "Jacobian Preconditioner Jacobian overlap";
+        case EDFUN_MISC:
+            return "EDFUN miscellaneous";
+        case EDFUN_PRE:
+            return "EDFUN before world->calc";
+        case EDFUN_POST:
+            return "EDFUN after world->calc";
+        case EDFUN_AN_RESET:
+            return "EDFUN affected nodes reset";
+        case WRITE_DATA:
+            return "Write data";
+        default:
+            return "Predefined timer";
+    }
+}
+
 /*!
  * \brief Have all registered timers print their current times using their names
  *        as a label.
  */
 void TimerRegistry::printAllTimers( ostream& aOut ) const {
     for( int timer = 0; timer < END; ++timer ) {
-        string timerName;
-        switch( timer ) {
-            case FULLSCENARIO:
-                timerName = "Full Scenario";
-                break;
-            case BISECT:
-                timerName = "Bisection solver";
-                break;
-            case SOLVER:
-                timerName = "Broyden Solver";
-                break;
-            case JACOBIAN:
-                timerName = "Jacobian calcs";
-                break;
-            case EVAL_PART:
-                timerName = "Partial function evaluations";
-                break;
-            case EVAL_FULL:
-                timerName = "Full function evaluations";
-                break;
-            case JAC_PRE:
-                timerName = "Jacobian Preconditioner (overlaps with Jacobian)";
-                break;
-            case JAC_PRE_JAC:
-                timerName = "Jacobian Preconditioner Jacobian overlap";
-                break;
-            case EDFUN_MISC:
-                timerName = "EDFUN miscellaneous";
-                break;
-            case EDFUN_PRE:
-                timerName = "EDFUN before world->calc";
-                break;
-            case EDFUN_POST:
-                timerName = "EDFUN after world->calc";
-                break;
-            case EDFUN_AN_RESET:
-                timerName = "EDFUN affected nodes reset";
-                break;
-                
-            default: timerName = "Predefined timer";
-        }
-        mPredefinedTimers[ timer ].print( aOut, timerName );
+        mPredefinedTimers[ timer ].print( aOut, getPredefinedTimerName( timer ) );
     }
     
     for( map<string, Timer>::const_iterator it = mNamedTimers.begin(); it != mNamedTimers.end(); ++it ) {
         (*it).second.print( aOut, (*it).first );
     }
 }
+
+/*!
+ * \brief Get the total time measured so far by all registered timers.
+ * \details Predefined timers are labeled the same way as in printAllTimers.  Time
+ *          on a timer which is currently running is not included.
+ * \return A map of timer label to the total time in seconds.
+ */
+map<string, double> TimerRegistry::getAllTimes() const {
+    map<string, double> times;
+    for( int timer = 0; timer < END; ++timer ) {
+        times[ getPredefinedTimerName( timer ) ] = mPredefinedTimers[ timer ].getTotalTimeDifference();
+    }
+    for( map<string, Timer>::const_iterator it = mNamedTimers.begin(); it != mNamedTimers.end(); ++it ) {
+        times[ (*it).first ] = (*it).second.getTotalTimeDifference();
+    }
+    return times;
+}
+
+/*!
+ * \brief Add to a named counter, creating it if it does not already exist.
+ * \details Like the named timers this is meant for convenience and is not safe to
+ *          call from multiple threads at once.
+ * \param aCounterName The name of the counter.
+ * \param aAmount The amount to add.
+ */
+void TimerRegistry::addToCounter( const string& aCounterName, const double aAmount ) {
+    mNamedCounters[ aCounterName ] += aAmount;
+}
+
+/*!
+ * \brief Get the running totals of all named counters.
+ * \return A map of counter name to total.
+ */
+const map<string, double>& TimerRegistry::getAllCounters() const {
+    return mNamedCounters;
+}
@@ -54,6 +54,7 @@
 
 #if GCAM_PARALLEL_ENABLED
 #include <tbb/spin_mutex.h>
+#include <tbb/enumerable_thread_specific.h>
 #endif
 
 // Forward definition of the Logger class.
@@ -66,6 +67,8 @@ class Tabs;
 * 
 * This is a very simple class which contains a pointer to its parent Logger.
 * When the streambuf receives a character it passes it to its parent stream for processing.
+* Strings written to the stream are passed along in a single call through xsputn
+* rather than one character at a time.
 *
 * \author Josh Lurz
 * \warning Overriding the iostream class is somewhat difficult so this class may be somewhat esoteric.
@@ -78,6 +81,7 @@ class PassToParentStreamBuf: std::streambuf {
 public:
     PassToParentStreamBuf();
     int overflow( int ch );
+    std::streamsize xsputn( const char* aString, std::streamsize aCount );
     int underflow( int ch );
     void setParent( Logger* parentIn );
     void toDebugXML( std::ostream& out ) const;
@@ -112,6 +116,7 @@ public:
     virtual ~Logger(); //!< Virtual destructor.
     virtual void open( const char[] = 0 ) = 0; //!< Pure virtual function called to begin logging.
     int receiveCharFromUnderStream( int ch ); //!< Pure virtual function called to complete the log and clean up.
+    void receiveCharsFromUnderStream( const char* aString, std::streamsize aCount ); //!< Receive a block of characters from the underlying stream.
     virtual void close() = 0;
     ILogger::WarningLevel setLevel( const ILogger::WarningLevel newLevel );
     bool wouldPrint(ILogger::WarningLevel aLevel) const;
@@ -148,16 +153,20 @@ protected:
     static void parseHeader( std::string& aHeader );
     static const std::string& convertLevelToString( ILogger::WarningLevel aLevel );
 private:
-	 //! Buffer which contains characters waiting to be printed.
-    std::stringstream mBuf;
 #if GCAM_PARALLEL_ENABLED
-    tbb::spin_mutex mMutex;  //<! mutex protecting mBuf
+	 //! Per thread buffers which contain characters waiting to be printed.
+    tbb::enumerable_thread_specific<std::string> mLineBuffers;
+    tbb::spin_mutex mMutex;  //<! mutex protecting the output of complete lines
+#else
+	 //! Buffer which contains characters waiting to be printed.
+    std::string mLineBuffer;
 #endif
 
 	 //! Underlying ofstream
     PassToParentStreamBuf mUnderStream;
 
     void XMLParse( const xercesc::DOMNode* node );
+    void updateStreamState();
     static const std::string getTimeString();
     static const std::string getDateString();
 };
@@ -45,6 +45,7 @@
 #include <iostream>
 #include <sstream>
 #include <cassert>
+#include <cstring>
 #include <ctime>
 #include <xercesc/dom/DOMNode.hpp>
 #include <xercesc/dom/DOMNodeList.hpp>
@@ -66,6 +67,14 @@ int PassToParentStreamBuf::overflow( int aChar ){
 	return mParent->receiveCharFromUnderStream( aChar );
 }
 
+//! Overriding xsputn function which passes a block of characters to its parent at once.
+streamsize PassToParentStreamBuf::xsputn( const char* aString, streamsize aCount ){
+	/*! \pre Make sure the parent is not null. */
+	assert( mParent );
+	mParent->receiveCharsFromUnderStream( aString, aCount );
+	return aCount;
+}
+
 //! Overriding underflow function which should not be reached because this is a write-only stream.
 int PassToParentStreamBuf::underflow( int aChar ){
 	/*! \pre This function should never be called. */
@@ -103,6 +112,7 @@ ILogger::WarningLevel Logger::setLevel( const ILogger::WarningLevel aLevel ){
     // doesn't actually solve the race condition.
     ILogger::WarningLevel oldLevel = mCurrentWarningLevel;
     mCurrentWarningLevel = aLevel;
+    updateStreamState();
     return oldLevel;
 }
 
@@ -115,31 +125,67 @@ bool Logger::wouldPrint(ILogger::WarningLevel aLevel) const
     return aLevel >= mMinLogWarningLevel || aLevel >= mMinToScreenWarningLevel;
 }
 
+/*! \brief Set the badbit on the stream while the current level would not print.
+ *  \details The sentry of every ostream insertion checks the stream state, so
+ *           messages which would be thrown away are never formatted. Skipped
+ *           insertions also set the failbit so the state is fully reset once
+ *           the level would print again.
+ */
+void Logger::updateStreamState() {
+    if( wouldPrint( mCurrentWarningLevel ) ){
+        clear();
+    }
+    else {
+        setstate( ios_base::badbit );
+    }
+}
+
 //! Receive a single character from the underlying stream and buffer it, printing the buffer it is a newline.
 int Logger::receiveCharFromUnderStream( int ch ) {
-    // Only receive the character or print to the screen if it needed.
-    if( mCurrentWarningLevel >= mMinLogWarningLevel || mCurrentWarningLevel >= mMinToScreenWarningLevel ){
-        // only really need to lock the mutex if we're going to do something.
+    if( ch != EOF ){
+        const char c = static_cast<char>( ch );
+        receiveCharsFromUnderStream( &c, 1 );
+    }
+    return ch;
+}
+
+/*! \brief Receive a block of characters from the underlying stream and buffer
+ *         them, printing each complete line.
+ *  \details Lines are assembled in a buffer local to the calling thread so
+ *           that concurrent writers do not interleave within a line, and the
+ *           mutex is only taken once a line is complete.
+ */
+void Logger::receiveCharsFromUnderStream( const char* aString, streamsize aCount ) {
+    // Only receive the characters or print to the screen if it needed.
+    if( !wouldPrint( mCurrentWarningLevel ) ){
+        return;
+    }
 #if GCAM_PARALLEL_ENABLED
-        tbb::spin_mutex::scoped_lock lck( mMutex );
+    string& lineBuffer = mLineBuffers.local();
+#else
+    string& lineBuffer = mLineBuffer;
 #endif
-        if( ch == '\n' ){
-            string tempString( mBuf.str() );
-            logCompleteMessage( tempString );
-            printToScreenIfConfigured( tempString );
-
-            // reset the stringstream buffer
-            mBuf.clear();       // Clear error flags, if any.
-            mBuf.str(std::string()); // clear out the data in the buffer.
-       }
-        else {
-            // The functions that perform the output will add the
-            // newline, so we only want to insert non-newline
-            // characters.
-            mBuf << ( char )ch;
+    const char* end = aString + aCount;
+    while( aString != end ){
+        const char* newline = static_cast<const char*>( memchr( aString, '\n', end - aString ) );
+        if( !newline ){
+            lineBuffer.append( aString, end );
+            break;
         }
+        // The functions that perform the output will add the
+        // newline, so we only want to insert non-newline
+        // characters.
+        lineBuffer.append( aString, newline );
+        {
+#if GCAM_PARALLEL_ENABLED
+            tbb::spin_mutex::scoped_lock lck( mMutex );
+#endif
+            logCompleteMessage( lineBuffer );
+            printToScreenIfConfigured( lineBuffer );
+        }
+        lineBuffer.clear();
+        aString = newline + 1;
     }
-    return ch;
 }
 
 //! Print the message to the screen if the Logger is configured to.
@@ -185,6 +231,7 @@ void Logger::XMLParse( const DOMNode* aNode ){
 			mHeaderMessage = XMLHelper<string>::getValue( curr );
 		}
 	}
+	updateStreamState();
 }
 
 void Logger::toDebugXML( ostream& out, Tabs* tabs ) const {
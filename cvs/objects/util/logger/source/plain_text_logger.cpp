@@ -81,6 +81,8 @@ void PlainTextLogger::logCompleteMessage( const string& aMessage ){
         if ( mPrintLogWarningLevel || mCurrentWarningLevel >= ILogger::ERROR ) {
             mLogFile << convertLevelToString( mCurrentWarningLevel ) << ":";
         }
+        // Write each line out as it completes so the end of the log is not lost
+        // if the model aborts or crashes.
         mLogFile << aMessage << endl;
     }
 }
@@ -83,15 +83,16 @@ void XMLLogger::logCompleteMessage( const string& aMessage ){
 	// Decide whether to print the message
 	if ( mCurrentWarningLevel >= mMinLogWarningLevel ){
 		// Print the opening log tag.
-		mLogFile << "\t<LogEntry>" << endl;
+		mLogFile << "\t<LogEntry>\n";
 		
 		// Print the warning level
-		mLogFile << "\t\t<WarningLevel>" << convertLevelToString( mCurrentWarningLevel ) << "</WarningLevel>" << endl;
+		mLogFile << "\t\t<WarningLevel>" << convertLevelToString( mCurrentWarningLevel ) << "</WarningLevel>\n";
 
 		// Print the message
-		mLogFile << "\t\t<Message>" << aMessage << "</Message>" << endl;
+		mLogFile << "\t\t<Message>" << aMessage << "</Message>\n";
 
-		// Print the closing tag.
+		// Print the closing tag, writing the entry out so it is not lost if the
+		// model aborts or crashes.
 		mLogFile << "\t</LogEntry>" << endl;
 	}
 }